@@ -1,17 +1,26 @@
 /*
  * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
  */
+#define _GNU_SOURCE // For pthread_setaffinity_np()
 
 #include "ucg_context.h"
 #include "ucg_global.h"
 #include "ucg_request.h"
+#include "ucg_group.h"
 #include "ucg_plan.h"
 
 #include "planc/ucg_planc.h"
 #include "util/ucg_helper.h"
 #include "util/ucg_malloc.h"
 #include "util/ucg_parser.h"
+#include "util/ucg_math.h"
 #include "util/ucg_cpu.h"
+#include "util/ucg_time.h"
+
+#include <poll.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
 
 
 #define UCG_CONTEXT_COPY_REQUIRED_FIELD(_field, _copy, _dst, _src, _err_label) \
@@ -34,6 +43,110 @@ static ucg_config_field_t ucg_context_config_table[] = {
      " - n      : use spinlock by default",
      ucg_offsetof(ucg_config_t, use_mt_mutex), UCG_CONFIG_TYPE_BOOL},
 
+    {"OP_CACHE_SIZE", "8",
+     "Maximum number of completed operations kept by each group for reuse. An\n"
+     "operation is reused by the next one with the same collective type, count,\n"
+     "datatype, reduction op, root, memory type and in-place flag. 0 disables it",
+     ucg_offsetof(ucg_config_t, op_cache_size), UCG_CONFIG_TYPE_UINT},
+
+    {"SHARE_PLANS", "y",
+     "Share the plans between the groups with the same size, number of nodes and\n"
+     "processes per node and socket, whose planc groups report the same plans tag.\n"
+     "The plans are built once by the first group instead of every group, which\n"
+     "saves the time and the memory of creating many groups of the same shape",
+     ucg_offsetof(ucg_config_t, share_plans), UCG_CONFIG_TYPE_BOOL},
+
+    {"TUNE_BUDGET", "0",
+     "Number of timed runs of each candidate plan before each group pins the\n"
+     "fastest plan for a collective type and message size. The candidates are\n"
+     "the plans that serve the size, the first run of each one is not timed.\n"
+     "The members agree on the plans when the requests start, so all members must\n"
+     "start the requests of a group in the same order.\n"
+     "0 disables it, the plan with the highest score is used",
+     ucg_offsetof(ucg_config_t, tune_budget), UCG_CONFIG_TYPE_UINT},
+
+    {"TUNE_OUTPUT", "",
+     "File that rank 0 of each group appends the tuned plans to, in the format of\n"
+     "the tuning file read by ucg_config_read(). Empty means not persisted",
+     ucg_offsetof(ucg_config_t, tune_output), UCG_CONFIG_TYPE_STRING},
+
+    {"COST_MODEL", "n",
+     "Select the plan with the smallest estimated completion time among the plans\n"
+     "that serve the message size. The estimate is based on the group topology and\n"
+     "the COST_* calibration. Plans that are not modeled or given score by the\n"
+     "plan attribute or the tuning file keep the score order",
+     ucg_offsetof(ucg_config_t, use_cost_model), UCG_CONFIG_TYPE_BOOL},
+
+    {"COST_SOCKET_LATENCY", "0.3us",
+     "Latency between processes in the same socket, used by the cost model",
+     ucg_offsetof(ucg_config_t, cost_model.links[UCG_PLAN_COST_LEVEL_SOCKET].latency),
+     UCG_CONFIG_TYPE_TIME},
+
+    {"COST_SOCKET_BANDWIDTH", "20GBs",
+     "Bandwidth between processes in the same socket, used by the cost model",
+     ucg_offsetof(ucg_config_t, cost_model.links[UCG_PLAN_COST_LEVEL_SOCKET].bandwidth),
+     UCG_CONFIG_TYPE_BW},
+
+    {"COST_NODE_LATENCY", "0.6us",
+     "Latency between processes in different sockets of a node, used by the cost model",
+     ucg_offsetof(ucg_config_t, cost_model.links[UCG_PLAN_COST_LEVEL_NODE].latency),
+     UCG_CONFIG_TYPE_TIME},
+
+    {"COST_NODE_BANDWIDTH", "10GBs",
+     "Bandwidth between processes in different sockets of a node, used by the cost model",
+     ucg_offsetof(ucg_config_t, cost_model.links[UCG_PLAN_COST_LEVEL_NODE].bandwidth),
+     UCG_CONFIG_TYPE_BW},
+
+    {"COST_NET_LATENCY", "2us",
+     "Latency between processes in different nodes, used by the cost model",
+     ucg_offsetof(ucg_config_t, cost_model.links[UCG_PLAN_COST_LEVEL_NET].latency),
+     UCG_CONFIG_TYPE_TIME},
+
+    {"COST_NET_BANDWIDTH", "10GBs",
+     "Bandwidth between processes in different nodes, used by the cost model",
+     ucg_offsetof(ucg_config_t, cost_model.links[UCG_PLAN_COST_LEVEL_NET].bandwidth),
+     UCG_CONFIG_TYPE_BW},
+
+    {"COST_REDUCE_BANDWIDTH", "8GBs",
+     "Bytes reduced per second by a process, used by the cost model",
+     ucg_offsetof(ucg_config_t, cost_model.reduce_bandwidth), UCG_CONFIG_TYPE_BW},
+
+    {"WAIT_SPIN_TIME", "100us",
+     "Time that ucg_request_wait() progresses the request in a busy loop before it\n"
+     "sleeps until the network has new events",
+     ucg_offsetof(ucg_config_t, wait_spin_time), UCG_CONFIG_TYPE_TIME},
+
+    {"WAIT_BLOCK_TIMEOUT", "1ms",
+     "Maximum time of each sleep of ucg_request_wait(), which bounds the delay of\n"
+     "the events that are not notified. It's rounded up to milliseconds",
+     ucg_offsetof(ucg_config_t, wait_block_timeout), UCG_CONFIG_TYPE_TIME},
+
+    {"PROGRESS_THREAD", "n",
+     "Start a thread that progresses the collectives in the background, so that the\n"
+     "started requests advance while the application computes. The context becomes\n"
+     "multi-thread internally even if the thread mode is single. It's ignored if\n"
+     "UCG is built without multi-thread support",
+     ucg_offsetof(ucg_config_t, progress_thread), UCG_CONFIG_TYPE_BOOL},
+
+    {"PROGRESS_THREAD_CPU", "-1",
+     "CPU that the progress thread is bound to, negative value leaves it unbound",
+     ucg_offsetof(ucg_config_t, progress_thread_cpu), UCG_CONFIG_TYPE_INT},
+
+    {"PROGRESS_THREAD_SPIN_TIME", "100us",
+     "Time that the progress thread polls without events before it sleeps until the\n"
+     "network has new events or UCG_WAIT_BLOCK_TIMEOUT expires. \"inf\" keeps the\n"
+     "thread polling, 0 makes it sleep whenever it's idle",
+     ucg_offsetof(ucg_config_t, progress_thread_spin_time), UCG_CONFIG_TYPE_TIME},
+
+    {"LAZY_ADDRESS", "try",
+     "Exchange only the locations of the processes during initialization and look up\n"
+     "the address of a process in the OOB key-value store when it's first needed.\n"
+     "It saves the memory and the initialization time of large jobs\n"
+     " - yes    : fetch the addresses lazily, fail if the key-value store is not provided\n"
+     " - no     : allgather the addresses of all processes\n"
+     " - try    : fetch the addresses lazily if the key-value store is provided",
+     ucg_offsetof(ucg_config_t, lazy_address), UCG_CONFIG_TYPE_TERNARY},
+
     {NULL},
 };
 UCG_CONFIG_REGISTER_TABLE(ucg_context_config_table, "UCG context", NULL,
@@ -142,6 +255,14 @@ static ucg_status_t ucg_context_apply_params(ucg_context_t *context,
                                     context->thread_mode, params->thread_mode,
                                     UCG_THREAD_MODE_SINGLE, err);
 
+    if (field_mask & UCG_PARAMS_FIELD_OOB_KVS) {
+        if (params->oob_kvs.publish == NULL || params->oob_kvs.lookup == NULL) {
+            ucg_error("Invalid OOB key-value store.");
+            goto err;
+        }
+        context->oob_kvs = params->oob_kvs;
+    }
+
     if (context->thread_mode == UCG_THREAD_MODE_MULTI) {
 #ifndef UCG_ENABLE_MT
         ucg_error("UCG is built without multi-thread support.");
@@ -176,6 +297,7 @@ static void ucg_context_free_resource_planc(ucg_context_t *context)
         ucg_resource_planc_t *rsc = &context->planc_rscs[i];
         rsc->planc->context_cleanup(rsc->ctx);
     }
+    ucg_free(context->wait_fds);
     ucg_free(context->planc_rscs);
     return;
 }
@@ -193,6 +315,11 @@ static ucg_status_t ucg_context_fill_resource_planc(ucg_context_t *context,
     if (context->planc_rscs == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
+    context->wait_fds = ucg_calloc(count, sizeof(struct pollfd), "ucg wait fds");
+    if (context->wait_fds == NULL) {
+        ucg_free(context->planc_rscs);
+        return UCG_ERR_NO_MEMORY;
+    }
 
     ucg_planc_params_t params = {
         .context = context,
@@ -227,6 +354,9 @@ err_free_resource:
 
 static void ucg_context_free_resource_mt(ucg_context_t *context)
 {
+    ucg_lock_destroy(&context->wait_lock);
+    ucg_lock_destroy(&context->procs_lock);
+    ucg_lock_destroy(&context->glist_lock);
     ucg_lock_destroy(&context->mt_lock);
     return;
 }
@@ -234,12 +364,14 @@ static void ucg_context_free_resource_mt(ucg_context_t *context)
 static ucg_status_t ucg_context_fill_resource_mt(ucg_context_t *context,
                                                  const ucg_config_t *config)
 {
-    ucg_lock_type_t lock_type = UCG_LOCK_TYPE_NONE;
+    ucg_status_t status;
+    ucg_lock_type_t mt_lock_type = UCG_LOCK_TYPE_NONE;
+    context->lock_type = UCG_LOCK_TYPE_NONE;
     if (context->thread_mode != UCG_THREAD_MODE_MULTI) {
         goto lock_init;
     }
 
-    ucg_status_t status;
+    context->lock_type = config->use_mt_mutex ? UCG_LOCK_TYPE_MUTEX : UCG_LOCK_TYPE_SPINLOCK;
     ucg_planc_context_attr_t attr = {
         .field_mask = UCG_PLANC_CONTEXT_ATTR_FIELD_THREAD_MODE,
     };
@@ -252,13 +384,60 @@ static ucg_status_t ucg_context_fill_resource_mt(ucg_context_t *context,
         status = rsc->planc->context_query(rsc->ctx, &attr);
         if (status != UCG_OK || attr.thread_mode == UCG_THREAD_MODE_SINGLE) {
             ucg_debug("There's a non-thread-safe planc, using context lock.");
-            lock_type = config->use_mt_mutex ? UCG_LOCK_TYPE_MUTEX : UCG_LOCK_TYPE_SPINLOCK;
+            mt_lock_type = context->lock_type;
             break;
         }
     }
 
 lock_init:
-    return ucg_lock_init(&context->mt_lock, lock_type);
+    status = ucg_lock_init(&context->mt_lock, mt_lock_type);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    status = ucg_lock_init(&context->glist_lock, context->lock_type);
+    if (status != UCG_OK) {
+        goto err_destroy_mt_lock;
+    }
+
+    status = ucg_lock_init(&context->procs_lock, context->lock_type);
+    if (status != UCG_OK) {
+        goto err_destroy_glist_lock;
+    }
+
+    status = ucg_lock_init(&context->wait_lock, context->lock_type);
+    if (status != UCG_OK) {
+        goto err_destroy_procs_lock;
+    }
+    return UCG_OK;
+
+err_destroy_procs_lock:
+    ucg_lock_destroy(&context->procs_lock);
+err_destroy_glist_lock:
+    ucg_lock_destroy(&context->glist_lock);
+err_destroy_mt_lock:
+    ucg_lock_destroy(&context->mt_lock);
+    return status;
+}
+
+static void ucg_context_query_req_id_window(ucg_context_t *context)
+{
+    uint32_t req_id_bits = 32;
+    ucg_planc_context_attr_t attr = {
+        .field_mask = UCG_PLANC_CONTEXT_ATTR_FIELD_REQ_ID_BITS,
+    };
+    for (int i = 0; i < context->num_planc_rscs; ++i) {
+        ucg_resource_planc_t *rsc = &context->planc_rscs[i];
+        /* The planc that doesn't report it carries the whole id. */
+        attr.req_id_bits = 32;
+        ucg_status_t status = rsc->planc->context_query(rsc->ctx, &attr);
+        if (status == UCG_OK && attr.req_id_bits < req_id_bits) {
+            req_id_bits = attr.req_id_bits;
+        }
+    }
+    context->req_id_window = (req_id_bits >= 32) ? UINT32_MAX : UCG_BIT(req_id_bits);
+    ucg_debug("request id window %u", context->req_id_window);
+    return;
 }
 
 static void ucg_context_free_resource(ucg_context_t *context)
@@ -282,6 +461,8 @@ static ucg_status_t ucg_context_fill_resource(ucg_context_t *context,
         goto err_free_resource_planc;
     }
 
+    ucg_context_query_req_id_window(context);
+
     return UCG_OK;
 
 err_free_resource_planc:
@@ -384,57 +565,460 @@ out:
     return status;
 }
 
-static ucg_status_t ucg_context_fill_procs(ucg_context_t *context)
+/* The processes of a node are stored as the difference from the first one. */
+static ucg_status_t ucg_context_fill_proc_store(ucg_context_t *context,
+                                                const uint8_t *procs, uint32_t stride)
 {
-    ucg_status_t status;
+    ucg_proc_info_array_t *proc_array = &context->procs;
+    uint32_t count = proc_array->count;
+    int32_t nnode = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const ucg_location_t *location = &proc_array->locations[i];
+        if (location->field_mask & UCG_LOCATION_FIELD_NODE_ID) {
+            nnode = ucg_max(nnode, location->node_id + 1);
+        }
+    }
 
-    ucg_proc_info_t *local_proc = ucg_context_get_local_proc_info(context);
-    if (local_proc == NULL) {
-        return UCG_ERR_NO_RESOURCE;
+    uint32_t *node_base = NULL;
+    if (nnode > 0) {
+        node_base = ucg_malloc(nnode * sizeof(uint32_t), "proc store node base");
+        if (node_base == NULL) {
+            return UCG_ERR_NO_MEMORY;
+        }
+        for (int32_t i = 0; i < nnode; ++i) {
+            node_base[i] = UCG_PROC_STORE_NO_BASE;
+        }
+    }
+
+    ucg_status_t status = ucg_proc_store_init(&proc_array->store, count);
+    if (status != UCG_OK) {
+        goto out;
     }
+    for (uint32_t i = 0; i < count; ++i) {
+        const ucg_proc_info_t *proc = (const ucg_proc_info_t*)(procs + (uint64_t)i * stride);
+        const ucg_location_t *location = &proc_array->locations[i];
+        uint32_t *base = NULL;
+        if ((location->field_mask & UCG_LOCATION_FIELD_NODE_ID) && location->node_id >= 0) {
+            base = &node_base[location->node_id];
+        }
+        status = ucg_proc_store_add(&proc_array->store, proc, proc->size,
+                                    base != NULL ? *base : UCG_PROC_STORE_NO_BASE);
+        if (status != UCG_OK) {
+            goto out;
+        }
+        if (base != NULL && *base == UCG_PROC_STORE_NO_BASE) {
+            *base = i;
+        }
+    }
+
+out:
+    if (node_base != NULL) {
+        ucg_free(node_base);
+    }
+    return status;
+}
 
+static ucg_status_t ucg_context_fill_procs_full(ucg_context_t *context,
+                                                const ucg_proc_info_t *local_proc)
+{
     uint32_t max_proc_info_size;
-    status = ucg_context_get_max_size(context, local_proc->size, &max_proc_info_size);
+    ucg_status_t status = ucg_context_get_max_size(context, local_proc->size,
+                                                   &max_proc_info_size);
     if (status != UCG_OK) {
-        goto err_free_local_proc;
+        return status;
     }
 
     ucg_assert(max_proc_info_size > 0);
     ucg_oob_group_t *oob_group = &context->oob_group;
-    ucg_proc_info_t *procs = ucg_malloc(max_proc_info_size * (oob_group->size + 1), "procs");
+    uint8_t *procs = ucg_malloc(max_proc_info_size * (oob_group->size + 1), "procs");
     if (procs == NULL) {
-        status = UCG_ERR_NO_MEMORY;
-        goto err_free_local_proc;
+        return UCG_ERR_NO_MEMORY;
     }
     /* local_proc->size may less than max_proc_info_size, using the last space
        to save local process information to avoid memory read out-of-bound. */
-    ucg_proc_info_t *tmp_local_proc = (ucg_proc_info_t*)((uint8_t*)procs + max_proc_info_size * oob_group->size);
+    ucg_proc_info_t *tmp_local_proc = (ucg_proc_info_t*)(procs + max_proc_info_size * oob_group->size);
     memcpy(tmp_local_proc, local_proc, local_proc->size);
     status = oob_group->allgather(tmp_local_proc, procs, max_proc_info_size,
                                   oob_group->group);
     if (status != UCG_OK) {
         ucg_error("Failed to allgather proc info");
+        goto out;
+    }
+
+    for (uint32_t i = 0; i < oob_group->size; ++i) {
+        const ucg_proc_info_t *proc = (const ucg_proc_info_t*)(procs + i * max_proc_info_size);
+        context->procs.locations[i] = proc->location;
+    }
+    /* The padded array is only kept during the exchange. */
+    status = ucg_context_fill_proc_store(context, procs, max_proc_info_size);
+    if (status != UCG_OK) {
+        goto out;
+    }
+    ucg_debug("Allgathered proc info, %lu bytes padded, %lu bytes stored",
+              (uint64_t)max_proc_info_size * oob_group->size,
+              ucg_proc_store_memory(&context->procs.store));
+
+out:
+    ucg_free(procs);
+    return status;
+}
+
+static ucg_status_t ucg_context_fill_procs_lazy(ucg_context_t *context,
+                                                const ucg_proc_info_t *local_proc)
+{
+    ucg_oob_kvs_t *oob_kvs = &context->oob_kvs;
+    ucg_status_t status = oob_kvs->publish(local_proc, local_proc->size, oob_kvs->arg);
+    if (status != UCG_OK) {
+        ucg_error("Failed to publish proc info");
+        return status;
+    }
+
+    /* The topology needs all locations, they are small and fixed-size. */
+    ucg_oob_group_t *oob_group = &context->oob_group;
+    status = oob_group->allgather(&local_proc->location, context->procs.locations,
+                                  sizeof(ucg_location_t), oob_group->group);
+    if (status != UCG_OK) {
+        ucg_error("Failed to allgather proc location");
+    }
+    return status;
+}
+
+static void ucg_context_free_procs(ucg_context_t *context)
+{
+    ucg_proc_info_array_t *procs = &context->procs;
+    if (procs->info != NULL) {
+        for (uint32_t i = 0; i < procs->count; ++i) {
+            ucg_free(procs->info[i]);
+        }
+        ucg_free(procs->info);
+        procs->info = NULL;
+    }
+    ucg_free(procs->locations);
+    procs->locations = NULL;
+    ucg_proc_store_cleanup(&procs->store);
+    procs->count = 0;
+    return;
+}
+
+static ucg_status_t ucg_context_fill_procs(ucg_context_t *context,
+                                           const ucg_config_t *config)
+{
+    ucg_status_t status;
+
+    int lazy = 0;
+    if (config->lazy_address != UCG_NO) {
+        if (context->oob_kvs.publish != NULL) {
+            lazy = 1;
+        } else if (config->lazy_address == UCG_YES) {
+            ucg_error("Lazy address requires the OOB key-value store.");
+            return UCG_ERR_INVALID_PARAM;
+        }
+    }
+
+    ucg_proc_info_array_t *procs = &context->procs;
+    procs->count = context->oob_group.size;
+    procs->locations = ucg_malloc(sizeof(ucg_location_t) * procs->count, "proc locations");
+    procs->info = ucg_calloc(procs->count, sizeof(ucg_proc_info_t*), "proc info");
+    if (procs->locations == NULL || procs->info == NULL) {
+        status = UCG_ERR_NO_MEMORY;
+        goto err_free_procs;
+    }
+
+    ucg_proc_info_t *local_proc = ucg_context_get_local_proc_info(context);
+    if (local_proc == NULL) {
+        status = UCG_ERR_NO_RESOURCE;
         goto err_free_procs;
     }
-    ucg_free(local_proc);
+    procs->info[context->oob_group.myrank] = local_proc;
 
-    context->procs.count = oob_group->size;
-    context->procs.stride = max_proc_info_size;
-    context->procs.info = (uint8_t*)procs;
+    uint64_t start = ucg_get_time_ns();
+    if (lazy) {
+        status = ucg_context_fill_procs_lazy(context, local_proc);
+    } else {
+        status = ucg_context_fill_procs_full(context, local_proc);
+    }
+    if (status != UCG_OK) {
+        goto err_free_procs;
+    }
+    ucg_debug("Exchanged proc info of %u processes in %.3f ms, lazy %d", procs->count,
+              (ucg_get_time_ns() - start) / 1e6, lazy);
     return UCG_OK;
 
 err_free_procs:
-    ucg_free(procs);
-err_free_local_proc:
-    ucg_free(local_proc);
+    ucg_context_free_procs(context);
     return status;
 }
 
-static void ucg_context_free_procs(ucg_context_t *context)
+static ucg_proc_info_t* ucg_context_decode_proc_info(ucg_context_t *context,
+                                                     ucg_rank_t rank)
+{
+    uint32_t size = ucg_proc_store_size(&context->procs.store, rank);
+    ucg_proc_info_t *proc = ucg_malloc(size, "decoded proc");
+    if (proc == NULL) {
+        ucg_error("Failed to allocate %u bytes", size);
+        return NULL;
+    }
+    ucg_proc_store_get(&context->procs.store, rank, proc);
+    return proc;
+}
+
+static ucg_proc_info_t* ucg_context_lookup_proc_info(ucg_context_t *context,
+                                                     ucg_rank_t rank)
+{
+    ucg_oob_kvs_t *oob_kvs = &context->oob_kvs;
+    uint32_t size = 0;
+    ucg_status_t status = oob_kvs->lookup(rank, NULL, &size, oob_kvs->arg);
+    if (status != UCG_OK || size < sizeof(ucg_proc_info_t)) {
+        ucg_error("Failed to look up proc info size of rank %d", rank);
+        return NULL;
+    }
+
+    ucg_proc_info_t *proc = ucg_malloc(size, "lazy proc");
+    if (proc == NULL) {
+        ucg_error("Failed to allocate %u bytes", size);
+        return NULL;
+    }
+    status = oob_kvs->lookup(rank, proc, &size, oob_kvs->arg);
+    if (status != UCG_OK || proc->size != size ||
+        proc->num_addr_desc != context->num_planc_rscs) {
+        ucg_error("Failed to look up proc info of rank %d", rank);
+        ucg_free(proc);
+        return NULL;
+    }
+    ucg_debug("Looked up proc info of rank %d, %u bytes", rank, size);
+    return proc;
+}
+
+/* Get the information of a process, it's decoded or looked up when first needed. */
+static ucg_proc_info_t* ucg_context_get_proc_info(ucg_context_t *context, ucg_rank_t rank)
+{
+    ucg_proc_info_t **slot = &context->procs.info[rank];
+    ucg_proc_info_t *proc = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    if (proc != NULL) {
+        return proc;
+    }
+
+    ucg_lock_enter(&context->procs_lock);
+    /* Someone else may have got it. */
+    proc = *slot;
+    if (proc != NULL) {
+        goto out;
+    }
+
+    if (context->procs.store.count > 0) {
+        proc = ucg_context_decode_proc_info(context, rank);
+    } else {
+        proc = ucg_context_lookup_proc_info(context, rank);
+    }
+    if (proc != NULL) {
+        __atomic_store_n(slot, proc, __ATOMIC_RELEASE);
+    }
+
+out:
+    ucg_lock_leave(&context->procs_lock);
+    return proc;
+}
+
+int ucg_context_progress_plancs(ucg_context_t *context)
 {
-    context->procs.count = 0;
-    context->procs.stride = 0;
-    ucg_free(context->procs.info);
+    int num_events = 0;
+    ucg_context_lock(context);
+    for (int i = 0; i < context->num_planc_rscs; ++i) {
+        ucg_resource_planc_t *rsc = &context->planc_rscs[i];
+        if (rsc->planc->context_progress != NULL) {
+            num_events += rsc->planc->context_progress(rsc->ctx);
+        }
+    }
+    ucg_context_unlock(context);
+    return num_events;
+}
+
+/*
+ * Returns the number of completed requests, num_events is that of the plancs and
+ * num_polled counts the progressed groups that still have polled requests.
+ */
+static int ucg_context_progress_events(ucg_context_t *context, int *num_events,
+                                       int *num_polled)
+{
+    ucg_context_lock(context);
+    /* Deliver the completion events, which wake up the event-driven requests. */
+    *num_events = ucg_context_progress_plancs(context);
+    *num_polled = 0;
+
+    int count = 0;
+    ucg_group_t *group = NULL;
+    ucg_lock_enter(&context->glist_lock);
+    ucg_list_for_each(group, &context->glist, list) {
+        /* The group is being progressed by its own thread, don't wait for it. */
+        if (!ucg_lock_try_enter(&group->lock)) {
+            continue;
+        }
+        count += ucg_group_progress(group);
+        *num_polled += !ucg_list_is_empty(&group->plist);
+        ucg_lock_leave(&group->lock);
+    }
+    ucg_lock_leave(&context->glist_lock);
+    ucg_context_unlock(context);
+
+    return count;
+}
+
+static int ucg_context_progress(ucg_context_h context)
+{
+    int num_events;
+    int num_polled;
+    return ucg_context_progress_events(context, &num_events, &num_polled);
+}
+
+ucg_status_t ucg_context_wait(ucg_context_t *context)
+{
+    struct pollfd *fds = context->wait_fds;
+    int nfds = 0;
+    ucg_status_t status = UCG_OK;
+
+    ucg_lock_enter(&context->wait_lock);
+    ucg_context_lock(context);
+    for (int i = 0; i < context->num_planc_rscs; ++i) {
+        ucg_resource_planc_t *rsc = &context->planc_rscs[i];
+        /* Its ops are polled by the waiters. */
+        if (rsc->planc->context_arm == NULL) {
+            continue;
+        }
+        status = rsc->planc->context_arm(rsc->ctx, &fds[nfds].fd);
+        if (status != UCG_OK) {
+            break;
+        }
+        fds[nfds].events = POLLIN;
+        ++nfds;
+    }
+    ucg_context_unlock(context);
+
+    if (status == UCG_OK && nfds == 0) {
+        status = UCG_ERR_UNSUPPORTED;
+    }
+    if (status == UCG_OK) {
+        /* Interrupted or not, the caller progresses again. */
+        poll(fds, nfds, context->wait_block_timeout);
+    }
+    ucg_lock_leave(&context->wait_lock);
+    return status;
+}
+
+/* The rules are applied to the plans of the plancs by name, the others match nothing. */
+static void ucg_context_check_tune_file(const ucg_context_t *context)
+{
+    const ucg_tune_file_t *file = &context->tune_file;
+    for (uint32_t i = 0; i < file->num_rules; ++i) {
+        const ucg_tune_rule_t *rule = &file->rules[i];
+        int found = 0;
+        for (int j = 0; j < context->num_planc_rscs && !found; ++j) {
+            found = !strcmp(rule->planc, context->planc_rscs[j].planc->super.name);
+        }
+        if (!found) {
+            ucg_warn("Tuning rule of %s for unknown planc %s is ignored",
+                     ucg_coll_type_string(rule->coll_type), rule->planc);
+        }
+    }
+    return;
+}
+
+static void ucg_context_progress_thread_config(ucg_context_t *context,
+                                               const ucg_config_t *config)
+{
+    ucg_progress_thread_t *thread = &context->progress_thread;
+    thread->enable = 0;
+    if (config->progress_thread) {
+#ifdef UCG_ENABLE_MT
+        thread->enable = 1;
+        /* The thread calls into the context together with the caller threads. */
+        context->thread_mode = UCG_THREAD_MODE_MULTI;
+#else
+        ucg_warn("UCG is built without multi-thread support, ignore the progress thread.");
+#endif
+    }
+    thread->cpu = config->progress_thread_cpu;
+    /* "inf" doesn't fit in nanoseconds. */
+    if (config->progress_thread_spin_time * 1e9 >= (double)UINT64_MAX) {
+        thread->spin_time = UINT64_MAX;
+    } else {
+        thread->spin_time = (uint64_t)(config->progress_thread_spin_time * 1e9);
+    }
+    return;
+}
+
+static void* ucg_context_progress_thread_func(void *arg)
+{
+    ucg_context_t *context = (ucg_context_t*)arg;
+    ucg_progress_thread_t *thread = &context->progress_thread;
+    uint64_t idle_start = ucg_get_time_ns();
+
+    while (!__atomic_load_n(&thread->stop, __ATOMIC_ACQUIRE)) {
+        int num_events;
+        int num_polled;
+        if (ucg_context_progress_events(context, &num_events, &num_polled) > 0 ||
+            num_events > 0) {
+            idle_start = ucg_get_time_ns();
+            continue;
+        }
+        /* The polled requests complete without events, nothing wakes up the thread. */
+        if (num_polled > 0 || ucg_get_time_ns() - idle_start < thread->spin_time) {
+            continue;
+        }
+
+        ucg_status_t status = ucg_context_wait(context);
+        if (status == UCG_INPROGRESS) {
+            continue;
+        }
+        if (status != UCG_OK) {
+            /* Some planc can't notify the events, nap instead. */
+            usleep(context->wait_block_timeout * 1000);
+        }
+    }
+    return NULL;
+}
+
+static ucg_status_t ucg_context_start_progress_thread(ucg_context_t *context)
+{
+    ucg_progress_thread_t *thread = &context->progress_thread;
+    if (!thread->enable) {
+        return UCG_OK;
+    }
+
+    thread->stop = 0;
+    int ret = pthread_create(&thread->thread, NULL, ucg_context_progress_thread_func,
+                             context);
+    if (ret != 0) {
+        ucg_error("Failed to create progress thread, %s", strerror(ret));
+        return UCG_ERR_NO_RESOURCE;
+    }
+    thread->active = 1;
+
+    if (thread->cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(thread->cpu, &cpuset);
+        ret = pthread_setaffinity_np(thread->thread, sizeof(cpuset), &cpuset);
+        if (ret != 0) {
+            /* Not fatal, the thread still progresses. */
+            ucg_warn("Failed to bind progress thread to cpu %d, %s", thread->cpu,
+                     strerror(ret));
+        }
+    }
+    ucg_debug("Started progress thread of context %p, cpu %d", context, thread->cpu);
+    return UCG_OK;
+}
+
+static void ucg_context_stop_progress_thread(ucg_context_t *context)
+{
+    ucg_progress_thread_t *thread = &context->progress_thread;
+    if (!thread->active) {
+        return;
+    }
+
+    /* The thread exits after its current sleep at most. */
+    __atomic_store_n(&thread->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(thread->thread, NULL);
+    thread->active = 0;
     return;
 }
 
@@ -462,23 +1046,59 @@ static ucg_status_t ucg_context_init_version(uint32_t major_version,
         goto err_free_ctx;
     }
 
+    ucg_context_progress_thread_config(ctx, config);
+
     status = ucg_context_fill_resource(ctx, config);
     if (status != UCG_OK) {
         goto err_free_ctx;
     }
 
-    status = ucg_context_fill_procs(ctx);
+    status = ucg_context_fill_procs(ctx, config);
     if (status != UCG_OK) {
         goto err_free_resource;
     }
-    ucg_list_head_init(&ctx->plist);
+    ucg_list_head_init(&ctx->glist);
+    ucg_list_head_init(&ctx->plans_list);
+    ctx->op_cache_size = config->op_cache_size;
+    ctx->share_plans = config->share_plans;
+    ctx->tune_budget = config->tune_budget;
+    ctx->use_cost_model = config->use_cost_model;
+    ctx->cost_model = config->cost_model;
+    ctx->wait_spin_time = (uint64_t)(config->wait_spin_time * 1e9);
+    /* Round up, so that a short timeout doesn't become busy polling. */
+    ctx->wait_block_timeout = (int)(config->wait_block_timeout * 1e3 + 0.999);
+    if (config->tune_output[0] != '\0') {
+        ctx->tune_output = ucg_strdup(config->tune_output, "tune output");
+        if (ctx->tune_output == NULL) {
+            status = UCG_ERR_NO_MEMORY;
+            goto err_free_procs;
+        }
+    }
 
-    status = ucg_mpool_init(&ctx->meta_op_mp, 0, sizeof(ucg_plan_meta_op_t),
-                            0, UCG_CACHE_LINE_SIZE, UCG_ELEMS_PER_CHUNK,
-                            UINT_MAX, NULL, "meta op mpool");
+    status = ucg_tune_file_copy(&ctx->tune_file, &config->tune_file);
+    if (status != UCG_OK) {
+        goto err_free_tune_output;
+    }
+    ucg_context_check_tune_file(ctx);
+
+    /* The groups of different threads share the pool. */
+    if (ctx->thread_mode == UCG_THREAD_MODE_MULTI) {
+        status = ucg_mpool_init_mt(&ctx->meta_op_mp, 0, sizeof(ucg_plan_meta_op_t),
+                                   0, UCG_CACHE_LINE_SIZE, UCG_ELEMS_PER_CHUNK,
+                                   UINT_MAX, NULL, "meta op mpool");
+    } else {
+        status = ucg_mpool_init(&ctx->meta_op_mp, 0, sizeof(ucg_plan_meta_op_t),
+                                0, UCG_CACHE_LINE_SIZE, UCG_ELEMS_PER_CHUNK,
+                                UINT_MAX, NULL, "meta op mpool");
+    }
     if (status != UCG_OK) {
         ucg_error("Failed to create mpool");
-        goto err_free_procs;
+        goto err_free_tune_file;
+    }
+
+    status = ucg_context_start_progress_thread(ctx);
+    if (status != UCG_OK) {
+        goto err_cleanup_mpool;
     }
 
     ucg_debug("Initialized ucg context %p, oob group size %u, myrank %d, "
@@ -488,6 +1108,14 @@ static ucg_status_t ucg_context_init_version(uint32_t major_version,
     *context = ctx;
     return UCG_OK;
 
+err_cleanup_mpool:
+    ucg_mpool_cleanup(&ctx->meta_op_mp, 1);
+err_free_tune_file:
+    ucg_tune_file_cleanup(&ctx->tune_file);
+err_free_tune_output:
+    if (ctx->tune_output != NULL) {
+        ucg_free(ctx->tune_output);
+    }
 err_free_procs:
     ucg_context_free_procs(ctx);
 err_free_resource:
@@ -497,28 +1125,17 @@ err_free_ctx:
     return status;
 }
 
-static int ucg_context_progress(ucg_context_h context)
-{
-    ucg_context_lock(context);
-    int count = 0;
-    ucg_request_t *req = NULL;
-    ucg_request_t *tmp_req = NULL;
-    ucg_list_for_each_safe(req, tmp_req, &context->plist, list) {
-        ucg_status_t status = ucg_request_test(req);
-        if (status != UCG_INPROGRESS) {
-            ++count;
-        }
-    }
-    ucg_context_unlock(context);
-
-    return count;
-}
-
 static void ucg_context_cleanup(ucg_context_h context)
 {
     UCG_CHECK_NULL_VOID(context);
 
+    /* Stop it first, it uses all the resources below. */
+    ucg_context_stop_progress_thread(context);
     ucg_mpool_cleanup(&context->meta_op_mp, 1);
+    ucg_tune_file_cleanup(&context->tune_file);
+    if (context->tune_output != NULL) {
+        ucg_free(context->tune_output);
+    }
     ucg_context_free_procs(context);
     ucg_context_free_resource(context);
     ucg_free(context);
@@ -532,8 +1149,8 @@ void* ucg_context_get_proc_addr(ucg_context_t *context, ucg_rank_t rank, ucg_pla
     int num_planc_rscs = context->num_planc_rscs;
     for (int i = 0; i < num_planc_rscs; ++i) {
         if (planc == context->planc_rscs[i].planc) {
-            ucg_proc_info_t *proc_info = UCG_PROC_INFO(context, rank);
-            if (UCG_PROC_ADDR_LEN(proc_info, i) == 0) {
+            ucg_proc_info_t *proc_info = ucg_context_get_proc_info(context, rank);
+            if (proc_info == NULL || UCG_PROC_ADDR_LEN(proc_info, i) == 0) {
                 return NULL;
             }
             return UCG_PROC_ADDR(proc_info, i);
@@ -547,8 +1164,7 @@ ucg_status_t ucg_context_get_location(ucg_context_t *context, ucg_rank_t rank,
 {
     ucg_assert(context != NULL && location != NULL);
     ucg_assert(rank != UCG_INVALID_RANK && rank < context->oob_group.size);
-    ucg_proc_info_t *proc = UCG_PROC_INFO(context, rank);
-    *location = proc->location;
+    *location = context->procs.locations[rank];
     return UCG_OK;
 }
 
@@ -559,19 +1175,24 @@ ucg_status_t ucg_config_read(const char *env_prefix, const char *filename,
 
     ucg_status_t status;
 
-    if (filename != NULL) {
-        return UCG_ERR_UNSUPPORTED;
-    }
-
     ucg_config_h cfg = ucg_malloc(sizeof(ucg_config_t), "ucg config");
     if (cfg == NULL) {
         status = UCG_ERR_NO_MEMORY;
         goto err;
     }
 
+    cfg->tune_file.num_rules = 0;
+    cfg->tune_file.rules = NULL;
+    if (filename != NULL) {
+        status = ucg_tune_file_load(&cfg->tune_file, filename);
+        if (status != UCG_OK) {
+            goto err_free_cfg;
+        }
+    }
+
     status = ucg_config_apply_env_prefix(cfg, env_prefix);
     if (status != UCG_OK) {
-        goto err_free_cfg;
+        goto err_free_tune_file;
     }
 
     status = ucg_config_parser_fill_opts(cfg, ucg_context_config_table,
@@ -580,7 +1201,8 @@ ucg_status_t ucg_config_read(const char *env_prefix, const char *filename,
         goto err_free_env_prefix;
     }
 
-    status = ucg_config_read_planc_cfg(cfg, env_prefix, filename);
+    /* The file only holds the rules of the tuning file. */
+    status = ucg_config_read_planc_cfg(cfg, env_prefix, NULL);
     if (status != UCG_OK) {
         goto err_free_opts;
     }
@@ -592,6 +1214,8 @@ err_free_opts:
     ucg_config_parser_release_opts(cfg, ucg_context_config_table);
 err_free_env_prefix:
     ucg_free(cfg->env_prefix);
+err_free_tune_file:
+    ucg_tune_file_cleanup(&cfg->tune_file);
 err_free_cfg:
     ucg_free(cfg);
 err:
@@ -629,6 +1253,7 @@ void ucg_config_release(ucg_config_h config)
     ucg_config_release_planc_cfg(config);
     ucg_config_parser_release_opts(config, ucg_context_config_table);
     ucg_free(config->env_prefix);
+    ucg_tune_file_cleanup(&config->tune_file);
     ucg_free(config);
     return;
 }
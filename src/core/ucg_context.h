@@ -14,10 +14,11 @@
 #include "planc/ucg_planc_def.h"
 
 #include "ucg_def.h"
+#include "ucg_tune_file.h"
+#include "ucg_plan_cost.h"
+#include "ucg_proc_store.h"
 
-/** Get process information */
-#define UCG_PROC_INFO(_context, _rank) \
-    (ucg_proc_info_t*)((_context)->procs.info + (_rank) * (_context)->procs.stride)
+#include <pthread.h>
 
 /** Get address of process */
 #define UCG_PROC_ADDR(_info, _planc_idx) \
@@ -30,6 +31,20 @@ typedef struct ucg_config {
     char *env_prefix;
     ucg_config_names_array_t planc;
     int32_t use_mt_mutex;
+    uint32_t op_cache_size;
+    int32_t share_plans;
+    uint32_t tune_budget;
+    char *tune_output;
+    /* rules read from the file passed to ucg_config_read() */
+    ucg_tune_file_t tune_file;
+    int32_t use_cost_model;
+    ucg_plan_cost_model_t cost_model;
+    double wait_spin_time;
+    double wait_block_timeout;
+    int32_t progress_thread;
+    int progress_thread_cpu;
+    double progress_thread_spin_time;
+    ucg_ternary_auto_value_t lazy_address;
     int32_t num_planc_cfg;
     ucg_planc_config_h *planc_cfg;
 } ucg_config_t;
@@ -63,22 +78,73 @@ typedef struct ucg_proc_info {
 
 typedef struct ucg_proc_info_array {
     uint32_t count;  /* number of process information */
-    uint32_t stride; /* size of process information */
-    uint8_t *info;   /* point to process information array */
+    ucg_location_t *locations; /* locations of all processes */
+    /* information of all processes, empty if looked up lazily */
+    ucg_proc_store_t store;
+    /* decoded or looked up information, NULL if not needed yet */
+    ucg_proc_info_t **info;
 } ucg_proc_info_array_t;
 
+typedef struct ucg_progress_thread {
+    pthread_t thread;
+    int enable; /* whether the thread is configured */
+    int active; /* whether the thread is started */
+    int stop; /* set to ask the thread to exit */
+    int cpu; /* CPU that the thread is bound to, negative if not bound */
+    /* nanoseconds that the thread busy polls without events before sleeping */
+    uint64_t spin_time;
+} ucg_progress_thread_t;
+
 typedef struct ucg_context {
     ucg_proc_info_array_t procs;
     int32_t num_planc_rscs;
     ucg_resource_planc_t *planc_rscs;
-    ucg_list_link_t plist; /* progress list */
+    ucg_list_link_t glist; /* group list, groups tested in every progress */
     ucg_oob_group_t oob_group;
+    /* key-value store for the lazy addresses, publish is NULL if not provided */
+    ucg_oob_kvs_t oob_kvs;
     ucg_get_location_cb_t get_location;
     ucg_thread_mode_t thread_mode;
-    /* Ensure thread-safe of all resources in the context. */
+    /* Serialize the calls into the non-thread-safe plancs, it's the outermost
+       lock and is not used if all plancs are thread-safe. */
     ucg_lock_t mt_lock;
+    /* Type of the locks of the shared states in multi-thread mode */
+    ucg_lock_type_t lock_type;
+    ucg_lock_t glist_lock;
+    /* Serialize the decoding and the lookups of the process information */
+    ucg_lock_t procs_lock;
+    /* Ids of the requests in flight in a group differ by less than it, so that
+       the plancs can tell their messages apart. */
+    uint32_t req_id_window;
     /* pool of @ref ucg_plan_meta_op_t */
     ucg_mpool_t meta_op_mp;
+    /* maximum number of idle ops cached by each group */
+    uint32_t op_cache_size;
+    /* share the plans between the groups with the same @ref ucg_plans_key_t */
+    int32_t share_plans;
+    /* plans shared by the groups, protected by glist_lock */
+    ucg_list_link_t plans_list;
+    /* number of timed samples of each plan when tuning, 0 disables it */
+    uint32_t tune_budget;
+    /* file that the tuned plans are appended to, NULL if not persisted */
+    char *tune_output;
+    /* rules that adjust the builtin plans of plan components */
+    ucg_tune_file_t tune_file;
+    /* select plans by the estimated time instead of the score */
+    int32_t use_cost_model;
+    /* calibration of the cost model */
+    ucg_plan_cost_model_t cost_model;
+    /* nanoseconds that ucg_request_wait() busy polls before sleeping */
+    uint64_t wait_spin_time;
+    /* maximum milliseconds of each sleep of ucg_request_wait() */
+    int wait_block_timeout;
+    /* Serialize the sleeps on wait_fds, the sleeper is woken up by the events of
+       all waiters. */
+    ucg_lock_t wait_lock;
+    /* descriptors of the plancs that can notify the events, num_planc_rscs at most */
+    struct pollfd *wait_fds;
+    /* thread that progresses the context in the background */
+    ucg_progress_thread_t progress_thread;
 } ucg_context_t;
 
 /**
@@ -122,6 +188,30 @@ static inline uint32_t ucg_context_size(ucg_context_t *context)
     return context->oob_group.size;
 }
 
+/**
+ * @brief Progress each planc once to deliver the completion events.
+ *
+ * The events wake up the event-driven requests, which don't progress the
+ * plancs themselves.
+ *
+ * @param [in] context      UCG Context.
+ * @return Number of events delivered.
+ */
+int ucg_context_progress_plancs(ucg_context_t *context);
+
+/**
+ * @brief Sleep until the plancs have new events or the block timeout expires.
+ *
+ * The plancs that can't notify the events are skipped, so the caller must not
+ * wait for the polled requests here.
+ *
+ * @param [in] context      UCG Context.
+ * @retval UCG_OK Woken up or timed out.
+ * @retval UCG_INPROGRESS There are events not progressed yet.
+ * @retval Otherwise No planc can notify the events.
+ */
+ucg_status_t ucg_context_wait(ucg_context_t *context);
+
 static inline void ucg_context_lock(ucg_context_t *context)
 {
     return ucg_lock_enter(&context->mt_lock);
@@ -22,4 +22,12 @@ typedef struct ucg_plan ucg_plan_t;
 
 typedef struct ucg_topo ucg_topo_t;
 
+typedef struct ucg_plan_op ucg_plan_op_t;
+
+typedef struct ucg_request ucg_request_t;
+
+typedef struct ucg_coll_args ucg_coll_args_t;
+
+typedef struct ucg_plan_tuner_bucket ucg_plan_tuner_bucket_t;
+
 #endif
\ No newline at end of file
@@ -17,52 +17,107 @@
 #define UCG_OP_FUNC_MIN(_target, _source) (_target) = (_target) < (_source) ? (_target) : (_source)
 #define UCG_OP_FUNC_SUM(_target, _source) (_target) += (_source)
 #define UCG_OP_FUNC_PROD(_target, _source) (_target) *= (_source)
-#define UCG_OP_FUNC(_type, _dt, _func) \
-    static inline ucg_status_t ucg_op_func_##_type##_##_dt(void *op, \
-                                                           const void *source, \
-                                                           void *target, \
-                                                           int32_t count, \
-                                                           void *dt) \
+
+/* Target attributes of the kernels vectorized by the compiler. */
+#define UCG_OP_ISA_ATTR_scalar
+#define UCG_OP_ISA_ATTR_avx2    __attribute__((target("avx2")))
+#define UCG_OP_ISA_ATTR_avx512  __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,prefer-vector-width=512")))
+#define UCG_OP_ISA_ATTR_neon
+#define UCG_OP_ISA_ATTR_sve     __attribute__((target("+sve")))
+
+#if defined(__x86_64__)
+    #define UCG_OP_ISA_ENABLE_AVX2
+    #define UCG_OP_ISA_ENABLE_AVX512
+#elif defined(__aarch64__)
+    #include <sys/auxv.h>
+    #define UCG_OP_ISA_ENABLE_NEON
+    #if !defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 10 && defined(HWCAP_SVE)
+        #define UCG_OP_ISA_ENABLE_SVE
+    #endif
+#endif
+
+/* Each element is reduced independently, so the vectorized kernels produce
+   exactly the same result as the scalar ones. */
+#define UCG_OP_FUNC(_isa, _type, _dt, _func) \
+    static UCG_OP_ISA_ATTR_##_isa \
+    ucg_status_t ucg_op_func_##_isa##_##_type##_##_dt(void *op, \
+                                                     const void *source, \
+                                                     void *target, \
+                                                     int32_t count, \
+                                                     void *dt) \
     { \
         UCG_UNUSED(op, dt); \
-        _dt *a = (_dt*)source; \
+        const _dt *a = (const _dt*)source; \
         _dt *b = (_dt*)target; \
         for (int i = 0; i < count; ++i) { \
-            _func(*b, *a); \
-            ++a; \
-            ++b; \
+            _func(b[i], a[i]); \
         } \
         return UCG_OK; \
     }
 
-#define UCG_OP_PREDEFINED_FUNCS(_type, _TYPE) \
-    UCG_OP_FUNC(_type, int8_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, int16_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, int32_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, int64_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, uint8_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, uint16_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, uint32_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, uint64_t, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, _Float16, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, float, UCG_OP_FUNC_##_TYPE) \
-    UCG_OP_FUNC(_type, double, UCG_OP_FUNC_##_TYPE)
+#define UCG_OP_ISA_FUNCS(_isa, _type, _TYPE) \
+    UCG_OP_FUNC(_isa, _type, int8_t, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, int16_t, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, int32_t, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, int64_t, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, uint8_t, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, uint16_t, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, uint32_t, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, uint64_t, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, _Float16, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, float, UCG_OP_FUNC_##_TYPE) \
+    UCG_OP_FUNC(_isa, _type, double, UCG_OP_FUNC_##_TYPE)
+
+#define UCG_OP_ISA_FUNCS_ALL(_isa) \
+    UCG_OP_ISA_FUNCS(_isa, max, MAX) \
+    UCG_OP_ISA_FUNCS(_isa, min, MIN) \
+    UCG_OP_ISA_FUNCS(_isa, sum, SUM) \
+    UCG_OP_ISA_FUNCS(_isa, prod, PROD)
+
+#define UCG_OP_ISA_TABLE(_isa, _type) \
+    { \
+        [UCG_DT_TYPE_INT8]      = ucg_op_func_##_isa##_##_type##_int8_t, \
+        [UCG_DT_TYPE_INT16]     = ucg_op_func_##_isa##_##_type##_int16_t, \
+        [UCG_DT_TYPE_INT32]     = ucg_op_func_##_isa##_##_type##_int32_t, \
+        [UCG_DT_TYPE_INT64]     = ucg_op_func_##_isa##_##_type##_int64_t, \
+        [UCG_DT_TYPE_UINT8]     = ucg_op_func_##_isa##_##_type##_uint8_t, \
+        [UCG_DT_TYPE_UINT16]    = ucg_op_func_##_isa##_##_type##_uint16_t, \
+        [UCG_DT_TYPE_UINT32]    = ucg_op_func_##_isa##_##_type##_uint32_t, \
+        [UCG_DT_TYPE_UINT64]    = ucg_op_func_##_isa##_##_type##_uint64_t, \
+        [UCG_DT_TYPE_FP16]      = ucg_op_func_##_isa##_##_type##__Float16, \
+        [UCG_DT_TYPE_FP32]      = ucg_op_func_##_isa##_##_type##_float, \
+        [UCG_DT_TYPE_FP64]      = ucg_op_func_##_isa##_##_type##_double, \
+    }
+
+#ifdef UCG_OP_ISA_ENABLE_AVX2
+    #define UCG_OP_ISA_TABLE_AVX2(_type) [UCG_OP_ISA_AVX2] = UCG_OP_ISA_TABLE(avx2, _type),
+#else
+    #define UCG_OP_ISA_TABLE_AVX2(_type)
+#endif
+#ifdef UCG_OP_ISA_ENABLE_AVX512
+    #define UCG_OP_ISA_TABLE_AVX512(_type) [UCG_OP_ISA_AVX512] = UCG_OP_ISA_TABLE(avx512, _type),
+#else
+    #define UCG_OP_ISA_TABLE_AVX512(_type)
+#endif
+#ifdef UCG_OP_ISA_ENABLE_NEON
+    #define UCG_OP_ISA_TABLE_NEON(_type) [UCG_OP_ISA_NEON] = UCG_OP_ISA_TABLE(neon, _type),
+#else
+    #define UCG_OP_ISA_TABLE_NEON(_type)
+#endif
+#ifdef UCG_OP_ISA_ENABLE_SVE
+    #define UCG_OP_ISA_TABLE_SVE(_type) [UCG_OP_ISA_SVE] = UCG_OP_ISA_TABLE(sve, _type),
+#else
+    #define UCG_OP_ISA_TABLE_SVE(_type)
+#endif
 
 #define UCG_OP_PREDEFINED_NAME(_type) ucg_op_predefined_##_type
 #define UCG_OP_PREDEFINED(_type, _TYPE) \
-    UCG_OP_PREDEFINED_FUNCS(_type, _TYPE) \
-    static ucg_op_func_t ucg_op_predefined_funcs_##_type[UCG_DT_TYPE_PREDEFINED_LAST] = { \
-        [UCG_DT_TYPE_INT8]      = ucg_op_func_##_type##_int8_t, \
-        [UCG_DT_TYPE_INT16]     = ucg_op_func_##_type##_int16_t, \
-        [UCG_DT_TYPE_INT32]     = ucg_op_func_##_type##_int32_t, \
-        [UCG_DT_TYPE_INT64]     = ucg_op_func_##_type##_int64_t, \
-        [UCG_DT_TYPE_UINT8]     = ucg_op_func_##_type##_uint8_t, \
-        [UCG_DT_TYPE_UINT16]    = ucg_op_func_##_type##_uint16_t, \
-        [UCG_DT_TYPE_UINT32]    = ucg_op_func_##_type##_uint32_t, \
-        [UCG_DT_TYPE_UINT64]    = ucg_op_func_##_type##_uint64_t, \
-        [UCG_DT_TYPE_FP16]      = ucg_op_func_##_type##__Float16, \
-        [UCG_DT_TYPE_FP32]      = ucg_op_func_##_type##_float, \
-        [UCG_DT_TYPE_FP64]      = ucg_op_func_##_type##_double, \
+    static ucg_op_func_t ucg_op_predefined_funcs_##_type[UCG_OP_ISA_LAST][UCG_DT_TYPE_PREDEFINED_LAST] = { \
+        [UCG_OP_ISA_SCALAR] = UCG_OP_ISA_TABLE(scalar, _type), \
+        UCG_OP_ISA_TABLE_AVX2(_type) \
+        UCG_OP_ISA_TABLE_AVX512(_type) \
+        UCG_OP_ISA_TABLE_NEON(_type) \
+        UCG_OP_ISA_TABLE_SVE(_type) \
     }; \
     static ucg_status_t UCG_OP_PREDEFINED_NAME(_type)(void *op, \
                                                        const void *source, \
@@ -73,7 +128,8 @@
         ucg_assert(((ucg_op_t*)op)->type == UCG_OP_TYPE_##_TYPE); \
         ucg_dt_t *ucg_dt = (ucg_dt_t*)dt; \
         ucg_assert(ucg_dt_is_predefined(ucg_dt)); \
-        return ucg_op_predefined_funcs_##_type[ucg_dt->type](op, source, target, count, dt); \
+        return ucg_op_predefined_funcs_##_type[ucg_op_isa][ucg_dt->type](op, source, target, \
+                                                                         count, dt); \
     }
 
 #define UCG_DT_STATE_INIT(_action, _state, _buffer, _dt, _count) \
@@ -152,6 +208,31 @@ static ucg_dt_t ucg_dt_predefined[UCG_DT_TYPE_PREDEFINED_LAST] = {
     {UCG_DT_TYPE_FP64,   UCG_DT_PREDEFINED_FLAGS, 8, 8, 0, 8},
 };
 
+/* Selected by ucg_dt_global_init() */
+static ucg_op_isa_t ucg_op_isa = UCG_OP_ISA_SCALAR;
+
+UCG_OP_ISA_FUNCS_ALL(scalar)
+/* -O2 of old compilers does not vectorize loops. */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("tree-vectorize")
+#endif
+#ifdef UCG_OP_ISA_ENABLE_AVX2
+UCG_OP_ISA_FUNCS_ALL(avx2)
+#endif
+#ifdef UCG_OP_ISA_ENABLE_AVX512
+UCG_OP_ISA_FUNCS_ALL(avx512)
+#endif
+#ifdef UCG_OP_ISA_ENABLE_NEON
+UCG_OP_ISA_FUNCS_ALL(neon)
+#endif
+#ifdef UCG_OP_ISA_ENABLE_SVE
+UCG_OP_ISA_FUNCS_ALL(sve)
+#endif
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
 UCG_OP_PREDEFINED(max, MAX);
 UCG_OP_PREDEFINED(min, MIN);
 UCG_OP_PREDEFINED(sum, SUM);
@@ -189,8 +270,82 @@ static void ucg_dt_unpack_contiguous(ucg_dt_state_t *state, uint64_t offset,
     return;
 }
 
+static const char *ucg_op_isa_names[UCG_OP_ISA_LAST] = {
+    [UCG_OP_ISA_SCALAR] = "scalar",
+    [UCG_OP_ISA_AVX2]   = "avx2",
+    [UCG_OP_ISA_AVX512] = "avx512",
+    [UCG_OP_ISA_NEON]   = "neon",
+    [UCG_OP_ISA_SVE]    = "sve",
+};
+
+int ucg_op_isa_is_supported(ucg_op_isa_t isa)
+{
+    switch (isa) {
+        case UCG_OP_ISA_SCALAR:
+            return 1;
+#ifdef UCG_OP_ISA_ENABLE_AVX2
+        case UCG_OP_ISA_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef UCG_OP_ISA_ENABLE_AVX512
+        case UCG_OP_ISA_AVX512:
+            return __builtin_cpu_supports("avx512f") &&
+                   __builtin_cpu_supports("avx512bw") &&
+                   __builtin_cpu_supports("avx512dq") &&
+                   __builtin_cpu_supports("avx512vl");
+#endif
+#ifdef UCG_OP_ISA_ENABLE_NEON
+        case UCG_OP_ISA_NEON:
+            return 1;
+#endif
+#ifdef UCG_OP_ISA_ENABLE_SVE
+        case UCG_OP_ISA_SVE:
+            return !!(getauxval(AT_HWCAP) & HWCAP_SVE);
+#endif
+        default:
+            return 0;
+    }
+}
+
+ucg_op_func_t ucg_op_predefined_func(ucg_op_type_t op_type, ucg_dt_type_t dt_type,
+                                     ucg_op_isa_t isa)
+{
+    if (!ucg_op_is_predefined_type(op_type) || !ucg_dt_is_predefined_type(dt_type) ||
+        isa >= UCG_OP_ISA_LAST || !ucg_op_isa_is_supported(isa)) {
+        return NULL;
+    }
+
+    switch (op_type) {
+        case UCG_OP_TYPE_MAX:
+            return ucg_op_predefined_funcs_max[isa][dt_type];
+        case UCG_OP_TYPE_MIN:
+            return ucg_op_predefined_funcs_min[isa][dt_type];
+        case UCG_OP_TYPE_SUM:
+            return ucg_op_predefined_funcs_sum[isa][dt_type];
+        case UCG_OP_TYPE_PROD:
+            return ucg_op_predefined_funcs_prod[isa][dt_type];
+        default:
+            return NULL;
+    }
+}
+
+ucg_op_isa_t ucg_op_get_isa()
+{
+    return ucg_op_isa;
+}
+
 ucg_status_t ucg_dt_global_init()
 {
+    /* Prefer the widest vectors. */
+    ucg_op_isa = UCG_OP_ISA_SCALAR;
+    for (int isa = UCG_OP_ISA_LAST - 1; isa > UCG_OP_ISA_SCALAR; --isa) {
+        if (ucg_op_isa_is_supported(isa)) {
+            ucg_op_isa = isa;
+            break;
+        }
+    }
+    ucg_debug("Using %s reduction kernels", ucg_op_isa_names[ucg_op_isa]);
+
     return UCG_MPOOL_INIT(&ucg_dt_state_mp, 0, sizeof(ucg_dt_state_t), 0,
                           UCG_CACHE_LINE_SIZE, 16, -1, NULL, "dt state mpool");
 }
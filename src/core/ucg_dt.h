@@ -21,6 +21,18 @@ typedef enum {
     UCG_OP_FLAG_IS_PERSISTENT  = UCG_BIT(2),
 } ucg_op_flag_t;
 
+/**
+ * @brief Instruction sets of the predefined reduction kernels
+ */
+typedef enum {
+    UCG_OP_ISA_SCALAR,
+    UCG_OP_ISA_NEON,
+    UCG_OP_ISA_SVE,
+    UCG_OP_ISA_AVX2,
+    UCG_OP_ISA_AVX512,
+    UCG_OP_ISA_LAST,
+} ucg_op_isa_t;
+
 typedef struct {
     /** opaque object */
     uint64_t obj;
@@ -86,6 +98,25 @@ ucg_status_t ucg_dt_global_init();
  */
 void ucg_dt_global_cleanup();
 
+/**
+ * @brief Whether the kernels of the instruction set are usable on this CPU.
+ */
+int ucg_op_isa_is_supported(ucg_op_isa_t isa);
+
+/**
+ * @brief Instruction set of the kernels selected by @ref ucg_dt_global_init
+ */
+ucg_op_isa_t ucg_op_get_isa();
+
+/**
+ * @brief Get the reduction kernel of predefined op and datatype.
+ *
+ * @return NULL if the op or datatype is not predefined or the instruction set
+ *         is not supported.
+ */
+ucg_op_func_t ucg_op_predefined_func(ucg_op_type_t op_type, ucg_dt_type_t dt_type,
+                                     ucg_op_isa_t isa);
+
 /***************************************************************
  *                      Datatype routines
  ***************************************************************/
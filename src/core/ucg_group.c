@@ -7,12 +7,17 @@
 #include "ucg_rank_map.h"
 #include "ucg_plan.h"
 #include "ucg_topo.h"
+#include "ucg_request.h"
 
 #include "util/ucg_helper.h"
 #include "util/ucg_malloc.h"
+#include "util/ucg_math.h"
 #include "util/ucg_log.h"
 #include "planc/ucg_planc.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #define UCG_GROUP_COPY_REQUIRED_FIELD(_field, _copy, _dst, _src, _err_label) \
     UCG_COPY_REQUIRED_FIELD(UCG_TOKENPASTE(UCG_GROUP_PARAMS_FIELD_, _field), \
                             _copy, _dst, _src, _err_label)
@@ -21,6 +26,35 @@
     UCG_COPY_OPTIONAL_FIELD(UCG_TOKENPASTE(UCG_GROUP_PARAMS_FIELD_, _field), \
                             _copy, _dst, _src, _default, _err_label)
 
+typedef struct ucg_group_split_member {
+    int32_t key;
+    ucg_rank_t rank;
+} ucg_group_split_member_t;
+
+/* The OOB group of a derived group. */
+typedef struct ucg_group_derive {
+    /* While the group is being created, the allgathers are exchanges over the
+       parent, in which the processes that aren't members take part as well. */
+    ucg_group_t *parent;
+    /* Once it's created, the group runs the allgathers itself. */
+    ucg_group_t *group;
+    uint32_t size;
+    ucg_rank_t *ranks; /* ranks of the members in the parent */
+    int32_t *counts; /* counts, recvcounts and displs of the exchanges */
+    /* OOB group of the first ancestor that isn't derived, and the ranks in it */
+    void *root_oob_group;
+    ucg_rank_t *root_ranks;
+} ucg_group_derive_t;
+
+static void ucg_group_derive_free(ucg_group_derive_t *derive)
+{
+    ucg_free(derive->root_ranks);
+    ucg_free(derive->counts);
+    ucg_free(derive->ranks);
+    ucg_free(derive);
+    return;
+}
+
 static void ucg_group_free_params(ucg_group_t *group)
 {
     ucg_rank_map_cleanup(&group->rank_map);
@@ -110,15 +144,94 @@ err_destroy_planc_group:
     return status;
 }
 
+/* Returns 0 if the plans of the group can not be shared. */
+static int ucg_group_get_plans_key(const ucg_group_t *group, ucg_plans_key_t *key)
+{
+    const ucg_topo_t *topo = group->topo;
+    memset(key, 0, sizeof(*key));
+    key->size = group->size;
+    key->ppn = topo->ppn;
+    key->pps = topo->pps;
+    /* The number of nodes is only used when the nodes are balanced. */
+    key->nnode = (topo->ppn == UCG_TOPO_PPX_UNBALANCED) ? 0 : group->size / topo->ppn;
+
+    if (group->num_planc_groups > UCG_PLANS_KEY_MAX_TAGS) {
+        return 0;
+    }
+    ucg_resource_planc_t *planc_rscs = group->context->planc_rscs;
+    for (int i = 0; i < group->num_planc_groups; ++i) {
+        ucg_planc_t *planc = planc_rscs[i].planc;
+        if (planc->get_plans_tag == NULL ||
+            planc->get_plans_tag(group->planc_groups[i], &key->tags[i]) != UCG_OK) {
+            return 0;
+        }
+    }
+    key->num_tags = group->num_planc_groups;
+    return 1;
+}
+
+static int ucg_group_plans_key_is_equal(const ucg_plans_key_t *key1,
+                                        const ucg_plans_key_t *key2)
+{
+    if (key1->size != key2->size || key1->nnode != key2->nnode ||
+        key1->ppn != key2->ppn || key1->pps != key2->pps ||
+        key1->num_tags != key2->num_tags) {
+        return 0;
+    }
+    for (int i = 0; i < key1->num_tags; ++i) {
+        if (key1->tags[i] != key2->tags[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static ucg_plans_t* ucg_group_find_plans(ucg_context_t *context, const ucg_plans_key_t *key)
+{
+    ucg_plans_t *plans = NULL;
+    ucg_lock_enter(&context->glist_lock);
+    ucg_list_for_each(plans, &context->plans_list, list) {
+        if (ucg_group_plans_key_is_equal(&plans->key, key)) {
+            ++plans->refcount;
+            ucg_lock_leave(&context->glist_lock);
+            return plans;
+        }
+    }
+    ucg_lock_leave(&context->glist_lock);
+    return NULL;
+}
+
 static void ucg_group_free_plans(ucg_group_t *group)
 {
-    ucg_plans_cleanup(group->plans);
+    ucg_context_t *context = group->context;
+    ucg_plans_t *plans = group->plans;
+    ucg_lock_enter(&context->glist_lock);
+    uint32_t refcount = --plans->refcount;
+    if (refcount == 0) {
+        ucg_list_del(&plans->list);
+    }
+    ucg_lock_leave(&context->glist_lock);
+
+    if (refcount == 0) {
+        ucg_plans_cleanup(plans);
+    }
     return;
 }
 
 static ucg_status_t ucg_group_fill_plans(ucg_group_t *group)
 {
     ucg_status_t status;
+    ucg_context_t *context = group->context;
+    ucg_plans_key_t key;
+    int share = ucg_group_get_plans_key(group, &key) && context->share_plans;
+    if (share) {
+        group->plans = ucg_group_find_plans(context, &key);
+        if (group->plans != NULL) {
+            ucg_debug("Group id %d shares plans, size %u, ppn %d, pps %d",
+                      group->id, key.size, key.ppn, key.pps);
+            return UCG_OK;
+        }
+    }
 
     status = ucg_plans_init(&group->plans);
     if (status != UCG_OK) {
@@ -127,7 +240,7 @@ static ucg_status_t ucg_group_fill_plans(ucg_group_t *group)
     }
 
     int32_t num_planc_groups = group->num_planc_groups;
-    ucg_resource_planc_t *planc_rscs = group->context->planc_rscs;
+    ucg_resource_planc_t *planc_rscs = context->planc_rscs;
     for (int i = 0; i < num_planc_groups; ++i) {
         ucg_planc_t *planc = planc_rscs[i].planc;
         status = planc->get_plans(group->planc_groups[i], group->plans);
@@ -135,12 +248,36 @@ static ucg_status_t ucg_group_fill_plans(ucg_group_t *group)
             ucg_error("Failed to get plans from planc %s", planc->super.name);
             goto err_free_plans;
         }
+        /* The tuning file is applied on top of the builtin plans of each planc. */
+        status = ucg_tune_file_add_plans(&context->tune_file, planc->super.name,
+                                         group->plans);
+        if (status != UCG_OK) {
+            ucg_error("Failed to add tuned plans of planc %s", planc->super.name);
+            goto err_free_plans;
+        }
+        ucg_plans_set_planc(group->plans, i);
     }
 
+    status = ucg_plans_build(group->plans);
+    if (status != UCG_OK) {
+        ucg_error("Failed to build plan tables");
+        goto err_free_plans;
+    }
+    /* The groups sharing the plans execute them with their own planc groups. */
+    if (!ucg_plans_bind(group->plans, group->planc_groups, num_planc_groups)) {
+        share = 0;
+    }
+    group->plans->key = key;
+
+    if (share) {
+        ucg_lock_enter(&context->glist_lock);
+        ucg_list_add_tail(&context->plans_list, &group->plans->list);
+        ucg_lock_leave(&context->glist_lock);
+    }
     return UCG_OK;
 
 err_free_plans:
-    ucg_group_free_plans(group);
+    ucg_plans_cleanup(group->plans);
     return status;
 }
 
@@ -169,20 +306,35 @@ ucg_status_t ucg_group_create(ucg_context_h context, const ucg_group_params_t *p
     }
     grp->context = context;
     grp->unique_req_id = 0;
+    ucg_list_head_init(&grp->id_list);
+    ucg_list_head_init(&grp->plist);
+    ucg_list_head_init(&grp->rlist);
+    ucg_list_head_init(&grp->slist);
 
-    status = ucg_group_apply_params(grp, params);
+    status = ucg_lock_init(&grp->lock, context->lock_type);
     if (status != UCG_OK) {
         goto err_free_grp;
     }
 
-    status = ucg_group_create_planc_group(grp);
+    status = ucg_lock_init(&grp->rlist_lock, context->lock_type);
     if (status != UCG_OK) {
-        goto err_free_params;
+        goto err_destroy_lock;
+    }
+
+    status = ucg_group_apply_params(grp, params);
+    if (status != UCG_OK) {
+        goto err_destroy_rlist_lock;
     }
 
+    /* The plancs may use the topology when their groups are created. */
     status = ucg_group_init_topo(grp);
     if (status != UCG_OK) {
-        goto err_destroy_planc_group;
+        goto err_free_params;
+    }
+
+    status = ucg_group_create_planc_group(grp);
+    if (status != UCG_OK) {
+        goto err_cleanup_topo;
     }
 
     status = ucg_group_fill_plans(grp);
@@ -190,14 +342,38 @@ ucg_status_t ucg_group_create(ucg_context_h context, const ucg_group_params_t *p
         goto err_destroy_planc_group;
     }
 
+    status = ucg_op_cache_init(&grp->op_cache, context->op_cache_size);
+    if (status != UCG_OK) {
+        goto err_free_plans;
+    }
+
+    status = ucg_plan_tuner_init(&grp->tuner, context->tune_budget, context->tune_output);
+    if (status != UCG_OK) {
+        goto err_cleanup_op_cache;
+    }
+
+    ucg_lock_enter(&context->glist_lock);
+    ucg_list_add_tail(&context->glist, &grp->list);
+    ucg_lock_leave(&context->glist_lock);
+
     ucg_debug("Group id %d, size %u, myrank %d", grp->id, grp->size, grp->myrank);
     *group = grp;
     goto out;
 
+err_cleanup_op_cache:
+    ucg_op_cache_cleanup(&grp->op_cache);
+err_free_plans:
+    ucg_group_free_plans(grp);
 err_destroy_planc_group:
     ucg_group_destroy_planc_group(grp);
+err_cleanup_topo:
+    ucg_topo_cleanup(grp->topo);
 err_free_params:
     ucg_group_free_params(grp);
+err_destroy_rlist_lock:
+    ucg_lock_destroy(&grp->rlist_lock);
+err_destroy_lock:
+    ucg_lock_destroy(&grp->lock);
 err_free_grp:
     ucg_free(grp);
 out:
@@ -212,12 +388,600 @@ void ucg_group_destroy(ucg_group_h group)
     ucg_context_t *context = group->context;
     ucg_context_lock(context);
 
-    ucg_topo_cleanup(group->topo);
+    /* No progress touches the group once it's out of the list. */
+    ucg_lock_enter(&context->glist_lock);
+    ucg_list_del(&group->list);
+    ucg_lock_leave(&context->glist_lock);
+
+    ucg_op_cache_cleanup(&group->op_cache);
+    ucg_plan_tuner_cleanup(&group->tuner);
     ucg_group_free_plans(group);
     ucg_group_destroy_planc_group(group);
+    if (ucg_group_is_derived(group)) {
+        ucg_group_derive_free((ucg_group_derive_t*)group->oob_group.group);
+    }
+    ucg_topo_cleanup(group->topo);
     ucg_group_free_params(group);
+    ucg_lock_destroy(&group->rlist_lock);
+    ucg_lock_destroy(&group->lock);
     ucg_free(group);
 
     ucg_context_unlock(context);
     return;
-}
\ No newline at end of file
+}
+
+static int ucg_group_plan_info_compare(const void *a, const void *b)
+{
+    const ucg_plan_info_t *info1 = (const ucg_plan_info_t*)a;
+    const ucg_plan_info_t *info2 = (const ucg_plan_info_t*)b;
+    int ret = strcmp(info1->planc, info2->planc);
+    if (ret != 0) {
+        return ret;
+    }
+    return (info1->id > info2->id) - (info1->id < info2->id);
+}
+
+static const char *ucg_group_plan_planc_name(ucg_group_t *group, const ucg_plan_t *plan)
+{
+    if (plan->planc == UCG_PLAN_PLANC_NONE) {
+        return "unknown";
+    }
+    return group->context->planc_rscs[plan->planc].planc->super.name;
+}
+
+static void ucg_group_add_plan_info(ucg_group_t *group, const ucg_plan_t *plan,
+                                    ucg_plan_info_t *infos, uint32_t *count)
+{
+    const char *planc = ucg_group_plan_planc_name(group, plan);
+    for (uint32_t i = 0; i < *count; ++i) {
+        if (infos[i].id == plan->attr.id && !strcmp(infos[i].planc, planc)) {
+            return;
+        }
+    }
+    infos[*count].id = plan->attr.id;
+    infos[*count].name = plan->attr.name;
+    infos[*count].planc = planc;
+    ++*count;
+    return;
+}
+
+ucg_status_t ucg_group_query_plans(ucg_group_t *group, ucg_coll_type_t coll_type,
+                                   ucg_mem_type_t mem_type, ucg_plan_info_t *infos,
+                                   uint32_t *count)
+{
+    UCG_CHECK_NULL_INVALID(group, count);
+    UCG_CHECK_OUT_RANGE(UCG_ERR_INVALID_PARAM, coll_type, 0, UCG_COLL_TYPE_LAST);
+    UCG_CHECK_OUT_RANGE(UCG_ERR_INVALID_PARAM, mem_type, 0, UCG_MEM_TYPE_LAST);
+
+    ucg_group_lock(group);
+    ucg_list_link_t *head = &group->plans->plans[coll_type][mem_type];
+    uint32_t num_plans = 0;
+    ucg_plan_t *plan = NULL;
+    ucg_list_for_each(plan, head, list) {
+        ++num_plans;
+        ucg_plan_t *plan_fb = NULL;
+        ucg_list_for_each(plan_fb, &plan->fallback, fallback) {
+            ++num_plans;
+        }
+    }
+
+    ucg_status_t status = UCG_OK;
+    uint32_t num_infos = 0;
+    ucg_plan_info_t *all = ucg_malloc(ucg_max(num_plans, 1) * sizeof(ucg_plan_info_t),
+                                      "plan infos");
+    if (all == NULL) {
+        status = UCG_ERR_NO_MEMORY;
+        goto out;
+    }
+    ucg_list_for_each(plan, head, list) {
+        ucg_group_add_plan_info(group, plan, all, &num_infos);
+        ucg_plan_t *plan_fb = NULL;
+        ucg_list_for_each(plan_fb, &plan->fallback, fallback) {
+            ucg_group_add_plan_info(group, plan_fb, all, &num_infos);
+        }
+    }
+    qsort(all, num_infos, sizeof(ucg_plan_info_t), ucg_group_plan_info_compare);
+
+    if (infos != NULL) {
+        memcpy(infos, all, ucg_min(num_infos, *count) * sizeof(ucg_plan_info_t));
+        if (num_infos > *count) {
+            status = UCG_ERR_TRUNCATE;
+        }
+    }
+    *count = num_infos;
+    ucg_free(all);
+out:
+    ucg_group_unlock(group);
+    return status;
+}
+
+static ucg_plan_t *ucg_group_find_plan(ucg_group_t *group, ucg_list_link_t *head,
+                                       const char *planc, int32_t id)
+{
+    ucg_plan_t *plan = NULL;
+    ucg_list_for_each(plan, head, list) {
+        if (plan->attr.id == id && !strcmp(ucg_group_plan_planc_name(group, plan), planc)) {
+            return plan;
+        }
+        ucg_plan_t *plan_fb = NULL;
+        ucg_list_for_each(plan_fb, &plan->fallback, fallback) {
+            if (plan_fb->attr.id == id &&
+                !strcmp(ucg_group_plan_planc_name(group, plan_fb), planc)) {
+                return plan_fb;
+            }
+        }
+    }
+    return NULL;
+}
+
+ucg_status_t ucg_group_force_plan(ucg_group_t *group, ucg_coll_type_t coll_type,
+                                  ucg_mem_type_t mem_type, const char *planc, int32_t id)
+{
+    UCG_CHECK_NULL_INVALID(group);
+    UCG_CHECK_OUT_RANGE(UCG_ERR_INVALID_PARAM, coll_type, 0, UCG_COLL_TYPE_LAST);
+    UCG_CHECK_OUT_RANGE(UCG_ERR_INVALID_PARAM, mem_type, 0, UCG_MEM_TYPE_LAST);
+
+    ucg_status_t status = UCG_OK;
+    ucg_plan_t *plan = NULL;
+    ucg_group_lock(group);
+    if (planc != NULL) {
+        plan = ucg_group_find_plan(group, &group->plans->plans[coll_type][mem_type],
+                                   planc, id);
+        if (plan == NULL) {
+            ucg_error("No plan %s:%d of %s", planc, id, ucg_coll_type_string(coll_type));
+            status = UCG_ERR_NOT_FOUND;
+            goto out;
+        }
+    }
+    group->forced_plans[coll_type][mem_type] = plan;
+    /* The cached ops may come from other plans. */
+    ucg_op_cache_flush(&group->op_cache);
+out:
+    ucg_group_unlock(group);
+    return status;
+}
+
+static ucg_status_t ucg_group_run_allgatherv(ucg_group_t *group, const void *sendbuf,
+                                              int32_t sendcount, void *recvbuf,
+                                              const int32_t *recvcounts,
+                                              const int32_t *displs, ucg_dt_type_t type)
+{
+    ucg_dt_t *dt = ucg_dt_get_predefined(type);
+    ucg_coll_args_t args = {
+        .type = UCG_COLL_TYPE_ALLGATHERV,
+        .info.field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .info.mem_type = UCG_MEM_TYPE_HOST,
+        .allgatherv.sendbuf = sendbuf,
+        .allgatherv.sendcount = sendcount,
+        .allgatherv.sendtype = dt,
+        .allgatherv.recvbuf = recvbuf,
+        .allgatherv.recvcounts = recvcounts,
+        .allgatherv.displs = displs,
+        .allgatherv.recvtype = dt,
+    };
+    return ucg_request_run_blocking(group, &args);
+}
+
+/*
+ * One exchange over the parent. Every process of the parent sends count bytes,
+ * or -1 if it has nothing to send, and the bytes of parent rank i are put at
+ * displs[i] of data. The data is NULL if no process sent.
+ */
+static ucg_status_t ucg_group_derive_exchange(ucg_group_derive_t *derive, const void *sendbuf,
+                                              int32_t count, uint8_t **data)
+{
+    ucg_group_t *parent = derive->parent;
+    uint32_t parent_size = parent->size;
+    int32_t *counts = derive->counts;
+    int32_t *recvcounts = counts + parent_size;
+    int32_t *displs = recvcounts + parent_size;
+    for (uint32_t i = 0; i < parent_size; ++i) {
+        counts[i] = -1;
+        recvcounts[i] = 1;
+        displs[i] = i;
+    }
+
+    *data = NULL;
+    ucg_status_t status = ucg_group_run_allgatherv(parent, &count, 1, counts, recvcounts,
+                                                   displs, UCG_DT_TYPE_INT32);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    int sent = 0;
+    int32_t total = 0;
+    for (uint32_t i = 0; i < parent_size; ++i) {
+        sent |= counts[i] >= 0;
+        recvcounts[i] = ucg_max(counts[i], 0);
+        displs[i] = total;
+        total += recvcounts[i];
+    }
+    if (!sent) {
+        return UCG_OK;
+    }
+
+    *data = ucg_malloc(ucg_max(total, 1), "derive exchange data");
+    if (*data == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    status = ucg_group_run_allgatherv(parent, sendbuf, ucg_max(count, 0), *data, recvcounts,
+                                      displs, UCG_DT_TYPE_UINT8);
+    if (status != UCG_OK) {
+        ucg_free(*data);
+        *data = NULL;
+    }
+    return status;
+}
+
+static ucg_status_t ucg_group_derive_allgather(const void *sendbuf, void *recvbuf,
+                                               int32_t count, void *group)
+{
+    ucg_group_derive_t *derive = (ucg_group_derive_t*)group;
+    uint32_t size = derive->size;
+    ucg_status_t status;
+    if (derive->group != NULL) {
+        int32_t *recvcounts = ucg_malloc(size * 2 * sizeof(int32_t), "derive recvcounts");
+        if (recvcounts == NULL) {
+            return UCG_ERR_NO_MEMORY;
+        }
+        int32_t *displs = recvcounts + size;
+        for (uint32_t i = 0; i < size; ++i) {
+            recvcounts[i] = count;
+            displs[i] = i * count;
+        }
+        status = ucg_group_run_allgatherv(derive->group, sendbuf, count, recvbuf, recvcounts,
+                                          displs, UCG_DT_TYPE_UINT8);
+        ucg_free(recvcounts);
+        return status;
+    }
+
+    uint8_t *data = NULL;
+    status = ucg_group_derive_exchange(derive, sendbuf, count, &data);
+    if (status != UCG_OK) {
+        return status;
+    }
+    int32_t *displs = derive->counts + 2 * derive->parent->size;
+    for (uint32_t i = 0; i < size; ++i) {
+        ucg_rank_t rank = derive->ranks[i];
+        if (derive->counts[rank] != count) {
+            /* The member has failed to create the group or it isn't in the same step. */
+            ucg_error("Member %u sent %d bytes instead of %d", i, derive->counts[rank], count);
+            status = UCG_ERR_INCOMPATIBLE;
+            break;
+        }
+        memcpy((uint8_t*)recvbuf + i * count, data + displs[rank], count);
+    }
+    ucg_free(data);
+    return status;
+}
+
+/* Take part in the exchanges until every process of the parent is done. */
+static ucg_status_t ucg_group_derive_finish(ucg_group_derive_t *derive)
+{
+    ucg_status_t status;
+    int done = 0;
+    while (!done) {
+        uint8_t *data = NULL;
+        status = ucg_group_derive_exchange(derive, NULL, -1, &data);
+        if (status != UCG_OK) {
+            return status;
+        }
+        done = data == NULL;
+        ucg_free(data);
+    }
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_group_derive_check_ranks(ucg_group_t *parent, const ucg_rank_t *ranks,
+                                                 uint32_t size)
+{
+    uint8_t *used = ucg_calloc(parent->size, sizeof(uint8_t), "derive used ranks");
+    if (used == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    ucg_status_t status = UCG_OK;
+    for (uint32_t i = 0; i < size; ++i) {
+        ucg_rank_t rank = ranks[i];
+        if (rank < 0 || rank >= parent->size || used[rank]) {
+            ucg_error("Invalid or duplicate rank %d of parent group id %d", rank, parent->id);
+            status = UCG_ERR_INVALID_PARAM;
+            break;
+        }
+        used[rank] = 1;
+    }
+    ucg_free(used);
+    return status;
+}
+
+static ucg_group_derive_t* ucg_group_derive_new(ucg_group_t *parent, const ucg_rank_t *ranks,
+                                                uint32_t size)
+{
+    ucg_group_derive_t *derive = ucg_calloc(1, sizeof(ucg_group_derive_t), "derive");
+    if (derive == NULL) {
+        return NULL;
+    }
+    derive->parent = parent;
+    derive->size = size;
+    derive->counts = ucg_malloc(parent->size * 3 * sizeof(int32_t), "derive counts");
+    derive->ranks = ucg_malloc(ucg_max(size, 1) * sizeof(ucg_rank_t), "derive ranks");
+    derive->root_ranks = ucg_malloc(ucg_max(size, 1) * sizeof(ucg_rank_t), "derive root ranks");
+    if (derive->counts == NULL || derive->ranks == NULL || derive->root_ranks == NULL) {
+        ucg_group_derive_free(derive);
+        return NULL;
+    }
+
+    ucg_group_derive_t *parent_derive = NULL;
+    derive->root_oob_group = parent->oob_group.group;
+    if (ucg_group_is_derived(parent)) {
+        parent_derive = (ucg_group_derive_t*)parent->oob_group.group;
+        derive->root_oob_group = parent_derive->root_oob_group;
+    }
+    for (uint32_t i = 0; i < size; ++i) {
+        derive->ranks[i] = ranks[i];
+        derive->root_ranks[i] = parent_derive == NULL ? ranks[i] :
+                                parent_derive->root_ranks[ranks[i]];
+    }
+    return derive;
+}
+
+/* The rank map and the topology come from the parent. */
+static ucg_status_t ucg_group_derive_create(ucg_group_derive_t *derive, ucg_rank_t myrank,
+                                            uint32_t id, ucg_group_h *group)
+{
+    ucg_group_t *parent = derive->parent;
+    uint32_t size = derive->size;
+    ucg_rank_t *ctx_ranks = ucg_malloc(size * sizeof(ucg_rank_t), "derive ctx ranks");
+    if (ctx_ranks == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    for (uint32_t i = 0; i < size; ++i) {
+        ctx_ranks[i] = ucg_group_get_ctx_rank(parent, derive->ranks[i]);
+    }
+
+    ucg_group_params_t params = {
+        .field_mask = UCG_GROUP_PARAMS_FIELD_ID |
+                      UCG_GROUP_PARAMS_FIELD_SIZE |
+                      UCG_GROUP_PARAMS_FIELD_MYRANK |
+                      UCG_GROUP_PARAMS_FIELD_RANK_MAP |
+                      UCG_GROUP_PARAMS_FIELD_OOB_GROUP,
+        .id = id,
+        .size = size,
+        .myrank = myrank,
+        .oob_group = {
+            .allgather = ucg_group_derive_allgather,
+            .myrank = myrank,
+            .size = size,
+            .group = derive,
+        },
+    };
+    ucg_status_t status = ucg_rank_map_init_by_array(&params.rank_map, &ctx_ranks, size, 1);
+    if (status != UCG_OK) {
+        ucg_free(ctx_ranks);
+        return status;
+    }
+
+    /* The topology is built from the locations cached by the context. */
+    status = ucg_group_create(parent->context, &params, group);
+    ucg_rank_map_cleanup(&params.rank_map);
+    return status;
+}
+
+/*
+ * Every process of the parent calls it, so that the processes that aren't
+ * members take part in the allgathers made while the group is created.
+ */
+static ucg_status_t ucg_group_derive(ucg_group_t *parent, const ucg_rank_t *ranks,
+                                     uint32_t size, ucg_rank_t myrank, uint32_t id,
+                                     ucg_group_h *group)
+{
+    *group = NULL;
+    ucg_status_t status = ucg_group_derive_check_ranks(parent, ranks, size);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_group_derive_t *derive = ucg_group_derive_new(parent, ranks, size);
+    if (derive == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    if (myrank != UCG_INVALID_RANK) {
+        status = ucg_group_derive_create(derive, myrank, id, group);
+        if (status == UCG_OK) {
+            derive->group = *group;
+        }
+    }
+    ucg_status_t finish_status = ucg_group_derive_finish(derive);
+    if (finish_status != UCG_OK) {
+        ucg_error("Failed to finish the exchanges of parent group id %d", parent->id);
+        if (*group != NULL) {
+            ucg_group_destroy(*group);
+            *group = NULL;
+        }
+        status = finish_status;
+    }
+    /* The parent may be destroyed before the group. */
+    derive->parent = NULL;
+    if (*group == NULL) {
+        ucg_group_derive_free(derive);
+    }
+    return status;
+}
+
+static int ucg_group_split_member_compare(const void *a, const void *b)
+{
+    const ucg_group_split_member_t *member1 = (const ucg_group_split_member_t*)a;
+    const ucg_group_split_member_t *member2 = (const ucg_group_split_member_t*)b;
+    if (member1->key != member2->key) {
+        return member1->key < member2->key ? -1 : 1;
+    }
+    return member1->rank < member2->rank ? -1 : (member1->rank > member2->rank);
+}
+
+ucg_status_t ucg_group_split(ucg_group_h parent, int32_t color, int32_t key,
+                             uint32_t id, ucg_group_h *group)
+{
+    UCG_CHECK_NULL_INVALID(parent, group);
+
+    uint32_t parent_size = parent->size;
+    ucg_status_t status = UCG_ERR_NO_MEMORY;
+    ucg_group_split_member_t *members = NULL;
+    ucg_rank_t *ranks = NULL;
+    int32_t *colors = ucg_malloc(parent_size * 2 * sizeof(int32_t), "split colors");
+    int32_t *counts = ucg_malloc(parent_size * sizeof(int32_t), "split counts");
+    int32_t *displs = ucg_malloc(parent_size * sizeof(int32_t), "split displs");
+    if (colors == NULL || counts == NULL || displs == NULL) {
+        goto out;
+    }
+
+    for (uint32_t i = 0; i < parent_size; ++i) {
+        counts[i] = 2;
+        displs[i] = 2 * i;
+    }
+    int32_t mine[2] = {color, key};
+    status = ucg_group_run_allgatherv(parent, mine, 2, colors, counts, displs,
+                                      UCG_DT_TYPE_INT32);
+    if (status != UCG_OK) {
+        ucg_error("Failed to allgather colors of group id %d", parent->id);
+        goto out;
+    }
+
+    uint32_t size = 0;
+    ucg_rank_t myrank = UCG_INVALID_RANK;
+    if (color >= 0) {
+        members = ucg_malloc(parent_size * sizeof(ucg_group_split_member_t), "split members");
+        ranks = ucg_malloc(parent_size * sizeof(ucg_rank_t), "split ranks");
+        if (members == NULL || ranks == NULL) {
+            status = UCG_ERR_NO_MEMORY;
+            goto out;
+        }
+        for (uint32_t i = 0; i < parent_size; ++i) {
+            if (colors[2 * i] == color) {
+                members[size].key = colors[2 * i + 1];
+                members[size].rank = i;
+                ++size;
+            }
+        }
+        qsort(members, size, sizeof(ucg_group_split_member_t), ucg_group_split_member_compare);
+        for (uint32_t i = 0; i < size; ++i) {
+            ranks[i] = members[i].rank;
+            if (ranks[i] == parent->myrank) {
+                myrank = i;
+            }
+        }
+    }
+    status = ucg_group_derive(parent, ranks, size, myrank, id, group);
+
+out:
+    ucg_free(ranks);
+    ucg_free(members);
+    ucg_free(displs);
+    ucg_free(counts);
+    ucg_free(colors);
+    return status;
+}
+
+ucg_status_t ucg_group_create_from_ranks(ucg_group_h parent, const ucg_rank_t *ranks,
+                                         uint32_t size, uint32_t id, ucg_group_h *group)
+{
+    UCG_CHECK_NULL_INVALID(parent, ranks, group);
+
+    ucg_rank_t myrank = UCG_INVALID_RANK;
+    for (uint32_t i = 0; i < size; ++i) {
+        if (ranks[i] == parent->myrank) {
+            myrank = i;
+            break;
+        }
+    }
+    return ucg_group_derive(parent, ranks, size, myrank, id, group);
+}
+
+int ucg_group_is_derived(const ucg_group_t *group)
+{
+    return group->oob_group.allgather == ucg_group_derive_allgather;
+}
+
+void* ucg_group_get_root_oob_group(const ucg_group_t *group, ucg_rank_t rank,
+                                   ucg_rank_t *root_rank)
+{
+    if (!ucg_group_is_derived(group)) {
+        *root_rank = rank;
+        return group->oob_group.group;
+    }
+
+    ucg_group_derive_t *derive = (ucg_group_derive_t*)group->oob_group.group;
+    *root_rank = derive->root_ranks[rank];
+    return derive->root_oob_group;
+}
+
+int ucg_group_progress(ucg_group_t *group)
+{
+    int count = 0;
+    ucg_request_t *req = NULL;
+    ucg_request_t *tmp_req = NULL;
+    ucg_list_for_each_safe(req, tmp_req, &group->plist, list) {
+        ucg_status_t status = ucg_request_progress(req);
+        if (status != UCG_INPROGRESS) {
+            ++count;
+        }
+    }
+
+    /* The requests woken up by the following tests are left to the next progress.
+       A request stays ready until it's extracted, so that the callbacks don't
+       link it again while it's in the local list. */
+    ucg_list_link_t ready;
+    ucg_list_head_init(&ready);
+    ucg_lock_enter(&group->rlist_lock);
+    ucg_list_splice_tail(&ready, &group->rlist);
+    ucg_list_head_init(&group->rlist);
+    ucg_lock_leave(&group->rlist_lock);
+    while (1) {
+        ucg_lock_enter(&group->rlist_lock);
+        if (ucg_list_is_empty(&ready)) {
+            ucg_lock_leave(&group->rlist_lock);
+            break;
+        }
+        req = ucg_list_extract_head(&ready, ucg_request_t, list);
+        req->ready = 0;
+        ucg_lock_leave(&group->rlist_lock);
+        if (req->status != UCG_INPROGRESS) {
+            continue;
+        }
+        ucg_status_t status = ucg_request_progress(req);
+        if (status != UCG_INPROGRESS) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+ucg_status_t ucg_group_alloc_req_id(ucg_group_t *group, ucg_request_t *request)
+{
+    uint32_t req_id = group->unique_req_id + 1;
+    if (req_id == UCG_GROUP_INVALID_REQ_ID) {
+        ++req_id;
+    }
+
+    /* The messages of the two requests can't be told apart, so the oldest request
+       must complete first. The others complete it too, it doesn't depend on this one. */
+    if (!ucg_list_is_empty(&group->id_list)) {
+        ucg_request_t *oldest = ucg_list_head(&group->id_list, ucg_request_t, id_list);
+        if (req_id - oldest->id >= group->context->req_id_window) {
+            return UCG_ERR_NO_RESOURCE;
+        }
+    }
+
+    group->unique_req_id = req_id;
+    request->id = req_id;
+    ucg_list_add_tail(&group->id_list, &request->id_list);
+    return UCG_OK;
+}
+
+void ucg_group_free_req_id(ucg_group_t *group, ucg_request_t *request)
+{
+    ucg_assert(request->id != UCG_GROUP_INVALID_REQ_ID);
+    ucg_list_del(&request->id_list);
+    request->id = UCG_GROUP_INVALID_REQ_ID;
+    return;
+}
@@ -10,13 +10,28 @@
 #include "ucg_def.h"
 #include "ucg_context.h"
 #include "ucg_rank_map.h"
+#include "ucg_op_cache.h"
+#include "ucg_plan_tuner.h"
 
 #include "planc/ucg_planc_def.h"
 
 #define UCG_GROUP_INVALID_REQ_ID 0
 
+/**
+ * @brief Information of a plan that a group may select.
+ */
+typedef struct ucg_plan_info {
+    /* Plan id, unique among the plans of the same planc and collective. */
+    int32_t id;
+    /* Plan name. */
+    const char *name;
+    /* Name of the planc that provides the plan. */
+    const char *planc;
+} ucg_plan_info_t;
+
 typedef struct ucg_group {
     ucg_context_t *context;
+    /* may be shared with other groups, @ref ucg_plans_key_t */
     ucg_plans_t *plans;
 
     int32_t num_planc_groups;
@@ -30,7 +45,29 @@ typedef struct ucg_group {
     ucg_rank_map_t rank_map; /* convert group rank to context rank */
     ucg_oob_group_t oob_group;
     /* collective operation request id */
-    uint16_t unique_req_id;
+    uint32_t unique_req_id;
+    /* started requests in the order of their ids, the oldest first */
+    ucg_list_link_t id_list;
+    /* idle ops that can be reused by the same collective operation */
+    ucg_op_cache_t op_cache;
+    /* plans chosen by measurement */
+    ucg_plan_tuner_t tuner;
+    /* plans that replace the selection, @ref ucg_group_force_plan */
+    ucg_plan_t *forced_plans[UCG_COLL_TYPE_LAST][UCG_MEM_TYPE_LAST];
+
+    /* link to the group list of the context */
+    ucg_list_link_t list;
+    /* Ensure thread-safe of the requests of the group, taken after the context lock. */
+    ucg_lock_t lock;
+    ucg_list_link_t plist; /* progress list, requests tested in every progress */
+    ucg_list_link_t rlist; /* ready list, event-driven requests woken up */
+    /* Request agreeing on its plan, the requests started afterwards are parked
+       in the start order and triggered after it selects. */
+    ucg_request_t *selecting;
+    ucg_list_link_t slist; /* parked list */
+    /* The completion callbacks of any thread wake up the requests, so the ready
+       list has its own lock which is never held while taking another lock. */
+    ucg_lock_t rlist_lock;
 } ucg_group_t;
 
 /**
@@ -79,22 +116,103 @@ static inline ucg_status_t ucg_group_get_location(ucg_group_t *group,
     return ucg_context_get_location(group->context, ctx_rank, location);
 }
 
-/* In the same communication group, different members must obtain the same request
-   ID when executing this function at the same time. */
-static inline uint16_t ucg_group_alloc_req_id(ucg_group_t *ucg_group)
+static inline void ucg_group_lock(ucg_group_t *group)
 {
-    uint16_t unique_req_id = ++ucg_group->unique_req_id;
-    if (unique_req_id == UCG_GROUP_INVALID_REQ_ID) {
-        unique_req_id = ++ucg_group->unique_req_id;
-    }
-    return unique_req_id;
+    ucg_context_lock(group->context);
+    ucg_lock_enter(&group->lock);
+    return;
 }
 
-/* Release the request id returned by ucg_group_alloc_req_id() */
-static inline void ucg_group_free_req_id(ucg_group_t *ucg_group, uint16_t req_id)
+static inline void ucg_group_unlock(ucg_group_t *group)
 {
-    /* Do nothing based on the current implementation. */
+    ucg_lock_leave(&group->lock);
+    ucg_context_unlock(group->context);
     return;
 }
 
+/**
+ * @brief Whether the group is created from a parent group by @ref ucg_group_split
+ * or @ref ucg_group_create_from_ranks.
+ *
+ * The allgather of the OOB group of a derived group runs over the parent while
+ * the group is created, and over the group itself afterwards.
+ */
+int ucg_group_is_derived(const ucg_group_t *group);
+
+/**
+ * @brief Get the OOB group given by the user that the group comes from.
+ *
+ * It's the OOB group of the group, or of its first ancestor that isn't derived.
+ *
+ * @param [in]  group       UCG Group
+ * @param [in]  rank        Group rank
+ * @param [out] root_rank   Rank in the returned OOB group
+ * @return @ref ucg_oob_group_t::group of the group or the ancestor
+ */
+void* ucg_group_get_root_oob_group(const ucg_group_t *group, ucg_rank_t rank,
+                                   ucg_rank_t *root_rank);
+
+/**
+ * @brief Test the requests of the group in the progress list and the ready list.
+ *
+ * The caller must hold the group lock.
+ *
+ * @return Number of completed requests.
+ */
+int ucg_group_progress(ucg_group_t *group);
+
+/**
+ * @brief Allocate the id of a request that is going to start.
+ *
+ * In the same communication group, different members must obtain the same request
+ * ID when executing this function at the same time. When the id is the same as that
+ * of the oldest request in flight in the id bits of the plancs, no id is allocated,
+ * see @ref ucg_context_t::req_id_window.
+ *
+ * The caller must hold the group lock.
+ *
+ * @retval UCG_ERR_NO_RESOURCE The oldest request must complete before retrying.
+ */
+ucg_status_t ucg_group_alloc_req_id(ucg_group_t *group, ucg_request_t *request);
+
+/* Release the request id allocated by ucg_group_alloc_req_id() */
+void ucg_group_free_req_id(ucg_group_t *group, ucg_request_t *request);
+
+/**
+ * @brief Query the plans of a collective operation in the group.
+ *
+ * Each plan is reported once, sorted by planc and then by id. The strings are
+ * valid until the group is destroyed.
+ *
+ * @param [in]    group     Group.
+ * @param [in]    coll_type Collective operation type.
+ * @param [in]    mem_type  Memory type of the buffers.
+ * @param [out]   infos     Information of the plans, can be NULL to only get the count.
+ * @param [inout] count     Capacity of infos, set to the number of plans on return.
+ * @retval UCG_OK Success.
+ * @retval UCG_ERR_TRUNCATE The capacity is less than the number of plans.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_group_query_plans(ucg_group_t *group, ucg_coll_type_t coll_type,
+                                   ucg_mem_type_t mem_type, ucg_plan_info_t *infos,
+                                   uint32_t *count);
+
+/**
+ * @brief Make the requests of a collective operation use one plan of the group.
+ *
+ * The plan replaces the selection by message size, cost and tuning for the
+ * requests initialized afterwards, the cached ops are discarded. It's meant for
+ * benchmarks, all members must force the same plan.
+ *
+ * @param [in] group        Group.
+ * @param [in] coll_type    Collective operation type.
+ * @param [in] mem_type     Memory type of the buffers.
+ * @param [in] planc        Name of the planc that provides the plan, NULL to restore
+ *                          the selection.
+ * @param [in] id           Plan id, see @ref ucg_plan_info_t.
+ * @retval UCG_ERR_NOT_FOUND The group has no such plan.
+ */
+ucg_status_t ucg_group_force_plan(ucg_group_t *group, ucg_coll_type_t coll_type,
+                                  ucg_mem_type_t mem_type, const char *planc, int32_t id);
+
 #endif
\ No newline at end of file
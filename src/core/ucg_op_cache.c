@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_op_cache.h"
+
+#include "util/ucg_log.h"
+#include "util/ucg_malloc.h"
+
+#include <string.h>
+
+
+static ucg_status_t ucg_op_cache_key_set_reduce(ucg_op_cache_key_t *key,
+                                                int32_t count, const ucg_dt_t *dt,
+                                                const ucg_op_t *op)
+{
+    if (!ucg_dt_is_predefined(dt) || !ucg_op_is_predefined(op)) {
+        return UCG_ERR_UNSUPPORTED;
+    }
+    key->count = count;
+    key->dt = dt;
+    key->op_type = ucg_op_type(op);
+    key->op_func = op->func;
+    return UCG_OK;
+}
+
+ucg_status_t ucg_op_cache_key_init(ucg_op_cache_key_t *key, const ucg_coll_args_t *args)
+{
+    /* Keys are compared by memcmp(), clear the padding. */
+    memset(key, 0, sizeof(*key));
+    key->coll_type = args->type;
+    key->mem_type = args->info.mem_type;
+
+    switch (args->type) {
+        case UCG_COLL_TYPE_BCAST:
+            if (!ucg_dt_is_predefined(args->bcast.dt)) {
+                return UCG_ERR_UNSUPPORTED;
+            }
+            key->count = args->bcast.count;
+            key->dt = args->bcast.dt;
+            key->root = args->bcast.root;
+            return UCG_OK;
+        case UCG_COLL_TYPE_ALLREDUCE:
+            key->inplace = (args->allreduce.sendbuf == UCG_IN_PLACE);
+            return ucg_op_cache_key_set_reduce(key, args->allreduce.count,
+                                               args->allreduce.dt,
+                                               args->allreduce.op);
+        case UCG_COLL_TYPE_BARRIER:
+            return UCG_OK;
+        default:
+            /* The counts of v-collectives are not part of the key. */
+            return UCG_ERR_UNSUPPORTED;
+    }
+}
+
+ucg_status_t ucg_op_cache_init(ucg_op_cache_t *cache, uint32_t size)
+{
+    cache->size = 0;
+    cache->stamp = 0;
+    cache->entries = NULL;
+    if (size == 0) {
+        return UCG_OK;
+    }
+
+    cache->entries = ucg_calloc(size, sizeof(ucg_op_cache_entry_t), "op cache entries");
+    if (cache->entries == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    cache->size = size;
+    return UCG_OK;
+}
+
+void ucg_op_cache_flush(ucg_op_cache_t *cache)
+{
+    for (uint32_t i = 0; i < cache->size; ++i) {
+        ucg_plan_op_t *op = cache->entries[i].op;
+        if (op != NULL) {
+            op->discard(op);
+            cache->entries[i].op = NULL;
+        }
+    }
+    return;
+}
+
+void ucg_op_cache_cleanup(ucg_op_cache_t *cache)
+{
+    ucg_op_cache_flush(cache);
+    ucg_free(cache->entries);
+    cache->entries = NULL;
+    cache->size = 0;
+    return;
+}
+
+ucg_plan_op_t* ucg_op_cache_get(ucg_op_cache_t *cache, const ucg_op_cache_key_t *key)
+{
+    for (uint32_t i = 0; i < cache->size; ++i) {
+        ucg_op_cache_entry_t *entry = &cache->entries[i];
+        if (entry->op != NULL && !memcmp(&entry->key, key, sizeof(*key))) {
+            ucg_plan_op_t *op = entry->op;
+            entry->op = NULL;
+            return op;
+        }
+    }
+    return NULL;
+}
+
+ucg_status_t ucg_op_cache_put(ucg_op_cache_t *cache, ucg_plan_op_t *op)
+{
+    if (cache->size == 0 || op->rebind == NULL || op->super.status != UCG_OK) {
+        return op->discard(op);
+    }
+
+    ucg_op_cache_key_t key;
+    if (ucg_op_cache_key_init(&key, &op->super.args) != UCG_OK) {
+        return op->discard(op);
+    }
+
+    ucg_op_cache_entry_t *victim = &cache->entries[0];
+    for (uint32_t i = 0; i < cache->size; ++i) {
+        ucg_op_cache_entry_t *entry = &cache->entries[i];
+        if (entry->op == NULL) {
+            victim = entry;
+            break;
+        }
+        if (entry->stamp < victim->stamp) {
+            victim = entry;
+        }
+    }
+
+    ucg_status_t status = UCG_OK;
+    if (victim->op != NULL) {
+        ucg_debug("Evict op(%d) from cache", victim->key.coll_type);
+        status = victim->op->discard(victim->op);
+    }
+    victim->key = key;
+    victim->op = op;
+    victim->stamp = ++cache->stamp;
+    return status;
+}
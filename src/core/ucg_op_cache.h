@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_OP_CACHE_H_
+#define UCG_OP_CACHE_H_
+
+#include "ucg_plan.h"
+
+/**
+ * @brief Signature of a collective operation.
+ *
+ * Two collective operations with the same signature select the same plan,
+ * the op prepared for one can serve the other after rebinding the buffers.
+ */
+typedef struct ucg_op_cache_key {
+    ucg_coll_type_t coll_type;
+    ucg_mem_type_t mem_type;
+    int32_t count;
+    const ucg_dt_t *dt;
+    ucg_op_type_t op_type;
+    ucg_op_func_t op_func;
+    ucg_rank_t root;
+    uint8_t inplace;
+} ucg_op_cache_key_t;
+
+typedef struct ucg_op_cache_entry {
+    ucg_op_cache_key_t key;
+    /** Idle op, NULL if the entry is empty. */
+    ucg_plan_op_t *op;
+    /** Last time the entry is filled, the smallest one is evicted first. */
+    uint64_t stamp;
+} ucg_op_cache_entry_t;
+
+/**
+ * @brief Idle ops of a group, keyed on the signature of the collective operation.
+ */
+typedef struct ucg_op_cache {
+    uint32_t size;
+    uint64_t stamp;
+    ucg_op_cache_entry_t *entries;
+} ucg_op_cache_t;
+
+/**
+ * @brief Initialize op cache
+ *
+ * @param [in] cache    Op cache.
+ * @param [in] size     Maximum number of cached ops, 0 disables the cache.
+ */
+ucg_status_t ucg_op_cache_init(ucg_op_cache_t *cache, uint32_t size);
+
+/**
+ * @brief Discard all cached ops and cleanup op cache
+ */
+void ucg_op_cache_cleanup(ucg_op_cache_t *cache);
+
+/**
+ * @brief Discard all cached ops and keep the cache usable.
+ */
+void ucg_op_cache_flush(ucg_op_cache_t *cache);
+
+/**
+ * @brief Get the signature of a collective operation.
+ *
+ * Only the operations on predefined datatypes and predefined reduction ops are
+ * cacheable, others may be freed by the user and reused with another layout.
+ *
+ * @retval UCG_OK               The operation is cacheable.
+ * @retval UCG_ERR_UNSUPPORTED  The operation is not cacheable.
+ */
+ucg_status_t ucg_op_cache_key_init(ucg_op_cache_key_t *key, const ucg_coll_args_t *args);
+
+/**
+ * @brief Take an idle op with the same signature out of the cache.
+ *
+ * @return The op whose buffers need to be rebound, NULL if not found.
+ */
+ucg_plan_op_t* ucg_op_cache_get(ucg_op_cache_t *cache, const ucg_op_cache_key_t *key);
+
+/**
+ * @brief Put a completed op into the cache.
+ *
+ * The op is discarded if it is not cacheable. When the cache is full, the least
+ * recently cached op is discarded to make room.
+ *
+ * @return Status of discarding the op.
+ */
+ucg_status_t ucg_op_cache_put(ucg_op_cache_t *cache, ucg_plan_op_t *op);
+
+#endif
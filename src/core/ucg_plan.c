@@ -12,6 +12,8 @@
 #include "util/ucg_malloc.h"
 #include "util/ucg_mpool.h"
 
+#include <string.h>
+
 
 static ucg_status_t ucg_plan_op_ctor(ucg_plan_op_t *self,
                                      ucg_vgroup_t *vgroup,
@@ -28,6 +30,8 @@ static ucg_status_t ucg_plan_op_ctor(ucg_plan_op_t *self,
     self->trigger = trigger;
     self->progress = progress;
     self->discard = discard;
+    self->rebind = NULL;
+    self->reserve = NULL;
     return UCG_OK;
 }
 
@@ -38,31 +42,46 @@ static void ucg_plan_op_dtor(ucg_plan_op_t *self)
 }
 UCG_CLASS_DEFINE(ucg_plan_op_t, ucg_plan_op_ctor, ucg_plan_op_dtor);
 
+ucg_status_t ucg_plan_op_rebind_buffers(ucg_plan_op_t *op, const ucg_coll_args_t *args)
+{
+    ucg_assert(op->super.args.type == args->type);
+    ucg_request_set_args(&op->super, args);
+    return UCG_OK;
+}
+
 static ucg_status_t ucg_plan_meta_op_progress(ucg_plan_op_t *ucg_op)
 {
     ucg_status_t status = UCG_OK;
     ucg_plan_meta_op_t *meta_op = ucg_derived_of(ucg_op, ucg_plan_meta_op_t);
 
-    int cur_op_idx = meta_op->n_completed_ops;
-    ucg_plan_op_t *curr_op = meta_op->ops[cur_op_idx];
-
-    if (!meta_op->triggered) {
-        /* To ensure that requests of multiple members in the same collection op
-           can be matched, all subops must have the same request ID. */
-        curr_op->super.id = meta_op->super.super.id;
-        status = curr_op->trigger(curr_op);
-        meta_op->triggered = 1;
-    }
+    do {
+        int cur_op_idx = meta_op->n_completed_ops;
+        ucg_plan_op_t *curr_op = meta_op->ops[cur_op_idx];
+
+        if (!meta_op->triggered) {
+            /* To ensure that requests of multiple members in the same collection op
+               can be matched, all subops must have the same request ID. */
+            curr_op->super.id = meta_op->super.super.id;
+            /* The completions of subop wake up the owner of the meta op. */
+            curr_op->super.owner = meta_op->super.super.owner;
+            status = curr_op->trigger(curr_op);
+            meta_op->triggered = 1;
+        }
 
-    status = curr_op->progress(curr_op);
-    if (status == UCG_OK) {
+        status = curr_op->progress(curr_op);
+        if (status != UCG_OK) {
+            break;
+        }
         ++meta_op->n_completed_ops;
         meta_op->triggered = 0;
         if (meta_op->n_completed_ops == meta_op->n_ops) {
             meta_op->super.super.status = UCG_OK;
             return UCG_OK;
         }
-    } else if (status != UCG_INPROGRESS) {
+        /* Trigger the next op now, there is no event to wake it up later. */
+    } while (1);
+
+    if (status != UCG_INPROGRESS) {
         meta_op->super.super.status = status;
     }
     return meta_op->super.super.status;
@@ -79,6 +98,12 @@ static ucg_status_t ucg_plan_meta_op_trigger(ucg_plan_op_t *ucg_op)
 
     meta_op->super.super.status = UCG_INPROGRESS;
     meta_op->n_completed_ops = 0;
+    for (int i = 0; i < meta_op->n_ops; ++i) {
+        ucg_plan_op_t *op = meta_op->ops[i];
+        if (op->reserve != NULL) {
+            op->reserve(op);
+        }
+    }
 
     ucg_status_t status = ucg_plan_meta_op_progress(ucg_op);
     if (status == UCG_INPROGRESS) {
@@ -126,6 +151,8 @@ ucg_plan_meta_op_t *ucg_plan_meta_op_new(ucg_group_t *group,
     meta_op->n_ops = 0;
     meta_op->n_completed_ops = 0;
     meta_op->triggered = 0;
+    /* Until an op that is not event-driven is added. */
+    meta_op->super.super.event_driven = 1;
 
     return meta_op;
 
@@ -233,6 +260,8 @@ static ucg_status_t ucg_plan_apply_attr(ucg_plan_t *plan, const ucg_plan_attr_t
     plan_attr->prepare = attr->prepare;
     plan_attr->vgroup = attr->vgroup;
     plan_attr->score = attr->score;
+    plan_attr->cost = attr->cost;
+    plan_attr->score_fixed = attr->score_fixed;
     plan_attr->range = attr->range;
     plan_attr->id = attr->id;
     plan_attr->name = ucg_strdup(attr->name, "ucg plan name");
@@ -278,6 +307,8 @@ static ucg_plan_t* ucg_plan_create(const ucg_plan_params_t *params)
     }
 
     plan->type = UCG_PLAN_TYPE_FIRST_CLASS;
+    plan->provider = UCG_PLAN_PROVIDER_NONE;
+    plan->planc = UCG_PLAN_PLANC_NONE;
     ucg_list_head_init(&plan->fallback);
 
     return plan;
@@ -320,6 +351,8 @@ static ucg_plan_t* ucg_plan_dup(const ucg_plan_t *plan)
     }
 
     new_plan->type = plan->type;
+    new_plan->provider = plan->provider;
+    new_plan->planc = plan->planc;
     if (new_plan->type == UCG_PLAN_TYPE_FIRST_CLASS) {
         ucg_list_head_init(&new_plan->fallback);
         ucg_plan_t *plan_fb = NULL;
@@ -634,6 +667,97 @@ static ucg_status_t ucg_plans_merge_one(ucg_list_link_t *head,
     return UCG_OK;
 }
 
+static void ucg_plan_table_cleanup(ucg_plan_table_t *table)
+{
+    if (table->entries != NULL) {
+        ucg_free(table->entries);
+    }
+    if (table->plans != NULL) {
+        ucg_free(table->plans);
+    }
+    table->entries = NULL;
+    table->plans = NULL;
+    table->num_entries = 0;
+    return;
+}
+
+/**
+ * Compile the linked list into a lookup table. The linked list is already
+ * sorted by range and the ranges do not overlap, see @ref ucg_plans_add.
+ * The old table is kept if it fails.
+ */
+static ucg_status_t ucg_plan_table_build(ucg_plan_table_t *table,
+                                         const ucg_list_link_t *head)
+{
+    uint32_t num_entries = 0;
+    uint32_t num_plans = 0;
+    ucg_plan_t *plan = NULL;
+    ucg_list_for_each(plan, head, list) {
+        ++num_entries;
+        num_plans += 1 + ucg_list_length(&plan->fallback);
+    }
+
+    ucg_plan_table_t new_table = {0, NULL, NULL};
+    if (num_entries == 0) {
+        goto out;
+    }
+
+    new_table.entries = ucg_malloc(num_entries * sizeof(ucg_plan_table_entry_t),
+                                   "ucg plan table entries");
+    if (new_table.entries == NULL) {
+        goto err;
+    }
+    new_table.plans = ucg_malloc(num_plans * sizeof(ucg_plan_t*), "ucg plan table plans");
+    if (new_table.plans == NULL) {
+        goto err_free_entries;
+    }
+
+    ucg_plan_t **plans = new_table.plans;
+    ucg_list_for_each(plan, head, list) {
+        ucg_plan_table_entry_t *entry = &new_table.entries[new_table.num_entries++];
+        entry->range = plan->attr.range;
+        entry->plans = plans;
+        *plans++ = plan;
+        ucg_plan_t *plan_fb = NULL;
+        ucg_list_for_each(plan_fb, &plan->fallback, fallback) {
+            *plans++ = plan_fb;
+        }
+        entry->num_plans = plans - entry->plans;
+    }
+
+out:
+    ucg_plan_table_cleanup(table);
+    *table = new_table;
+    return UCG_OK;
+
+err_free_entries:
+    ucg_free(new_table.entries);
+err:
+    return UCG_ERR_NO_MEMORY;
+}
+
+static const ucg_plan_table_entry_t* ucg_plan_table_lookup(const ucg_plan_table_t *table,
+                                                           uint64_t msg_size)
+{
+    /* Find the first entry that starts after msg_size, the previous one is the candidate. */
+    uint32_t low = 0;
+    uint32_t high = table->num_entries;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (table->entries[middle].range.start <= msg_size) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low == 0) {
+        return NULL;
+    }
+    const ucg_plan_table_entry_t *entry = &table->entries[low - 1];
+    return msg_size < entry->range.end ? entry : NULL;
+}
+
 ucg_status_t ucg_plans_init(ucg_plans_t **plans)
 {
     UCG_CHECK_NULL_INVALID(plans);
@@ -650,8 +774,15 @@ ucg_status_t ucg_plans_init(ucg_plans_t **plans)
     for (coll_type = 0; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
         for (mem_type = 0; mem_type < UCG_MEM_TYPE_LAST; ++mem_type) {
             ucg_list_head_init(&p->plans[coll_type][mem_type]);
+            ucg_plan_table_t *table = &p->tables[coll_type][mem_type];
+            table->num_entries = 0;
+            table->entries = NULL;
+            table->plans = NULL;
         }
     }
+    memset(&p->key, 0, sizeof(p->key));
+    p->refcount = 1;
+    ucg_list_head_init(&p->list);
 
     *plans = p;
     return UCG_OK;
@@ -665,6 +796,7 @@ void ucg_plans_cleanup(ucg_plans_t *plans)
     ucg_mem_type_t mem_type;
     for (coll_type = 0; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
         for (mem_type = 0; mem_type < UCG_MEM_TYPE_LAST; ++mem_type) {
+            ucg_plan_table_cleanup(&plans->tables[coll_type][mem_type]);
             ucg_plans_cleanup_one(&plans->plans[coll_type][mem_type]);
         }
     }
@@ -673,6 +805,65 @@ void ucg_plans_cleanup(ucg_plans_t *plans)
     return;
 }
 
+void ucg_plans_set_planc(ucg_plans_t *plans, int32_t planc)
+{
+    UCG_CHECK_NULL_VOID(plans);
+
+    ucg_coll_type_t coll_type;
+    ucg_mem_type_t mem_type;
+    for (coll_type = 0; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
+        for (mem_type = 0; mem_type < UCG_MEM_TYPE_LAST; ++mem_type) {
+            ucg_plan_t *plan = NULL;
+            ucg_list_for_each(plan, &plans->plans[coll_type][mem_type], list) {
+                if (plan->planc == UCG_PLAN_PLANC_NONE) {
+                    plan->planc = planc;
+                }
+                ucg_plan_t *plan_fb = NULL;
+                ucg_list_for_each(plan_fb, &plan->fallback, fallback) {
+                    if (plan_fb->planc == UCG_PLAN_PLANC_NONE) {
+                        plan_fb->planc = planc;
+                    }
+                }
+            }
+        }
+    }
+    return;
+}
+
+static int ucg_plan_bind(ucg_plan_t *plan, ucg_planc_group_h *planc_groups, int32_t num)
+{
+    plan->provider = UCG_PLAN_PROVIDER_NONE;
+    for (int32_t i = 0; i < num; ++i) {
+        if ((ucg_vgroup_t*)planc_groups[i] == plan->attr.vgroup) {
+            plan->provider = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int ucg_plans_bind(ucg_plans_t *plans, ucg_planc_group_h *planc_groups, int32_t num)
+{
+    UCG_CHECK_NULL(0, plans, planc_groups);
+
+    int bound = 1;
+    ucg_coll_type_t coll_type;
+    ucg_mem_type_t mem_type;
+    for (coll_type = 0; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
+        for (mem_type = 0; mem_type < UCG_MEM_TYPE_LAST; ++mem_type) {
+            ucg_plan_t *plan = NULL;
+            ucg_list_for_each(plan, &plans->plans[coll_type][mem_type], list) {
+                bound &= ucg_plan_bind(plan, planc_groups, num);
+                ucg_plan_t *plan_fb = NULL;
+                ucg_list_for_each(plan_fb, &plan->fallback, fallback) {
+                    bound &= ucg_plan_bind(plan_fb, planc_groups, num);
+                }
+            }
+        }
+    }
+    return bound;
+}
+
 void ucg_plans_print(const ucg_plans_t *plans, FILE *stream)
 {
     fprintf(stream, "# Details of all plans\n");
@@ -720,6 +911,8 @@ ucg_status_t ucg_plans_add(ucg_plans_t *plans, const ucg_plan_params_t *params)
     ucg_status_t status = ucg_plans_add_one(head, new_plan);
     if (status != UCG_OK) {
         ucg_plan_destroy(new_plan);
+        /* Merge the existing plans that were split back into one. */
+        ucg_plans_compact_one(head);
         return status;
     }
 
@@ -727,6 +920,25 @@ ucg_status_t ucg_plans_add(ucg_plans_t *plans, const ucg_plan_params_t *params)
     return UCG_OK;
 }
 
+ucg_status_t ucg_plans_build(ucg_plans_t *plans)
+{
+    UCG_CHECK_NULL_INVALID(plans);
+
+    ucg_coll_type_t coll_type;
+    ucg_mem_type_t mem_type;
+    for (coll_type = 0; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
+        for (mem_type = 0; mem_type < UCG_MEM_TYPE_LAST; ++mem_type) {
+            ucg_status_t status;
+            status = ucg_plan_table_build(&plans->tables[coll_type][mem_type],
+                                          &plans->plans[coll_type][mem_type]);
+            if (status != UCG_OK) {
+                return status;
+            }
+        }
+    }
+    return UCG_OK;
+}
+
 ucg_status_t ucg_plans_merge(ucg_plans_t **dst, const ucg_plans_t *src)
 {
     UCG_CHECK_NULL_INVALID(dst, *dst, src);
@@ -770,47 +982,105 @@ err:
     return status;
 }
 
+const ucg_plan_table_entry_t* ucg_plans_lookup(const ucg_plans_t *plans,
+                                               const ucg_coll_args_t *args,
+                                               const uint32_t size,
+                                               uint64_t *msg_size)
+{
+    if (ucg_request_msg_size(args, size, msg_size) != UCG_OK) {
+        return NULL;
+    }
+
+    const ucg_plan_table_t *table = &plans->tables[args->type][args->info.mem_type];
+    return ucg_plan_table_lookup(table, *msg_size);
+}
+
+int ucg_plans_size_dependent(const ucg_plans_t *plans, ucg_coll_type_t coll_type,
+                             ucg_mem_type_t mem_type)
+{
+    const ucg_plan_table_t *table = &plans->tables[coll_type][mem_type];
+    if (table->num_entries != 1) {
+        return table->num_entries > 1;
+    }
+    const ucg_plan_range_t *range = &table->entries[0].range;
+    return range->start != 0 || range->end != UCG_PLAN_RANGE_MAX;
+}
+
+uint32_t ucg_plan_table_entry_cheapest(const ucg_plan_table_entry_t *entry,
+                                       ucg_planc_group_h *planc_groups, uint64_t msg_size)
+{
+    /* Plans that are not modeled or given score by user keep the priority. */
+    const ucg_plan_t *plan = entry->plans[0];
+    if (plan->attr.cost == NULL || plan->attr.score_fixed) {
+        return 0;
+    }
+
+    ucg_vgroup_t *vgroup = ucg_plan_vgroup(plan, planc_groups);
+    const ucg_context_t *context = vgroup->group->context;
+    if (!context->use_cost_model) {
+        return 0;
+    }
+
+    ucg_plan_cost_topo_t topo;
+    ucg_plan_cost_topo_init(&topo, vgroup);
+    ucg_plan_cost_params_t params = {
+        .model = &context->cost_model,
+        .topo = &topo,
+        .msg_size = msg_size,
+    };
+    uint32_t cheapest = 0;
+    double min_cost = 0;
+    for (uint32_t i = 0; i < entry->num_plans; ++i) {
+        plan = entry->plans[i];
+        if (plan->attr.cost == NULL) {
+            continue;
+        }
+        params.vgroup = ucg_plan_vgroup(plan, planc_groups);
+        double cost = plan->attr.cost(&params);
+        ucg_debug("plan '%s' in '%s' costs %.3f us", plan->attr.name,
+                  plan->attr.domain, cost * 1e6);
+        if (i == 0 || cost < min_cost) {
+            cheapest = i;
+            min_cost = cost;
+        }
+    }
+    return cheapest;
+}
+
 ucg_status_t ucg_plans_prepare(const ucg_plans_t *plans, const ucg_coll_args_t *args,
-                               const uint32_t size, ucg_plan_op_t **op)
+                               const uint32_t size, ucg_planc_group_h *planc_groups,
+                               ucg_plan_op_t **op)
 {
     UCG_CHECK_NULL_INVALID(plans, args, op);
 
     ucg_status_t status;
-    uint32_t msg_size = 0;
+    uint64_t msg_size = 0;
     status = ucg_request_msg_size(args, size, &msg_size);
     if (status != UCG_OK) {
         return status;
     }
 
-    int8_t found = 0;
-    ucg_plan_t *plan = NULL;
-    const ucg_list_link_t *head = &plans->plans[args->type][args->info.mem_type];
-    ucg_list_for_each(plan, head, list) {
-        ucg_plan_range_t *range = &plan->attr.range;
-        if (msg_size < range->start) {
-            break;
-        }
-
-        if (msg_size >= range->start && msg_size < range->end) {
-            found = 1;
-            break;
-        }
-    }
-
-    if (!found) {
+    const ucg_plan_table_t *table = &plans->tables[args->type][args->info.mem_type];
+    const ucg_plan_table_entry_t *entry = ucg_plan_table_lookup(table, msg_size);
+    if (entry == NULL) {
         return UCG_ERR_NOT_FOUND;
     }
 
-    status = plan->attr.prepare(plan->attr.vgroup, args, op);
+    ucg_assert(entry->plans[0]->type == UCG_PLAN_TYPE_FIRST_CLASS);
+    uint32_t first = ucg_plan_table_entry_cheapest(entry, planc_groups, msg_size);
+    ucg_plan_t *plan = entry->plans[first];
+    status = plan->attr.prepare(ucg_plan_vgroup(plan, planc_groups), args, op);
     if (status == UCG_OK) {
         ucg_info("select plan '%s' in '%s'", plan->attr.name, plan->attr.domain);
         return UCG_OK;
     }
 
-    ucg_assert(plan->type == UCG_PLAN_TYPE_FIRST_CLASS);
-    ucg_plan_t *plan_fb = NULL;
-    ucg_list_for_each(plan_fb, &plan->fallback, fallback) {
-        status = plan_fb->attr.prepare(plan_fb->attr.vgroup, args, op);
+    for (uint32_t i = 0; i < entry->num_plans; ++i) {
+        if (i == first) {
+            continue;
+        }
+        ucg_plan_t *plan_fb = entry->plans[i];
+        status = plan_fb->attr.prepare(ucg_plan_vgroup(plan_fb, planc_groups), args, op);
         if (status == UCG_OK) {
             ucg_info("select fallback plan '%s' in '%s', origin plan '%s'",
                      plan_fb->attr.name, plan_fb->attr.domain, plan->attr.name);
@@ -842,6 +1112,7 @@ ucg_status_t ucg_plan_attr_update(ucg_plan_attr_t *attr, const char *update)
             if (sscanf(attr_str, "S:%u%n", &score, &skip) != 1) {
                 return UCG_ERR_INVALID_PARAM;
             }
+            attr->score_fixed = 1;
         } else if (attr_str[0] == 'R') {
             int rc = sscanf(attr_str, "R:%lu-%lu%n", &range.start, &range.end, &skip);
             if (rc != 1 && rc != 2) {
@@ -7,6 +7,7 @@
 
 #include "ucg_request.h"
 #include "ucg_def.h"
+#include "ucg_plan_cost.h"
 
 #include "util/ucg_list.h"
 #include "util/ucg_class.h"
@@ -15,11 +16,16 @@
 #include "planc/ucg_planc_def.h"
 
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 
 
-#define UCG_PLAN_RANGE_MAX (ULONG_MAX)
+#define UCG_PLAN_RANGE_MAX (UINT64_MAX)
 #define UCG_PLAN_OPS_MAX 8
+/* The plan is executed by @ref ucg_plan_attr_t::vgroup. */
+#define UCG_PLAN_PROVIDER_NONE (-1)
+/* The plan is not added by a planc of the context. */
+#define UCG_PLAN_PLANC_NONE (-1)
 
 #define UCG_PLAN_ATTR_DESC \
     "Plan attribute that determines when to use the plan.\n" \
@@ -83,6 +89,12 @@ typedef ucg_status_t (*ucg_plan_prepare_func_t)(ucg_vgroup_t *vgroup,
                                                 const ucg_coll_args_t *args,
                                                 ucg_plan_op_t **op);
 
+/**
+ * @brief Type of rebinding plan operation to the buffers of new arguments
+ */
+typedef ucg_status_t (*ucg_plan_op_rebind_func_t)(ucg_plan_op_t *op,
+                                                  const ucg_coll_args_t *args);
+
 /**
  * @brief Plan operation.
  */
@@ -94,6 +106,15 @@ typedef struct ucg_plan_op {
     ucg_plan_op_func_t trigger;
     /** Release the operation. */
     ucg_plan_op_func_t discard;
+    /** Rebind the op to new buffers, NULL if the op can not be reused. */
+    ucg_plan_op_rebind_func_t rebind;
+    /**
+     * Take the turn of the op among the ops of other requests. It's called when
+     * the meta op that contains the op is triggered, so the turns follow the
+     * order in which the requests start even if the op is triggered later.
+     * NULL if the op does not need it.
+     */
+    ucg_plan_op_func_t reserve;
     /** Group that executes the op. */
     ucg_vgroup_t *vgroup;
 } ucg_plan_op_t;
@@ -144,6 +165,10 @@ typedef struct ucg_plan_attr {
     ucg_vgroup_t *vgroup;
     /** Plan score, larger value indicate higher priority. */
     uint32_t score;
+    /** Estimate of the completion time, NULL if the plan is not modeled. */
+    ucg_plan_cost_func_t cost;
+    /** The score is given by the user, which overrides the estimate. */
+    int8_t score_fixed;
 } ucg_plan_attr_t;
 
 /**
@@ -162,13 +187,70 @@ typedef struct ucg_plan {
     ucg_list_link_t list;
     /** For first-class plan, it's the linked list header. */
     ucg_list_link_t fallback;
+    /** Index of the planc group that executes the plan, @ref ucg_plans_bind. */
+    int32_t provider;
+    /** Index of the planc that adds the plan, @ref ucg_plans_set_planc. */
+    int32_t planc;
 } ucg_plan_t;
 
+/**
+ * @brief Plans that serve one range of message size.
+ */
+typedef struct ucg_plan_table_entry {
+    ucg_plan_range_t range;
+    /** Number of plans in the entry. */
+    uint32_t num_plans;
+    /** The first-class plan followed by its fallback plans in priority order. */
+    ucg_plan_t **plans;
+} ucg_plan_table_entry_t;
+
+/**
+ * @brief Lookup table compiled from a plan linked list.
+ *
+ * Entries are sorted by range and the ranges do not overlap, so the plans
+ * of a message size are found by binary search.
+ */
+typedef struct ucg_plan_table {
+    uint32_t num_entries;
+    ucg_plan_table_entry_t *entries;
+    /** Storage of the plan pointers of all entries. */
+    ucg_plan_t **plans;
+} ucg_plan_table_t;
+
+/** Maximum number of planc groups whose plans can be shared. */
+#define UCG_PLANS_KEY_MAX_TAGS 8
+
+/**
+ * @brief What the plans of a group depend on, besides the plancs of the context.
+ */
+typedef struct ucg_plans_key {
+    uint32_t size;
+    int32_t nnode;
+    /** Processes per node, it may be UCG_TOPO_PPX_UNBALANCED. */
+    int32_t ppn;
+    /** Processes per socket, it may be UCG_TOPO_PPX_UNBALANCED. */
+    int32_t pps;
+    /** State of the planc groups, see @ref ucg_planc_get_plans_tag_func_t. */
+    int32_t num_tags;
+    uint64_t tags[UCG_PLANS_KEY_MAX_TAGS];
+} ucg_plans_key_t;
+
 /**
  * @brief Plan container
+ *
+ * The groups of a context with the same key share one container, the plans
+ * are bound to the planc groups by index so that each group executes them
+ * with its own planc groups.
  */
 typedef struct ucg_plans {
     ucg_list_link_t plans[UCG_COLL_TYPE_LAST][UCG_MEM_TYPE_LAST];
+    /** Compiled from the linked lists by @ref ucg_plans_build, used to select plans. */
+    ucg_plan_table_t tables[UCG_COLL_TYPE_LAST][UCG_MEM_TYPE_LAST];
+    ucg_plans_key_t key;
+    /** Number of groups that use the container. */
+    uint32_t refcount;
+    /** Element of the shared containers list of the context. */
+    ucg_list_link_t list;
 } ucg_plans_t;
 
 /**
@@ -193,6 +275,47 @@ ucg_status_t ucg_plans_init(ucg_plans_t **plans);
  */
 void ucg_plans_cleanup(ucg_plans_t *plans);
 
+/**
+ * @brief Set the planc of the plans that don't have one.
+ *
+ * It's called after each planc adds its plans, in the order of the plancs.
+ *
+ * @param [inout] plans     Plan container.
+ * @param [in]    planc     Index of the planc in the context.
+ */
+void ucg_plans_set_planc(ucg_plans_t *plans, int32_t planc);
+
+/**
+ * @brief Bind the plans to the planc groups that provide them.
+ *
+ * The provider of a plan is the index of its @ref ucg_plan_attr_t::vgroup in
+ * the planc groups, the plans of other vgroups are left unbound.
+ *
+ * @param [inout] plans         Plan container.
+ * @param [in]    planc_groups  Planc groups of the group that gets the plans.
+ * @param [in]    num           Number of planc groups.
+ * @return 1 if all plans are bound, otherwise 0 and the unbound plans are executed
+ *         by their own vgroups, so the plans can not be shared.
+ */
+int ucg_plans_bind(ucg_plans_t *plans, ucg_planc_group_h *planc_groups, int32_t num);
+
+/**
+ * @brief Group that executes the plan on behalf of the group.
+ *
+ * @param [in] plan             Plan.
+ * @param [in] planc_groups     Planc groups of the group, can be NULL if the
+ *                              plans are not bound.
+ */
+static inline ucg_vgroup_t* ucg_plan_vgroup(const ucg_plan_t *plan,
+                                            ucg_planc_group_h *planc_groups)
+{
+    if (plan->provider == UCG_PLAN_PROVIDER_NONE || planc_groups == NULL) {
+        return plan->attr.vgroup;
+    }
+    /* The vgroup is the first member of the planc group. */
+    return (ucg_vgroup_t*)planc_groups[plan->provider];
+}
+
 /**
  * @brief Print detail of all plans for debug purpose.
  *
@@ -215,6 +338,9 @@ void ucg_plans_print(const ucg_plans_t *plans, FILE *stream);
  * This routine can be invoked to add deprecated plan. However, the deprecated
  * plan is not added in fact.
  *
+ * The plans are not used for selection until @ref ucg_plans_build is called.
+ * The plans in the container are unchanged if it fails.
+ *
  * @param [in] plans    Plan container.
  * @param [in] params   Parameters of plan.
  * @retval UCG_OK Success.
@@ -222,9 +348,23 @@ void ucg_plans_print(const ucg_plans_t *plans, FILE *stream);
  */
 ucg_status_t ucg_plans_add(ucg_plans_t *plans, const ucg_plan_params_t *params);
 
+/**
+ * @brief Compile the plans into the lookup tables.
+ *
+ * It's called once after all plans are added or merged, the container must not
+ * be changed after that.
+ *
+ * @param [in] plans    Plan container.
+ * @retval UCG_OK Success.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_plans_build(ucg_plans_t *plans);
+
 /**
  * @brief Merge plan container
  *
+ * Like @ref ucg_plans_add, the merged plans are used after @ref ucg_plans_build.
+ *
  * @param [inout] dst   Dest plan container.
  * @param [in]    src   Source plan container.
  * @retval UCG_OK Success.
@@ -232,19 +372,62 @@ ucg_status_t ucg_plans_add(ucg_plans_t *plans, const ucg_plan_params_t *params);
  */
 ucg_status_t ucg_plans_merge(ucg_plans_t **dst, const ucg_plans_t *src);
 
+/**
+ * @brief Find the plans that serve the collective operation.
+ *
+ * @param [in]  plans       Plan container.
+ * @param [in]  args        Arguments of collective operation.
+ * @param [in]  size        Group size.
+ * @param [out] msg_size    Message size of the operation.
+ * @return The table entry, NULL if not found.
+ */
+const ucg_plan_table_entry_t* ucg_plans_lookup(const ucg_plans_t *plans,
+                                               const ucg_coll_args_t *args,
+                                               const uint32_t size,
+                                               uint64_t *msg_size);
+
+/**
+ * @brief Check whether the selected plan depends on the message size.
+ *
+ * @return 1 if the plans of the collective type and memory type have different
+ *         message size ranges, otherwise 0.
+ */
+int ucg_plans_size_dependent(const ucg_plans_t *plans, ucg_coll_type_t coll_type,
+                             ucg_mem_type_t mem_type);
+
+/**
+ * @brief Get the plan of the entry with the smallest estimated time.
+ *
+ * The estimate is used only if the cost model is enabled in the context and
+ * the first-class plan is modeled without a score given by the user. Plans
+ * that are not modeled are skipped.
+ *
+ * @param [in] entry        Table entry.
+ * @param [in] planc_groups Planc groups of the group, @ref ucg_plan_vgroup.
+ * @param [in] msg_size     Message size, @ref ucg_request_msg_size.
+ * @return Index of the plan in the entry.
+ */
+uint32_t ucg_plan_table_entry_cheapest(const ucg_plan_table_entry_t *entry,
+                                       ucg_planc_group_h *planc_groups, uint64_t msg_size);
+
 /**
  * @brief Select the best plan and prepare the operation.
  *
- * @param [in]  plans   Plan container.
- * @param [in]  args    Arguments of collective operation.
- * @param [in]  size    Group size.
- * @param [out] op      Plan operation.
+ * The cheapest plan of @ref ucg_plan_table_entry_cheapest is tried first, then
+ * the others in priority order.
+ *
+ * @param [in]  plans           Plan container.
+ * @param [in]  args            Arguments of collective operation.
+ * @param [in]  size            Group size.
+ * @param [in]  planc_groups    Planc groups of the group, @ref ucg_plan_vgroup.
+ * @param [out] op              Plan operation.
  * @retval UCG_OK Success.
  * @retval Otherwise Failure.
  */
 ucg_status_t ucg_plans_prepare(const ucg_plans_t *plans,
                                const ucg_coll_args_t *args,
                                const uint32_t size,
+                               ucg_planc_group_h *planc_groups,
                                ucg_plan_op_t **op);
 
 /**
@@ -284,6 +467,15 @@ void ucg_plan_attr_array_update(ucg_plan_attr_t *attr, int32_t id,
     return;
 }
 
+/**
+ * @brief Rebind the op to the buffers of new arguments.
+ *
+ * It's only suitable for the op that does not keep the buffer addresses
+ * anywhere except the arguments at prepare time. The other arguments must be
+ * the same as the ones used to prepare the op.
+ */
+ucg_status_t ucg_plan_op_rebind_buffers(ucg_plan_op_t *op, const ucg_coll_args_t *args);
+
 /**
  * @brief Create one meta op
  */
@@ -303,6 +495,7 @@ static inline ucg_status_t ucg_plan_meta_op_add(ucg_plan_meta_op_t *meta_op,
         return UCG_ERR_NO_MEMORY;
     }
     meta_op->ops[meta_op->n_ops++] = op;
+    meta_op->super.super.event_driven &= op->super.event_driven;
     return UCG_OK;
 }
 
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_plan_cost.h"
+#include "ucg_group.h"
+
+#include "util/ucg_helper.h"
+#include "util/ucg_math.h"
+
+
+/* Number of rounds that a k-nomial tree takes to reach nprocs processes. */
+static uint32_t ucg_plan_cost_rounds(uint32_t nprocs, uint32_t degree)
+{
+    uint32_t rounds = 0;
+    for (uint64_t span = 1; span < nprocs; span *= degree) {
+        ++rounds;
+    }
+    return rounds;
+}
+
+static int ucg_plan_cost_is_pow2(uint32_t n)
+{
+    return (n & (n - 1)) == 0;
+}
+
+void ucg_plan_cost_topo_init(ucg_plan_cost_topo_t *topo, const ucg_vgroup_t *vgroup)
+{
+    const ucg_group_t *group = vgroup->group;
+    const ucg_topo_t *group_topo = group->topo;
+    uint32_t size = group->size;
+    topo->size = size;
+    if (group_topo->ppn != UCG_TOPO_PPX_UNBALANCED) {
+        topo->ppn = group_topo->ppn;
+        topo->nnode = size / topo->ppn;
+    } else {
+        topo->nnode = ucg_max(group_topo->detail.nnode, 1);
+        topo->ppn = (size + topo->nnode - 1) / topo->nnode;
+    }
+
+    if (group_topo->pps != UCG_TOPO_PPX_UNBALANCED) {
+        topo->pps = group_topo->pps;
+    } else {
+        uint32_t nsocket = ucg_max(group_topo->detail.nsocket, 1);
+        topo->pps = (topo->ppn + nsocket - 1) / nsocket;
+    }
+    return;
+}
+
+ucg_plan_cost_level_t ucg_plan_cost_top_level(const ucg_plan_cost_topo_t *topo)
+{
+    if (topo->nnode > 1) {
+        return UCG_PLAN_COST_LEVEL_NET;
+    }
+    if (topo->pps < topo->ppn) {
+        return UCG_PLAN_COST_LEVEL_NODE;
+    }
+    return UCG_PLAN_COST_LEVEL_SOCKET;
+}
+
+void ucg_plan_cost_topo_group(const ucg_plan_cost_topo_t *topo, ucg_topo_group_type_t type,
+                              ucg_plan_cost_level_t *level, uint32_t *nprocs)
+{
+    switch (type) {
+        case UCG_TOPO_GROUP_TYPE_NODE:
+            *level = topo->pps < topo->ppn ? UCG_PLAN_COST_LEVEL_NODE : UCG_PLAN_COST_LEVEL_SOCKET;
+            *nprocs = topo->ppn;
+            break;
+        case UCG_TOPO_GROUP_TYPE_NODE_LEADER:
+            *level = UCG_PLAN_COST_LEVEL_NET;
+            *nprocs = topo->nnode;
+            break;
+        case UCG_TOPO_GROUP_TYPE_SOCKET:
+            *level = UCG_PLAN_COST_LEVEL_SOCKET;
+            *nprocs = topo->pps;
+            break;
+        case UCG_TOPO_GROUP_TYPE_SOCKET_LEADER:
+            *level = UCG_PLAN_COST_LEVEL_NODE;
+            *nprocs = (topo->ppn + topo->pps - 1) / topo->pps;
+            break;
+        default:
+            /* The subnets are unknown to the model, regard them as the whole group. */
+            *level = ucg_plan_cost_top_level(topo);
+            *nprocs = topo->size;
+            break;
+    }
+    return;
+}
+
+double ucg_plan_cost_kntree(const ucg_plan_cost_model_t *model, ucg_plan_cost_level_t level,
+                            uint32_t nprocs, uint32_t degree, double size)
+{
+    if (nprocs <= 1) {
+        return 0;
+    }
+    degree = ucg_min(ucg_max(degree, 2), nprocs);
+    const ucg_plan_cost_link_t *link = &model->links[level];
+    double round = link->latency + (degree - 1) * size / link->bandwidth;
+    return ucg_plan_cost_rounds(nprocs, degree) * round;
+}
+
+double ucg_plan_cost_reduce_kntree(const ucg_plan_cost_model_t *model,
+                                   ucg_plan_cost_level_t level, uint32_t nprocs,
+                                   uint32_t degree, double size)
+{
+    if (nprocs <= 1) {
+        return 0;
+    }
+    degree = ucg_min(ucg_max(degree, 2), nprocs);
+    double reduce = ucg_plan_cost_rounds(nprocs, degree) * (degree - 1) *
+                    ucg_plan_cost_reduce(model, size);
+    return ucg_plan_cost_kntree(model, level, nprocs, degree, size) + reduce;
+}
+
+double ucg_plan_cost_rd(const ucg_plan_cost_model_t *model, ucg_plan_cost_level_t level,
+                        uint32_t nprocs, double size)
+{
+    if (nprocs <= 1) {
+        return 0;
+    }
+    double step = ucg_plan_cost_p2p(model, level, size) + ucg_plan_cost_reduce(model, size);
+    uint32_t steps = ucg_plan_cost_rounds(nprocs, 2);
+    if (!ucg_plan_cost_is_pow2(nprocs)) {
+        /* The extra processes fold in before and get the result after. */
+        steps = steps - 1 + 2;
+    }
+    return steps * step;
+}
+
+double ucg_plan_cost_ring_allgather(const ucg_plan_cost_model_t *model,
+                                    ucg_plan_cost_level_t level, uint32_t nprocs,
+                                    double size)
+{
+    if (nprocs <= 1) {
+        return 0;
+    }
+    return (nprocs - 1) * ucg_plan_cost_p2p(model, level, size / nprocs);
+}
+
+double ucg_plan_cost_ring_reduce_scatter(const ucg_plan_cost_model_t *model,
+                                         ucg_plan_cost_level_t level, uint32_t nprocs,
+                                         double size)
+{
+    if (nprocs <= 1) {
+        return 0;
+    }
+    double block = size / nprocs;
+    return (nprocs - 1) * (ucg_plan_cost_p2p(model, level, block) +
+                           ucg_plan_cost_reduce(model, block));
+}
+
+double ucg_plan_cost_rh_reduce_scatter(const ucg_plan_cost_model_t *model,
+                                       ucg_plan_cost_level_t level, uint32_t nprocs,
+                                       double size)
+{
+    if (nprocs <= 1) {
+        return 0;
+    }
+    const ucg_plan_cost_link_t *link = &model->links[level];
+    double moved = size * (nprocs - 1) / nprocs;
+    return ucg_plan_cost_rounds(nprocs, 2) * link->latency + moved / link->bandwidth +
+           ucg_plan_cost_reduce(model, moved);
+}
+
+double ucg_plan_cost_rd_allgather(const ucg_plan_cost_model_t *model,
+                                  ucg_plan_cost_level_t level, uint32_t nprocs,
+                                  double size)
+{
+    if (nprocs <= 1) {
+        return 0;
+    }
+    const ucg_plan_cost_link_t *link = &model->links[level];
+    double moved = size * (nprocs - 1) / nprocs;
+    return ucg_plan_cost_rounds(nprocs, 2) * link->latency + moved / link->bandwidth;
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLAN_COST_H_
+#define UCG_PLAN_COST_H_
+
+#include "ucg/api/ucg.h"
+
+#include "ucg_topo.h"
+
+/**
+ * @brief Link levels of the cost model, from the fastest to the slowest.
+ */
+typedef enum ucg_plan_cost_level {
+    UCG_PLAN_COST_LEVEL_SOCKET, /**< Between processes in the same socket. */
+    UCG_PLAN_COST_LEVEL_NODE, /**< Between processes in different sockets of a node. */
+    UCG_PLAN_COST_LEVEL_NET, /**< Between processes in different nodes. */
+    UCG_PLAN_COST_LEVEL_LAST
+} ucg_plan_cost_level_t;
+
+/**
+ * @brief Hockney parameters of a link, a message of n bytes takes
+ * latency + n / bandwidth seconds.
+ */
+typedef struct ucg_plan_cost_link {
+    double latency; /* seconds */
+    double bandwidth; /* bytes per second */
+} ucg_plan_cost_link_t;
+
+/**
+ * @brief Calibration table of the cost model.
+ */
+typedef struct ucg_plan_cost_model {
+    ucg_plan_cost_link_t links[UCG_PLAN_COST_LEVEL_LAST];
+    /** Bytes reduced per second by a process. */
+    double reduce_bandwidth;
+} ucg_plan_cost_model_t;
+
+/**
+ * @brief Shape of the group seen by the cost model.
+ *
+ * The processes are assumed to be evenly distributed, the numbers of an
+ * unbalanced group are the ceiling of the average.
+ */
+typedef struct ucg_plan_cost_topo {
+    uint32_t size;
+    uint32_t nnode;
+    /** Processes per node. */
+    uint32_t ppn;
+    /** Processes per socket. */
+    uint32_t pps;
+} ucg_plan_cost_topo_t;
+
+typedef struct ucg_plan_cost_params {
+    const ucg_plan_cost_model_t *model;
+    const ucg_plan_cost_topo_t *topo;
+    /** Group that provides the plan, NULL if estimating without a group. */
+    ucg_vgroup_t *vgroup;
+    /** @ref ucg_request_msg_size */
+    uint64_t msg_size;
+} ucg_plan_cost_params_t;
+
+/**
+ * @brief Estimate the completion time of a plan in seconds.
+ */
+typedef double (*ucg_plan_cost_func_t)(const ucg_plan_cost_params_t *params);
+
+/**
+ * @brief Get the shape of the group of the vgroup.
+ */
+void ucg_plan_cost_topo_init(ucg_plan_cost_topo_t *topo, const ucg_vgroup_t *vgroup);
+
+/**
+ * @brief Get the slowest level between the processes of the topo.
+ */
+ucg_plan_cost_level_t ucg_plan_cost_top_level(const ucg_plan_cost_topo_t *topo);
+
+/**
+ * @brief Get the slowest level and the number of processes of the topo group
+ * that a process belongs to. The socket leaders are those in the same node.
+ */
+void ucg_plan_cost_topo_group(const ucg_plan_cost_topo_t *topo, ucg_topo_group_type_t type,
+                              ucg_plan_cost_level_t *level, uint32_t *nprocs);
+
+/* Time of sending a message of size bytes. */
+static inline double ucg_plan_cost_p2p(const ucg_plan_cost_model_t *model,
+                                       ucg_plan_cost_level_t level, double size)
+{
+    const ucg_plan_cost_link_t *link = &model->links[level];
+    return link->latency + size / link->bandwidth;
+}
+
+/* Time of reducing size bytes. */
+static inline double ucg_plan_cost_reduce(const ucg_plan_cost_model_t *model, double size)
+{
+    return size / model->reduce_bandwidth;
+}
+
+/**
+ * @brief Time of a k-nomial tree among nprocs processes, the parent sends
+ * the whole message to its k - 1 children in each round. It's the same for
+ * fanin and fanout, the reduction is not counted.
+ */
+double ucg_plan_cost_kntree(const ucg_plan_cost_model_t *model, ucg_plan_cost_level_t level,
+                            uint32_t nprocs, uint32_t degree, double size);
+
+/**
+ * @brief Time of a k-nomial tree reduction, the parent reduces the messages of
+ * its children in each round.
+ */
+double ucg_plan_cost_reduce_kntree(const ucg_plan_cost_model_t *model,
+                                   ucg_plan_cost_level_t level, uint32_t nprocs,
+                                   uint32_t degree, double size);
+
+/**
+ * @brief Time of recursive doubling allreduce among nprocs processes.
+ */
+double ucg_plan_cost_rd(const ucg_plan_cost_model_t *model, ucg_plan_cost_level_t level,
+                        uint32_t nprocs, double size);
+
+/**
+ * @brief Time of ring allgather among nprocs processes, size is the total bytes.
+ */
+double ucg_plan_cost_ring_allgather(const ucg_plan_cost_model_t *model,
+                                    ucg_plan_cost_level_t level, uint32_t nprocs,
+                                    double size);
+
+/**
+ * @brief Time of ring reduce-scatter among nprocs processes, size is the total bytes.
+ */
+double ucg_plan_cost_ring_reduce_scatter(const ucg_plan_cost_model_t *model,
+                                         ucg_plan_cost_level_t level, uint32_t nprocs,
+                                         double size);
+
+/**
+ * @brief Time of recursive halving reduce-scatter among nprocs processes, size
+ * is the total bytes.
+ */
+double ucg_plan_cost_rh_reduce_scatter(const ucg_plan_cost_model_t *model,
+                                       ucg_plan_cost_level_t level, uint32_t nprocs,
+                                       double size);
+
+/**
+ * @brief Time of recursive doubling allgather among nprocs processes, size is
+ * the total bytes.
+ */
+double ucg_plan_cost_rd_allgather(const ucg_plan_cost_model_t *model,
+                                  ucg_plan_cost_level_t level, uint32_t nprocs,
+                                  double size);
+
+#endif
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_plan_select.h"
+#include "ucg_plan_tuner.h"
+#include "ucg_group.h"
+#include "ucg_request.h"
+
+#include "util/ucg_log.h"
+#include "util/ucg_malloc.h"
+#include "util/ucg_time.h"
+
+
+/**
+ * @brief Select op, which agrees on the plan before running the op of the plan.
+ *
+ * It's polled, as the op of the plan is not known before the request starts.
+ */
+typedef struct ucg_plan_select_op {
+    ucg_plan_op_t super;
+    /** The size metrics of the arguments are agreed, @ref ucg_coll_args_t::vsize. */
+    uint8_t sized;
+    /** Bucket of the op, NULL if not tuned. */
+    ucg_plan_tuner_bucket_t *bucket;
+    /** Agreement in flight, valid while the request is selecting. */
+    ucg_plan_op_t *agree_op;
+    ucg_op_generic_t max_op;
+    /** Op of the selected plan, reused by the next start if the plan is the same. */
+    ucg_plan_op_t *op;
+    /** Index of the plan of op in the entry, -1 if selected as if not tuned. */
+    int32_t plan;
+} ucg_plan_select_op_t;
+
+/* Start the agreement of the members, it takes the id of the request. */
+static ucg_status_t ucg_plan_select_op_agree(ucg_plan_select_op_t *op,
+                                             const ucg_coll_args_t *args)
+{
+    ucg_request_t *request = &op->super.super;
+    ucg_group_t *group = request->group;
+    ucg_plan_op_t *agree_op;
+    ucg_status_t status = ucg_plans_prepare(group->plans, args, group->size,
+                                            group->planc_groups, &agree_op);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    agree_op->super.id = request->id;
+    status = agree_op->trigger(agree_op);
+    if (status == UCG_OK) {
+        status = agree_op->super.status;
+    }
+    if (status == UCG_INPROGRESS) {
+        op->agree_op = agree_op;
+        return UCG_INPROGRESS;
+    }
+    agree_op->discard(agree_op);
+    return status;
+}
+
+static ucg_status_t ucg_plan_select_op_agree_max(ucg_plan_select_op_t *op, uint64_t *values,
+                                                 int32_t count)
+{
+    ucg_op_params_t params = {
+        .field_mask = UCG_OP_PARAMS_FIELD_TYPE,
+        .type = UCG_OP_TYPE_MAX,
+    };
+    ucg_status_t status = ucg_op_init(&params, &op->max_op.super, sizeof(op->max_op));
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_coll_args_t args = {
+        .type = UCG_COLL_TYPE_ALLREDUCE,
+        .info.field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .info.mem_type = UCG_MEM_TYPE_HOST,
+        .allreduce.sendbuf = UCG_IN_PLACE,
+        .allreduce.recvbuf = values,
+        .allreduce.count = count,
+        .allreduce.dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT64),
+        .allreduce.op = &op->max_op.super,
+    };
+    return ucg_plan_select_op_agree(op, &args);
+}
+
+/* The root knows the counts of scatterv and gatherv, the others take its metrics. */
+static ucg_status_t ucg_plan_select_op_agree_vsize(ucg_plan_select_op_t *op)
+{
+    ucg_coll_args_t *args = &op->super.super.args;
+    uint64_t *values = (uint64_t*)&args->vsize;
+    int32_t count = sizeof(args->vsize) / sizeof(uint64_t);
+    if (args->type == UCG_COLL_TYPE_ALLTOALLV) {
+        return ucg_plan_select_op_agree_max(op, values, count);
+    }
+
+    ucg_coll_args_t bcast_args = {
+        .type = UCG_COLL_TYPE_BCAST,
+        .info.field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+        .info.mem_type = UCG_MEM_TYPE_HOST,
+        .bcast.buffer = values,
+        .bcast.count = count,
+        .bcast.dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT64),
+        .bcast.root = args->type == UCG_COLL_TYPE_SCATTERV ?
+                      args->scatterv.root : args->gatherv.root,
+    };
+    return ucg_plan_select_op_agree(op, &bcast_args);
+}
+
+/* Apply the result of the size agreement. */
+static ucg_status_t ucg_plan_select_op_sized(ucg_plan_select_op_t *op, ucg_status_t status)
+{
+    ucg_request_t *request = &op->super.super;
+    if (status != UCG_OK) {
+        ucg_error("Failed to agree on the size of %s, %s",
+                  ucg_coll_type_string(request->args.type), ucg_status_string(status));
+        return status;
+    }
+    op->sized = 1;
+    op->bucket = ucg_plan_tuner_get(request->group, &request->args);
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_plan_select_op_prepare(ucg_plan_select_op_t *op, int32_t plan)
+{
+    ucg_request_t *request = &op->super.super;
+    ucg_group_t *group = request->group;
+    if (op->op != NULL) {
+        if (op->plan == plan) {
+            return UCG_OK;
+        }
+        op->op->discard(op->op);
+        op->op = NULL;
+    }
+
+    ucg_status_t status;
+    if (plan != -1) {
+        ucg_plan_t *selected = op->bucket->entry->plans[plan];
+        ucg_vgroup_t *vgroup = ucg_plan_vgroup(selected, group->planc_groups);
+        status = selected->attr.prepare(vgroup, &request->args, &op->op);
+        if (status == UCG_OK) {
+            op->plan = plan;
+            return UCG_OK;
+        }
+        /* The same as the fallback of the plans, it's not a sample then. */
+        request->tune.bucket = NULL;
+    }
+    status = ucg_plans_prepare(group->plans, &request->args, group->size,
+                               group->planc_groups, &op->op);
+    op->plan = -1;
+    return status;
+}
+
+/* Select the plan, UCG_INPROGRESS if an agreement has started. */
+static ucg_status_t ucg_plan_select_op_select(ucg_plan_select_op_t *op)
+{
+    ucg_request_t *request = &op->super.super;
+    ucg_group_t *group = request->group;
+    int32_t plan = -1;
+    int timed = 0;
+    ucg_status_t status = UCG_OK;
+    if (!op->sized) {
+        /* The arguments are the same at each start, so they are agreed once. */
+        status = ucg_plan_select_op_agree_vsize(op);
+        if (status != UCG_INPROGRESS) {
+            status = ucg_plan_select_op_sized(op, status);
+        }
+    }
+
+    while (status == UCG_OK && op->bucket != NULL &&
+           (status = ucg_plan_tuner_decide(group, op->bucket, &request->args,
+                                           &plan, &timed)) == UCG_INPROGRESS) {
+        status = ucg_plan_select_op_agree_max(op, op->bucket->values,
+                                              op->bucket->entry->num_plans);
+        if (status != UCG_INPROGRESS) {
+            ucg_plan_tuner_agreed(group, op->bucket, status);
+            status = UCG_OK;
+        }
+    }
+    request->selecting = status == UCG_INPROGRESS;
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    if (timed) {
+        request->tune.bucket = op->bucket;
+        request->tune.plan = plan;
+    }
+    return ucg_plan_select_op_prepare(op, plan);
+}
+
+/* Select the plan and trigger its op, returns the status of the request. */
+static ucg_status_t ucg_plan_select_op_run(ucg_plan_select_op_t *op)
+{
+    ucg_status_t status = ucg_plan_select_op_select(op);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_request_t *request = &op->super.super;
+    ucg_plan_op_t *selected = op->op;
+    /* To ensure that the ops of the members are matched. */
+    selected->super.id = request->id;
+    if (request->tune.bucket != NULL) {
+        request->tune.start = ucg_get_time_ns();
+    }
+    status = selected->trigger(selected);
+    if (status != UCG_OK) {
+        return status;
+    }
+    return selected->super.status;
+}
+
+static ucg_status_t ucg_plan_select_op_progress_sub(ucg_plan_select_op_t *op,
+                                                    ucg_plan_op_t *sub)
+{
+    if (sub->super.event_driven) {
+        /* Nothing wakes up the select op, deliver the events of the op here. */
+        ucg_context_progress_plancs(op->super.super.group->context);
+    }
+    return sub->progress(sub);
+}
+
+static ucg_status_t ucg_plan_select_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_plan_select_op_t *op = ucg_derived_of(ucg_op, ucg_plan_select_op_t);
+    ucg_request_t *request = &op->super.super;
+    ucg_status_t status;
+    if (request->selecting) {
+        status = ucg_plan_select_op_progress_sub(op, op->agree_op);
+        if (status == UCG_INPROGRESS) {
+            return UCG_INPROGRESS;
+        }
+        op->agree_op->discard(op->agree_op);
+        op->agree_op = NULL;
+        if (op->sized) {
+            ucg_plan_tuner_agreed(request->group, op->bucket, status);
+            status = ucg_plan_select_op_run(op);
+        } else if (ucg_plan_select_op_sized(op, status) == UCG_OK) {
+            status = ucg_plan_select_op_run(op);
+        } else {
+            request->selecting = 0;
+        }
+    } else {
+        status = ucg_plan_select_op_progress_sub(op, op->op);
+    }
+    request->status = status;
+    return status;
+}
+
+static ucg_status_t ucg_plan_select_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_plan_select_op_t *op = ucg_derived_of(ucg_op, ucg_plan_select_op_t);
+    ucg_request_t *request = &op->super.super;
+    request->tune.bucket = NULL;
+    ucg_status_t status = ucg_plan_select_op_run(op);
+    if (status != UCG_OK && status != UCG_INPROGRESS) {
+        return status;
+    }
+    request->status = status;
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_plan_select_op_discard(ucg_plan_op_t *ucg_op)
+{
+    ucg_plan_select_op_t *op = ucg_derived_of(ucg_op, ucg_plan_select_op_t);
+    if (op->agree_op != NULL) {
+        op->agree_op->discard(op->agree_op);
+    }
+    if (op->op != NULL) {
+        op->op->discard(op->op);
+    }
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
+    ucg_free(op);
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_plan_select_op_new(ucg_plan_tuner_bucket_t *bucket,
+                                           const ucg_coll_args_t *args,
+                                           ucg_plan_op_t **op)
+{
+    ucg_plan_select_op_t *select_op = ucg_calloc(1, sizeof(ucg_plan_select_op_t),
+                                                 "plan select op");
+    if (select_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    ucg_status_t status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &select_op->super, NULL,
+                                              ucg_plan_select_op_trigger,
+                                              ucg_plan_select_op_progress,
+                                              ucg_plan_select_op_discard,
+                                              args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of select op");
+        ucg_free(select_op);
+        return status;
+    }
+    /* Without a bucket, the size metrics are not agreed yet. */
+    select_op->sized = bucket != NULL;
+    select_op->bucket = bucket;
+    select_op->agree_op = NULL;
+    select_op->op = NULL;
+    select_op->plan = -1;
+    *op = &select_op->super;
+    return UCG_OK;
+}
+
+/* The metrics of alltoallv, scatterv and gatherv differ between the members. */
+static int ucg_plan_select_needs_vsize(ucg_group_t *group, const ucg_coll_args_t *args)
+{
+    if (args->type != UCG_COLL_TYPE_ALLTOALLV && args->type != UCG_COLL_TYPE_SCATTERV &&
+        args->type != UCG_COLL_TYPE_GATHERV) {
+        return 0;
+    }
+    return group->size > 1 &&
+           (group->tuner.budget > 0 ||
+            ucg_plans_size_dependent(group->plans, args->type, args->info.mem_type));
+}
+
+ucg_status_t ucg_plan_select_prepare(ucg_group_t *group, const ucg_coll_args_t *args,
+                                     ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(group, args, op);
+
+    if (ucg_plan_select_needs_vsize(group, args)) {
+        return ucg_plan_select_op_new(NULL, args, op);
+    }
+
+    ucg_plan_tuner_bucket_t *bucket = ucg_plan_tuner_get(group, args);
+    if (bucket == NULL || bucket->state == UCG_PLAN_TUNER_STATE_STOPPED) {
+        return ucg_plans_prepare(group->plans, args, group->size, group->planc_groups, op);
+    }
+
+    if (bucket->state == UCG_PLAN_TUNER_STATE_PINNED) {
+        /* The state is final, so the op is the same as the one the select op runs. */
+        ucg_plan_t *plan = bucket->entry->plans[bucket->winner];
+        ucg_status_t status = plan->attr.prepare(ucg_plan_vgroup(plan, group->planc_groups),
+                                                 args, op);
+        if (status == UCG_OK) {
+            return UCG_OK;
+        }
+        return ucg_plans_prepare(group->plans, args, group->size, group->planc_groups, op);
+    }
+    return ucg_plan_select_op_new(bucket, args, op);
+}
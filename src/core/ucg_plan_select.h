@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLAN_SELECT_H_
+#define UCG_PLAN_SELECT_H_
+
+#include "ucg_plan.h"
+
+/**
+ * @brief Select the plan and prepare the operation.
+ *
+ * If the members must agree before selecting the plan, such as while the plans
+ * are being tuned or when the plan depends on the size metrics of alltoallv,
+ * scatterv and gatherv, the op is a select op. It agrees on the plan when its
+ * request starts and then runs the op of the plan, the agreement is a part of
+ * the op, so no collective operation blocks here.
+ *
+ * While the select op agrees, its request is selecting, see
+ * @ref ucg_request_t::selecting. The requests started afterwards are not
+ * triggered until it selects, so the ops keep the order of the starts.
+ *
+ * @param [in]  group   Group that executes the operation.
+ * @param [in]  args    Arguments of collective operation.
+ * @param [out] op      Plan operation.
+ */
+ucg_status_t ucg_plan_select_prepare(ucg_group_t *group, const ucg_coll_args_t *args,
+                                     ucg_plan_op_t **op);
+
+#endif
@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_plan_tuner.h"
+#include "ucg_group.h"
+#include "ucg_topo.h"
+#include "ucg_request.h"
+
+#include "planc/ucg_planc.h"
+#include "util/ucg_log.h"
+#include "util/ucg_malloc.h"
+#include "util/ucg_math.h"
+
+#include <stdio.h>
+
+
+static uint32_t ucg_plan_tuner_bucket_idx(uint64_t msg_size)
+{
+    return msg_size == 0 ? 0 : 64 - __builtin_clzll(msg_size);
+}
+
+static ucg_plan_range_t ucg_plan_tuner_bucket_range(const ucg_plan_table_entry_t *entry,
+                                                    uint32_t idx)
+{
+    ucg_plan_range_t range;
+    if (idx == 0) {
+        range.start = 0;
+        range.end = 1;
+    } else {
+        range.start = 1ull << (idx - 1);
+        range.end = idx == 64 ? UCG_PLAN_RANGE_MAX : 1ull << idx;
+    }
+    range.start = ucg_max(range.start, entry->range.start);
+    range.end = ucg_min(range.end, entry->range.end);
+    return range;
+}
+
+static ucg_plan_tuner_bucket_t* ucg_plan_tuner_get_bucket(ucg_plan_tuner_t *tuner,
+                                                          const ucg_plans_t *plans,
+                                                          const ucg_coll_args_t *args,
+                                                          const ucg_plan_table_entry_t *entry,
+                                                          uint64_t msg_size)
+{
+    ucg_coll_type_t coll_type = args->type;
+    ucg_mem_type_t mem_type = args->info.mem_type;
+    const ucg_plan_table_t *table = &plans->tables[coll_type][mem_type];
+    ucg_plan_tuner_bucket_t **buckets = tuner->buckets[coll_type][mem_type];
+    if (buckets == NULL) {
+        buckets = ucg_calloc(table->num_entries * UCG_PLAN_TUNER_NUM_BUCKETS,
+                             sizeof(ucg_plan_tuner_bucket_t*), "plan tuner buckets");
+        if (buckets == NULL) {
+            return NULL;
+        }
+        tuner->buckets[coll_type][mem_type] = buckets;
+        tuner->num_entries[coll_type][mem_type] = table->num_entries;
+    }
+
+    uint32_t bucket_idx = ucg_plan_tuner_bucket_idx(msg_size);
+    uint32_t idx = (entry - table->entries) * UCG_PLAN_TUNER_NUM_BUCKETS + bucket_idx;
+    if (buckets[idx] != NULL) {
+        return buckets[idx];
+    }
+
+    uint32_t num_plans = entry->num_plans;
+    ucg_plan_tuner_bucket_t *bucket;
+    bucket = ucg_calloc(1, sizeof(ucg_plan_tuner_bucket_t) +
+                        num_plans * sizeof(ucg_plan_tuner_candidate_t) +
+                        num_plans * sizeof(uint64_t), "plan tuner bucket");
+    if (bucket == NULL) {
+        return NULL;
+    }
+    bucket->state = UCG_PLAN_TUNER_STATE_NEW;
+    bucket->entry = entry;
+    bucket->coll_type = coll_type;
+    bucket->range = ucg_plan_tuner_bucket_range(entry, bucket_idx);
+    bucket->winner = 0;
+    bucket->values = (uint64_t*)&bucket->candidates[num_plans];
+    buckets[idx] = bucket;
+    return bucket;
+}
+
+/* Get the enabled candidate that is used least, return -1 if all are used up. */
+static int32_t ucg_plan_tuner_next_candidate(const ucg_plan_tuner_bucket_t *bucket,
+                                             uint32_t budget)
+{
+    int32_t next = -1;
+    for (uint32_t i = 0; i < bucket->entry->num_plans; ++i) {
+        const ucg_plan_tuner_candidate_t *candidate = &bucket->candidates[i];
+        /* One more for warming up. */
+        if (candidate->disabled || candidate->num_dispatched > budget) {
+            continue;
+        }
+        if (next == -1 || candidate->num_dispatched < bucket->candidates[next].num_dispatched) {
+            next = i;
+        }
+    }
+    return next;
+}
+
+/* Try the candidates with the arguments, the failures are agreed on later. */
+static void ucg_plan_tuner_probe(ucg_group_t *group, ucg_plan_tuner_bucket_t *bucket,
+                                 const ucg_coll_args_t *args)
+{
+    for (uint32_t i = 0; i < bucket->entry->num_plans; ++i) {
+        ucg_plan_t *plan = bucket->entry->plans[i];
+        ucg_vgroup_t *vgroup = ucg_plan_vgroup(plan, group->planc_groups);
+        ucg_plan_op_t *op;
+        ucg_status_t status = plan->attr.prepare(vgroup, args, &op);
+        if (status != UCG_OK) {
+            ucg_debug("plan '%s' in '%s' is not tuned, %s", plan->attr.name,
+                      plan->attr.domain, ucg_status_string(status));
+            bucket->values[i] = 1;
+            continue;
+        }
+        op->discard(op);
+        bucket->values[i] = 0;
+    }
+    return;
+}
+
+static const char* ucg_plan_tuner_planc_name(ucg_group_t *group, const ucg_plan_t *plan)
+{
+    ucg_vgroup_t *vgroup = ucg_plan_vgroup(plan, group->planc_groups);
+    for (int i = 0; i < group->num_planc_groups; ++i) {
+        if ((ucg_vgroup_t*)group->planc_groups[i] == vgroup) {
+            return group->context->planc_rscs[i].planc->super.name;
+        }
+    }
+    return NULL;
+}
+
+/* Append the winner to the output in the format of the tuning file. */
+static void ucg_plan_tuner_persist(ucg_group_t *group, const ucg_plan_tuner_bucket_t *bucket)
+{
+    const char *output = group->tuner.output;
+    if (output == NULL || group->myrank != 0) {
+        return;
+    }
+
+    const ucg_plan_t *plan = bucket->entry->plans[bucket->winner];
+    const char *planc_name = ucg_plan_tuner_planc_name(group, plan);
+    if (planc_name == NULL) {
+        return;
+    }
+
+    FILE *file = fopen(output, "a");
+    if (file == NULL) {
+        ucg_warn("Failed to open tuning output %s", output);
+        return;
+    }
+
+    fprintf(file, "%s %s", planc_name, ucg_coll_type_string(bucket->coll_type));
+    int32_t ppn = group->topo->ppn;
+    if (ppn == UCG_TOPO_PPX_UNBALANCED) {
+        fprintf(file, " G:%u-%u", group->size, group->size + 1);
+    } else {
+        int32_t node_cnt = group->size / ppn;
+        fprintf(file, " N:%d-%d P:%d-%d", node_cnt, node_cnt + 1, ppn, ppn + 1);
+    }
+    /* Higher than the first-class plan of the range. */
+    fprintf(file, " R:%lu-%lu I:%d S:%u\n", bucket->range.start, bucket->range.end,
+            plan->attr.id, bucket->entry->plans[0]->attr.score + 1);
+    fclose(file);
+    return;
+}
+
+static void ucg_plan_tuner_average(ucg_plan_tuner_bucket_t *bucket)
+{
+    for (uint32_t i = 0; i < bucket->entry->num_plans; ++i) {
+        ucg_plan_tuner_candidate_t *candidate = &bucket->candidates[i];
+        if (candidate->disabled || candidate->num_samples == 0) {
+            bucket->values[i] = UINT64_MAX;
+        } else {
+            bucket->values[i] = candidate->elapsed / candidate->num_samples;
+        }
+    }
+    return;
+}
+
+static void ucg_plan_tuner_stop(ucg_plan_tuner_bucket_t *bucket, const char *reason)
+{
+    ucg_info("stop tuning %s [%lu, %lu), %s", ucg_coll_type_string(bucket->coll_type),
+             bucket->range.start, bucket->range.end, reason);
+    bucket->state = UCG_PLAN_TUNER_STATE_STOPPED;
+    return;
+}
+
+static void ucg_plan_tuner_enable(ucg_plan_tuner_bucket_t *bucket)
+{
+    int num_enabled = 0;
+    for (uint32_t i = 0; i < bucket->entry->num_plans; ++i) {
+        bucket->candidates[i].disabled = bucket->values[i] != 0;
+        num_enabled += !bucket->candidates[i].disabled;
+    }
+
+    if (num_enabled == 0) {
+        ucg_plan_tuner_stop(bucket, "no plan can be tuned");
+        return;
+    }
+    bucket->state = UCG_PLAN_TUNER_STATE_TUNING;
+    return;
+}
+
+static void ucg_plan_tuner_pin(ucg_group_t *group, ucg_plan_tuner_bucket_t *bucket)
+{
+    /* The collective operation finishes when the slowest member finishes. */
+    uint32_t winner = 0;
+    for (uint32_t i = 1; i < bucket->entry->num_plans; ++i) {
+        if (bucket->values[i] < bucket->values[winner]) {
+            winner = i;
+        }
+    }
+
+    if (bucket->values[winner] == UINT64_MAX) {
+        ucg_plan_tuner_stop(bucket, "no plan is timed");
+        return;
+    }
+    bucket->winner = winner;
+    bucket->state = UCG_PLAN_TUNER_STATE_PINNED;
+
+    const ucg_plan_t *plan = bucket->entry->plans[winner];
+    ucg_info("pin plan '%s' in '%s' for %s [%lu, %lu), %lu ns",
+             plan->attr.name, plan->attr.domain, ucg_coll_type_string(bucket->coll_type),
+             bucket->range.start, bucket->range.end, bucket->values[winner]);
+    ucg_plan_tuner_persist(group, bucket);
+    return;
+}
+
+ucg_status_t ucg_plan_tuner_init(ucg_plan_tuner_t *tuner, uint32_t budget,
+                                 const char *output)
+{
+    tuner->budget = budget;
+    tuner->output = output;
+    for (int i = 0; i < UCG_COLL_TYPE_LAST; ++i) {
+        for (int j = 0; j < UCG_MEM_TYPE_LAST; ++j) {
+            tuner->buckets[i][j] = NULL;
+            tuner->num_entries[i][j] = 0;
+        }
+    }
+    return UCG_OK;
+}
+
+void ucg_plan_tuner_cleanup(ucg_plan_tuner_t *tuner)
+{
+    for (int i = 0; i < UCG_COLL_TYPE_LAST; ++i) {
+        for (int j = 0; j < UCG_MEM_TYPE_LAST; ++j) {
+            ucg_plan_tuner_bucket_t **buckets = tuner->buckets[i][j];
+            if (buckets == NULL) {
+                continue;
+            }
+            uint32_t num_buckets = tuner->num_entries[i][j] * UCG_PLAN_TUNER_NUM_BUCKETS;
+            for (uint32_t k = 0; k < num_buckets; ++k) {
+                if (buckets[k] != NULL) {
+                    ucg_free(buckets[k]);
+                }
+            }
+            ucg_free(buckets);
+            tuner->buckets[i][j] = NULL;
+        }
+    }
+    return;
+}
+
+ucg_plan_tuner_bucket_t* ucg_plan_tuner_get(ucg_group_t *group, const ucg_coll_args_t *args)
+{
+    ucg_plan_tuner_t *tuner = &group->tuner;
+    if (tuner->budget == 0) {
+        return NULL;
+    }
+
+    uint64_t msg_size = 0;
+    const ucg_plan_table_entry_t *entry;
+    entry = ucg_plans_lookup(group->plans, args, group->size, &msg_size);
+    if (entry == NULL || entry->num_plans == 1) {
+        /* Nothing to tune. */
+        return NULL;
+    }
+
+    ucg_plan_tuner_bucket_t *bucket;
+    bucket = ucg_plan_tuner_get_bucket(tuner, group->plans, args, entry, msg_size);
+    if (bucket == NULL) {
+        ucg_error("Failed to allocate plan tuner bucket");
+    }
+    return bucket;
+}
+
+ucg_status_t ucg_plan_tuner_decide(ucg_group_t *group, ucg_plan_tuner_bucket_t *bucket,
+                                   const ucg_coll_args_t *args, int32_t *plan, int *timed)
+{
+    UCG_CHECK_NULL_INVALID(group, bucket, args, plan, timed);
+
+    *timed = 0;
+    while (1) {
+        switch (bucket->state) {
+            case UCG_PLAN_TUNER_STATE_NEW:
+                ucg_plan_tuner_probe(group, bucket, args);
+                break;
+            case UCG_PLAN_TUNER_STATE_TUNING:
+                *plan = ucg_plan_tuner_next_candidate(bucket, group->tuner.budget);
+                if (*plan != -1) {
+                    /* The first one warms up. */
+                    *timed = bucket->candidates[*plan].num_dispatched++ > 0;
+                    return UCG_OK;
+                }
+                ucg_plan_tuner_average(bucket);
+                break;
+            case UCG_PLAN_TUNER_STATE_PINNED:
+                *plan = bucket->winner;
+                return UCG_OK;
+            default:
+                *plan = -1;
+                return UCG_OK;
+        }
+
+        if (group->size > 1) {
+            return UCG_INPROGRESS;
+        }
+        ucg_plan_tuner_agreed(group, bucket, UCG_OK);
+    }
+}
+
+void ucg_plan_tuner_agreed(ucg_group_t *group, ucg_plan_tuner_bucket_t *bucket,
+                           ucg_status_t status)
+{
+    if (status != UCG_OK) {
+        ucg_warn("Failed to agree on the tuned plans, %s", ucg_status_string(status));
+        ucg_plan_tuner_stop(bucket, "the agreement failed");
+        return;
+    }
+
+    if (bucket->state == UCG_PLAN_TUNER_STATE_NEW) {
+        ucg_plan_tuner_enable(bucket);
+    } else if (bucket->state == UCG_PLAN_TUNER_STATE_TUNING) {
+        ucg_plan_tuner_pin(group, bucket);
+    }
+    return;
+}
+
+void ucg_plan_tuner_sample(ucg_plan_tuner_bucket_t *bucket, uint32_t plan,
+                           uint64_t elapsed)
+{
+    if (bucket->state != UCG_PLAN_TUNER_STATE_TUNING) {
+        /* Completed after the agreement. */
+        return;
+    }
+
+    ucg_assert(plan < bucket->entry->num_plans);
+    ucg_plan_tuner_candidate_t *candidate = &bucket->candidates[plan];
+    candidate->elapsed += elapsed;
+    ++candidate->num_samples;
+    return;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLAN_TUNER_H_
+#define UCG_PLAN_TUNER_H_
+
+#include "ucg_plan.h"
+
+/* Bucket 0 holds message size 0, bucket i holds the sizes in [2^(i-1), 2^i). */
+#define UCG_PLAN_TUNER_NUM_BUCKETS 65
+
+typedef enum ucg_plan_tuner_state {
+    /** The members have not agreed on the plans that can be tuned. */
+    UCG_PLAN_TUNER_STATE_NEW,
+    /** The candidate plans are used in turn and timed. */
+    UCG_PLAN_TUNER_STATE_TUNING,
+    /** The winner is used. */
+    UCG_PLAN_TUNER_STATE_PINNED,
+    /** An agreement failed, the plans are selected as if not tuned. */
+    UCG_PLAN_TUNER_STATE_STOPPED,
+} ucg_plan_tuner_state_t;
+
+typedef struct ucg_plan_tuner_candidate {
+    /** Total time of the completed samples, in nanoseconds. */
+    uint64_t elapsed;
+    uint32_t num_samples;
+    /** Number of ops dispatched to the plan, including the warm-up one. */
+    uint32_t num_dispatched;
+    /** The plan failed to prepare the op on some member. */
+    uint8_t disabled;
+} ucg_plan_tuner_candidate_t;
+
+/**
+ * @brief Tuning state of one bucket of message sizes in one plan table entry.
+ *
+ * The candidates are the plans of the entry, their order is the same on all
+ * members of the group. The state changes only when the requests start, which
+ * happens in the same order on all members.
+ */
+struct ucg_plan_tuner_bucket {
+    ucg_plan_tuner_state_t state;
+    const ucg_plan_table_entry_t *entry;
+    ucg_coll_type_t coll_type;
+    /** Message sizes served by the bucket. */
+    ucg_plan_range_t range;
+    /** Index of the winner in the entry, valid if the state is pinned. */
+    uint32_t winner;
+    /**
+     * One value of each candidate, which the members replace with the maximum
+     * among them: whether the candidate failed to prepare in the new state, the
+     * average time when the candidates are used up in the tuning state.
+     */
+    uint64_t *values;
+    ucg_plan_tuner_candidate_t candidates[0];
+};
+
+/**
+ * @brief Online plan tuner of a group.
+ *
+ * The first invocations of each (collective type, memory type, size bucket)
+ * rotate through the plans that can serve them on all members. Each plan is
+ * used once to warm up and then budget times with the elapsed time measured.
+ * Afterwards the group agrees on the plan with the smallest average time of
+ * the slowest member, and the plan is pinned for the bucket.
+ */
+typedef struct ucg_plan_tuner {
+    /** Number of timed samples of each plan, 0 disables the tuner. */
+    uint32_t budget;
+    /** File that the pinned plans are appended to, NULL if not persisted. */
+    const char *output;
+    /** Buckets of each table entry, allocated on first use. */
+    ucg_plan_tuner_bucket_t **buckets[UCG_COLL_TYPE_LAST][UCG_MEM_TYPE_LAST];
+    uint32_t num_entries[UCG_COLL_TYPE_LAST][UCG_MEM_TYPE_LAST];
+} ucg_plan_tuner_t;
+
+/**
+ * @brief Initialize plan tuner
+ *
+ * @param [in] tuner    Plan tuner.
+ * @param [in] budget   Number of timed samples of each plan, 0 disables the tuner.
+ * @param [in] output   File that the pinned plans are appended to, can be NULL.
+ */
+ucg_status_t ucg_plan_tuner_init(ucg_plan_tuner_t *tuner, uint32_t budget,
+                                 const char *output);
+
+/**
+ * @brief Cleanup plan tuner
+ */
+void ucg_plan_tuner_cleanup(ucg_plan_tuner_t *tuner);
+
+/**
+ * @brief Get the bucket of the operation.
+ *
+ * @param [in]  group   Group that executes the operation.
+ * @param [in]  args    Arguments of collective operation.
+ * @return NULL if the operation is not tuned.
+ */
+ucg_plan_tuner_bucket_t* ucg_plan_tuner_get(ucg_group_t *group, const ucg_coll_args_t *args);
+
+/**
+ * @brief Decide the plan of an operation of the bucket when its request starts.
+ *
+ * All members decide in the same order, as they start the requests in the same
+ * order. If the members must agree on @ref ucg_plan_tuner_bucket::values first,
+ * it returns UCG_INPROGRESS, and the decision is made again after
+ * @ref ucg_plan_tuner_agreed.
+ *
+ * @param [in]  group   Group that executes the operation.
+ * @param [in]  bucket  Bucket of the operation.
+ * @param [in]  args    Arguments of collective operation.
+ * @param [out] plan    Index of the plan in the entry, -1 to select as if not tuned.
+ * @param [out] timed   Whether the operation is a timed sample of the plan.
+ */
+ucg_status_t ucg_plan_tuner_decide(ucg_group_t *group, ucg_plan_tuner_bucket_t *bucket,
+                                   const ucg_coll_args_t *args, int32_t *plan, int *timed);
+
+/**
+ * @brief Apply the values agreed by the members.
+ *
+ * If the agreement failed, which it does on every member, the bucket stops
+ * tuning instead of deciding from the local values.
+ *
+ * @param [in] group    Group that executes the operation.
+ * @param [in] bucket   Bucket whose values are agreed.
+ * @param [in] status   Status of the agreement.
+ */
+void ucg_plan_tuner_agreed(ucg_group_t *group, ucg_plan_tuner_bucket_t *bucket,
+                           ucg_status_t status);
+
+/**
+ * @brief Record the elapsed time of a completed sample.
+ *
+ * @param [in] bucket   Bucket of the sample.
+ * @param [in] plan     Index of the plan in the entry.
+ * @param [in] elapsed  Elapsed time in nanoseconds.
+ */
+void ucg_plan_tuner_sample(ucg_plan_tuner_bucket_t *bucket, uint32_t plan,
+                           uint64_t elapsed);
+
+#endif
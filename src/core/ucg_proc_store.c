@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_proc_store.h"
+
+#include "util/ucg_malloc.h"
+#include "util/ucg_helper.h"
+#include "util/ucg_math.h"
+#include "util/ucg_log.h"
+
+#include <string.h>
+
+/* A shorter match doesn't pay for the run header that it costs. */
+#define UCG_PROC_STORE_MIN_MATCH 4
+#define UCG_PROC_STORE_MAX_RUN   UINT16_MAX
+
+typedef struct ucg_proc_store_header {
+    uint32_t base;
+    uint32_t size;
+} ucg_proc_store_header_t;
+
+typedef struct ucg_proc_store_run {
+    uint16_t copy;
+    uint16_t literal;
+} ucg_proc_store_run_t;
+
+static ucg_proc_store_header_t* ucg_proc_store_header(const ucg_proc_store_t *store,
+                                                      uint32_t index)
+{
+    return (ucg_proc_store_header_t*)(store->data + store->offsets[index]);
+}
+
+static ucg_status_t ucg_proc_store_reserve(ucg_proc_store_t *store, uint64_t size)
+{
+    uint64_t used = store->offsets[store->count];
+    if (used + size <= store->capacity) {
+        return UCG_OK;
+    }
+
+    uint64_t capacity = ucg_max(store->capacity * 2, used + size);
+    uint8_t *data = ucg_realloc(store->data, capacity, "proc store data");
+    if (data == NULL) {
+        ucg_error("Failed to extend proc store to %lu bytes", capacity);
+        return UCG_ERR_NO_MEMORY;
+    }
+    store->data = data;
+    store->capacity = capacity;
+    return UCG_OK;
+}
+
+static void ucg_proc_store_trim(ucg_proc_store_t *store)
+{
+    uint64_t used = store->offsets[store->count];
+    uint8_t *data = ucg_realloc(store->data, used, "proc store data");
+    /* Not fatal, keep the larger one. */
+    if (data != NULL) {
+        store->data = data;
+        store->capacity = used;
+    }
+    return;
+}
+
+static uint32_t ucg_proc_store_match(const uint8_t *data, const uint8_t *base,
+                                     uint32_t offset, uint32_t common, uint32_t max)
+{
+    uint32_t len = 0;
+    while (offset + len < common && len < max && data[offset + len] == base[offset + len]) {
+        ++len;
+    }
+    return len;
+}
+
+/* Returns the encoded size, 0 if it's not smaller than the entry itself. */
+static uint64_t ucg_proc_store_encode(uint8_t *dst, const uint8_t *data, uint32_t size,
+                                      const uint8_t *base, uint32_t base_size)
+{
+    uint32_t common = ucg_min(size, base_size);
+    uint64_t pos = 0;
+    uint32_t offset = 0;
+    while (offset < size) {
+        ucg_proc_store_run_t run;
+        run.copy = ucg_proc_store_match(data, base, offset, common,
+                                        UCG_PROC_STORE_MAX_RUN);
+        offset += run.copy;
+
+        uint32_t literal_start = offset;
+        while (offset < size && offset - literal_start < UCG_PROC_STORE_MAX_RUN) {
+            if (ucg_proc_store_match(data, base, offset, common,
+                                     UCG_PROC_STORE_MIN_MATCH) == UCG_PROC_STORE_MIN_MATCH) {
+                break;
+            }
+            ++offset;
+        }
+        run.literal = offset - literal_start;
+
+        if (pos + sizeof(run) + run.literal >= size) {
+            return 0;
+        }
+        memcpy(dst + pos, &run, sizeof(run));
+        pos += sizeof(run);
+        memcpy(dst + pos, data + literal_start, run.literal);
+        pos += run.literal;
+    }
+    return pos;
+}
+
+ucg_status_t ucg_proc_store_init(ucg_proc_store_t *store, uint32_t max_count)
+{
+    store->count = 0;
+    store->max_count = max_count;
+    store->data = NULL;
+    store->capacity = 0;
+    store->offsets = ucg_calloc(max_count + 1, sizeof(uint64_t), "proc store offsets");
+    if (store->offsets == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    return UCG_OK;
+}
+
+void ucg_proc_store_cleanup(ucg_proc_store_t *store)
+{
+    if (store->data != NULL) {
+        ucg_free(store->data);
+        store->data = NULL;
+    }
+    if (store->offsets != NULL) {
+        ucg_free(store->offsets);
+        store->offsets = NULL;
+    }
+    store->count = 0;
+    store->max_count = 0;
+    store->capacity = 0;
+    return;
+}
+
+ucg_status_t ucg_proc_store_add(ucg_proc_store_t *store, const void *data,
+                                uint32_t size, uint32_t base)
+{
+    ucg_assert(base == UCG_PROC_STORE_NO_BASE ||
+               (base < store->count && ucg_proc_store_is_base(store, base)));
+
+    /* The encoded entry is used only if it's smaller than the entry itself. */
+    ucg_status_t status = ucg_proc_store_reserve(store, sizeof(ucg_proc_store_header_t) + size);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    uint64_t offset = store->offsets[store->count];
+    ucg_proc_store_header_t *header = (ucg_proc_store_header_t*)(store->data + offset);
+    uint8_t *body = (uint8_t*)(header + 1);
+    uint64_t body_size = 0;
+    if (base != UCG_PROC_STORE_NO_BASE) {
+        ucg_proc_store_header_t *base_header = ucg_proc_store_header(store, base);
+        body_size = ucg_proc_store_encode(body, data, size, (uint8_t*)(base_header + 1),
+                                          base_header->size);
+    }
+    if (body_size == 0) {
+        base = UCG_PROC_STORE_NO_BASE;
+        memcpy(body, data, size);
+        body_size = size;
+    }
+    header->base = base;
+    header->size = size;
+
+    ++store->count;
+    store->offsets[store->count] = offset + sizeof(*header) + body_size;
+    if (store->count == store->max_count) {
+        ucg_proc_store_trim(store);
+    }
+    return UCG_OK;
+}
+
+int ucg_proc_store_is_base(const ucg_proc_store_t *store, uint32_t index)
+{
+    ucg_assert(index < store->count);
+    return ucg_proc_store_header(store, index)->base == UCG_PROC_STORE_NO_BASE;
+}
+
+uint32_t ucg_proc_store_size(const ucg_proc_store_t *store, uint32_t index)
+{
+    ucg_assert(index < store->count);
+    return ucg_proc_store_header(store, index)->size;
+}
+
+void ucg_proc_store_get(const ucg_proc_store_t *store, uint32_t index, void *data)
+{
+    ucg_assert(index < store->count);
+    ucg_proc_store_header_t *header = ucg_proc_store_header(store, index);
+    const uint8_t *body = (const uint8_t*)(header + 1);
+    if (header->base == UCG_PROC_STORE_NO_BASE) {
+        memcpy(data, body, header->size);
+        return;
+    }
+
+    const uint8_t *base = (const uint8_t*)(ucg_proc_store_header(store, header->base) + 1);
+    const uint8_t *end = store->data + store->offsets[index + 1];
+    uint8_t *dst = (uint8_t*)data;
+    uint32_t offset = 0;
+    while (body < end) {
+        ucg_proc_store_run_t run;
+        memcpy(&run, body, sizeof(run));
+        body += sizeof(run);
+        memcpy(dst + offset, base + offset, run.copy);
+        offset += run.copy;
+        memcpy(dst + offset, body, run.literal);
+        body += run.literal;
+        offset += run.literal;
+    }
+    ucg_assert(offset == header->size);
+    return;
+}
+
+uint64_t ucg_proc_store_memory(const ucg_proc_store_t *store)
+{
+    return store->capacity + (store->count + 1) * sizeof(uint64_t);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PROC_STORE_H_
+#define UCG_PROC_STORE_H_
+
+#include "ucg/api/ucg.h"
+
+/** Entry that is stored as it is. */
+#define UCG_PROC_STORE_NO_BASE UINT32_MAX
+
+/**
+ * @brief Compact store of the variable-length information of all processes.
+ *
+ * An entry is either stored as it is or as the difference from a base entry,
+ * which is usually the first process of the same node. The addresses of the
+ * processes in a node share most of their device and transport bytes, so the
+ * entry keeps only the bytes that differ.
+ *
+ * Layout of an entry:
+ * ------------------------------------------------------------------
+ * |base|size|copy[0]|literal[0]|bytes[0]|...|copy[N]|literal[N]|bytes[N]
+ * ------------------------------------------------------------------
+ * The runs are only present when base is not UCG_PROC_STORE_NO_BASE,
+ * copy[i] bytes are taken from the base at the same offset, followed by
+ * literal[i] bytes of the entry itself. Otherwise the entry has size bytes.
+ */
+typedef struct ucg_proc_store {
+    uint32_t count;
+    uint32_t max_count;
+    /* offset of each entry in data, the one past the last is the used size */
+    uint64_t *offsets;
+    uint8_t *data;
+    uint64_t capacity;
+} ucg_proc_store_t;
+
+/**
+ * @brief Initialize the store for at most max_count entries.
+ */
+ucg_status_t ucg_proc_store_init(ucg_proc_store_t *store, uint32_t max_count);
+
+void ucg_proc_store_cleanup(ucg_proc_store_t *store);
+
+/**
+ * @brief Append the next entry, the data is trimmed to the used size once the
+ * last one is added.
+ *
+ * @param [in] base     Index of an entry that is stored as it is, or
+ *                      UCG_PROC_STORE_NO_BASE. The entry is stored as it is
+ *                      if the difference doesn't save memory.
+ * @return The index of the entry is the number of entries added before.
+ */
+ucg_status_t ucg_proc_store_add(ucg_proc_store_t *store, const void *data,
+                                uint32_t size, uint32_t base);
+
+/**
+ * @brief Whether the entry can be the base of the following entries.
+ */
+int ucg_proc_store_is_base(const ucg_proc_store_t *store, uint32_t index);
+
+/**
+ * @brief Size of the decoded entry.
+ */
+uint32_t ucg_proc_store_size(const ucg_proc_store_t *store, uint32_t index);
+
+/**
+ * @brief Decode the entry into data, which has at least
+ * @ref ucg_proc_store_size bytes.
+ */
+void ucg_proc_store_get(const ucg_proc_store_t *store, uint32_t index, void *data);
+
+/**
+ * @brief Bytes of memory used by the entries and their index.
+ */
+uint64_t ucg_proc_store_memory(const ucg_proc_store_t *store);
+
+#endif
@@ -5,11 +5,16 @@
 #include "ucg_request.h"
 #include "ucg_group.h"
 #include "ucg_plan.h"
+#include "ucg_plan_tuner.h"
+#include "ucg_plan_select.h"
+#include "ucg_op_cache.h"
 #include "ucg_dt.h"
 
 #include "util/ucg_log.h"
 #include "util/ucg_helper.h"
+#include "util/ucg_math.h"
 #include "util/ucg_profile.h"
+#include "util/ucg_time.h"
 #include <string.h>
 
 
@@ -95,11 +100,9 @@ out:
     return;
 }
 
-static ucg_status_t ucg_request_ctor(ucg_request_t *self, const ucg_coll_args_t *args)
+void ucg_request_set_args(ucg_request_t *self, const ucg_coll_args_t *args)
 {
-    self->status = UCG_OK;
     self->args = *args;
-    self->id = UCG_GROUP_INVALID_REQ_ID;
     /** trade-off, get more information from comments of @ref ucg_op_init */
     if (args->type == UCG_COLL_TYPE_ALLREDUCE) {
         if (!ucg_op_is_persistent(args->allreduce.op)) {
@@ -107,6 +110,20 @@ static ucg_status_t ucg_request_ctor(ucg_request_t *self, const ucg_coll_args_t
             ucg_op_copy(self->args.allreduce.op, args->allreduce.op);
         }
     }
+    return;
+}
+
+static ucg_status_t ucg_request_ctor(ucg_request_t *self, const ucg_coll_args_t *args)
+{
+    self->status = UCG_OK;
+    self->id = UCG_GROUP_INVALID_REQ_ID;
+    self->event_driven = 0;
+    self->ready = 0;
+    self->parked = 0;
+    self->selecting = 0;
+    self->owner = NULL;
+    self->tune.bucket = NULL;
+    ucg_request_set_args(self, args);
     return UCG_OK;
 }
 
@@ -115,29 +132,164 @@ static void ucg_request_dtor(ucg_request_t *self)
     return;
 }
 
+void ucg_request_wakeup(ucg_request_t *request)
+{
+    ucg_request_t *owner = request->owner;
+    if (owner == NULL) {
+        return;
+    }
+
+    ucg_group_t *group = owner->group;
+    ucg_lock_enter(&group->rlist_lock);
+    if (!owner->ready && owner->status == UCG_INPROGRESS) {
+        owner->ready = 1;
+        ucg_list_add_tail(&group->rlist, &owner->list);
+    }
+    ucg_lock_leave(&group->rlist_lock);
+    return;
+}
+
+static void ucg_request_vsize_counts(const int32_t *counts, uint64_t dt_size, uint32_t size,
+                                     ucg_coll_vsize_t *vsize)
+{
+    uint64_t total = 0;
+    uint64_t max_peer = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        uint64_t bytes = dt_size * counts[i];
+        total += bytes;
+        max_peer = ucg_max(max_peer, bytes);
+    }
+    vsize->total = ucg_max(vsize->total, total);
+    vsize->max_peer = ucg_max(vsize->max_peer, max_peer);
+    if (total > 0) {
+        vsize->imbalance = ucg_max(vsize->imbalance, max_peer * size * 100 / total);
+    }
+    return;
+}
+
+void ucg_request_vsize_local(const ucg_coll_args_t *args, uint32_t size, ucg_rank_t myrank,
+                             ucg_coll_vsize_t *vsize)
+{
+    vsize->total = 0;
+    vsize->max_peer = 0;
+    vsize->imbalance = 0;
+    switch (args->type) {
+        case UCG_COLL_TYPE_ALLTOALLV:
+            ucg_request_vsize_counts(args->alltoallv.sendcounts,
+                                     ucg_dt_size(args->alltoallv.sendtype), size, vsize);
+            ucg_request_vsize_counts(args->alltoallv.recvcounts,
+                                     ucg_dt_size(args->alltoallv.recvtype), size, vsize);
+            break;
+        case UCG_COLL_TYPE_SCATTERV:
+            if (myrank == args->scatterv.root) {
+                ucg_request_vsize_counts(args->scatterv.sendcounts,
+                                         ucg_dt_size(args->scatterv.sendtype), size, vsize);
+            }
+            break;
+        case UCG_COLL_TYPE_GATHERV:
+            if (myrank == args->gatherv.root) {
+                ucg_request_vsize_counts(args->gatherv.recvcounts,
+                                         ucg_dt_size(args->gatherv.recvtype), size, vsize);
+            }
+            break;
+        default:
+            break;
+    }
+    return;
+}
+
+ucg_status_t ucg_request_run_blocking(ucg_group_t *group, const ucg_coll_args_t *args)
+{
+    UCG_CHECK_NULL_INVALID(group, args);
+
+    ucg_plan_op_t *op = NULL;
+    ucg_group_lock(group);
+    ucg_status_t status = ucg_plans_prepare(group->plans, args, group->size, group->planc_groups, &op);
+    if (status != UCG_OK) {
+        goto out;
+    }
+
+    op->super.group = group;
+    /* The other threads may need the lock to complete the oldest request. */
+    while ((status = ucg_group_alloc_req_id(group, &op->super)) == UCG_ERR_NO_RESOURCE) {
+        ucg_group_unlock(group);
+        ucg_progress(group->context);
+        ucg_group_lock(group);
+    }
+    if (status != UCG_OK) {
+        goto out_discard;
+    }
+
+    status = op->trigger(op);
+    if (status == UCG_OK) {
+        status = op->super.status;
+        while (status == UCG_INPROGRESS) {
+            /* The others may wait for my requests before they come here. */
+            ucg_group_unlock(group);
+            ucg_progress(group->context);
+            ucg_group_lock(group);
+            status = op->progress(op);
+        }
+    }
+    ucg_group_free_req_id(group, &op->super);
+out_discard:
+    op->discard(op);
+out:
+    ucg_group_unlock(group);
+    return status;
+}
+
 static inline ucg_status_t ucg_request_init(ucg_group_t *group, ucg_coll_args_t *args,
                                             ucg_request_t **request)
 {
-    ucg_context_lock(group->context);
+    ucg_group_lock(group);
 
     ucg_plan_op_t *op;
-    ucg_status_t status = ucg_plans_prepare(group->plans, args, group->size, &op);
+    ucg_status_t status;
+    ucg_op_cache_key_t key;
+    if (ucg_op_cache_key_init(&key, args) == UCG_OK) {
+        op = ucg_op_cache_get(&group->op_cache, &key);
+        if (op != NULL) {
+            status = op->rebind(op, args);
+            if (status == UCG_OK) {
+                goto out_set_request;
+            }
+            op->discard(op);
+        }
+    }
+
+    if (args->type == UCG_COLL_TYPE_ALLTOALLV || args->type == UCG_COLL_TYPE_SCATTERV ||
+        args->type == UCG_COLL_TYPE_GATHERV) {
+        /* The select op agrees on them if the selection depends on them. */
+        ucg_request_vsize_local(args, group->size, group->myrank, &args->vsize);
+    }
+
+    ucg_plan_t *forced = group->forced_plans[args->type][args->info.mem_type];
+    if (forced != NULL) {
+        status = forced->attr.prepare(ucg_plan_vgroup(forced, group->planc_groups), args, &op);
+    } else {
+        status = ucg_plan_select_prepare(group, args, &op);
+    }
     if (status != UCG_OK) {
         ucg_debug("Failed to prepare op(%d), %s", args->type, ucg_status_string(status));
         goto out;
     }
+out_set_request:
     op->super.group = group;
     *request = &op->super;
     ucg_assert((*request)->status == UCG_OK);
 out:
-    ucg_context_unlock(group->context);
+    ucg_group_unlock(group);
     return status;
 }
 
 static inline void ucg_request_complete(ucg_request_t *request, ucg_status_t status)
 {
-    ucg_group_free_req_id(request->group, request->id);
-    request->id = UCG_GROUP_INVALID_REQ_ID;
+    ucg_group_free_req_id(request->group, request);
+    if (request->tune.bucket != NULL && status == UCG_OK) {
+        ucg_plan_tuner_sample(request->tune.bucket, request->tune.plan,
+                              ucg_get_time_ns() - request->tune.start);
+    }
     ucg_request_info_t *info = &request->args.info;
     if (info->field_mask & UCG_REQUEST_INFO_FIELD_CB) {
         info->complete_cb.cb(info->complete_cb.arg, status);
@@ -337,95 +489,230 @@ ucg_status_t ucg_request_allgatherv_init(const void *sendbuf, int sendcount,
     return ucg_request_init(group, &args, request);
 }
 
+/* Remove the request from the progress list or the ready list. */
+static inline void ucg_request_dequeue(ucg_request_t *request)
+{
+    if (!request->event_driven) {
+        ucg_list_del(&request->list);
+        return;
+    }
+
+    ucg_group_t *group = request->group;
+    ucg_lock_enter(&group->rlist_lock);
+    if (request->ready) {
+        ucg_list_del(&request->list);
+        request->ready = 0;
+    }
+    ucg_lock_leave(&group->rlist_lock);
+    return;
+}
+
+/* Trigger the started request and queue it, it's not freed if failed. */
+static ucg_status_t ucg_request_trigger(ucg_request_t *request)
+{
+    ucg_group_t *group = request->group;
+    ucg_plan_op_t *op = ucg_derived_of(request, ucg_plan_op_t);
+    ucg_status_t status = op->trigger(op);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    if (request->status == UCG_INPROGRESS) {
+        if (!request->event_driven) {
+            ucg_list_add_tail(&group->plist, &request->list);
+        }
+        if (request->selecting) {
+            group->selecting = request;
+        }
+    } else {
+        if (request->event_driven) {
+            /* May be woken up during the trigger. */
+            ucg_request_dequeue(request);
+        }
+        ucg_request_complete(request, request->status);
+    }
+    return UCG_OK;
+}
+
+/* Trigger the parked requests in the order they started, until one selects. */
+static void ucg_request_unpark(ucg_group_t *group)
+{
+    group->selecting = NULL;
+    while (group->selecting == NULL && !ucg_list_is_empty(&group->slist)) {
+        ucg_request_t *request = ucg_list_extract_head(&group->slist, ucg_request_t, list);
+        request->parked = 0;
+        request->status = UCG_OK;
+        ucg_status_t status = ucg_request_trigger(request);
+        if (status != UCG_OK) {
+            /* The start has succeeded, so the failure completes the request. */
+            request->status = status;
+            ucg_request_complete(request, status);
+        }
+    }
+    return;
+}
+
 UCG_PROFILE_FUNC(ucg_status_t, ucg_request_start, (request), ucg_request_h request)
 {
     UCG_CHECK_NULL_INVALID(request);
 
-    ucg_context_lock(request->group->context);
+    ucg_group_t *group = request->group;
+    ucg_group_lock(group);
 
     if (ucg_unlikely(request->status != UCG_OK)) {
         ucg_error("Attempt to start a request with status %d", request->status);
-        ucg_context_unlock(request->group->context);
+        ucg_group_unlock(group);
         return request->status;
     }
 
     /* Requests with the same ID are combined into a complete collection op. */
     ucg_assert(request->id == UCG_GROUP_INVALID_REQ_ID);
-    request->id = ucg_group_alloc_req_id(request->group);
+    ucg_status_t status = ucg_group_alloc_req_id(group, request);
+    if (status != UCG_OK) {
+        ucg_group_unlock(group);
+        return status;
+    }
 
-    ucg_plan_op_t *op = ucg_derived_of(request, ucg_plan_op_t);
-    ucg_status_t status = op->trigger(op);
-    if (status == UCG_OK) {
-        if (op->super.status == UCG_INPROGRESS) {
-            ucg_list_add_tail(&op->super.group->context->plist, &op->super.list);
-        } else {
-            ucg_request_complete(&op->super, op->super.status);
-        }
+    /* The event-driven request is put into the ready list once woken up. */
+    request->owner = request->event_driven ? request : NULL;
+    request->ready = 0;
+
+    if (group->selecting != NULL) {
+        /* The ops take their turns when triggered, which must follow the starts. */
+        request->parked = 1;
+        request->status = UCG_INPROGRESS;
+        ucg_list_add_tail(&group->slist, &request->list);
+        ucg_group_unlock(group);
+        return UCG_OK;
     }
-    ucg_context_unlock(request->group->context);
+
+    status = ucg_request_trigger(request);
+    if (status != UCG_OK) {
+        ucg_group_free_req_id(group, request);
+    }
+    ucg_group_unlock(group);
 
     return status;
 }
 
-UCG_PROFILE_FUNC(ucg_status_t, ucg_request_test, (request), ucg_request_h request)
+ucg_status_t ucg_request_progress(ucg_request_t *request)
 {
-    UCG_CHECK_NULL_INVALID(request);
-
-    ucg_context_lock(request->group->context);
+    ucg_group_t *group = request->group;
+    ucg_group_lock(group);
     if (ucg_unlikely(request->status != UCG_INPROGRESS)) {
-        ucg_context_unlock(request->group->context);
+        ucg_group_unlock(group);
         return request->status;
     }
 
+    ucg_status_t status;
+    if (ucg_unlikely(request->parked)) {
+        /* Triggered after the selecting request selects its plan. */
+        ucg_request_progress(group->selecting);
+        status = request->status;
+        ucg_group_unlock(group);
+        return status;
+    }
+
     ucg_plan_op_t *op = ucg_derived_of(request, ucg_plan_op_t);
-    ucg_status_t status = op->progress(op);
+    status = op->progress(op);
     ucg_assert(status == op->super.status);
+    if (ucg_unlikely(request == group->selecting) && !request->selecting) {
+        ucg_request_unpark(group);
+    }
     if (status != UCG_INPROGRESS) {
-        ucg_list_del(&op->super.list);
+        ucg_request_dequeue(request);
         ucg_request_complete(&op->super, status);
     }
-    ucg_context_unlock(request->group->context);
+    ucg_group_unlock(group);
 
     return status;
 }
 
+UCG_PROFILE_FUNC(ucg_status_t, ucg_request_test, (request), ucg_request_h request)
+{
+    UCG_CHECK_NULL_INVALID(request);
+
+    if (request->event_driven && request->status == UCG_INPROGRESS) {
+        /* The op doesn't progress the plancs, deliver its events first. */
+        ucg_context_progress_plancs(request->group->context);
+    }
+    return ucg_request_progress(request);
+}
+
+/* The polled requests complete without events, a parked one waits for a polled one. */
+static int ucg_request_is_polled(ucg_request_t *request)
+{
+    ucg_group_t *group = request->group;
+    ucg_group_lock(group);
+    int polled = !request->event_driven || request->parked;
+    ucg_group_unlock(group);
+    return polled;
+}
+
+UCG_PROFILE_FUNC(ucg_status_t, ucg_request_wait, (request), ucg_request_h request)
+{
+    UCG_CHECK_NULL_INVALID(request);
+
+    ucg_context_t *context = request->group->context;
+    uint64_t spin_end = ucg_get_time_ns() + context->wait_spin_time;
+    int can_block = 1;
+    ucg_status_t status;
+    while ((status = ucg_request_test(request)) == UCG_INPROGRESS) {
+        if (!can_block || ucg_get_time_ns() < spin_end || ucg_request_is_polled(request)) {
+            continue;
+        }
+        /* Arming fails while the events keep coming, so it only sleeps when idle. */
+        ucg_status_t wait_status = ucg_context_wait(context);
+        if (wait_status != UCG_OK && wait_status != UCG_INPROGRESS) {
+            can_block = 0;
+        }
+    }
+    return status;
+}
+
 UCG_PROFILE_FUNC(ucg_status_t, ucg_request_cleanup, (request), ucg_request_h request)
 {
     UCG_CHECK_NULL_INVALID(request);
 
-    ucg_context_lock(request->group->context);
+    /* The request may be freed, don't touch it after putting it into the cache. */
+    ucg_group_t *group = request->group;
+    ucg_group_lock(group);
 
     if (ucg_unlikely(request->status == UCG_INPROGRESS)) {
         ucg_error("Attempt to cleanup a in-progress request");
-        ucg_context_unlock(request->group->context);
+        ucg_group_unlock(group);
         return UCG_INPROGRESS;
     }
 
     ucg_plan_op_t *op = ucg_derived_of(request, ucg_plan_op_t);
-    ucg_status_t status = op->discard(op);
-    ucg_context_unlock(request->group->context);
+    ucg_status_t status = ucg_op_cache_put(&group->op_cache, op);
+    ucg_group_unlock(group);
     return status;
 }
 
-ucg_status_t ucg_request_msg_size(const ucg_coll_args_t *args, const uint32_t size, uint32_t *msize)
+ucg_status_t ucg_request_msg_size(const ucg_coll_args_t *args, const uint32_t size, uint64_t *msize)
 {
     uint64_t total_size;
     uint64_t dt_size;
     switch (args->type) {
         case UCG_COLL_TYPE_BCAST:
-            *msize = ucg_dt_size(args->bcast.dt) * args->bcast.count;
+            *msize = (uint64_t)ucg_dt_size(args->bcast.dt) * args->bcast.count;
             break;
         case UCG_COLL_TYPE_ALLREDUCE:
-            *msize = ucg_dt_size(args->allreduce.dt) * args->allreduce.count;
+            *msize = (uint64_t)ucg_dt_size(args->allreduce.dt) * args->allreduce.count;
             break;
         case UCG_COLL_TYPE_BARRIER:
+            *msize = 0;
+            break;
         case UCG_COLL_TYPE_ALLTOALLV:
+            *msize = args->vsize.max_peer;
+            break;
         case UCG_COLL_TYPE_SCATTERV:
         case UCG_COLL_TYPE_GATHERV:
-            *msize = 0;
+            *msize = args->vsize.total;
             break;
         case UCG_COLL_TYPE_ALLGATHERV:
-            /* The message size of each process is different, so using 0. */
+            /* The message size of each process is different, so using the average. */
             dt_size = (args->allgatherv.sendbuf != UCG_IN_PLACE) ?
                       (uint64_t)ucg_dt_size(args->allgatherv.sendtype) :
                       (uint64_t)ucg_dt_size(args->allgatherv.recvtype);
@@ -433,7 +720,7 @@ ucg_status_t ucg_request_msg_size(const ucg_coll_args_t *args, const uint32_t si
             for (int i = 0; i < size; i++) {
                 total_size += dt_size * args->allgatherv.recvcounts[i];
             }
-            *msize = (uint32_t)(total_size / size);
+            *msize = total_size / size;
             break;
         default:
             return UCG_ERR_INVALID_PARAM;
@@ -459,6 +746,8 @@ const char* ucg_coll_type_string(ucg_coll_type_t coll_type)
             return "gatherv";
         case UCG_COLL_TYPE_ALLGATHERV:
             return "allgatherv";
+        case UCG_COLL_TYPE_REDUCE:
+            return "reduce";
         default:
             return "unknown";
     }
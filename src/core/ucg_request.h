@@ -96,9 +96,28 @@ typedef struct ucg_coll_reduce_args {
     ucg_rank_t root;
 } ucg_coll_reduce_args_t;
 
+/**
+ * @brief Size metrics of alltoallv, scatterv and gatherv.
+ *
+ * The counts of these collectives differ between the processes or are only
+ * significant at the root, so the metrics are agreed by the processes before
+ * selecting the plan.
+ */
+typedef struct ucg_coll_vsize {
+    /** Bytes sent or received by the root, the most bytes sent or received by
+        a process for alltoallv. */
+    uint64_t total;
+    /** The most bytes between a process and one of its peers. */
+    uint64_t max_peer;
+    /** max_peer over the average bytes per peer in percent, 100 if balanced. */
+    uint64_t imbalance;
+} ucg_coll_vsize_t;
+
 typedef struct ucg_coll_args {
     ucg_coll_type_t type;
     ucg_request_info_t info;
+    /* Only valid for alltoallv, scatterv and gatherv. */
+    ucg_coll_vsize_t vsize;
     union {
         ucg_coll_bcast_args_t bcast;
         ucg_coll_allreduce_args_t allreduce;
@@ -110,19 +129,96 @@ typedef struct ucg_coll_args {
     };
 } ucg_coll_args_t;
 
+typedef struct ucg_request_tune {
+    /* NULL if the request is not a timed sample of plan tuning */
+    ucg_plan_tuner_bucket_t *bucket;
+    uint32_t plan;
+    uint64_t start;
+} ucg_request_tune_t;
+
 typedef struct ucg_request {
     ucg_status_t status;
     ucg_coll_args_t args;
     ucg_group_t *group;
-    ucg_list_link_t list; /* link to progress list */
-    uint16_t id;
+    ucg_list_link_t list; /* link to progress list or ready list */
+    uint32_t id;
+    ucg_list_link_t id_list; /* link to the id list of the group while started */
+    /* Progressed only after being woken up, see @ref ucg_request_wakeup */
+    uint8_t event_driven;
+    /* Woken up and waiting in the ready list */
+    uint8_t ready;
+    /* Started but not triggered, waiting for the selecting request of the group */
+    uint8_t parked;
+    /* Agreeing on the plan with the other members, see @ref ucg_plan_select_prepare */
+    uint8_t selecting;
+    /* Started request that is woken up by the completions of this request,
+       NULL if it's not started by @ref ucg_request_start */
+    struct ucg_request *owner;
+    ucg_request_tune_t tune;
     char pending[32]; /* cacheline pending, `ucg_info -t` check struct size */
 } ucg_request_t;
 UCG_CLASS_DECLARE(ucg_request_t,
                   UCG_CLASS_CTOR_ARGS(const ucg_coll_args_t *arg));
 
+/**
+ * @brief Set the arguments of the request.
+ */
+void ucg_request_set_args(ucg_request_t *request, const ucg_coll_args_t *args);
+
+/**
+ * @brief Wake up the owner of the request.
+ *
+ * The plan components call it when a completion event of an event-driven
+ * request occurs, then the owner is progressed in the next @ref ucg_progress.
+ * Requests that are not event-driven are progressed in every ucg_progress.
+ */
+void ucg_request_wakeup(ucg_request_t *request);
+
+/**
+ * @brief Progress the started request without progressing the plancs.
+ *
+ * It's for @ref ucg_progress, which delivers the events of all event-driven
+ * requests before testing them.
+ */
+ucg_status_t ucg_request_progress(ucg_request_t *request);
+
+/**
+ * @brief Get the size metrics of a v-collective from the local arguments.
+ *
+ * The counts only significant at the root are ignored by the other processes,
+ * whose metrics are 0.
+ *
+ * @param [in]  args    Arguments of alltoallv, scatterv or gatherv.
+ * @param [in]  size    Group size.
+ * @param [in]  myrank  My rank in the group.
+ * @param [out] vsize   Size metrics.
+ */
+void ucg_request_vsize_local(const ucg_coll_args_t *args, uint32_t size, ucg_rank_t myrank,
+                             ucg_coll_vsize_t *vsize);
+
+/**
+ * @brief Run a collective operation among the group and wait for its completion.
+ *
+ * It's for the small internal collective operations of the core layer, every
+ * process of the group must call it with matched arguments. It takes the group
+ * lock and releases it while progressing the context.
+ */
+ucg_status_t ucg_request_run_blocking(ucg_group_t *group, const ucg_coll_args_t *args);
+
+/**
+ * @brief Get the message size in bytes that the plan is selected by.
+ *
+ * For the v-collectives, it is the total bytes at the root of scatterv and
+ * gatherv, the most bytes between two processes of alltoallv, and the average
+ * bytes per process of allgatherv. Plans of these collectives declare their
+ * ranges on the same metrics.
+ *
+ * @param [in]  args    Arguments of collective operation.
+ * @param [in]  size    Group size.
+ * @param [out] msize   Message size, which may exceed 4 GiB.
+ */
 ucg_status_t ucg_request_msg_size(const ucg_coll_args_t *args, const uint32_t size,
-                                  uint32_t *msize);
+                                  uint64_t *msize);
 
 const char* ucg_coll_type_string(ucg_coll_type_t coll_type);
 
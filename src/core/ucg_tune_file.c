@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_tune_file.h"
+#include "ucg_group.h"
+#include "ucg_topo.h"
+#include "ucg_vgroup.h"
+
+#include "util/ucg_log.h"
+#include "util/ucg_malloc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define UCG_TUNE_FILE_LINE_MAX 1024
+
+
+static ucg_status_t ucg_tune_file_parse_range(const char *str, ucg_plan_range_t *range)
+{
+    int skip = 0;
+    int rc = sscanf(str, "%lu-%lu%n", &range->start, &range->end, &skip);
+    if (rc == 2) {
+        if (str[skip] != '\0' || range->start >= range->end) {
+            return UCG_ERR_INVALID_PARAM;
+        }
+        return UCG_OK;
+    }
+
+    /* No upper limit, "start-" or "start". */
+    if (sscanf(str, "%lu%n", &range->start, &skip) != 1) {
+        return UCG_ERR_INVALID_PARAM;
+    }
+    if (str[skip] == '-') {
+        ++skip;
+    }
+    if (str[skip] != '\0') {
+        return UCG_ERR_INVALID_PARAM;
+    }
+    range->end = UCG_PLAN_RANGE_MAX;
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_tune_file_parse_coll_type(const char *str,
+                                                  ucg_coll_type_t *coll_type)
+{
+    for (ucg_coll_type_t type = 0; type < UCG_COLL_TYPE_LAST; ++type) {
+        if (!strcmp(str, ucg_coll_type_string(type))) {
+            *coll_type = type;
+            return UCG_OK;
+        }
+    }
+    return UCG_ERR_INVALID_PARAM;
+}
+
+/* Return UCG_ERR_NOT_FOUND if the line has no rule. */
+static ucg_status_t ucg_tune_file_parse_line(char *line, ucg_tune_rule_t *rule)
+{
+    char *comment = strchr(line, '#');
+    if (comment != NULL) {
+        *comment = '\0';
+    }
+
+    const char *delim = " \t\r\n";
+    char *saveptr = NULL;
+    char *token = strtok_r(line, delim, &saveptr);
+    if (token == NULL) {
+        return UCG_ERR_NOT_FOUND;
+    }
+    if (strlen(token) >= UCG_TUNE_FILE_NAME_MAX) {
+        return UCG_ERR_INVALID_PARAM;
+    }
+    strcpy(rule->planc, token);
+
+    token = strtok_r(NULL, delim, &saveptr);
+    if (token == NULL || ucg_tune_file_parse_coll_type(token, &rule->coll_type) != UCG_OK) {
+        return UCG_ERR_INVALID_PARAM;
+    }
+
+    ucg_plan_range_t whole = {0, UCG_PLAN_RANGE_MAX};
+    rule->node_cnt = whole;
+    rule->ppn = whole;
+    rule->group_size = whole;
+    rule->range = whole;
+    int has_id = 0;
+    int has_score = 0;
+    ucg_status_t status = UCG_OK;
+    while ((token = strtok_r(NULL, delim, &saveptr)) != NULL) {
+        int skip = 0;
+        if (strlen(token) < 2 || token[1] != ':') {
+            return UCG_ERR_INVALID_PARAM;
+        }
+        const char *value = token + 2;
+        switch (token[0]) {
+            case 'N':
+                status = ucg_tune_file_parse_range(value, &rule->node_cnt);
+                break;
+            case 'P':
+                status = ucg_tune_file_parse_range(value, &rule->ppn);
+                break;
+            case 'G':
+                status = ucg_tune_file_parse_range(value, &rule->group_size);
+                break;
+            case 'R':
+                status = ucg_tune_file_parse_range(value, &rule->range);
+                break;
+            case 'I':
+                if (sscanf(value, "%d%n", &rule->id, &skip) != 1 || value[skip] != '\0') {
+                    return UCG_ERR_INVALID_PARAM;
+                }
+                has_id = 1;
+                break;
+            case 'S':
+                if (sscanf(value, "%u%n", &rule->score, &skip) != 1 || value[skip] != '\0') {
+                    return UCG_ERR_INVALID_PARAM;
+                }
+                has_score = 1;
+                break;
+            default:
+                return UCG_ERR_INVALID_PARAM;
+        }
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+
+    if (!has_id || !has_score) {
+        return UCG_ERR_INVALID_PARAM;
+    }
+    return UCG_OK;
+}
+
+static int ucg_tune_file_in_range(const ucg_plan_range_t *range, uint64_t value)
+{
+    return value >= range->start && value < range->end;
+}
+
+static int ucg_tune_file_is_whole(const ucg_plan_range_t *range)
+{
+    return range->start == 0 && range->end == UCG_PLAN_RANGE_MAX;
+}
+
+static int ucg_tune_file_match_group(const ucg_tune_rule_t *rule, const ucg_vgroup_t *vgroup)
+{
+    if (!ucg_tune_file_in_range(&rule->group_size, vgroup->size)) {
+        return 0;
+    }
+
+    if (ucg_tune_file_is_whole(&rule->node_cnt) && ucg_tune_file_is_whole(&rule->ppn)) {
+        return 1;
+    }
+
+    int32_t ppn = vgroup->group->topo->ppn;
+    if (ppn == UCG_TOPO_PPX_UNBALANCED) {
+        return 0;
+    }
+    int32_t node_cnt = vgroup->group->size / ppn;
+    return ucg_tune_file_in_range(&rule->node_cnt, node_cnt) &&
+           ucg_tune_file_in_range(&rule->ppn, ppn);
+}
+
+ucg_status_t ucg_tune_file_load(ucg_tune_file_t *file, const char *filename)
+{
+    UCG_CHECK_NULL_INVALID(file, filename);
+
+    FILE *stream = fopen(filename, "r");
+    if (stream == NULL) {
+        ucg_error("Failed to open tuning file %s", filename);
+        return UCG_ERR_NOT_FOUND;
+    }
+
+    file->num_rules = 0;
+    file->rules = NULL;
+    uint32_t max_rules = 0;
+    ucg_status_t status = UCG_OK;
+    char line[UCG_TUNE_FILE_LINE_MAX];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), stream) != NULL) {
+        ++lineno;
+        ucg_tune_rule_t rule;
+        status = ucg_tune_file_parse_line(line, &rule);
+        if (status == UCG_ERR_NOT_FOUND) {
+            continue;
+        }
+        if (status != UCG_OK) {
+            ucg_error("Invalid rule at %s:%d", filename, lineno);
+            goto err_free_rules;
+        }
+
+        if (file->num_rules == max_rules) {
+            max_rules = max_rules == 0 ? 16 : max_rules * 2;
+            ucg_tune_rule_t *rules = ucg_realloc(file->rules, max_rules * sizeof(ucg_tune_rule_t),
+                                                 "tune rules");
+            if (rules == NULL) {
+                status = UCG_ERR_NO_MEMORY;
+                goto err_free_rules;
+            }
+            file->rules = rules;
+        }
+        file->rules[file->num_rules++] = rule;
+    }
+    fclose(stream);
+    ucg_debug("Read %u rules from tuning file %s", file->num_rules, filename);
+    return UCG_OK;
+
+err_free_rules:
+    ucg_tune_file_cleanup(file);
+    fclose(stream);
+    return status;
+}
+
+ucg_status_t ucg_tune_file_copy(ucg_tune_file_t *dst, const ucg_tune_file_t *src)
+{
+    UCG_CHECK_NULL_INVALID(dst, src);
+
+    dst->num_rules = 0;
+    dst->rules = NULL;
+    if (src->num_rules == 0) {
+        return UCG_OK;
+    }
+
+    size_t size = src->num_rules * sizeof(ucg_tune_rule_t);
+    dst->rules = ucg_malloc(size, "tune rules");
+    if (dst->rules == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    memcpy(dst->rules, src->rules, size);
+    dst->num_rules = src->num_rules;
+    return UCG_OK;
+}
+
+void ucg_tune_file_cleanup(ucg_tune_file_t *file)
+{
+    UCG_CHECK_NULL_VOID(file);
+
+    if (file->rules != NULL) {
+        ucg_free(file->rules);
+        file->rules = NULL;
+    }
+    file->num_rules = 0;
+    return;
+}
+
+/* A plan added by the planc with the id, the tuned copies have the same attributes
+   except the range and the score. */
+static const ucg_plan_t* ucg_tune_file_find_plan(ucg_list_link_t *head, int32_t id)
+{
+    ucg_plan_t *plan = NULL;
+    ucg_list_for_each(plan, head, list) {
+        if (plan->planc == UCG_PLAN_PLANC_NONE && plan->attr.id == id) {
+            return plan;
+        }
+        ucg_plan_t *plan_fb = NULL;
+        ucg_list_for_each(plan_fb, &plan->fallback, fallback) {
+            if (plan_fb->planc == UCG_PLAN_PLANC_NONE && plan_fb->attr.id == id) {
+                return plan_fb;
+            }
+        }
+    }
+    return NULL;
+}
+
+ucg_status_t ucg_tune_file_add_plans(const ucg_tune_file_t *file, const char *planc,
+                                     ucg_plans_t *plans)
+{
+    UCG_CHECK_NULL_INVALID(file, planc, plans);
+
+    for (uint32_t i = 0; i < file->num_rules; ++i) {
+        const ucg_tune_rule_t *rule = &file->rules[i];
+        if (strcmp(rule->planc, planc)) {
+            continue;
+        }
+
+        ucg_mem_type_t mem_type;
+        for (mem_type = 0; mem_type < UCG_MEM_TYPE_LAST; ++mem_type) {
+            ucg_list_link_t *head = &plans->plans[rule->coll_type][mem_type];
+            const ucg_plan_t *plan = ucg_tune_file_find_plan(head, rule->id);
+            if (plan == NULL || !ucg_tune_file_match_group(rule, plan->attr.vgroup)) {
+                continue;
+            }
+
+            ucg_plan_params_t tuned;
+            tuned.mem_type = mem_type;
+            tuned.coll_type = rule->coll_type;
+            tuned.attr = plan->attr;
+            tuned.attr.range = rule->range;
+            tuned.attr.score = rule->score;
+            tuned.attr.score_fixed = 1;
+            ucg_status_t status = ucg_plans_add(plans, &tuned);
+            if (status != UCG_OK) {
+                return status;
+            }
+            ucg_debug("Add tuned plan '%s' in '%s', range [%lu, %lu), score %u",
+                      tuned.attr.name, tuned.attr.domain, tuned.attr.range.start,
+                      tuned.attr.range.end, tuned.attr.score);
+        }
+    }
+    return UCG_OK;
+}
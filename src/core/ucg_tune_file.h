@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_TUNE_FILE_H_
+#define UCG_TUNE_FILE_H_
+
+#include "ucg_plan.h"
+
+#define UCG_TUNE_FILE_NAME_MAX 16
+
+typedef struct ucg_tune_rule {
+    char planc[UCG_TUNE_FILE_NAME_MAX];
+    ucg_coll_type_t coll_type;
+    /* [start, end) of each dimension */
+    ucg_plan_range_t node_cnt;
+    ucg_plan_range_t ppn;
+    ucg_plan_range_t group_size;
+    ucg_plan_range_t range;
+    int32_t id;
+    uint32_t score;
+} ucg_tune_rule_t;
+
+/**
+ * @brief Rules read from a tuning file.
+ *
+ * Each line is a rule that adds a plan on top of the builtin plans of a plan
+ * component, text after '#' is ignored.
+ * Syntax: <planc> <coll> [N:<range>] [P:<range>] [G:<range>] I:<id> S:<score> [R:<range>]
+ * - N, P, G: number of nodes, processes per node and group size of the groups
+ *   that the rule applies to. Rules with N or P are not applied to the groups
+ *   with unbalanced nodes.
+ * - I, S: plan id in the plan component and its score.
+ * - R: message size range, whole range if not given.
+ * The range is "start-end" with end excluded, no upper limit if there is no "-end".
+ * Example: ucx allreduce N:4-5 P:64-65 R:0-8192 I:5 S:100
+ */
+typedef struct ucg_tune_file {
+    uint32_t num_rules;
+    ucg_tune_rule_t *rules;
+} ucg_tune_file_t;
+
+/**
+ * @brief Read the rules from the tuning file.
+ *
+ * @param [out] file        Tuning file.
+ * @param [in]  filename    Path of the tuning file.
+ * @retval UCG_ERR_INVALID_PARAM    The format of a line is incorrect.
+ */
+ucg_status_t ucg_tune_file_load(ucg_tune_file_t *file, const char *filename);
+
+/**
+ * @brief Copy the rules.
+ */
+ucg_status_t ucg_tune_file_copy(ucg_tune_file_t *dst, const ucg_tune_file_t *src);
+
+/**
+ * @brief Release the rules.
+ */
+void ucg_tune_file_cleanup(ucg_tune_file_t *file);
+
+/**
+ * @brief Add the plans of the rules of a plan component.
+ *
+ * It's called after the plan component adds its builtin plans and before
+ * @ref ucg_plans_set_planc, so its plans are the ones without a planc. Each
+ * matched rule adds a copy of the builtin plan with the range and score of the
+ * rule, the builtin plan is still the fallback out of the range. Deprecated
+ * plans are not added, so their rules match nothing.
+ *
+ * @param [in] file     Tuning file.
+ * @param [in] planc    Name of the plan component.
+ * @param [in] plans    Plan container.
+ */
+ucg_status_t ucg_tune_file_add_plans(const ucg_tune_file_t *file, const char *planc,
+                                     ucg_plans_t *plans);
+
+#endif
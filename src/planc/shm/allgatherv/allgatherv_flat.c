@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include <string.h>
+
+#include "allgatherv.h"
+
+#include "util/ucg_helper.h"
+#include "util/ucg_log.h"
+
+/* Bytes of the block that are moved in the round. */
+static inline int64_t ucg_planc_shm_allgatherv_flat_length(const ucg_planc_shm_op_t *op,
+                                                           int64_t block_size)
+{
+    int64_t length = block_size - op->round * op->frag;
+    if (length < 0) {
+        return 0;
+    }
+    return ucg_min(length, op->frag);
+}
+
+/**
+ * Each round: every process copies one fragment of its block to its slot, then
+ * copies the fragments of the others out of their slots.
+ */
+static ucg_status_t ucg_planc_shm_allgatherv_flat_op_step(ucg_planc_shm_op_t *op)
+{
+    ucg_planc_shm_group_t *shm_group = op->shm_group;
+    ucg_coll_allgatherv_args_t *args = &op->super.super.args.allgatherv;
+    ucg_rank_t myrank = shm_group->node_group.myrank;
+    uint32_t size = shm_group->node_group.size;
+    uint32_t extent = ucg_dt_extent(args->recvtype);
+    char *myblock = (char *)args->recvbuf + (int64_t)args->displs[myrank] * extent;
+
+    while (op->round < op->nround) {
+        uint64_t base = ucg_planc_shm_op_base(op);
+        int64_t offset = op->round * op->frag;
+        if (op->phase == 0) {
+            if (!ucg_planc_shm_group_all_arrived(shm_group, base)) {
+                return UCG_INPROGRESS;
+            }
+            if (op->round == 0 && args->sendbuf != UCG_IN_PLACE) {
+                memcpy(myblock, args->sendbuf, (int64_t)args->recvcounts[myrank] * extent);
+            }
+            int64_t length = ucg_planc_shm_allgatherv_flat_length(op,
+                                (int64_t)args->recvcounts[myrank] * extent);
+            memcpy(ucg_planc_shm_group_slot(shm_group, myrank), myblock + offset, length);
+            ucg_planc_shm_group_post(shm_group, base + 1);
+            op->phase = 1;
+        }
+
+        if (!ucg_planc_shm_group_all_arrived(shm_group, base + 1)) {
+            return UCG_INPROGRESS;
+        }
+        for (ucg_rank_t rank = 0; rank < size; ++rank) {
+            if (rank == myrank) {
+                continue;
+            }
+            int64_t length = ucg_planc_shm_allgatherv_flat_length(op,
+                                (int64_t)args->recvcounts[rank] * extent);
+            char *block = (char *)args->recvbuf + (int64_t)args->displs[rank] * extent;
+            memcpy(block + offset, ucg_planc_shm_group_slot(shm_group, rank), length);
+        }
+        ucg_planc_shm_group_post(shm_group, base + 2);
+        op->phase = 0;
+        ++op->round;
+    }
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_allgatherv_flat_op_new(ucg_planc_shm_group_t *shm_group,
+                                                  ucg_vgroup_t *vgroup,
+                                                  const ucg_coll_args_t *args,
+                                                  ucg_planc_shm_op_t **op)
+{
+    const ucg_coll_allgatherv_args_t *coll_args = &args->allgatherv;
+    ucg_status_t status = ucg_planc_shm_op_check(shm_group, coll_args->recvtype);
+    if (status != UCG_OK) {
+        return status;
+    }
+    if (coll_args->sendbuf != UCG_IN_PLACE) {
+        status = ucg_planc_shm_op_check(shm_group, coll_args->sendtype);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+
+    ucg_planc_shm_op_t *shm_op;
+    shm_op = ucg_planc_shm_op_new(shm_group, vgroup, args,
+                                  ucg_planc_shm_allgatherv_flat_op_step);
+    if (shm_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    uint32_t extent = ucg_dt_extent(coll_args->recvtype);
+    int64_t total = 0;
+    for (uint32_t i = 0; i < shm_group->node_group.size; ++i) {
+        total = ucg_max(total, (int64_t)coll_args->recvcounts[i] * extent);
+    }
+    ucg_planc_shm_op_set_rounds(shm_op, 2, total, shm_group->slot_size);
+    *op = shm_op;
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_allgatherv_flat_prepare(ucg_vgroup_t *vgroup,
+                                                   const ucg_coll_args_t *args,
+                                                   ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_planc_shm_group_t *shm_group = ucg_derived_of(vgroup, ucg_planc_shm_group_t);
+    ucg_planc_shm_op_t *shm_op = NULL;
+    ucg_status_t status = ucg_planc_shm_allgatherv_flat_op_new(shm_group, vgroup, args, &shm_op);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    *op = &shm_op->super;
+    return UCG_OK;
+}
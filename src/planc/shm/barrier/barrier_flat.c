@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "barrier.h"
+
+#include "util/ucg_helper.h"
+#include "util/ucg_log.h"
+
+/* One round: post my arrival, then wait for all the others. */
+static ucg_status_t ucg_planc_shm_barrier_flat_op_step(ucg_planc_shm_op_t *op)
+{
+    ucg_planc_shm_group_t *shm_group = op->shm_group;
+    uint64_t base = ucg_planc_shm_op_base(op);
+
+    if (op->phase == 0) {
+        ucg_planc_shm_group_post(shm_group, base + 1);
+        op->phase = 1;
+    }
+
+    if (!ucg_planc_shm_group_all_arrived(shm_group, base + 1)) {
+        return UCG_INPROGRESS;
+    }
+    op->phase = 0;
+    ++op->round;
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_barrier_flat_op_new(ucg_planc_shm_group_t *shm_group,
+                                               ucg_vgroup_t *vgroup,
+                                               const ucg_coll_args_t *args,
+                                               ucg_planc_shm_op_t **op)
+{
+    ucg_status_t status = ucg_planc_shm_op_check(shm_group, NULL);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_shm_op_t *shm_op;
+    shm_op = ucg_planc_shm_op_new(shm_group, vgroup, args,
+                                  ucg_planc_shm_barrier_flat_op_step);
+    if (shm_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    ucg_planc_shm_op_set_rounds(shm_op, 1, 1, 1);
+    *op = shm_op;
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_barrier_flat_prepare(ucg_vgroup_t *vgroup,
+                                                const ucg_coll_args_t *args,
+                                                ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_planc_shm_group_t *shm_group = ucg_derived_of(vgroup, ucg_planc_shm_group_t);
+    ucg_planc_shm_op_t *shm_op = NULL;
+    ucg_status_t status = ucg_planc_shm_barrier_flat_op_new(shm_group, vgroup, args, &shm_op);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    *op = &shm_op->super;
+    return UCG_OK;
+}
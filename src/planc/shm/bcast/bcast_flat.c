@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include <string.h>
+
+#include "bcast.h"
+
+#include "util/ucg_helper.h"
+#include "util/ucg_log.h"
+
+/**
+ * Each round: the root copies one fragment to its slot, then the others copy
+ * it out of the slot.
+ */
+static ucg_status_t ucg_planc_shm_bcast_flat_op_step(ucg_planc_shm_op_t *op)
+{
+    ucg_planc_shm_group_t *shm_group = op->shm_group;
+    ucg_coll_bcast_args_t *args = &op->super.super.args.bcast;
+    ucg_rank_t myrank = shm_group->node_group.myrank;
+    int64_t total = (int64_t)args->count * ucg_dt_extent(args->dt);
+    void *slot = ucg_planc_shm_group_slot(shm_group, args->root);
+
+    while (op->round < op->nround) {
+        uint64_t base = ucg_planc_shm_op_base(op);
+        int64_t length = ucg_planc_shm_op_frag(op, total);
+        char *buffer = (char *)args->buffer + op->round * op->frag;
+        if (op->phase == 0) {
+            if (myrank == args->root) {
+                /* The slot is free once all processes finished the previous round. */
+                if (!ucg_planc_shm_group_all_arrived(shm_group, base)) {
+                    return UCG_INPROGRESS;
+                }
+                memcpy(slot, buffer, length);
+            }
+            ucg_planc_shm_group_post(shm_group, base + 1);
+            op->phase = 1;
+        }
+
+        if (myrank != args->root) {
+            if (!ucg_planc_shm_group_arrived(shm_group, args->root, base + 1)) {
+                return UCG_INPROGRESS;
+            }
+            memcpy(buffer, slot, length);
+        }
+        ucg_planc_shm_group_post(shm_group, base + 2);
+        op->phase = 0;
+        ++op->round;
+    }
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_bcast_flat_op_new(ucg_planc_shm_group_t *shm_group,
+                                             ucg_vgroup_t *vgroup,
+                                             const ucg_coll_args_t *args,
+                                             ucg_planc_shm_op_t **op)
+{
+    const ucg_coll_bcast_args_t *coll_args = &args->bcast;
+    ucg_status_t status = ucg_planc_shm_op_check(shm_group, coll_args->dt);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_shm_op_t *shm_op;
+    shm_op = ucg_planc_shm_op_new(shm_group, vgroup, args,
+                                  ucg_planc_shm_bcast_flat_op_step);
+    if (shm_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    int64_t total = (int64_t)coll_args->count * ucg_dt_extent(coll_args->dt);
+    ucg_planc_shm_op_set_rounds(shm_op, 2, total, shm_group->slot_size);
+    *op = shm_op;
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_bcast_flat_prepare(ucg_vgroup_t *vgroup,
+                                              const ucg_coll_args_t *args,
+                                              ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_planc_shm_group_t *shm_group = ucg_derived_of(vgroup, ucg_planc_shm_group_t);
+    ucg_planc_shm_op_t *shm_op = NULL;
+    ucg_status_t status = ucg_planc_shm_bcast_flat_op_new(shm_group, vgroup, args, &shm_op);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    *op = &shm_op->super;
+    return UCG_OK;
+}
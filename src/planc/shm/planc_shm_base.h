@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_SHM_BASE_H_
+#define UCG_PLANC_SHM_BASE_H_
+
+#include "ucg/api/ucg.h"
+
+ucg_status_t ucg_planc_shm_mem_query(const void *ptr, ucg_mem_attr_t *attr);
+
+#endif
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "planc_shm_context.h"
+#include "planc_shm_plan.h"
+#include "planc_shm_global.h"
+
+#include "core/ucg_global.h"
+#include "core/ucg_context.h"
+
+#include "util/ucg_malloc.h"
+#include "util/ucg_parser.h"
+#include "util/ucg_helper.h"
+#include "util/ucg_cpu.h"
+#include "util/ucg_math.h"
+
+#define PLANC_SHM_CONFIG_PREFIX "PLANC_SHM_"
+
+static ucg_config_field_t ucg_planc_shm_config_table[] = {
+    {"SLOT_SIZE", "64k",
+     "Size of the data slot of each process in the shared segment of the node, "
+     "larger messages are transferred in fragments of this size",
+     ucg_offsetof(ucg_planc_shm_config_t, slot_size),
+     UCG_CONFIG_TYPE_MEMUNITS},
+
+    {"BCAST_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_shm_config_t, plan_attr[UCG_COLL_TYPE_BCAST]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"ALLREDUCE_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_shm_config_t, plan_attr[UCG_COLL_TYPE_ALLREDUCE]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"BARRIER_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_shm_config_t, plan_attr[UCG_COLL_TYPE_BARRIER]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"ALLGATHERV_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_shm_config_t, plan_attr[UCG_COLL_TYPE_ALLGATHERV]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {"REDUCE_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_shm_config_t, plan_attr[UCG_COLL_TYPE_REDUCE]),
+     UCG_CONFIG_TYPE_STRING},
+
+    {NULL}
+};
+UCG_CONFIG_REGISTER_TABLE(ucg_planc_shm_config_table, "UCG PlanC SHM",
+                          PLANC_SHM_CONFIG_PREFIX, ucg_planc_shm_config_t,
+                          &ucg_config_global_list)
+
+ucg_status_t ucg_planc_shm_config_read(const char *env_prefix,
+                                       const char *filename,
+                                       ucg_planc_config_h *config)
+{
+    UCG_CHECK_NULL_INVALID(config);
+
+    if (filename != NULL) {
+        return UCG_ERR_UNSUPPORTED;
+    }
+
+    ucg_status_t status;
+    char *full_env_prefix;
+    ucg_planc_shm_config_t *cfg;
+
+    cfg = ucg_calloc(1, sizeof(ucg_planc_shm_config_t), "ucg planc shm config");
+    if (cfg == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    if (env_prefix == NULL) {
+        full_env_prefix = ucg_strdup(UCG_DEFAULT_ENV_PREFIX, "default planc shm env prefix");
+        if (full_env_prefix == NULL) {
+            status = UCG_ERR_NO_MEMORY;
+            goto err_free_cfg;
+        }
+    } else {
+        int full_env_prefix_len = strlen(env_prefix)
+                                  + 1 /* '_' */
+                                  + sizeof(UCG_DEFAULT_ENV_PREFIX);
+        full_env_prefix = ucg_malloc(full_env_prefix_len, "ucg planc shm env prefix");
+        if (full_env_prefix == NULL) {
+            status = UCG_ERR_NO_MEMORY;
+            goto err_free_cfg;
+        }
+        snprintf(full_env_prefix, full_env_prefix_len, "%s_%s", env_prefix, UCG_DEFAULT_ENV_PREFIX);
+    }
+
+    status = ucg_config_parser_fill_opts(cfg, ucg_planc_shm_config_table,
+                                         full_env_prefix, PLANC_SHM_CONFIG_PREFIX, 0);
+    ucg_free(full_env_prefix);
+    if (status != UCG_OK) {
+        ucg_error("Failed to read PlanC SHM configuration");
+        goto err_free_cfg;
+    }
+
+    *config = (ucg_planc_config_h)cfg;
+    return UCG_OK;
+
+err_free_cfg:
+    ucg_free(cfg);
+    return status;
+}
+
+ucg_status_t ucg_planc_shm_config_modify(ucg_planc_config_h config,
+                                         const char *name,
+                                         const char *value)
+{
+    UCG_CHECK_NULL_INVALID(config, name, value);
+
+    ucg_planc_shm_config_t *cfg = (ucg_planc_shm_config_t *)config;
+    ucg_status_t status = ucg_config_parser_set_value(cfg, ucg_planc_shm_config_table,
+                                                      name, value);
+    if (status != UCG_OK) {
+        ucg_error("Failed to modify PlanC SHM configuration");
+    }
+    return status;
+}
+
+void ucg_planc_shm_config_release(ucg_planc_config_h config)
+{
+    UCG_CHECK_NULL_VOID(config);
+
+    ucg_config_parser_release_opts(config, ucg_planc_shm_config_table);
+    ucg_free(config);
+}
+
+static void ucg_planc_shm_free_plan_attr(ucg_planc_shm_context_t *context)
+{
+    ucg_coll_type_t coll_type = UCG_COLL_TYPE_BCAST;
+    for (; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
+        if (context->plan_attr[coll_type] != NULL) {
+            ucg_free(context->plan_attr[coll_type]);
+            context->plan_attr[coll_type] = NULL;
+        }
+    }
+    return;
+}
+
+static ucg_status_t ucg_planc_shm_fill_plan_attr(ucg_planc_shm_context_t *context,
+                                                 ucg_planc_shm_config_t *config)
+{
+    ucg_coll_type_t coll_type = UCG_COLL_TYPE_BCAST;
+    for (; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
+        if (config->plan_attr[coll_type] == NULL) {
+            continue;
+        }
+
+        context->plan_attr[coll_type] = ucg_strdup(config->plan_attr[coll_type], "plan attr");
+        if (context->plan_attr[coll_type] == NULL) {
+            ucg_error("Failed to duplicate plan attribute");
+            goto err_free_plan_attr;
+        }
+    }
+
+    return UCG_OK;
+
+err_free_plan_attr:
+    ucg_planc_shm_free_plan_attr(context);
+    return UCG_ERR_NO_MEMORY;
+}
+
+ucg_status_t ucg_planc_shm_context_init(const ucg_planc_params_t *params,
+                                        const ucg_planc_config_h config,
+                                        ucg_planc_context_h *context)
+{
+    UCG_CHECK_NULL_INVALID(params, config, context);
+
+    ucg_status_t status = UCG_OK;
+    ucg_planc_shm_config_t *cfg = (ucg_planc_shm_config_t *)config;
+
+    ucg_planc_shm_context_t *ctx;
+    ctx = ucg_calloc(1, sizeof(ucg_planc_shm_context_t), "planc shm context");
+    if (ctx == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    ctx->ucg_context = params->context;
+    ctx->slot_size = ucg_align_up(cfg->slot_size, UCG_CACHE_LINE_SIZE);
+    if (ctx->slot_size == 0) {
+        ucg_error("Invalid slot size of PlanC SHM");
+        status = UCG_ERR_INVALID_PARAM;
+        goto err_free_ctx;
+    }
+
+    status = ucg_planc_shm_fill_plan_attr(ctx, cfg);
+    if (status != UCG_OK) {
+        goto err_free_ctx;
+    }
+
+    status = ucg_mpool_init(&ctx->op_mp, 0, sizeof(ucg_planc_shm_op_t),
+                            0, UCG_CACHE_LINE_SIZE, UCG_ELEMS_PER_CHUNK,
+                            -1, NULL, "planc shm op");
+    if (status != UCG_OK) {
+        ucg_error("Failed to create mpool");
+        goto err_free_plan_attr;
+    }
+
+    *context = (ucg_planc_context_h)ctx;
+    return UCG_OK;
+
+err_free_plan_attr:
+    ucg_planc_shm_free_plan_attr(ctx);
+err_free_ctx:
+    ucg_free(ctx);
+    return status;
+}
+
+void ucg_planc_shm_context_cleanup(ucg_planc_context_h context)
+{
+    UCG_CHECK_NULL_VOID(context);
+
+    ucg_planc_shm_context_t *ctx = (ucg_planc_shm_context_t*)context;
+    ucg_mpool_cleanup(&ctx->op_mp, 1);
+    ucg_planc_shm_free_plan_attr(ctx);
+    ucg_free(ctx);
+
+    return;
+}
+
+ucg_status_t ucg_planc_shm_context_query(ucg_planc_context_h context,
+                                         ucg_planc_context_attr_t *attr)
+{
+    UCG_CHECK_NULL_INVALID(context, attr);
+
+    if (attr->field_mask & UCG_PLANC_CONTEXT_ATTR_FIELD_ADDR_LEN) {
+        attr->addr_len = 0;
+    }
+
+    if (attr->field_mask & UCG_PLANC_CONTEXT_ATTR_FIELD_ADDR) {
+        attr->addr = NULL;
+    }
+
+    return UCG_OK;
+}
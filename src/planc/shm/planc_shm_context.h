@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_SHM_CONTEXT_H_
+#define UCG_PLANC_SHM_CONTEXT_H_
+
+#include "ucg/api/ucg.h"
+#include "core/ucg_request.h"
+#include "planc/ucg_planc.h"
+#include "util/ucg_mpool.h"
+
+
+typedef struct ucg_planc_shm_config {
+    /** Size of the data slot of each process in the shared segment */
+    size_t slot_size;
+    /** Attributes of collective operation plans */
+    char *plan_attr[UCG_COLL_TYPE_LAST];
+} ucg_planc_shm_config_t;
+
+typedef struct ucg_planc_shm_context {
+    ucg_context_t *ucg_context;
+
+    /** pool of @ref ucg_planc_shm_op_t */
+    ucg_mpool_t op_mp;
+    size_t slot_size;
+    /** User-defined plan attribute */
+    char *plan_attr[UCG_COLL_TYPE_LAST];
+} ucg_planc_shm_context_t;
+
+/** Configuration */
+ucg_status_t ucg_planc_shm_config_read(const char *env_prefix,
+                                       const char *filename,
+                                       ucg_planc_config_h *config);
+ucg_status_t ucg_planc_shm_config_modify(ucg_planc_config_h config,
+                                         const char *name,
+                                         const char *value);
+void ucg_planc_shm_config_release(ucg_planc_config_h config);
+
+/** Context */
+ucg_status_t ucg_planc_shm_context_init(const ucg_planc_params_t *params,
+                                        const ucg_planc_config_h config,
+                                        ucg_planc_context_h *context);
+void ucg_planc_shm_context_cleanup(ucg_planc_context_h context);
+ucg_status_t ucg_planc_shm_context_query(ucg_planc_context_h context,
+                                         ucg_planc_context_attr_t *attr);
+
+#endif
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "planc_shm_global.h"
+#include "planc_shm_base.h"
+#include "planc_shm_context.h"
+#include "planc_shm_group.h"
+#include "planc_shm_plan.h"
+
+ucg_planc_shm_t UCG_PLANC_OBJNAME(shm) = {
+    .super.super.name         = "shm",
+    .super.mem_query          = ucg_planc_shm_mem_query,
+
+    .super.config_read        = ucg_planc_shm_config_read,
+    .super.config_modify      = ucg_planc_shm_config_modify,
+    .super.config_release     = ucg_planc_shm_config_release,
+
+    .super.context_init       = ucg_planc_shm_context_init,
+    .super.context_cleanup    = ucg_planc_shm_context_cleanup,
+    .super.context_query      = ucg_planc_shm_context_query,
+
+    .super.group_create       = ucg_planc_shm_group_create,
+    .super.group_destroy      = ucg_planc_shm_group_destroy,
+
+    .super.get_plans          = ucg_planc_shm_get_plans,
+    .super.get_plans_tag      = ucg_planc_shm_get_plans_tag,
+
+    .super.node_op_prepare    = ucg_planc_shm_node_op_prepare,
+};
+
+ucg_planc_shm_t *ucg_planc_shm_instance()
+{
+    return &UCG_PLANC_OBJNAME(shm);
+}
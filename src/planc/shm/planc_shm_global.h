@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_SHM_GLOBAL_H_
+#define UCG_PLANC_SHM_GLOBAL_H_
+
+#include "planc_shm_plan.h"
+
+typedef struct ucg_planc_shm {
+    ucg_planc_t super;
+} ucg_planc_shm_t;
+
+ucg_planc_shm_t *ucg_planc_shm_instance();
+
+#endif
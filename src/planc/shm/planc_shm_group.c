@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "planc_shm_group.h"
+#include "planc_shm_global.h"
+
+#include "core/ucg_group.h"
+#include "util/ucg_helper.h"
+#include "util/ucg_log.h"
+#include "util/ucg_malloc.h"
+
+#define UCG_PLANC_SHM_SEG_NAME_MAX 64
+
+/* Exchanged by all processes to name the segment created by the node leader. */
+typedef struct ucg_planc_shm_seg_info {
+    int32_t pid;
+    uint32_t serial;
+    /* Whether the segment is created, only meaningful for the node leader. */
+    int32_t created;
+} ucg_planc_shm_seg_info_t;
+
+/* Distinguish the segments of the groups created by the same process. */
+static uint32_t ucg_planc_shm_seg_serial = 0;
+
+static ucg_status_t ucg_planc_shm_group_init_node_group(ucg_planc_shm_group_t *shm_group)
+{
+    ucg_group_t *group = shm_group->super.super.group;
+    ucg_vgroup_t *node_group = &shm_group->node_group;
+    ucg_status_t status;
+    ucg_location_t location;
+
+    node_group->group = group;
+    node_group->myrank = UCG_INVALID_RANK;
+    node_group->size = 0;
+
+    status = ucg_group_get_location(group, group->myrank, &location);
+    if (status != UCG_OK) {
+        return status;
+    }
+    if (!(location.field_mask & UCG_LOCATION_FIELD_NODE_ID)) {
+        /* The location is the same in all processes, so is the decision. */
+        return UCG_ERR_UNSUPPORTED;
+    }
+    int32_t mynode_id = location.node_id;
+
+    ucg_rank_t *ranks = ucg_malloc(group->size * sizeof(ucg_rank_t), "planc shm node ranks");
+    if (ranks == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    uint32_t size = 0;
+    for (ucg_rank_t rank = 0; rank < group->size; ++rank) {
+        status = ucg_group_get_location(group, rank, &location);
+        if (status != UCG_OK) {
+            goto err_free_ranks;
+        }
+        if (!(location.field_mask & UCG_LOCATION_FIELD_NODE_ID)) {
+            status = UCG_ERR_UNSUPPORTED;
+            goto err_free_ranks;
+        }
+        if (location.node_id != mynode_id) {
+            continue;
+        }
+        if (rank == group->myrank) {
+            node_group->myrank = size;
+        }
+        ranks[size++] = rank;
+    }
+    ucg_assert(node_group->myrank != UCG_INVALID_RANK);
+
+    status = ucg_rank_map_init_by_array(&node_group->rank_map, &ranks, size, 1);
+    if (status != UCG_OK) {
+        goto err_free_ranks;
+    }
+    node_group->size = size;
+    return UCG_OK;
+
+err_free_ranks:
+    ucg_free(ranks);
+    return status;
+}
+
+static void ucg_planc_shm_group_seg_name(char *name, const ucg_planc_shm_seg_info_t *info)
+{
+    snprintf(name, UCG_PLANC_SHM_SEG_NAME_MAX, "/ucg_planc_shm_%d_%u", info->pid, info->serial);
+    return;
+}
+
+static void *ucg_planc_shm_group_seg_map(const char *name, size_t size, int create)
+{
+    int flags = create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR;
+    int fd = shm_open(name, flags, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        ucg_debug("Failed to open shared segment %s, %m", name);
+        return NULL;
+    }
+
+    void *seg = NULL;
+    if (create && ftruncate(fd, size) != 0) {
+        ucg_debug("Failed to resize shared segment %s to %zu bytes, %m", name, size);
+        goto out;
+    }
+
+    seg = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (seg == MAP_FAILED) {
+        ucg_debug("Failed to map shared segment %s, %m", name);
+        seg = NULL;
+    }
+out:
+    close(fd);
+    if (create && seg == NULL) {
+        shm_unlink(name);
+    }
+    return seg;
+}
+
+/**
+ * The node leader creates the segment before the out-of-band allgather, which
+ * tells the others its name and whether it's created, so that all processes of
+ * the node make the same decision from one exchange. The others attach to it and
+ * the last one unlinks it. Failing to create the segment is not fatal, the group
+ * just provides no operation. Failing to attach to a created one is, because
+ * the others can't know it without another exchange.
+ */
+static ucg_status_t ucg_planc_shm_group_init_seg(ucg_planc_shm_group_t *shm_group)
+{
+    ucg_group_t *group = shm_group->super.super.group;
+    ucg_oob_group_t *oob_group = &group->oob_group;
+    ucg_vgroup_t *node_group = &shm_group->node_group;
+    ucg_status_t status;
+
+    ucg_planc_shm_seg_info_t *infos;
+    infos = ucg_malloc(group->size * sizeof(ucg_planc_shm_seg_info_t), "planc shm seg infos");
+    if (infos == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    char name[UCG_PLANC_SHM_SEG_NAME_MAX];
+    ucg_planc_shm_seg_info_t myinfo;
+    myinfo.pid = getpid();
+    myinfo.serial = __atomic_fetch_add(&ucg_planc_shm_seg_serial, 1, __ATOMIC_RELAXED);
+    myinfo.created = 0;
+    shm_group->slot_size = shm_group->context->slot_size;
+    shm_group->seg_size = sizeof(ucg_planc_shm_hdr_t) +
+                          node_group->size * (sizeof(ucg_planc_shm_ctrl_t) +
+                                              shm_group->slot_size);
+    int is_leader = (node_group->myrank == 0);
+    int need_seg = (node_group->size > 1);
+    if (need_seg && is_leader) {
+        ucg_planc_shm_group_seg_name(name, &myinfo);
+        shm_group->seg = ucg_planc_shm_group_seg_map(name, shm_group->seg_size, 1);
+        myinfo.created = (shm_group->seg != NULL);
+    }
+
+    status = oob_group->allgather(&myinfo, infos, sizeof(myinfo), oob_group->group);
+    if (status != UCG_OK) {
+        ucg_error("Failed to oob allgather");
+        goto err_unmap;
+    }
+
+    const ucg_planc_shm_seg_info_t *leader_info;
+    leader_info = &infos[ucg_rank_map_eval(&node_group->rank_map, 0)];
+    if (!need_seg || !leader_info->created) {
+        if (need_seg) {
+            ucg_info("Processes of node are not able to share memory, planc shm is disabled");
+        }
+        goto out_free_infos;
+    }
+
+    if (!is_leader) {
+        ucg_planc_shm_group_seg_name(name, leader_info);
+        shm_group->seg = ucg_planc_shm_group_seg_map(name, shm_group->seg_size, 0);
+        if (shm_group->seg == NULL) {
+            ucg_error("Failed to attach to shared segment %s", name);
+            status = UCG_ERR_IO_ERROR;
+            goto out_free_infos;
+        }
+    }
+    /* The last one to map the segment removes its name, it's released with the last mapping. */
+    ucg_planc_shm_hdr_t *hdr = (ucg_planc_shm_hdr_t *)shm_group->seg;
+    if (__atomic_add_fetch(&hdr->attached, 1, __ATOMIC_ACQ_REL) == node_group->size) {
+        shm_unlink(name);
+    }
+    goto out_free_infos;
+
+err_unmap:
+    if (shm_group->seg != NULL) {
+        shm_unlink(name);
+        munmap(shm_group->seg, shm_group->seg_size);
+        shm_group->seg = NULL;
+    }
+out_free_infos:
+    ucg_free(infos);
+    return status;
+}
+
+ucg_status_t ucg_planc_shm_group_create(ucg_planc_context_h context,
+                                        const ucg_planc_group_params_t *params,
+                                        ucg_planc_group_h *planc_group)
+{
+    UCG_CHECK_NULL_INVALID(context, params, planc_group);
+
+    ucg_status_t status;
+    ucg_planc_shm_group_t *shm_group;
+
+    shm_group = ucg_calloc(1, sizeof(ucg_planc_shm_group_t), "ucg planc shm group");
+    if (shm_group == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    shm_group->context = (ucg_planc_shm_context_t *)context;
+    shm_group->seg = NULL;
+    shm_group->seq = 0;
+    ucg_list_head_init(&shm_group->ops);
+
+    status = UCG_CLASS_CONSTRUCT(ucg_planc_group_t, &shm_group->super, params->group);
+    if (status != UCG_OK) {
+        ucg_error("Failed to init planc shm group");
+        goto err_free_group;
+    }
+
+    status = ucg_planc_shm_group_init_node_group(shm_group);
+    if (status == UCG_ERR_UNSUPPORTED) {
+        ucg_info("Location of processes is unknown, planc shm is disabled");
+        goto out;
+    } else if (status != UCG_OK) {
+        goto err_destruct;
+    }
+
+    status = ucg_planc_shm_group_init_seg(shm_group);
+    if (status != UCG_OK) {
+        goto err_cleanup_node_group;
+    }
+
+out:
+    *planc_group = (ucg_planc_group_h)shm_group;
+    return UCG_OK;
+
+err_cleanup_node_group:
+    ucg_rank_map_cleanup(&shm_group->node_group.rank_map);
+err_destruct:
+    UCG_CLASS_DESTRUCT(ucg_planc_group_t, &shm_group->super);
+err_free_group:
+    ucg_free(shm_group);
+    return status;
+}
+
+void ucg_planc_shm_group_destroy(ucg_planc_group_h planc_group)
+{
+    UCG_CHECK_NULL_VOID(planc_group);
+
+    ucg_planc_shm_group_t *shm_group = ucg_derived_of(planc_group, ucg_planc_shm_group_t);
+    if (!ucg_list_is_empty(&shm_group->ops)) {
+        ucg_warn("Planc shm group is destroyed with %lu pending ops",
+                 ucg_list_length(&shm_group->ops));
+    }
+    if (shm_group->seg != NULL) {
+        munmap(shm_group->seg, shm_group->seg_size);
+    }
+    if (shm_group->node_group.size > 0) {
+        ucg_rank_map_cleanup(&shm_group->node_group.rank_map);
+    }
+    UCG_CLASS_DESTRUCT(ucg_planc_group_t, &shm_group->super);
+    ucg_free(shm_group);
+    return;
+}
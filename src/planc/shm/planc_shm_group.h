@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_SHM_GROUP_H_
+#define UCG_PLANC_SHM_GROUP_H_
+
+#include "ucg/api/ucg.h"
+
+#include "planc_shm_context.h"
+#include "core/ucg_group.h"
+#include "planc/ucg_planc.h"
+#include "util/ucg_cpu.h"
+#include "util/ucg_list.h"
+
+/**
+ * @brief Control block of one process in the shared segment.
+ *
+ * The process publishes its progress by storing a monotonically increasing
+ * sequence number to the flag, and the others poll it.
+ */
+typedef struct ucg_planc_shm_ctrl {
+    volatile uint64_t flag;
+    char pad[UCG_CACHE_LINE_SIZE - sizeof(uint64_t)];
+} ucg_planc_shm_ctrl_t;
+
+/**
+ * @brief Header of the shared segment.
+ */
+typedef struct ucg_planc_shm_hdr {
+    /* Number of processes that have mapped the segment. */
+    uint32_t attached;
+    char pad[UCG_CACHE_LINE_SIZE - sizeof(uint32_t)];
+} ucg_planc_shm_hdr_t;
+
+/**
+ * @brief PlanC shm group.
+ *
+ * The processes of the same node share one segment laid out as
+ *   hdr, ctrl[0], ..., ctrl[n-1], slot[0], ..., slot[n-1]
+ * where n is the number of node-local processes.
+ */
+typedef struct ucg_planc_shm_group {
+    ucg_planc_group_t super;
+    ucg_planc_shm_context_t *context;
+
+    /** Processes of my node, the node-local ranks follow the order of group ranks. */
+    ucg_vgroup_t node_group;
+    /** NULL if the processes of my node do not share a segment. */
+    void *seg;
+    size_t seg_size;
+    size_t slot_size;
+    /** Flag value at the end of the last reserved op. */
+    uint64_t seq;
+    /** Started ops in the order of execution, only the head is executing. */
+    ucg_list_link_t ops;
+} ucg_planc_shm_group_t;
+
+ucg_status_t ucg_planc_shm_group_create(ucg_planc_context_h context,
+                                        const ucg_planc_group_params_t *params,
+                                        ucg_planc_group_h *planc_group);
+void ucg_planc_shm_group_destroy(ucg_planc_group_h planc_group);
+
+static inline ucg_planc_shm_ctrl_t *ucg_planc_shm_group_ctrl(ucg_planc_shm_group_t *shm_group,
+                                                             ucg_rank_t rank)
+{
+    return (ucg_planc_shm_ctrl_t *)((ucg_planc_shm_hdr_t *)shm_group->seg + 1) + rank;
+}
+
+static inline void *ucg_planc_shm_group_slot(ucg_planc_shm_group_t *shm_group,
+                                             ucg_rank_t rank)
+{
+    return (char *)shm_group->seg + sizeof(ucg_planc_shm_hdr_t) +
+           shm_group->node_group.size * sizeof(ucg_planc_shm_ctrl_t) +
+           rank * shm_group->slot_size;
+}
+
+/**
+ * @brief Publish my progress, all my previous stores are visible before it.
+ */
+static inline void ucg_planc_shm_group_post(ucg_planc_shm_group_t *shm_group,
+                                            uint64_t value)
+{
+    ucg_planc_shm_ctrl_t *ctrl;
+    ctrl = ucg_planc_shm_group_ctrl(shm_group, shm_group->node_group.myrank);
+    __atomic_store_n(&ctrl->flag, value, __ATOMIC_RELEASE);
+    return;
+}
+
+/**
+ * @brief Check whether the process rank has reached the value.
+ */
+static inline int ucg_planc_shm_group_arrived(ucg_planc_shm_group_t *shm_group,
+                                              ucg_rank_t rank, uint64_t value)
+{
+    ucg_planc_shm_ctrl_t *ctrl = ucg_planc_shm_group_ctrl(shm_group, rank);
+    return __atomic_load_n(&ctrl->flag, __ATOMIC_ACQUIRE) >= value;
+}
+
+static inline int ucg_planc_shm_group_all_arrived(ucg_planc_shm_group_t *shm_group,
+                                                  uint64_t value)
+{
+    uint32_t size = shm_group->node_group.size;
+    for (ucg_rank_t rank = 0; rank < size; ++rank) {
+        if (!ucg_planc_shm_group_arrived(shm_group, rank, value)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+#endif
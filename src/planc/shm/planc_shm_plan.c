@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "planc_shm_plan.h"
+
+#include "allreduce/allreduce.h"
+#include "allgatherv/allgatherv.h"
+#include "barrier/barrier.h"
+#include "bcast/bcast.h"
+#include "reduce/reduce.h"
+
+#include "util/ucg_helper.h"
+#include "util/ucg_log.h"
+
+
+UCG_PLAN_ATTR_TABLE_DEFINE(ucg_planc_shm);
+
+
+static ucg_status_t ucg_planc_shm_op_reserve(ucg_plan_op_t *ucg_op)
+{
+    ucg_planc_shm_op_t *op = ucg_derived_of(ucg_op, ucg_planc_shm_op_t);
+    ucg_planc_shm_group_t *shm_group = op->shm_group;
+
+    if (op->queued) {
+        return UCG_OK;
+    }
+    op->triggered = 0;
+    op->seq = shm_group->seq;
+    shm_group->seq += op->nround * op->nflag;
+    ucg_list_add_tail(&shm_group->ops, &op->list);
+    op->queued = 1;
+    return UCG_OK;
+}
+
+static ucg_status_t ucg_planc_shm_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_planc_shm_op_t *op = ucg_derived_of(ucg_op, ucg_planc_shm_op_t);
+
+    /* Not reserved by a meta op, the op takes its turn when it starts. */
+    ucg_planc_shm_op_reserve(ucg_op);
+    op->super.super.status = UCG_INPROGRESS;
+    op->triggered = 1;
+    op->round = 0;
+    op->phase = 0;
+
+    ucg_status_t status = ucg_planc_shm_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+ucg_planc_shm_op_t *ucg_planc_shm_op_new(ucg_planc_shm_group_t *shm_group,
+                                         ucg_vgroup_t *vgroup,
+                                         const ucg_coll_args_t *args,
+                                         ucg_planc_shm_op_step_func_t step)
+{
+    ucg_planc_shm_op_t *op = ucg_mpool_get(&shm_group->context->op_mp);
+    if (op == NULL) {
+        return NULL;
+    }
+
+    ucg_status_t status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &op->super, vgroup,
+                                              ucg_planc_shm_op_trigger,
+                                              ucg_planc_shm_op_progress,
+                                              ucg_planc_shm_op_discard,
+                                              args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of shm op");
+        ucg_mpool_put(op);
+        return NULL;
+    }
+
+    op->super.reserve = ucg_planc_shm_op_reserve;
+    op->shm_group = shm_group;
+    op->step = step;
+    op->queued = 0;
+    op->triggered = 0;
+    op->nflag = 0;
+    op->seq = 0;
+    op->round = 0;
+    op->nround = 0;
+    op->phase = 0;
+    op->frag = 0;
+    return op;
+}
+
+ucg_status_t ucg_planc_shm_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_planc_shm_op_t *op = ucg_derived_of(ucg_op, ucg_planc_shm_op_t);
+    ucg_planc_shm_group_progress(op->shm_group);
+    return op->super.super.status;
+}
+
+ucg_status_t ucg_planc_shm_op_discard(ucg_plan_op_t *ucg_op)
+{
+    ucg_planc_shm_op_t *op = ucg_derived_of(ucg_op, ucg_planc_shm_op_t);
+    if (op->queued) {
+        /* The others of the node have reserved the same turn for the op. */
+        ucg_warn("Discard shm op in progress, the node may hang");
+        ucg_list_del(&op->list);
+        op->queued = 0;
+    }
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
+    ucg_mpool_put(op);
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_op_check(ucg_planc_shm_group_t *shm_group, ucg_dt_t *dt)
+{
+    if (shm_group->seg == NULL) {
+        return UCG_ERR_UNSUPPORTED;
+    }
+    if (dt != NULL && !ucg_dt_is_contiguous(dt)) {
+        ucg_debug("Planc shm don't support non-contiguous datatype");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+void ucg_planc_shm_group_progress(ucg_planc_shm_group_t *shm_group)
+{
+    while (!ucg_list_is_empty(&shm_group->ops)) {
+        ucg_planc_shm_op_t *op = ucg_list_head(&shm_group->ops, ucg_planc_shm_op_t, list);
+        if (!op->triggered) {
+            /* Reserved by a started meta op that hasn't reached the op yet. */
+            return;
+        }
+
+        ucg_status_t status = op->step(op);
+        if (status == UCG_INPROGRESS) {
+            return;
+        }
+        ucg_list_del(&op->list);
+        op->queued = 0;
+        op->triggered = 0;
+        op->super.super.status = status;
+    }
+    return;
+}
+
+/* The plans serve the groups inside one node, others use the intra-node operations
+   through the plans of other PlanC. */
+static int ucg_planc_shm_group_has_plans(const ucg_planc_shm_group_t *shm_group)
+{
+    return shm_group->seg != NULL &&
+           shm_group->node_group.size == shm_group->super.super.size;
+}
+
+ucg_status_t ucg_planc_shm_get_plans(ucg_planc_group_h planc_group, ucg_plans_t *plans)
+{
+    UCG_CHECK_NULL_INVALID(planc_group, plans);
+
+    ucg_planc_shm_group_t *shm_group = ucg_derived_of(planc_group, ucg_planc_shm_group_t);
+    ucg_planc_shm_context_t *context = shm_group->context;
+
+    if (!ucg_planc_shm_group_has_plans(shm_group)) {
+        return UCG_OK;
+    }
+
+    ucg_plan_params_t params;
+    params.mem_type = UCG_MEM_TYPE_HOST;
+
+    ucg_status_t status = UCG_OK;
+    ucg_plan_attr_t *default_plan_attr = NULL;
+    ucg_coll_type_t coll_type = UCG_COLL_TYPE_BCAST;
+    for (; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
+        default_plan_attr = UCG_PLAN_ATTR_ARRAY(ucg_planc_shm, coll_type);
+        if (default_plan_attr == NULL) {
+            continue;
+        }
+
+        params.coll_type = coll_type;
+        char *user_plan_attr = context->plan_attr[coll_type];
+        for (; !UCG_PLAN_ATTR_IS_LAST(default_plan_attr); ++default_plan_attr) {
+            params.attr = *default_plan_attr;
+            params.attr.vgroup = &shm_group->super.super;
+            /* apply user-configured attribute */
+            status = ucg_plan_attr_update(&params.attr, user_plan_attr);
+            if (status != UCG_OK) {
+                ucg_warn("Failed to update plan attribute(%s), using default", user_plan_attr);
+            }
+            /* add plan */
+            status = ucg_plans_add(plans, &params);
+            if (status != UCG_OK) {
+                ucg_error("Failed to add default plan, coll type %d", coll_type);
+                return status;
+            }
+        }
+    }
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_get_plans_tag(ucg_planc_group_h planc_group, uint64_t *tag)
+{
+    UCG_CHECK_NULL_INVALID(planc_group, tag);
+
+    /* Whether the segment is mapped differs between the groups of the same shape. */
+    ucg_planc_shm_group_t *shm_group = ucg_derived_of(planc_group, ucg_planc_shm_group_t);
+    *tag = ucg_planc_shm_group_has_plans(shm_group);
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_node_op_prepare(ucg_planc_group_h planc_group,
+                                           const ucg_coll_args_t *args,
+                                           ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(planc_group, args, op);
+
+    ucg_planc_shm_group_t *shm_group = ucg_derived_of(planc_group, ucg_planc_shm_group_t);
+    ucg_vgroup_t *node_group = &shm_group->node_group;
+    ucg_planc_shm_op_t *shm_op = NULL;
+    ucg_status_t status;
+
+    switch (args->type) {
+        case UCG_COLL_TYPE_BCAST:
+            status = ucg_planc_shm_bcast_flat_op_new(shm_group, node_group, args, &shm_op);
+            break;
+        case UCG_COLL_TYPE_ALLREDUCE:
+            status = ucg_planc_shm_allreduce_flat_op_new(shm_group, node_group, args, &shm_op);
+            break;
+        case UCG_COLL_TYPE_BARRIER:
+            status = ucg_planc_shm_barrier_flat_op_new(shm_group, node_group, args, &shm_op);
+            break;
+        case UCG_COLL_TYPE_ALLGATHERV:
+            status = ucg_planc_shm_allgatherv_flat_op_new(shm_group, node_group, args, &shm_op);
+            break;
+        case UCG_COLL_TYPE_REDUCE:
+            status = ucg_planc_shm_reduce_flat_op_new(shm_group, node_group, args, &shm_op);
+            break;
+        default:
+            status = UCG_ERR_UNSUPPORTED;
+            break;
+    }
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    *op = &shm_op->super;
+    return UCG_OK;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_SHM_PLAN_H_
+#define UCG_PLANC_SHM_PLAN_H_
+
+#include "ucg/api/ucg.h"
+
+#include "planc_shm_group.h"
+
+#include "core/ucg_plan.h"
+#include "planc/ucg_planc.h"
+#include "util/ucg_helper.h"
+#include "util/ucg_list.h"
+#include "util/ucg_math.h"
+
+
+#ifndef UCG_PLANC_SHM_DEFAULT_SCORE
+    #define UCG_PLANC_SHM_DEFAULT_SCORE 100
+#endif
+
+typedef struct ucg_planc_shm_op ucg_planc_shm_op_t;
+
+/**
+ * @brief Advance the op as far as possible.
+ *
+ * @return UCG_INPROGRESS if it's waiting for other processes.
+ */
+typedef ucg_status_t (*ucg_planc_shm_op_step_func_t)(ucg_planc_shm_op_t *op);
+
+/**
+ * @brief PlanC shm op.
+ *
+ * The data is moved in rounds, each round moves up to one slot per process and
+ * consists of nflag phases. A process posts base + i + 1 to its flag when it
+ * finishes the phase i of the round, where base is (seq + round * nflag).
+ */
+typedef struct ucg_planc_shm_op {
+    ucg_plan_op_t super;
+    ucg_planc_shm_group_t *shm_group;
+    ucg_planc_shm_op_step_func_t step;
+
+    /** Element of ucg_planc_shm_group_t::ops */
+    ucg_list_link_t list;
+    /** The op has taken its turn in ucg_planc_shm_group_t::ops. */
+    int8_t queued;
+    int8_t triggered;
+    int32_t nflag;
+    /** Flag value before the op starts */
+    uint64_t seq;
+    int64_t round;
+    int64_t nround;
+    int32_t phase;
+    /** Data moved in one round, in elements for reduction or in bytes for others */
+    int64_t frag;
+} ucg_planc_shm_op_t;
+
+UCG_PLAN_ATTR_TABLE_DECLARE(ucg_planc_shm);
+
+/**
+ * @brief Allocate an op.
+ *
+ * The op is put at the tail of the execution order when its request starts:
+ * when it's triggered, or when the meta op that contains it is triggered, see
+ * @ref ucg_plan_op_t::reserve. Processes of a node start the requests in the
+ * same order, so they execute the ops in the same order, while the ops that are
+ * prepared but not started don't block the others.
+ */
+ucg_planc_shm_op_t *ucg_planc_shm_op_new(ucg_planc_shm_group_t *shm_group,
+                                         ucg_vgroup_t *vgroup,
+                                         const ucg_coll_args_t *args,
+                                         ucg_planc_shm_op_step_func_t step);
+ucg_status_t ucg_planc_shm_op_progress(ucg_plan_op_t *ucg_op);
+ucg_status_t ucg_planc_shm_op_discard(ucg_plan_op_t *ucg_op);
+
+/**
+ * @brief Split the total amount of data into rounds of frag.
+ */
+static inline void ucg_planc_shm_op_set_rounds(ucg_planc_shm_op_t *op, int32_t nflag,
+                                               int64_t total, int64_t frag)
+{
+    ucg_assert(frag > 0);
+    op->nflag = nflag;
+    op->frag = frag;
+    op->nround = (total + frag - 1) / frag;
+    return;
+}
+
+/**
+ * @brief Flag value at the beginning of the current round.
+ */
+static inline uint64_t ucg_planc_shm_op_base(const ucg_planc_shm_op_t *op)
+{
+    return op->seq + op->round * op->nflag;
+}
+
+/**
+ * @brief Amount of data moved in the current round.
+ */
+static inline int64_t ucg_planc_shm_op_frag(const ucg_planc_shm_op_t *op, int64_t total)
+{
+    return ucg_min(op->frag, total - op->round * op->frag);
+}
+
+/**
+ * @brief Part of count elements that the rank is responsible for.
+ */
+static inline void ucg_planc_shm_op_chunk(int64_t count, uint32_t size, ucg_rank_t rank,
+                                          int64_t *offset, int64_t *chunk_count)
+{
+    int64_t quot = count / size;
+    int64_t rem = count % size;
+    *offset = rank * quot + ucg_min(rank, rem);
+    *chunk_count = quot + (rank < rem ? 1 : 0);
+    return;
+}
+
+/**
+ * @brief Check whether the group is able to perform the op.
+ */
+ucg_status_t ucg_planc_shm_op_check(ucg_planc_shm_group_t *shm_group, ucg_dt_t *dt);
+
+/**
+ * @brief Execute the ops of the group in order until one of them blocks.
+ */
+void ucg_planc_shm_group_progress(ucg_planc_shm_group_t *shm_group);
+
+ucg_status_t ucg_planc_shm_get_plans(ucg_planc_group_h planc_group, ucg_plans_t *plans);
+
+ucg_status_t ucg_planc_shm_get_plans_tag(ucg_planc_group_h planc_group, uint64_t *tag);
+
+ucg_status_t ucg_planc_shm_node_op_prepare(ucg_planc_group_h planc_group,
+                                           const ucg_coll_args_t *args,
+                                           ucg_plan_op_t **op);
+
+#endif
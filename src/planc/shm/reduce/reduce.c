@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "reduce.h"
+
+
+#define PLAN_DOMAIN "planc shm reduce"
+
+static ucg_plan_attr_t ucg_planc_shm_reduce_plan_attr[] = {
+    {ucg_planc_shm_reduce_flat_prepare,
+     1, "flat", PLAN_DOMAIN,
+     0, {0, UCG_PLAN_RANGE_MAX}, NULL, UCG_PLANC_SHM_DEFAULT_SCORE},
+
+    {NULL},
+};
+
+UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_shm, UCG_COLL_TYPE_REDUCE,
+                             ucg_planc_shm_reduce_plan_attr);
@@ -0,0 +1,19 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_SHM_REDUCE_H_
+#define UCG_PLANC_SHM_REDUCE_H_
+
+#include "planc_shm_plan.h"
+
+ucg_status_t ucg_planc_shm_reduce_flat_op_new(ucg_planc_shm_group_t *shm_group,
+                                              ucg_vgroup_t *vgroup,
+                                              const ucg_coll_args_t *args,
+                                              ucg_planc_shm_op_t **op);
+
+ucg_status_t ucg_planc_shm_reduce_flat_prepare(ucg_vgroup_t *vgroup,
+                                               const ucg_coll_args_t *args,
+                                               ucg_plan_op_t **op);
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include <string.h>
+
+#include "reduce.h"
+
+#include "util/ucg_helper.h"
+#include "util/ucg_log.h"
+
+/**
+ * Same as allreduce flat except that only the root copies the reduced chunks
+ * out in phase 2.
+ */
+static ucg_status_t ucg_planc_shm_reduce_flat_op_step(ucg_planc_shm_op_t *op)
+{
+    ucg_planc_shm_group_t *shm_group = op->shm_group;
+    ucg_coll_reduce_args_t *args = &op->super.super.args.reduce;
+    ucg_rank_t myrank = shm_group->node_group.myrank;
+    uint32_t size = shm_group->node_group.size;
+    uint32_t extent = ucg_dt_extent(args->dt);
+    const char *sendbuf = args->sendbuf == UCG_IN_PLACE ? args->recvbuf : args->sendbuf;
+    char *myslot = ucg_planc_shm_group_slot(shm_group, myrank);
+    ucg_status_t status;
+    int64_t chunk_offset;
+    int64_t chunk_count;
+
+    while (op->round < op->nround) {
+        uint64_t base = ucg_planc_shm_op_base(op);
+        int64_t count = ucg_planc_shm_op_frag(op, args->count);
+        int64_t offset = op->round * op->frag * extent;
+        if (op->phase == 0) {
+            if (!ucg_planc_shm_group_all_arrived(shm_group, base)) {
+                return UCG_INPROGRESS;
+            }
+            memcpy(myslot, sendbuf + offset, count * extent);
+            ucg_planc_shm_group_post(shm_group, base + 1);
+            op->phase = 1;
+        }
+
+        if (op->phase == 1) {
+            if (!ucg_planc_shm_group_all_arrived(shm_group, base + 1)) {
+                return UCG_INPROGRESS;
+            }
+            ucg_planc_shm_op_chunk(count, size, myrank, &chunk_offset, &chunk_count);
+            for (ucg_rank_t rank = 0; rank < size; ++rank) {
+                if (rank == myrank) {
+                    continue;
+                }
+                char *slot = ucg_planc_shm_group_slot(shm_group, rank);
+                status = ucg_op_reduce(args->op, slot + chunk_offset * extent,
+                                       myslot + chunk_offset * extent,
+                                       chunk_count, args->dt);
+                if (status != UCG_OK) {
+                    return status;
+                }
+            }
+            ucg_planc_shm_group_post(shm_group, base + 2);
+            op->phase = 2;
+        }
+
+        if (myrank == args->root) {
+            if (!ucg_planc_shm_group_all_arrived(shm_group, base + 2)) {
+                return UCG_INPROGRESS;
+            }
+            char *recvbuf = (char *)args->recvbuf + offset;
+            for (ucg_rank_t rank = 0; rank < size; ++rank) {
+                char *slot = ucg_planc_shm_group_slot(shm_group, rank);
+                ucg_planc_shm_op_chunk(count, size, rank, &chunk_offset, &chunk_count);
+                memcpy(recvbuf + chunk_offset * extent, slot + chunk_offset * extent,
+                       chunk_count * extent);
+            }
+        }
+        ucg_planc_shm_group_post(shm_group, base + 3);
+        op->phase = 0;
+        ++op->round;
+    }
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_reduce_flat_op_new(ucg_planc_shm_group_t *shm_group,
+                                              ucg_vgroup_t *vgroup,
+                                              const ucg_coll_args_t *args,
+                                              ucg_planc_shm_op_t **op)
+{
+    const ucg_coll_reduce_args_t *coll_args = &args->reduce;
+    ucg_status_t status = ucg_planc_shm_op_check(shm_group, coll_args->dt);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    /* Chunks are reduced in different orders, which requires commutativity. */
+    if (!ucg_op_is_commutative(coll_args->op)) {
+        ucg_debug("Reduce flat don't support non-commutative op");
+        return UCG_ERR_UNSUPPORTED;
+    }
+
+    int64_t frag = shm_group->slot_size / ucg_dt_extent(coll_args->dt);
+    if (frag == 0) {
+        return UCG_ERR_UNSUPPORTED;
+    }
+
+    ucg_planc_shm_op_t *shm_op;
+    shm_op = ucg_planc_shm_op_new(shm_group, vgroup, args,
+                                  ucg_planc_shm_reduce_flat_op_step);
+    if (shm_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    ucg_planc_shm_op_set_rounds(shm_op, 3, coll_args->count, frag);
+    *op = shm_op;
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_shm_reduce_flat_prepare(ucg_vgroup_t *vgroup,
+                                               const ucg_coll_args_t *args,
+                                               ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_planc_shm_group_t *shm_group = ucg_derived_of(vgroup, ucg_planc_shm_group_t);
+    ucg_planc_shm_op_t *shm_op = NULL;
+    ucg_status_t status = ucg_planc_shm_reduce_flat_op_new(shm_group, vgroup, args, &shm_op);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    *op = &shm_op->super;
+    return UCG_OK;
+}
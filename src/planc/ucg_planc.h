@@ -46,6 +46,7 @@ typedef enum {
     UCG_PLANC_CONTEXT_ATTR_FIELD_ADDR = UCG_BIT(0), /**< Context address. */
     UCG_PLANC_CONTEXT_ATTR_FIELD_ADDR_LEN = UCG_BIT(1), /**< Length of Context address. */
     UCG_PLANC_CONTEXT_ATTR_FIELD_THREAD_MODE = UCG_BIT(2), /**< Thread mode of Context. */
+    UCG_PLANC_CONTEXT_ATTR_FIELD_REQ_ID_BITS = UCG_BIT(3), /**< Request id bits in messages. */
 } ucg_planc_context_attr_field_t;
 
 /**
@@ -83,6 +84,13 @@ typedef struct ucg_planc_context_attr {
      * UCG_PLANC_CONTEXT_ATTR_FIELD_THREAD_MODE
      */
     ucg_thread_mode_t thread_mode;
+
+    /**
+     * Number of the low bits of the request id that the messages carry, the
+     * requests whose ids are the same in these bits can't be in flight together.
+     * Corresponding bit is UCG_PLANC_CONTEXT_ATTR_FIELD_REQ_ID_BITS
+     */
+    uint32_t req_id_bits;
 } ucg_planc_context_attr_t;
 
 /**
@@ -139,6 +147,9 @@ typedef struct ucg_planc {
     ucg_planc_context_init_func_t context_init;
     ucg_planc_context_cleanup_func_t context_cleanup;
     ucg_planc_context_query_func_t context_query;
+    /* optional */
+    ucg_planc_context_progress_func_t context_progress;
+    ucg_planc_context_arm_func_t context_arm;
 
     /* Group */
     ucg_planc_group_create_func_t group_create;
@@ -146,6 +157,11 @@ typedef struct ucg_planc {
 
     /* Plan */
     ucg_planc_get_plans_func_t get_plans;
+    /* optional, the plans are not shared without it */
+    ucg_planc_get_plans_tag_func_t get_plans_tag;
+
+    /* Intra-node operation, optional */
+    ucg_planc_node_op_prepare_func_t node_op_prepare;
 } ucg_planc_t;
 
 /**
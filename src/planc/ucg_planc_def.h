@@ -113,6 +113,29 @@ typedef void (*ucg_planc_context_cleanup_func_t)(ucg_planc_context_h context);
 typedef ucg_status_t (*ucg_planc_context_query_func_t)(ucg_planc_context_h context,
                                                        ucg_planc_context_attr_t *attr);
 
+/**
+ * @ingroup UCG_PLANC
+ * @brief Function that progress the communication resources of PlanC context.
+ *
+ * It's called once in each @ref ucg_progress, so the requests waiting for
+ * completion events can be woken up without being tested.
+ *
+ * @return Number of completion events.
+ */
+typedef int (*ucg_planc_context_progress_func_t)(ucg_planc_context_h context);
+
+/**
+ * @ingroup UCG_PLANC
+ * @brief Function that arm the event notification of PlanC context.
+ *
+ * @param [in]  context     PlanC context.
+ * @param [out] fd          File descriptor that becomes readable on new events.
+ * @retval UCG_OK It's safe to sleep until the fd is readable.
+ * @retval UCG_INPROGRESS There are events not progressed yet, progress and arm again.
+ * @retval Otherwise The events can not be notified.
+ */
+typedef ucg_status_t (*ucg_planc_context_arm_func_t)(ucg_planc_context_h context, int *fd);
+
 /**
  * @ingroup UCG_PLANC
  * @brief Function that create PlanC group.
@@ -134,4 +157,33 @@ typedef void (*ucg_planc_group_destroy_func_t)(ucg_planc_group_h planc_group);
 typedef ucg_status_t (*ucg_planc_get_plans_func_t)(ucg_planc_group_h planc_group,
                                                    ucg_plans_t *plans);
 
+/**
+ * @ingroup UCG_PLANC
+ * @brief Function that get the tag of the plans provided by PlanC group.
+ *
+ * Besides the size and the topology of the group, the plans may depend on the
+ * state of the PlanC group. The groups whose PlanC groups have the same tags get
+ * the same plans, so they share one container.
+ *
+ * @param [in]  planc_group PlanC group.
+ * @param [out] tag         Tag of the plans.
+ * @retval UCG_OK The plans can be shared with the groups of the same tag.
+ * @retval Otherwise The plans can not be shared.
+ */
+typedef ucg_status_t (*ucg_planc_get_plans_tag_func_t)(ucg_planc_group_h planc_group,
+                                                       uint64_t *tag);
+
+/**
+ * @ingroup UCG_PLANC
+ * @brief Function that prepare an operation among the processes of my node.
+ *
+ * The ranks in @b args are node-local ranks, which follow the order of group
+ * ranks, so the node leader is rank 0. Returns UCG_ERR_UNSUPPORTED if the PlanC
+ * can not perform the operation. The op is added to a meta op, which calls its
+ * @ref ucg_plan_op_t::reserve when the meta op is triggered.
+ */
+typedef ucg_status_t (*ucg_planc_node_op_prepare_func_t)(ucg_planc_group_h planc_group,
+                                                         const ucg_coll_args_t *args,
+                                                         ucg_plan_op_t **op);
+
 #endif
\ No newline at end of file
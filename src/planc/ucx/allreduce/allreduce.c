@@ -10,28 +10,36 @@
 
 static ucg_plan_attr_t ucg_planc_ucx_allreduce_plan_attr[] = {
     {ucg_planc_ucx_allreduce_rd_prepare,
-     1, "Recursive doubling", PLAN_DOMAIN},
+     1, "Recursive doubling", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_rd_cost},
 
     {ucg_planc_ucx_allreduce_na_rd_and_bntree_prepare,
-     2, "Node-aware recursive doubling and binomial tree", PLAN_DOMAIN},
+     2, "Node-aware recursive doubling and binomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_na_rd_and_bntree_cost},
 
     {ucg_planc_ucx_allreduce_sa_rd_and_bntree_prepare,
-     3, "Socket-aware recursive doubling and binomial tree", PLAN_DOMAIN},
+     3, "Socket-aware recursive doubling and binomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_sa_rd_and_bntree_cost},
 
     {ucg_planc_ucx_allreduce_ring_prepare,
-     4, "Ring", PLAN_DOMAIN},
+     4, "Ring", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_ring_cost},
 
     {ucg_planc_ucx_allreduce_na_rd_and_kntree_prepare,
-     5, "Node-aware recursive doubling and k-nomial tree", PLAN_DOMAIN},
+     5, "Node-aware recursive doubling and k-nomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_na_rd_and_kntree_cost},
 
     {ucg_planc_ucx_allreduce_sa_rd_and_kntree_prepare,
-     6, "Socket-aware recursive doubling and k-nomial tree", PLAN_DOMAIN},
+     6, "Socket-aware recursive doubling and k-nomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_sa_rd_and_kntree_cost},
 
     {ucg_planc_ucx_allreduce_na_kntree_prepare,
-     7, "Node-aware k-nomial tree", PLAN_DOMAIN},
+     7, "Node-aware k-nomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_na_kntree_cost},
 
     {ucg_planc_ucx_allreduce_sa_kntree_prepare,
-     8, "Socket-aware k-nomial tree", PLAN_DOMAIN},
+     8, "Socket-aware k-nomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_sa_kntree_cost},
 
     {ucg_planc_ucx_allreduce_na_inc_prepare,
      9, "Node-aware in-network-computing", PLAN_DOMAIN},
@@ -40,13 +48,16 @@ static ucg_plan_attr_t ucg_planc_ucx_allreduce_plan_attr[] = {
      10, "Socket-aware in-network-computing", PLAN_DOMAIN},
 
     {ucg_planc_ucx_allreduce_rabenseifner_prepare,
-     12, "Rabenseifner", PLAN_DOMAIN},
+     12, "Rabenseifner", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_rabenseifner_cost},
 
     {ucg_planc_ucx_allreduce_na_rabenseifner_prepare,
-     13, "Node-aware rabenseifner", PLAN_DOMAIN},
+     13, "Node-aware rabenseifner", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_na_rabenseifner_cost},
 
     {ucg_planc_ucx_allreduce_sa_rabenseifner_prepare,
-     14, "Socket-aware rabenseifner", PLAN_DOMAIN},
+     14, "Socket-aware rabenseifner", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_allreduce_sa_rabenseifner_cost},
 
     {ucg_planc_ucx_allreduce_nta_kntree_prepare,
      15, "Net-topo-aware k-nomial tree", PLAN_DOMAIN},
@@ -87,11 +98,45 @@ static ucg_config_field_t allreduce_config_table[] = {
      ucg_offsetof(ucg_planc_ucx_allreduce_config_t, nta_kntree_intra_degree),
      UCG_CONFIG_TYPE_INT},
 
+    {"ALLREDUCE_RING_FRAGMENT_SIZE", "64k",
+     "Configure the size of the fragments that the blocks are split into in ring algo "
+     "for allreduce",
+     ucg_offsetof(ucg_planc_ucx_allreduce_config_t, ring_frag_size),
+     UCG_CONFIG_TYPE_MEMUNITS},
+
+    {"ALLREDUCE_RING_PIPELINE_DEPTH", "4",
+     "Configure the maximum number of fragments in flight in ring algo for allreduce",
+     ucg_offsetof(ucg_planc_ucx_allreduce_config_t, ring_pipeline_depth),
+     UCG_CONFIG_TYPE_INT},
+
     {NULL}
 };
 UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_ALLREDUCE, allreduce_config_table,
                                     sizeof(ucg_planc_ucx_allreduce_config_t))
 
+const ucg_planc_ucx_allreduce_config_t*
+ucg_planc_ucx_allreduce_cost_config(const ucg_plan_cost_params_t *params)
+{
+    /* Defaults of allreduce_config_table */
+    static const ucg_planc_ucx_allreduce_config_t default_config = {
+        .fanin_inter_degree = 8,
+        .fanout_inter_degree = 8,
+        .fanin_intra_degree = 4,
+        .fanout_intra_degree = 2,
+        .nta_kntree_inter_degree = 8,
+        .nta_kntree_intra_degree = 8,
+        .ring_frag_size = 65536,
+        .ring_pipeline_depth = 4,
+    };
+    if (params->vgroup == NULL) {
+        return &default_config;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(params->vgroup, ucg_planc_ucx_group_t);
+    return UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, allreduce,
+                                                       UCG_COLL_TYPE_ALLREDUCE);
+}
+
 void ucg_planc_ucx_allreduce_set_plan_attr(ucg_vgroup_t *vgroup,
                                            ucg_plan_attr_t *default_plan_attr)
 {
@@ -8,6 +8,7 @@
 #include "planc_ucx_def.h"
 #include "planc_ucx_context.h"
 #include "planc_ucx_group.h"
+#include "planc_ucx_p2p.h"
 #include "core/ucg_plan.h"
 #include "util/algo/ucg_kntree.h"
 #include "util/algo/ucg_rd.h"
@@ -22,6 +23,9 @@ typedef struct ucg_planc_ucx_allreduce_config {
     int fanout_intra_degree;
     int nta_kntree_inter_degree;
     int nta_kntree_intra_degree;
+    /* configuration of ring */
+    size_t ring_frag_size;
+    int ring_pipeline_depth;
 } ucg_planc_ucx_allreduce_config_t;
 
 typedef struct ucg_planc_ucx_allreduce_rabenseifner_args {
@@ -53,6 +57,21 @@ typedef struct ucg_planc_ucx_allreduce {
             int32_t spilt_rank;
             int32_t large_blkcount;
             int32_t small_blkcount;
+            /* every block is split into nfrag fragments of at most frag_count elements */
+            int32_t frag_count;
+            int32_t nfrag;
+            /* maximum number of fragments being received at the same time */
+            int32_t depth;
+            /**
+             * A unit is the fragment f of step s, its index is s * nfrag + f. Units
+             * are received, reduced and sent in ascending order.
+             */
+            int32_t nunits;
+            int32_t posted_recv;
+            int32_t done;
+            int32_t posted_send;
+            /* requests[unit % depth] is the receive request of the unit */
+            ucg_planc_ucx_p2p_req_t **requests;
         } ring;
         ucg_planc_ucx_allreduce_rabenseifner_args_t rabenseifner;
     };
@@ -61,6 +80,12 @@ typedef struct ucg_planc_ucx_allreduce {
 void ucg_planc_ucx_allreduce_set_plan_attr(ucg_vgroup_t *vgroup,
                                             ucg_plan_attr_t *default_plan_attr);
 
+/**
+ * @brief Get the configuration that the plan estimated by params uses.
+ */
+const ucg_planc_ucx_allreduce_config_t*
+ucg_planc_ucx_allreduce_cost_config(const ucg_plan_cost_params_t *params);
+
 /* xxx_op_new routines are provided for internal algorithm combination */
 ucg_planc_ucx_op_t *ucg_planc_ucx_allreduce_rd_op_new(ucg_planc_ucx_group_t *ucx_group,
                                                       ucg_vgroup_t *vgroup,
@@ -116,4 +141,18 @@ ucg_status_t ucg_planc_ucx_allreduce_nta_kntree_prepare(ucg_vgroup_t *vgroup,
                                                         const ucg_coll_args_t *args,
                                                         ucg_plan_op_t **op);
 
+
+/* xxx_cost routines are provided for core layer to estimate the plans */
+double ucg_planc_ucx_allreduce_rd_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_na_rd_and_bntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_sa_rd_and_bntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_ring_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_na_rd_and_kntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_sa_rd_and_kntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_na_kntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_sa_kntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_rabenseifner_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_na_rabenseifner_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_allreduce_sa_rabenseifner_cost(const ucg_plan_cost_params_t *params);
+
 #endif
\ No newline at end of file
@@ -28,6 +28,13 @@ static ucg_status_t ucg_planc_ucx_allreduce_add_bcast_topo_group_op(ucg_plan_met
         return UCG_ERR_NO_RESOURCE;
     }
 
+    if (type == UCG_TOPO_GROUP_TYPE_NODE) {
+        ucg_status_t status = ucg_planc_ucx_add_node_op(meta_op, ucx_group, args);
+        if (status != UCG_ERR_UNSUPPORTED) {
+            return status;
+        }
+    }
+
     ucg_planc_ucx_op_t *ucx_op;
     ucx_op = ucg_planc_ucx_bcast_kntree_op_new(ucx_group,
                                                &topo_group->super,
@@ -87,6 +94,13 @@ static ucg_status_t ucg_planc_ucx_allreduce_add_reduce_topo_group_op(ucg_plan_me
         return UCG_ERR_NO_RESOURCE;
     }
 
+    if (type == UCG_TOPO_GROUP_TYPE_NODE) {
+        ucg_status_t status = ucg_planc_ucx_add_node_op(meta_op, ucx_group, args);
+        if (status != UCG_ERR_UNSUPPORTED) {
+            return status;
+        }
+    }
+
     ucg_planc_ucx_op_t *ucx_op;
     ucx_op = ucg_planc_ucx_reduce_kntree_op_new(ucx_group, &topo_group->super,
                                                 args, config);
@@ -114,6 +128,7 @@ ucg_status_t ucg_planc_ucx_allreduce_add_reduce_kntree_op(ucg_plan_meta_op_t *me
     }
 
     ucg_coll_args_t reduce_args;
+    reduce_args.type = UCG_COLL_TYPE_REDUCE;
     if (send_in_place) {
         reduce_args.reduce.sendbuf = UCG_IN_PLACE;
     } else {
@@ -163,6 +178,7 @@ ucg_status_t ucg_planc_ucx_allreduce_add_bcast_kntree_op(ucg_plan_meta_op_t *met
     }
 
     ucg_coll_args_t bcast_args;
+    bcast_args.type = UCG_COLL_TYPE_BCAST;
     bcast_args.bcast.buffer = args->allreduce.recvbuf;
     bcast_args.bcast.count = args->allreduce.count;
     bcast_args.bcast.dt = args->allreduce.dt;
@@ -364,4 +380,45 @@ void ucg_planc_ucx_allreduce_set_send_in_place_flag(ucg_vgroup_t *vgroup,
         *send_in_place = 1;
     }
     return;
-}
\ No newline at end of file
+}
+
+static int ucg_planc_ucx_allreduce_is_intra_group(ucg_topo_group_type_t group_type)
+{
+    return group_type == UCG_TOPO_GROUP_TYPE_NODE ||
+           group_type == UCG_TOPO_GROUP_TYPE_SOCKET ||
+           group_type == UCG_TOPO_GROUP_TYPE_SOCKET_LEADER;
+}
+
+double ucg_planc_ucx_allreduce_reduce_kntree_cost(const ucg_plan_cost_params_t *params,
+                                                  const ucg_planc_ucx_allreduce_config_t *config,
+                                                  ucg_topo_group_type_t group_type)
+{
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(params->topo, group_type, &level, &nprocs);
+    int degree = ucg_planc_ucx_allreduce_is_intra_group(group_type) ?
+                 config->fanin_intra_degree : config->fanin_inter_degree;
+    return ucg_plan_cost_reduce_kntree(params->model, level, nprocs, degree,
+                                       params->msg_size);
+}
+
+double ucg_planc_ucx_allreduce_allreduce_rd_cost(const ucg_plan_cost_params_t *params,
+                                                 ucg_topo_group_type_t group_type)
+{
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(params->topo, group_type, &level, &nprocs);
+    return ucg_plan_cost_rd(params->model, level, nprocs, params->msg_size);
+}
+
+double ucg_planc_ucx_allreduce_bcast_kntree_cost(const ucg_plan_cost_params_t *params,
+                                                 const ucg_planc_ucx_allreduce_config_t *config,
+                                                 ucg_topo_group_type_t group_type)
+{
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(params->topo, group_type, &level, &nprocs);
+    int degree = ucg_planc_ucx_allreduce_is_intra_group(group_type) ?
+                 config->fanout_intra_degree : config->fanout_inter_degree;
+    return ucg_plan_cost_kntree(params->model, level, nprocs, degree, params->msg_size);
+}
@@ -62,4 +62,17 @@ ucg_status_t ucg_planc_ucx_allreduce_add_allgatherv_op(ucg_plan_meta_op_t *meta_
 void ucg_planc_ucx_allreduce_set_send_in_place_flag(ucg_vgroup_t *vgroup,
                                                     ucg_topo_group_type_t pre_group_type,
                                                     int32_t *send_in_place);
+
+/**
+ * @brief Estimate the time of the op added by the xxx_op routines above with
+ * the same group_type.
+ */
+double ucg_planc_ucx_allreduce_reduce_kntree_cost(const ucg_plan_cost_params_t *params,
+                                                  const ucg_planc_ucx_allreduce_config_t *config,
+                                                  ucg_topo_group_type_t group_type);
+double ucg_planc_ucx_allreduce_allreduce_rd_cost(const ucg_plan_cost_params_t *params,
+                                                 ucg_topo_group_type_t group_type);
+double ucg_planc_ucx_allreduce_bcast_kntree_cost(const ucg_plan_cost_params_t *params,
+                                                 const ucg_planc_ucx_allreduce_config_t *config,
+                                                 ucg_topo_group_type_t group_type);
 #endif
\ No newline at end of file
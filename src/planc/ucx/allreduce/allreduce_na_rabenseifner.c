@@ -87,4 +87,18 @@ ucg_status_t ucg_planc_ucx_allreduce_na_rabenseifner_prepare(ucg_vgroup_t *vgrou
     }
     *op = &meta_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_allreduce_na_rabenseifner_cost(const ucg_plan_cost_params_t *params)
+{
+    const ucg_plan_cost_model_t *model = params->model;
+    ucg_plan_cost_level_t node_level, leader_level;
+    uint32_t ppn, nnode;
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NODE, &node_level, &ppn);
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NODE_LEADER, &leader_level, &nnode);
+    /* The processes with the same local rank reduce their blocks across the nodes. */
+    double size = params->msg_size;
+    return ucg_plan_cost_rh_reduce_scatter(model, node_level, ppn, size) +
+           ucg_plan_cost_rd(model, leader_level, nnode, size / ppn) +
+           ucg_plan_cost_rd_allgather(model, node_level, ppn, size);
 }
\ No newline at end of file
@@ -326,9 +326,7 @@ static ucg_status_t ucg_planc_ucx_allreduce_rabenseifner_common_op_discard(ucg_p
 {
     ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
 
-    if (op->staging_area != NULL) {
-        ucg_free(op->staging_area);
-    }
+    ucg_planc_ucx_op_free_staging(op);
     if (op->allreduce.rabenseifner.recv_count != NULL) {
         ucg_free(op->allreduce.rabenseifner.recv_count);
     }
@@ -401,8 +399,7 @@ static ucg_status_t ucg_planc_ucx_allreduce_rabenseifner_common_op_init(ucg_plan
     ucg_op->allreduce.rabenseifner.window_size = coll_args->count;
 
     int64_t data_size = coll_args->dt->true_extent + (int64_t)coll_args->dt->extent * (coll_args->count - 1);
-    ucg_op->staging_area = ucg_malloc(data_size, "allreduce staging area");
-    if (ucg_op->staging_area == NULL) {
+    if (ucg_planc_ucx_op_alloc_staging(ucg_op, data_size) != UCG_OK) {
         goto err_free_recv_count;
     }
 
@@ -760,4 +757,13 @@ ucg_status_t ucg_planc_ucx_allreduce_rabenseifner_prepare(ucg_vgroup_t *vgroup,
     }
     *op = &meta_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_allreduce_rabenseifner_cost(const ucg_plan_cost_params_t *params)
+{
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NET, &level, &nprocs);
+    return ucg_plan_cost_rh_reduce_scatter(params->model, level, nprocs, params->msg_size) +
+           ucg_plan_cost_rd_allgather(params->model, level, nprocs, params->msg_size);
 }
\ No newline at end of file
@@ -203,9 +203,7 @@ static ucg_status_t ucg_planc_ucx_allreduce_rd_op_trigger(ucg_plan_op_t *ucg_op)
 static ucg_status_t ucg_planc_ucx_allreduce_rd_op_discard(ucg_plan_op_t *ucg_op)
 {
     ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
-    if (op->staging_area != NULL) {
-        ucg_free(op->staging_area);
-    }
+    ucg_planc_ucx_op_free_staging(op);
     UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
     ucg_mpool_put(op);
     return UCG_OK;
@@ -240,9 +238,8 @@ ucg_planc_ucx_op_t *ucg_planc_ucx_allreduce_rd_op_new(ucg_planc_ucx_group_t *ucx
         ucg_dt_t *dt = args->allreduce.dt;
         int32_t count = args->allreduce.count;
         int64_t data_size = dt->true_extent + (int64_t)dt->extent * (count - 1);
-        ucg_assert(op->staging_area == NULL);
-        op->staging_area = ucg_malloc(data_size, "allreduce rd op staging area");
-        if (op->staging_area == NULL) {
+        status = ucg_planc_ucx_op_alloc_staging(op, data_size);
+        if (status != UCG_OK) {
             goto err_destruct;
         }
     }
@@ -267,6 +264,15 @@ ucg_status_t ucg_planc_ucx_allreduce_rd_prepare(ucg_vgroup_t *vgroup,
     if (rd_op == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
+    rd_op->super.rebind = ucg_plan_op_rebind_buffers;
     *op = &rd_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_allreduce_rd_cost(const ucg_plan_cost_params_t *params)
+{
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NET, &level, &nprocs);
+    return ucg_plan_cost_rd(params->model, level, nprocs, params->msg_size);
 }
\ No newline at end of file
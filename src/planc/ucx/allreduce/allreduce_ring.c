@@ -9,26 +9,9 @@
 #include "core/ucg_group.h"
 #include "util/ucg_log.h"
 #include "util/ucg_malloc.h"
+#include "util/ucg_math.h"
 #include "util/algo/ucg_ring.h"
 
-/* op flags needed by allreduce ring. */
-enum {
-    UCG_RING_REDUCE_SCATTER = UCG_BIT(0),
-    UCG_RING_REDUCE_SCATTER_SEND = UCG_BIT(1), /* reduce scatter phase send to peer */
-    UCG_RING_REDUCE_SCATTER_RECV = UCG_BIT(2), /* reduce scatter phase receive from peer */
-    UCG_RING_ALLGATHERV = UCG_BIT(3),
-    UCG_RING_ALLGATHERV_SEND = UCG_BIT(4), /* allgatherv phase send to peer */
-    UCG_RING_ALLGATHERV_RECV = UCG_BIT(5), /* allgatherv phase recv from peer */
-};
-
-#define UCG_RING_REDUCE_SCATTER_FLAGS UCG_RING_REDUCE_SCATTER | \
-                                      UCG_RING_REDUCE_SCATTER_SEND | \
-                                      UCG_RING_REDUCE_SCATTER_RECV
-#define UCG_RING_ALLGATHERV_FLAGS UCG_RING_ALLGATHERV | \
-                                  UCG_RING_ALLGATHERV_SEND | \
-                                  UCG_RING_ALLGATHERV_RECV
-#define UCG_RING_FLAGS UCG_RING_REDUCE_SCATTER_FLAGS | UCG_RING_ALLGATHERV_FLAGS
-
 static ucg_status_t ucg_planc_ucx_allreduce_ring_check(ucg_vgroup_t *vgroup,
                                                        const ucg_coll_args_t *args)
 {
@@ -46,113 +29,44 @@ static ucg_status_t ucg_planc_ucx_allreduce_ring_check(ucg_vgroup_t *vgroup,
     return UCG_OK;
 }
 
-static ucg_status_t ucg_planc_ucx_allreduce_ring_op_reduce_scatter(ucg_plan_op_t *ucg_op)
+static inline int32_t ucg_planc_ucx_allreduce_ring_block_offset(ucg_planc_ucx_op_t *op,
+                                                                int32_t block)
 {
-    ucg_status_t status;
-    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
-    ucg_vgroup_t *vgroup = op->super.vgroup;
-    ucg_coll_allreduce_args_t *args = &ucg_op->super.args.allreduce;
-    ucg_rank_t my_rank = vgroup->myrank;
-    uint32_t group_size = vgroup->size;
-    uint32_t dt_ext = ucg_dt_extent(args->dt);
-    ucg_planc_ucx_p2p_params_t params;
-    ucg_planc_ucx_op_set_p2p_params(op, &params);
-    ucg_algo_ring_iter_t *iter = &op->allreduce.ring.iter;
-    ucg_rank_t left_peer = ucg_algo_ring_iter_left_value(iter);
-    ucg_rank_t right_peer = ucg_algo_ring_iter_right_value(iter);
     int32_t large_blkcount = op->allreduce.ring.large_blkcount;
     int32_t small_blkcount = op->allreduce.ring.small_blkcount;
-    int32_t max_blkcount = large_blkcount;
     int32_t spilt_rank = op->allreduce.ring.spilt_rank;
-    void *temp_staging_area = op->staging_area - args->dt->true_lb;
-    while (!ucg_algo_ring_iter_end(iter)) {
-        int32_t step_idx = ucg_algo_ring_iter_idx(iter);
-        if (ucg_test_and_clear_flags(&op->flags, UCG_RING_REDUCE_SCATTER_RECV)) {
-            status = ucg_planc_ucx_p2p_irecv(temp_staging_area, max_blkcount,
-                                             args->dt, left_peer, op->tag,
-                                             vgroup, &params);
-            UCG_CHECK_GOTO(status, out);
-        }
-        if (ucg_test_and_clear_flags(&op->flags, UCG_RING_REDUCE_SCATTER_SEND)) {
-            int32_t sendblock = (my_rank + group_size - step_idx) % group_size;
-            int32_t blockoffset = ((sendblock < spilt_rank) ? (sendblock * large_blkcount) :
-                                    (sendblock * small_blkcount + spilt_rank));
-            int32_t blockcount = ((sendblock < spilt_rank) ?
-                                    large_blkcount : small_blkcount);
-            void *tmpsend = args->recvbuf + (int64_t)blockoffset * dt_ext;
-            status = ucg_planc_ucx_p2p_isend(tmpsend, blockcount, args->dt,
-                                             right_peer, op->tag, vgroup, &params);
-            UCG_CHECK_GOTO(status, out);
-        }
-        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
-        UCG_CHECK_GOTO(status, out);
-        int32_t recvblock = (my_rank + group_size - step_idx - 1) % group_size;
-        int32_t blockoffset = ((recvblock < spilt_rank) ? (recvblock *large_blkcount) :
-                                (recvblock *small_blkcount + spilt_rank));
-        int32_t blockcount = ((recvblock < spilt_rank) ? large_blkcount : small_blkcount);
-        void *tmprecv = args->recvbuf + blockoffset * dt_ext;
-        status = ucg_op_reduce(args->op, temp_staging_area, tmprecv, blockcount, args->dt);
-        UCG_CHECK_GOTO(status, out);
-        ucg_algo_ring_iter_inc(iter);
-        op->flags |= (UCG_RING_REDUCE_SCATTER_RECV | UCG_RING_REDUCE_SCATTER_SEND);
-    }
-    ucg_algo_ring_iter_reset(iter);
-
-out:
-    return status;
+    return (block < spilt_rank) ? (block * large_blkcount) :
+                                  (block * small_blkcount + spilt_rank);
 }
 
-static ucg_status_t ucg_planc_ucx_allreduce_ring_op_allgatherv(ucg_plan_op_t *ucg_op)
+/**
+ * @brief Get the position of the fragment sent or received in the unit.
+ *
+ * In step s, rank r sends block (r - s) and receives block (r - s - 1). The first
+ * (group_size - 1) steps are reduce-scatter, the others are allgatherv.
+ */
+static void ucg_planc_ucx_allreduce_ring_unit(ucg_planc_ucx_op_t *op, int32_t unit,
+                                              int is_recv, int32_t *offset,
+                                              int32_t *count)
 {
-    ucg_status_t status;
-    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
-    ucg_vgroup_t *vgroup = op->super.vgroup;
-    ucg_coll_allreduce_args_t *args = &ucg_op->super.args.allreduce;
-    ucg_rank_t my_rank = vgroup->myrank;
-    uint32_t group_size = vgroup->size;
-    uint32_t dt_ext = ucg_dt_extent(args->dt);
-    ucg_planc_ucx_p2p_params_t params;
-    ucg_planc_ucx_op_set_p2p_params(op, &params);
-    ucg_algo_ring_iter_t *iter = &op->allreduce.ring.iter;
-    ucg_rank_t left_peer = ucg_algo_ring_iter_left_value(iter);
-    ucg_rank_t right_peer = ucg_algo_ring_iter_right_value(iter);
-    int32_t large_blkcount = op->allreduce.ring.large_blkcount;
-    int32_t small_blkcount = op->allreduce.ring.small_blkcount;
-    int32_t max_blkcount = large_blkcount;
-    int32_t spilt_rank = op->allreduce.ring.spilt_rank;
-
-    while (!ucg_algo_ring_iter_end(iter)) {
-        int32_t step_idx = ucg_algo_ring_iter_idx(iter);
-        if (ucg_test_and_clear_flags(&op->flags, UCG_RING_ALLGATHERV_RECV)) {
-            int32_t recvblock = (my_rank + group_size - step_idx) % group_size;
-            int32_t recv_block_offset = ((recvblock < spilt_rank) ?
-                                            (recvblock * large_blkcount) :
-                                            (recvblock * small_blkcount + spilt_rank));
-            void *tmprecv = args->recvbuf + (int64_t)recv_block_offset * dt_ext;
-            status = ucg_planc_ucx_p2p_irecv(tmprecv, max_blkcount, args->dt,
-                                             left_peer, op->tag, vgroup, &params);
-            UCG_CHECK_GOTO(status, out);
-        }
-        if (ucg_test_and_clear_flags(&op->flags, UCG_RING_ALLGATHERV_SEND)) {
-            int32_t sendblock = (my_rank + group_size - step_idx + 1) % group_size;
-            int32_t send_block_offset = ((sendblock < spilt_rank) ?
-                                            (sendblock * large_blkcount) :
-                                            (sendblock * small_blkcount + spilt_rank));
-            int32_t blockcount = ((sendblock < spilt_rank) ? large_blkcount : small_blkcount);
-            void *tmpsend = args->recvbuf + (int64_t)send_block_offset * dt_ext;
-            status = ucg_planc_ucx_p2p_isend(tmpsend, blockcount, args->dt,
-                                             right_peer, op->tag, vgroup, &params);
-            UCG_CHECK_GOTO(status, out);
-        }
-        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
-        UCG_CHECK_GOTO(status, out);
-        ucg_algo_ring_iter_inc(iter);
-        op->flags |= (UCG_RING_ALLGATHERV_RECV | UCG_RING_ALLGATHERV_SEND);
+    uint32_t group_size = op->super.vgroup->size;
+    ucg_rank_t my_rank = op->super.vgroup->myrank;
+    int32_t nfrag = op->allreduce.ring.nfrag;
+    int32_t frag_count = op->allreduce.ring.frag_count;
+    int32_t step = unit / nfrag;
+    int32_t frag = unit % nfrag;
+    int32_t block = (my_rank + 2 * group_size - step - is_recv) % group_size;
+    int32_t blkcount = (block < op->allreduce.ring.spilt_rank) ?
+                       op->allreduce.ring.large_blkcount :
+                       op->allreduce.ring.small_blkcount;
+    int32_t frag_offset = frag * frag_count;
+    *offset = ucg_planc_ucx_allreduce_ring_block_offset(op, block) + frag_offset;
+    if (blkcount <= frag_offset) {
+        *count = 0;
+    } else {
+        *count = ucg_min(blkcount - frag_offset, frag_count);
     }
-    ucg_algo_ring_iter_reset(iter);
-
-out:
-    return status;
+    return;
 }
 
 /**
@@ -206,6 +120,11 @@ out:
  *
  *          DISTRIBUTION PHASE: ring ALLGATHER with ranks shifted by 1.
  *
+ *          Each block is split into fragments. The fragments are sent, received
+ *          and reduced in a pipeline, so that the reduction of a fragment overlaps
+ *          the transfer of the following ones and a step does not wait for the
+ *          whole block of the previous step.
+ *
  * @note Limitations:
  *      - The algorithm DOES NOT preserve order of operations so it
  *        can be used only for commutative operations.
@@ -214,20 +133,88 @@ out:
  */
 static ucg_status_t ucg_planc_ucx_allreduce_ring_op_progress(ucg_plan_op_t *ucg_op)
 {
-    ucg_status_t status;
+    ucg_status_t status = UCG_OK;
     ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_coll_allreduce_args_t *args = &ucg_op->super.args.allreduce;
+    uint32_t group_size = vgroup->size;
+    uint32_t dt_ext = ucg_dt_extent(args->dt);
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+    ucg_algo_ring_iter_t *iter = &op->allreduce.ring.iter;
+    ucg_rank_t left_peer = ucg_algo_ring_iter_left_value(iter);
+    ucg_rank_t right_peer = ucg_algo_ring_iter_right_value(iter);
+    int32_t nfrag = op->allreduce.ring.nfrag;
+    int32_t depth = op->allreduce.ring.depth;
+    int32_t nunits = op->allreduce.ring.nunits;
+    int32_t reduce_scatter_units = (group_size - 1) * nfrag;
+    int64_t frag_size = args->dt->true_extent +
+                        (int64_t)dt_ext * (op->allreduce.ring.frag_count - 1);
+    void *temp_staging_area = op->staging_area - args->dt->true_lb;
+    int32_t *posted_recv = &op->allreduce.ring.posted_recv;
+    int32_t *done = &op->allreduce.ring.done;
+    int32_t *posted_send = &op->allreduce.ring.posted_send;
+    ucg_planc_ucx_p2p_req_t **requests = op->allreduce.ring.requests;
+    int32_t offset;
+    int32_t count;
 
-    if (ucg_test_flags(op->flags, UCG_RING_REDUCE_SCATTER)) {
-        status = ucg_planc_ucx_allreduce_ring_op_reduce_scatter(ucg_op);
-        UCG_CHECK_GOTO(status, out);
-        ucg_clear_flags(&op->flags, UCG_RING_REDUCE_SCATTER);
-    }
-
-    if (ucg_test_flags(op->flags, UCG_RING_ALLGATHERV)) {
-        status = ucg_planc_ucx_allreduce_ring_op_allgatherv(ucg_op);
-        UCG_CHECK_GOTO(status, out);
-        ucg_clear_flags(&op->flags, UCG_RING_ALLGATHERV);
+    while (*done < nunits) {
+        int progress = 0;
+        /* Keep up to depth fragments being received. */
+        while (*posted_recv < nunits && *posted_recv - *done < depth) {
+            int32_t slot = *posted_recv % depth;
+            ucg_planc_ucx_allreduce_ring_unit(op, *posted_recv, 1, &offset, &count);
+            requests[slot] = NULL;
+            if (count > 0) {
+                void *tmprecv = (*posted_recv < reduce_scatter_units) ?
+                                temp_staging_area + slot * frag_size :
+                                args->recvbuf + (int64_t)offset * dt_ext;
+                params.request = &requests[slot];
+                status = ucg_planc_ucx_p2p_irecv(tmprecv, count, args->dt,
+                                                 left_peer, op->tag, vgroup, &params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            ++(*posted_recv);
+        }
+        /* Complete the received fragments in order. */
+        while (*done < *posted_recv) {
+            int32_t slot = *done % depth;
+            status = ucg_planc_ucx_p2p_test(op->ucx_group, &requests[slot]);
+            if (status == UCG_INPROGRESS) {
+                break;
+            }
+            UCG_CHECK_GOTO(status, out);
+            if (*done < reduce_scatter_units) {
+                ucg_planc_ucx_allreduce_ring_unit(op, *done, 1, &offset, &count);
+                if (count > 0) {
+                    void *tmprecv = args->recvbuf + (int64_t)offset * dt_ext;
+                    status = ucg_op_reduce(args->op, temp_staging_area + slot * frag_size,
+                                           tmprecv, count, args->dt);
+                    UCG_CHECK_GOTO(status, out);
+                }
+            }
+            ++(*done);
+            progress = 1;
+        }
+        /* A fragment is forwarded once the same fragment of the previous step is done. */
+        while (*posted_send < nunits && (*posted_send < nfrag || *posted_send - nfrag < *done)) {
+            ucg_planc_ucx_allreduce_ring_unit(op, *posted_send, 0, &offset, &count);
+            if (count > 0) {
+                void *tmpsend = args->recvbuf + (int64_t)offset * dt_ext;
+                params.request = NULL;
+                status = ucg_planc_ucx_p2p_isend(tmpsend, count, args->dt,
+                                                 right_peer, op->tag, vgroup, &params);
+                UCG_CHECK_GOTO(status, out);
+            }
+            ++(*posted_send);
+            progress = 1;
+        }
+        if (!progress) {
+            status = UCG_INPROGRESS;
+            goto out;
+        }
     }
+    status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
 
 out:
     op->super.super.status = status;
@@ -241,8 +228,9 @@ static ucg_status_t ucg_planc_ucx_allreduce_ring_op_trigger(ucg_plan_op_t *ucg_o
     ucg_coll_allreduce_args_t *args = &ucg_op->super.args.allreduce;
 
     ucg_planc_ucx_op_reset(op);
-    op->flags = UCG_RING_FLAGS;
-    ucg_algo_ring_iter_reset(&op->allreduce.ring.iter);
+    op->allreduce.ring.posted_recv = 0;
+    op->allreduce.ring.done = 0;
+    op->allreduce.ring.posted_send = 0;
 
     if (args->sendbuf != UCG_IN_PLACE) {
         status = ucg_dt_memcpy(args->recvbuf, args->count, args->dt,
@@ -262,7 +250,18 @@ static ucg_status_t ucg_planc_ucx_allreduce_ring_op_trigger(ucg_plan_op_t *ucg_o
     return status;
 }
 
-ucg_status_t ucg_planc_ucx_allreduce_ring_op_init(ucg_planc_ucx_op_t *ucg_op)
+static ucg_status_t ucg_planc_ucx_allreduce_ring_op_discard(ucg_plan_op_t *ucg_op)
+{
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    if (op->allreduce.ring.requests != NULL) {
+        ucg_free(op->allreduce.ring.requests);
+        op->allreduce.ring.requests = NULL;
+    }
+    return ucg_planc_ucx_op_discard(ucg_op);
+}
+
+static ucg_status_t ucg_planc_ucx_allreduce_ring_op_init(ucg_planc_ucx_op_t *ucg_op,
+                                                         const ucg_planc_ucx_allreduce_config_t *config)
 {
     ucg_coll_allreduce_args_t *args = &ucg_op->super.super.args.allreduce;
     int32_t count = args->count;
@@ -277,10 +276,31 @@ ucg_status_t ucg_planc_ucx_allreduce_ring_op_init(ucg_planc_ucx_op_t *ucg_op)
     ucg_op->allreduce.ring.spilt_rank = spilt_rank;
     ucg_op->allreduce.ring.large_blkcount = large_blkcount;
     ucg_op->allreduce.ring.small_blkcount = small_blkcount;
+
     ucg_dt_t *dt = args->dt;
-    int64_t data_size = dt->true_extent + (int64_t)dt->extent * (large_blkcount - 1);
-    ucg_op->staging_area = ucg_malloc(data_size, "alloc staging area");
-    if (!ucg_op->staging_area) {
+    size_t dt_ext = ucg_dt_extent(dt);
+    int32_t frag_count = large_blkcount;
+    if (dt_ext > 0 && config->ring_frag_size / dt_ext < (size_t)frag_count) {
+        frag_count = ucg_max((int32_t)(config->ring_frag_size / dt_ext), 1);
+    }
+    int32_t nfrag = (large_blkcount + frag_count - 1) / frag_count;
+    int32_t nunits = 2 * (group_size - 1) * nfrag;
+    int32_t depth = ucg_max(config->ring_pipeline_depth, 1);
+    depth = ucg_max(ucg_min(depth, nunits), 1);
+    ucg_op->allreduce.ring.frag_count = frag_count;
+    ucg_op->allreduce.ring.nfrag = nfrag;
+    ucg_op->allreduce.ring.depth = depth;
+    ucg_op->allreduce.ring.nunits = nunits;
+
+    int64_t data_size = dt->true_extent + (int64_t)dt->extent * (frag_count - 1);
+    ucg_status_t status = ucg_planc_ucx_op_alloc_staging(ucg_op, data_size * depth);
+    if (status != UCG_OK) {
+        return status;
+    }
+    ucg_op->allreduce.ring.requests = ucg_malloc(sizeof(ucg_planc_ucx_p2p_req_t *) * depth,
+                                                 "allreduce ring requests");
+    if (ucg_op->allreduce.ring.requests == NULL) {
+        ucg_planc_ucx_op_free_staging(ucg_op);
         return UCG_ERR_NO_MEMORY;
     }
     ucg_algo_ring_iter_init(&ucg_op->allreduce.ring.iter, group_size, my_rank);
@@ -289,7 +309,8 @@ ucg_status_t ucg_planc_ucx_allreduce_ring_op_init(ucg_planc_ucx_op_t *ucg_op)
 
 ucg_planc_ucx_op_t *ucg_planc_ucx_allreduce_ring_op_new(ucg_planc_ucx_group_t *ucx_group,
                                                         ucg_vgroup_t *vgroup,
-                                                        const ucg_coll_args_t *args)
+                                                        const ucg_coll_args_t *args,
+                                                        const ucg_planc_ucx_allreduce_config_t *config)
 {
     ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
     if (ucx_op == NULL) {
@@ -300,7 +321,7 @@ ucg_planc_ucx_op_t *ucg_planc_ucx_allreduce_ring_op_new(ucg_planc_ucx_group_t *u
     status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
                                  ucg_planc_ucx_allreduce_ring_op_trigger,
                                  ucg_planc_ucx_allreduce_ring_op_progress,
-                                 ucg_planc_ucx_op_discard,
+                                 ucg_planc_ucx_allreduce_ring_op_discard,
                                  args);
 
     if (status != UCG_OK) {
@@ -310,7 +331,7 @@ ucg_planc_ucx_op_t *ucg_planc_ucx_allreduce_ring_op_new(ucg_planc_ucx_group_t *u
 
     ucg_planc_ucx_op_init(ucx_op, ucx_group);
 
-    status = ucg_planc_ucx_allreduce_ring_op_init(ucx_op);
+    status = ucg_planc_ucx_allreduce_ring_op_init(ucx_op, config);
     if (status != UCG_OK) {
         ucg_error("Failed to initialize allreduce ring ucx op");
         goto err_destruct;
@@ -339,10 +360,24 @@ ucg_status_t ucg_planc_ucx_allreduce_ring_prepare(ucg_vgroup_t *vgroup,
     }
 
     ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
-    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_allreduce_ring_op_new(ucx_group, vgroup, args);
+    ucg_planc_ucx_allreduce_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, allreduce,
+                                                         UCG_COLL_TYPE_ALLREDUCE);
+    ucg_planc_ucx_op_t *ucx_op = ucg_planc_ucx_allreduce_ring_op_new(ucx_group, vgroup,
+                                                                     args, config);
     if (ucx_op == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
+    ucx_op->super.rebind = ucg_plan_op_rebind_buffers;
     *op = &ucx_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_allreduce_ring_cost(const ucg_plan_cost_params_t *params)
+{
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NET, &level, &nprocs);
+    return ucg_plan_cost_ring_reduce_scatter(params->model, level, nprocs, params->msg_size) +
+           ucg_plan_cost_ring_allgather(params->model, level, nprocs, params->msg_size);
 }
\ No newline at end of file
@@ -98,4 +98,23 @@ ucg_status_t ucg_planc_ucx_allreduce_sa_rabenseifner_prepare(ucg_vgroup_t *vgrou
     }
     *op = &meta_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_allreduce_sa_rabenseifner_cost(const ucg_plan_cost_params_t *params)
+{
+    const ucg_plan_cost_model_t *model = params->model;
+    ucg_plan_cost_level_t socket_level, socket_leader_level, node_leader_level;
+    uint32_t pps, nsocket, nnode;
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_SOCKET, &socket_level, &pps);
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_SOCKET_LEADER,
+                             &socket_leader_level, &nsocket);
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NODE_LEADER,
+                             &node_leader_level, &nnode);
+    /* The processes with the same socket-local rank reduce their blocks across
+       the sockets and then across the nodes. */
+    double size = params->msg_size;
+    return ucg_plan_cost_rh_reduce_scatter(model, socket_level, pps, size) +
+           ucg_plan_cost_rd(model, socket_leader_level, nsocket, size / pps) +
+           ucg_plan_cost_rd(model, node_leader_level, nnode, size / pps) +
+           ucg_plan_cost_rd_allgather(model, socket_level, pps, size);
 }
\ No newline at end of file
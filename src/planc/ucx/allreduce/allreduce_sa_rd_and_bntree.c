@@ -98,4 +98,18 @@ ucg_status_t ucg_planc_ucx_allreduce_sa_rd_and_bntree_prepare(ucg_vgroup_t *vgro
     }
     *op = &meta_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_allreduce_sa_rd_and_bntree_cost(const ucg_plan_cost_params_t *params)
+{
+    ucg_planc_ucx_allreduce_config_t config = *ucg_planc_ucx_allreduce_cost_config(params);
+    config.fanin_intra_degree = 2;
+    config.fanout_intra_degree = 2;
+    return ucg_planc_ucx_allreduce_reduce_kntree_cost(params, &config, UCG_TOPO_GROUP_TYPE_SOCKET) +
+           ucg_planc_ucx_allreduce_reduce_kntree_cost(params, &config,
+                                                      UCG_TOPO_GROUP_TYPE_SOCKET_LEADER) +
+           ucg_planc_ucx_allreduce_allreduce_rd_cost(params, UCG_TOPO_GROUP_TYPE_NODE_LEADER) +
+           ucg_planc_ucx_allreduce_bcast_kntree_cost(params, &config,
+                                                     UCG_TOPO_GROUP_TYPE_SOCKET_LEADER) +
+           ucg_planc_ucx_allreduce_bcast_kntree_cost(params, &config, UCG_TOPO_GROUP_TYPE_SOCKET);
 }
\ No newline at end of file
@@ -98,4 +98,16 @@ ucg_status_t ucg_planc_ucx_allreduce_sa_rd_and_kntree_prepare(ucg_vgroup_t *vgro
     }
     *op = &meta_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_allreduce_sa_rd_and_kntree_cost(const ucg_plan_cost_params_t *params)
+{
+    const ucg_planc_ucx_allreduce_config_t *config = ucg_planc_ucx_allreduce_cost_config(params);
+    return ucg_planc_ucx_allreduce_reduce_kntree_cost(params, config, UCG_TOPO_GROUP_TYPE_SOCKET) +
+           ucg_planc_ucx_allreduce_reduce_kntree_cost(params, config,
+                                                      UCG_TOPO_GROUP_TYPE_SOCKET_LEADER) +
+           ucg_planc_ucx_allreduce_allreduce_rd_cost(params, UCG_TOPO_GROUP_TYPE_NODE_LEADER) +
+           ucg_planc_ucx_allreduce_bcast_kntree_cost(params, config,
+                                                     UCG_TOPO_GROUP_TYPE_SOCKET_LEADER) +
+           ucg_planc_ucx_allreduce_bcast_kntree_cost(params, config, UCG_TOPO_GROUP_TYPE_SOCKET);
 }
\ No newline at end of file
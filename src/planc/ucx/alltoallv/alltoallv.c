@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "alltoallv.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_global.h"
+#include "core/ucg_topo.h"
+#include "util/ucg_log.h"
+
+#define PLAN_DOMAIN "planc ucx alltoallv"
+
+static ucg_plan_attr_t ucg_planc_ucx_alltoallv_plan_attr[] = {
+    {ucg_planc_ucx_alltoallv_linear_prepare,
+     1, "Linear", PLAN_DOMAIN},
+
+    {ucg_planc_ucx_alltoallv_pairwise_prepare,
+     2, "Pairwise exchange", PLAN_DOMAIN},
+
+    {ucg_planc_ucx_alltoallv_node_aware_prepare,
+     3, "Node-aware two-level", PLAN_DOMAIN},
+
+    {NULL},
+};
+UCG_PLAN_ATTR_REGISTER_TABLE(ucg_planc_ucx, UCG_COLL_TYPE_ALLTOALLV,
+                             ucg_planc_ucx_alltoallv_plan_attr);
+
+static ucg_config_field_t alltoallv_config_table[] = {
+    {"ALLTOALLV_LINEAR_WINDOW", "32",
+     "Configure the maximum number of peers in flight in linear algo for alltoallv, "
+     "0 means exchanging with all peers at once",
+     ucg_offsetof(ucg_planc_ucx_alltoallv_config_t, linear_window),
+     UCG_CONFIG_TYPE_INT},
+
+    {NULL}
+};
+UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_ALLTOALLV, alltoallv_config_table,
+                                    sizeof(ucg_planc_ucx_alltoallv_config_t))
+
+ucg_status_t ucg_planc_ucx_alltoallv_check(ucg_vgroup_t *vgroup,
+                                           const ucg_coll_args_t *args)
+{
+    if (args->alltoallv.sendbuf == UCG_IN_PLACE) {
+        ucg_info("Alltoallv don't support in-place");
+        return UCG_ERR_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_exchange(ucg_planc_ucx_op_t *op,
+                                              ucg_rank_t sendpeer,
+                                              ucg_rank_t recvpeer,
+                                              ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_rank_t myrank = vgroup->myrank;
+    uint32_t sendtype_extent = ucg_dt_extent(args->sendtype);
+    uint32_t recvtype_extent = ucg_dt_extent(args->recvtype);
+    const void *sbuf = (char *)args->sendbuf + (int64_t)args->sdispls[sendpeer] * sendtype_extent;
+    void *rbuf = (char *)args->recvbuf + (int64_t)args->rdispls[recvpeer] * recvtype_extent;
+    int32_t scount = args->sendcounts[sendpeer];
+    int32_t rcount = args->recvcounts[recvpeer];
+
+    if (sendpeer == myrank) {
+        ucg_assert(recvpeer == myrank);
+        if (scount > 0) {
+            status = ucg_dt_memcpy(rbuf, rcount, args->recvtype,
+                                   sbuf, scount, args->sendtype);
+        }
+        return status;
+    }
+
+    if (rcount > 0) {
+        status = ucg_planc_ucx_p2p_irecv(rbuf, rcount, args->recvtype, recvpeer,
+                                         op->tag, vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+    }
+    if (scount > 0) {
+        status = ucg_planc_ucx_p2p_isend(sbuf, scount, args->sendtype, sendpeer,
+                                         op->tag, vgroup, params);
+    }
+out:
+    return status;
+}
+
+void ucg_planc_ucx_alltoallv_set_plan_attr(ucg_vgroup_t *vgroup,
+                                           ucg_plan_attr_t *default_plan_attr)
+{
+    ucg_plan_attr_t *attr;
+    for (attr = default_plan_attr; !UCG_PLAN_ATTR_IS_LAST(attr); ++attr) {
+        ucg_plan_range_t range = {0, UCG_PLAN_RANGE_MAX};
+        attr->range = range;
+        attr->score = UCG_PLANC_UCX_DEFAULT_SCORE;
+    }
+
+    /* The message size is the max bytes between two processes in the group. */
+    ucg_group_t *group = vgroup->group;
+    int32_t ppn = group->topo->ppn;
+    const int32_t score = UCG_PLANC_UCX_DEFAULT_SCORE + 1;
+    if (group->size <= 32) {
+        ucg_plan_attr_array_update(default_plan_attr, 1, 0, UCG_PLAN_RANGE_MAX, score);
+        return;
+    }
+    if (ppn != UCG_TOPO_PPX_UNBALANCED && ppn >= 16 && group->size / ppn > 1) {
+        /* Aggregating through node leaders reduces inter-node messages by ppn^2,
+           which pays off until the copies through the leaders dominate. */
+        ucg_plan_attr_array_update(default_plan_attr, 3, 0, 8192, score);
+        ucg_plan_attr_array_update(default_plan_attr, 2, 8192, UCG_PLAN_RANGE_MAX, score);
+        return;
+    }
+    ucg_plan_attr_array_update(default_plan_attr, 2, 0, UCG_PLAN_RANGE_MAX, score);
+    return;
+}
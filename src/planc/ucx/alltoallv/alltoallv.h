@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_UCX_ALLTOALLV_H_
+#define UCG_PLANC_UCX_ALLTOALLV_H_
+
+#include "planc_ucx_def.h"
+#include "planc_ucx_context.h"
+#include "planc_ucx_group.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_plan.h"
+
+typedef struct ucg_planc_ucx_alltoallv {
+    union {
+        struct {
+            /* distance of the next peer to exchange with */
+            int32_t idx;
+            /* maximum number of peers in flight, 0 means all */
+            int32_t window;
+        } linear;
+        struct {
+            int32_t step;
+        } pairwise;
+        struct {
+            int32_t phase;
+            ucg_rank_t leader;
+            int32_t nnode;
+            /* node index of each rank, nodes are ordered by their leader */
+            int32_t *node_of;
+            /* ranks of node i are node_ranks[node_start[i]...node_start[i+1]) */
+            int32_t *node_start;
+            ucg_rank_t *node_ranks;
+            /**
+             * Leader only, bytes each local rank sends to and receives from each rank:
+             * meta[local * 2 * size + rank] and meta[local * 2 * size + size + rank].
+             */
+            int64_t *meta;
+            /* capacity of staging area */
+            int64_t staging_size;
+            /* leader only, size of the data to remote nodes in staging area */
+            int64_t out_size;
+        } node_aware;
+    };
+} ucg_planc_ucx_alltoallv_t;
+
+typedef struct ucg_planc_ucx_alltoallv_config {
+    /* configuration of linear alltoallv */
+    int linear_window;
+} ucg_planc_ucx_alltoallv_config_t;
+
+void ucg_planc_ucx_alltoallv_set_plan_attr(ucg_vgroup_t *vgroup,
+                                           ucg_plan_attr_t *default_plan_attr);
+
+/**
+ * @brief Check whether the alltoallv op is supported by the builtin algorithms.
+ */
+ucg_status_t ucg_planc_ucx_alltoallv_check(ucg_vgroup_t *vgroup,
+                                           const ucg_coll_args_t *args);
+
+/**
+ * @brief Post the send to sendpeer and the receive from recvpeer.
+ *
+ * The data to myself is copied directly. Empty messages are not posted.
+ */
+ucg_status_t ucg_planc_ucx_alltoallv_exchange(ucg_planc_ucx_op_t *op,
+                                              ucg_rank_t sendpeer,
+                                              ucg_rank_t recvpeer,
+                                              ucg_planc_ucx_p2p_params_t *params);
+
+ucg_planc_ucx_op_t *ucg_planc_ucx_alltoallv_linear_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                          ucg_vgroup_t *vgroup,
+                                                          const ucg_coll_args_t *args,
+                                                          const ucg_planc_ucx_alltoallv_config_t *config);
+
+ucg_status_t ucg_planc_ucx_alltoallv_linear_prepare(ucg_vgroup_t *vgroup,
+                                                    const ucg_coll_args_t *args,
+                                                    ucg_plan_op_t **op);
+
+ucg_planc_ucx_op_t *ucg_planc_ucx_alltoallv_pairwise_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                            ucg_vgroup_t *vgroup,
+                                                            const ucg_coll_args_t *args);
+
+ucg_status_t ucg_planc_ucx_alltoallv_pairwise_prepare(ucg_vgroup_t *vgroup,
+                                                      const ucg_coll_args_t *args,
+                                                      ucg_plan_op_t **op);
+
+ucg_planc_ucx_op_t *ucg_planc_ucx_alltoallv_node_aware_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                              ucg_vgroup_t *vgroup,
+                                                              const ucg_coll_args_t *args);
+
+ucg_status_t ucg_planc_ucx_alltoallv_node_aware_prepare(ucg_vgroup_t *vgroup,
+                                                        const ucg_coll_args_t *args,
+                                                        ucg_plan_op_t **op);
+
+#endif
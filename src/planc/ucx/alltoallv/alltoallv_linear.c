@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "alltoallv.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+
+enum {
+    UCG_ALLTOALLV_LINEAR_POST = UCG_BIT(0),
+};
+
+/**
+ * Exchange with the peers at distance [idx, idx + window) in each round, i.e.
+ * send to (myrank + i) and receive from (myrank - i). Scattering the peers
+ * avoids that all processes send to the same process at the same time, the
+ * window limits the number of requests in flight.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_linear_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    uint32_t group_size = vgroup->size;
+    ucg_rank_t myrank = vgroup->myrank;
+    int32_t *idx = &op->alltoallv.linear.idx;
+    int32_t window = op->alltoallv.linear.window;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    while (1) {
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_LINEAR_POST)) {
+            int32_t end = group_size;
+            if (window > 0 && *idx + window < group_size) {
+                end = *idx + window;
+            }
+            for (; *idx < end; ++(*idx)) {
+                ucg_rank_t sendpeer = (myrank + *idx) % group_size;
+                ucg_rank_t recvpeer = (myrank - *idx + group_size) % group_size;
+                status = ucg_planc_ucx_alltoallv_exchange(op, sendpeer, recvpeer, &params);
+                UCG_CHECK_GOTO(status, out);
+            }
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+        if (*idx >= group_size) {
+            break;
+        }
+        op->flags |= UCG_ALLTOALLV_LINEAR_POST;
+    }
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_linear_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_op_reset(op);
+    op->alltoallv.linear.idx = 0;
+    op->flags = UCG_ALLTOALLV_LINEAR_POST;
+    status = ucg_planc_ucx_alltoallv_linear_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+ucg_planc_ucx_op_t *ucg_planc_ucx_alltoallv_linear_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                          ucg_vgroup_t *vgroup,
+                                                          const ucg_coll_args_t *args,
+                                                          const ucg_planc_ucx_alltoallv_config_t *config)
+{
+    UCG_CHECK_NULL(NULL, ucx_group, vgroup, args, config);
+
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                              ucg_planc_ucx_alltoallv_linear_op_trigger,
+                                              ucg_planc_ucx_alltoallv_linear_op_progress,
+                                              ucg_planc_ucx_op_discard,
+                                              args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+    ucx_op->alltoallv.linear.window = config->linear_window < 0 ? 0 : config->linear_window;
+    return ucx_op;
+
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_linear_prepare(ucg_vgroup_t *vgroup,
+                                                    const ucg_coll_args_t *args,
+                                                    ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status = ucg_planc_ucx_alltoallv_check(vgroup, args);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_alltoallv_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, alltoallv,
+                                                         UCG_COLL_TYPE_ALLTOALLV);
+    ucg_planc_ucx_op_t *linear_op = ucg_planc_ucx_alltoallv_linear_op_new(ucx_group, vgroup,
+                                                                          args, config);
+    if (linear_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &linear_op->super;
+    return UCG_OK;
+}
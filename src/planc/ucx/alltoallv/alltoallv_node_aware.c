@@ -0,0 +1,592 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "alltoallv.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_group.h"
+#include "core/ucg_rank_map.h"
+#include "util/ucg_log.h"
+#include "util/ucg_malloc.h"
+#include "util/ucg_math.h"
+
+#include <string.h>
+
+/**
+ * Node-aware two-level alltoallv.
+ *
+ * The processes in the same node exchange data directly. The data between
+ * nodes is aggregated by the node leaders, so there is only one message
+ * between each pair of nodes:
+ * 1. The leader gathers the byte counts of all local processes.
+ * 2. The leader gathers the data to the remote processes from local processes.
+ * 3. The leaders exchange the aggregated data.
+ * 4. The leader scatters the data from remote processes to local processes.
+ *
+ * Data is transferred in bytes, so only contiguous datatypes are supported.
+ * The messages between two processes use the same tag, the order of posting
+ * must be the same on both sides to make the messages matched correctly.
+ */
+typedef enum {
+    UCG_ALLTOALLV_NA_PHASE_INIT,
+    UCG_ALLTOALLV_NA_PHASE_GATHER,
+    UCG_ALLTOALLV_NA_PHASE_EXCHANGE,
+    UCG_ALLTOALLV_NA_PHASE_SCATTER,
+    UCG_ALLTOALLV_NA_PHASE_DONE,
+} ucg_planc_ucx_alltoallv_na_phase_t;
+
+#define UCG_ALLTOALLV_NA_MAX_MSG_SIZE INT32_MAX
+
+#define UCG_ALLTOALLV_NA_NODE_RANKS(_op, _node) \
+    (&(_op)->alltoallv.node_aware.node_ranks[(_op)->alltoallv.node_aware.node_start[_node]])
+
+#define UCG_ALLTOALLV_NA_NODE_SIZE(_op, _node) \
+    ((_op)->alltoallv.node_aware.node_start[(_node) + 1] - \
+     (_op)->alltoallv.node_aware.node_start[_node])
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_isend(const void *buffer, int64_t length,
+                                                     ucg_rank_t peer, ucg_planc_ucx_op_t *op,
+                                                     ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_dt_t *dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
+    const char *buf = (const char *)buffer;
+    while (length > 0) {
+        int32_t count = length > UCG_ALLTOALLV_NA_MAX_MSG_SIZE ?
+                        UCG_ALLTOALLV_NA_MAX_MSG_SIZE : (int32_t)length;
+        status = ucg_planc_ucx_p2p_isend(buf, count, dt, peer, op->tag,
+                                         op->super.vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+        buf += count;
+        length -= count;
+    }
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_irecv(void *buffer, int64_t length,
+                                                     ucg_rank_t peer, ucg_planc_ucx_op_t *op,
+                                                     ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_dt_t *dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
+    char *buf = (char *)buffer;
+    while (length > 0) {
+        int32_t count = length > UCG_ALLTOALLV_NA_MAX_MSG_SIZE ?
+                        UCG_ALLTOALLV_NA_MAX_MSG_SIZE : (int32_t)length;
+        status = ucg_planc_ucx_p2p_irecv(buf, count, dt, peer, op->tag,
+                                         op->super.vgroup, params);
+        UCG_CHECK_GOTO(status, out);
+        buf += count;
+        length -= count;
+    }
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_reserve(ucg_planc_ucx_op_t *op, int64_t size)
+{
+    if (op->alltoallv.node_aware.staging_size >= size) {
+        return UCG_OK;
+    }
+    ucg_planc_ucx_op_free_staging(op);
+    ucg_status_t status = ucg_planc_ucx_op_alloc_staging(op, size);
+    if (status != UCG_OK) {
+        op->alltoallv.node_aware.staging_size = 0;
+        return status;
+    }
+    op->alltoallv.node_aware.staging_size = size;
+    return UCG_OK;
+}
+
+static void ucg_planc_ucx_alltoallv_na_fill_meta(ucg_planc_ucx_op_t *op, int64_t *meta)
+{
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    uint32_t group_size = op->super.vgroup->size;
+    int64_t sendtype_size = ucg_dt_size(args->sendtype);
+    int64_t recvtype_size = ucg_dt_size(args->recvtype);
+    for (int i = 0; i < group_size; ++i) {
+        meta[i] = args->sendcounts[i] * sendtype_size;
+        meta[group_size + i] = args->recvcounts[i] * recvtype_size;
+    }
+    return;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_init(ucg_planc_ucx_op_t *op,
+                                                    ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    uint32_t group_size = vgroup->size;
+    ucg_rank_t myrank = vgroup->myrank;
+    ucg_rank_t leader = op->alltoallv.node_aware.leader;
+    int32_t nnode = op->alltoallv.node_aware.nnode;
+    int32_t mynode = op->alltoallv.node_aware.node_of[myrank];
+    ucg_rank_t *local_ranks = UCG_ALLTOALLV_NA_NODE_RANKS(op, mynode);
+    int32_t nlocal = UCG_ALLTOALLV_NA_NODE_SIZE(op, mynode);
+    int64_t meta_size = 2 * (int64_t)group_size * sizeof(int64_t);
+    uint32_t sendtype_extent = ucg_dt_extent(args->sendtype);
+    uint32_t recvtype_extent = ucg_dt_extent(args->recvtype);
+
+    if (myrank == leader) {
+        int64_t *meta = op->alltoallv.node_aware.meta;
+        ucg_planc_ucx_alltoallv_na_fill_meta(op, meta);
+        for (int i = 1; i < nlocal; ++i) {
+            status = ucg_planc_ucx_alltoallv_na_irecv((char *)meta + i * meta_size,
+                                                      meta_size, local_ranks[i],
+                                                      op, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        /* The receives from local processes are posted after their metas arrive. */
+        for (int i = 1; i < nlocal; ++i) {
+            ucg_rank_t peer = local_ranks[i];
+            if (args->sendcounts[peer] > 0) {
+                const void *sbuf = (char *)args->sendbuf +
+                                   (int64_t)args->sdispls[peer] * sendtype_extent;
+                status = ucg_planc_ucx_p2p_isend(sbuf, args->sendcounts[peer],
+                                                 args->sendtype, peer, op->tag,
+                                                 vgroup, params);
+                UCG_CHECK_GOTO(status, out);
+            }
+        }
+        status = ucg_planc_ucx_alltoallv_exchange(op, myrank, myrank, params);
+        goto out;
+    }
+
+    /* Send meta and the data to remote processes to leader. */
+    int64_t *meta = (int64_t *)op->staging_area;
+    ucg_planc_ucx_alltoallv_na_fill_meta(op, meta);
+    status = ucg_planc_ucx_alltoallv_na_isend(meta, meta_size, leader, op, params);
+    UCG_CHECK_GOTO(status, out);
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == mynode) {
+            continue;
+        }
+        ucg_rank_t *ranks = UCG_ALLTOALLV_NA_NODE_RANKS(op, node);
+        int32_t size = UCG_ALLTOALLV_NA_NODE_SIZE(op, node);
+        for (int i = 0; i < size; ++i) {
+            const void *sbuf = (char *)args->sendbuf +
+                               (int64_t)args->sdispls[ranks[i]] * sendtype_extent;
+            status = ucg_planc_ucx_alltoallv_na_isend(sbuf, meta[ranks[i]], leader,
+                                                      op, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+
+    /* Exchange with local processes directly. */
+    for (int i = 0; i < nlocal; ++i) {
+        status = ucg_planc_ucx_alltoallv_exchange(op, local_ranks[i], local_ranks[i], params);
+        UCG_CHECK_GOTO(status, out);
+    }
+
+    /* Receive the data from remote processes from leader. */
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == mynode) {
+            continue;
+        }
+        ucg_rank_t *ranks = UCG_ALLTOALLV_NA_NODE_RANKS(op, node);
+        int32_t size = UCG_ALLTOALLV_NA_NODE_SIZE(op, node);
+        for (int i = 0; i < size; ++i) {
+            void *rbuf = (char *)args->recvbuf +
+                         (int64_t)args->rdispls[ranks[i]] * recvtype_extent;
+            status = ucg_planc_ucx_alltoallv_na_irecv(rbuf, meta[group_size + ranks[i]],
+                                                      leader, op, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+out:
+    return status;
+}
+
+/**
+ * The staging area of leader:
+ * | to node 0 | to node 1 | ... | from node 0 | from node 1 | ... |
+ * The data to node n is ordered by (local source, destination in node n), the
+ * data from node n is ordered by (source in node n, local destination), so
+ * the data to node n of one leader is exactly the data from node m of the
+ * leader of node n.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_na_gather(ucg_planc_ucx_op_t *op,
+                                                      ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status;
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    uint32_t group_size = vgroup->size;
+    int32_t nnode = op->alltoallv.node_aware.nnode;
+    int32_t mynode = op->alltoallv.node_aware.node_of[vgroup->myrank];
+    ucg_rank_t *local_ranks = UCG_ALLTOALLV_NA_NODE_RANKS(op, mynode);
+    int32_t nlocal = UCG_ALLTOALLV_NA_NODE_SIZE(op, mynode);
+    int64_t *meta = op->alltoallv.node_aware.meta;
+    uint32_t sendtype_extent = ucg_dt_extent(args->sendtype);
+
+    int64_t out_size = 0;
+    int64_t in_size = 0;
+    for (int i = 0; i < nlocal; ++i) {
+        int64_t *local_meta = &meta[2 * (int64_t)group_size * i];
+        for (int peer = 0; peer < group_size; ++peer) {
+            if (op->alltoallv.node_aware.node_of[peer] != mynode) {
+                out_size += local_meta[peer];
+                in_size += local_meta[group_size + peer];
+            }
+        }
+    }
+    status = ucg_planc_ucx_alltoallv_na_reserve(op, out_size + in_size);
+    UCG_CHECK_GOTO(status, out);
+    op->alltoallv.node_aware.out_size = out_size;
+
+    char *out_buf = (char *)op->staging_area;
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == mynode) {
+            continue;
+        }
+        ucg_rank_t *ranks = UCG_ALLTOALLV_NA_NODE_RANKS(op, node);
+        int32_t size = UCG_ALLTOALLV_NA_NODE_SIZE(op, node);
+        for (int i = 0; i < nlocal; ++i) {
+            int64_t *local_meta = &meta[2 * (int64_t)group_size * i];
+            for (int j = 0; j < size; ++j) {
+                int64_t length = local_meta[ranks[j]];
+                if (i == 0) {
+                    const void *sbuf = (char *)args->sendbuf +
+                                       (int64_t)args->sdispls[ranks[j]] * sendtype_extent;
+                    memcpy(out_buf, sbuf, length);
+                } else {
+                    status = ucg_planc_ucx_alltoallv_na_irecv(out_buf, length, local_ranks[i],
+                                                              op, params);
+                    UCG_CHECK_GOTO(status, out);
+                }
+                out_buf += length;
+            }
+        }
+    }
+
+    /* Local processes send to me directly after sending the data to remote processes. */
+    for (int i = 1; i < nlocal; ++i) {
+        ucg_rank_t peer = local_ranks[i];
+        if (args->recvcounts[peer] > 0) {
+            void *rbuf = (char *)args->recvbuf +
+                         (int64_t)args->rdispls[peer] * ucg_dt_extent(args->recvtype);
+            status = ucg_planc_ucx_p2p_irecv(rbuf, args->recvcounts[peer], args->recvtype,
+                                             peer, op->tag, vgroup, params);
+            UCG_CHECK_GOTO(status, out);
+        }
+    }
+
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_exchange(ucg_planc_ucx_op_t *op,
+                                                        ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    uint32_t group_size = op->super.vgroup->size;
+    int32_t nnode = op->alltoallv.node_aware.nnode;
+    int32_t mynode = op->alltoallv.node_aware.node_of[op->super.vgroup->myrank];
+    int32_t nlocal = UCG_ALLTOALLV_NA_NODE_SIZE(op, mynode);
+    int64_t *meta = op->alltoallv.node_aware.meta;
+
+    char *in_buf = (char *)op->staging_area + op->alltoallv.node_aware.out_size;
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == mynode) {
+            continue;
+        }
+        ucg_rank_t *ranks = UCG_ALLTOALLV_NA_NODE_RANKS(op, node);
+        int32_t size = UCG_ALLTOALLV_NA_NODE_SIZE(op, node);
+        int64_t length = 0;
+        for (int j = 0; j < size; ++j) {
+            for (int i = 0; i < nlocal; ++i) {
+                length += meta[2 * (int64_t)group_size * i + group_size + ranks[j]];
+            }
+        }
+        status = ucg_planc_ucx_alltoallv_na_irecv(in_buf, length, ranks[0], op, params);
+        UCG_CHECK_GOTO(status, out);
+        in_buf += length;
+    }
+
+    char *out_buf = (char *)op->staging_area;
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == mynode) {
+            continue;
+        }
+        ucg_rank_t *ranks = UCG_ALLTOALLV_NA_NODE_RANKS(op, node);
+        int32_t size = UCG_ALLTOALLV_NA_NODE_SIZE(op, node);
+        int64_t length = 0;
+        for (int i = 0; i < nlocal; ++i) {
+            for (int j = 0; j < size; ++j) {
+                length += meta[2 * (int64_t)group_size * i + ranks[j]];
+            }
+        }
+        status = ucg_planc_ucx_alltoallv_na_isend(out_buf, length, ranks[0], op, params);
+        UCG_CHECK_GOTO(status, out);
+        out_buf += length;
+    }
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_scatter(ucg_planc_ucx_op_t *op,
+                                                       ucg_planc_ucx_p2p_params_t *params)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_coll_alltoallv_args_t *args = &op->super.super.args.alltoallv;
+    uint32_t group_size = op->super.vgroup->size;
+    int32_t nnode = op->alltoallv.node_aware.nnode;
+    int32_t mynode = op->alltoallv.node_aware.node_of[op->super.vgroup->myrank];
+    ucg_rank_t *local_ranks = UCG_ALLTOALLV_NA_NODE_RANKS(op, mynode);
+    int32_t nlocal = UCG_ALLTOALLV_NA_NODE_SIZE(op, mynode);
+    int64_t *meta = op->alltoallv.node_aware.meta;
+    uint32_t recvtype_extent = ucg_dt_extent(args->recvtype);
+
+    char *in_buf = (char *)op->staging_area + op->alltoallv.node_aware.out_size;
+    for (int32_t node = 0; node < nnode; ++node) {
+        if (node == mynode) {
+            continue;
+        }
+        ucg_rank_t *ranks = UCG_ALLTOALLV_NA_NODE_RANKS(op, node);
+        int32_t size = UCG_ALLTOALLV_NA_NODE_SIZE(op, node);
+        for (int j = 0; j < size; ++j) {
+            for (int i = 0; i < nlocal; ++i) {
+                int64_t length = meta[2 * (int64_t)group_size * i + group_size + ranks[j]];
+                if (i == 0) {
+                    void *rbuf = (char *)args->recvbuf +
+                                 (int64_t)args->rdispls[ranks[j]] * recvtype_extent;
+                    memcpy(rbuf, in_buf, length);
+                } else {
+                    status = ucg_planc_ucx_alltoallv_na_isend(in_buf, length, local_ranks[i],
+                                                              op, params);
+                    UCG_CHECK_GOTO(status, out);
+                }
+                in_buf += length;
+            }
+        }
+    }
+out:
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    int32_t *phase = &op->alltoallv.node_aware.phase;
+    int is_leader = op->super.vgroup->myrank == op->alltoallv.node_aware.leader;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    while (1) {
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+        switch (*phase) {
+            case UCG_ALLTOALLV_NA_PHASE_INIT:
+                status = ucg_planc_ucx_alltoallv_na_init(op, &params);
+                *phase = is_leader ? UCG_ALLTOALLV_NA_PHASE_GATHER : UCG_ALLTOALLV_NA_PHASE_DONE;
+                break;
+            case UCG_ALLTOALLV_NA_PHASE_GATHER:
+                status = ucg_planc_ucx_alltoallv_na_gather(op, &params);
+                *phase = UCG_ALLTOALLV_NA_PHASE_EXCHANGE;
+                break;
+            case UCG_ALLTOALLV_NA_PHASE_EXCHANGE:
+                status = ucg_planc_ucx_alltoallv_na_exchange(op, &params);
+                *phase = UCG_ALLTOALLV_NA_PHASE_SCATTER;
+                break;
+            case UCG_ALLTOALLV_NA_PHASE_SCATTER:
+                status = ucg_planc_ucx_alltoallv_na_scatter(op, &params);
+                *phase = UCG_ALLTOALLV_NA_PHASE_DONE;
+                break;
+            default:
+                goto out;
+        }
+        UCG_CHECK_GOTO(status, out);
+    }
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_op_reset(op);
+    op->alltoallv.node_aware.phase = UCG_ALLTOALLV_NA_PHASE_INIT;
+    status = ucg_planc_ucx_alltoallv_na_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_op_discard(ucg_plan_op_t *ucg_op)
+{
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    if (op->alltoallv.node_aware.node_of != NULL) {
+        ucg_free(op->alltoallv.node_aware.node_of);
+    }
+    if (op->alltoallv.node_aware.meta != NULL) {
+        ucg_free(op->alltoallv.node_aware.meta);
+    }
+    return ucg_planc_ucx_op_discard(ucg_op);
+}
+
+/**
+ * Group the ranks by node, the nodes are numbered in the order of their
+ * smallest rank, which is the leader of the node.
+ */
+static ucg_status_t ucg_planc_ucx_alltoallv_na_init_nodes(ucg_planc_ucx_op_t *op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    ucg_group_t *group = vgroup->group;
+    uint32_t group_size = vgroup->size;
+
+    int32_t *node_of = ucg_malloc((3 * (int64_t)group_size + 1) * sizeof(int32_t),
+                                  "alltoallv nodes");
+    if (node_of == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    int32_t *node_start = node_of + group_size;
+    ucg_rank_t *node_ranks = node_start + group_size + 1;
+
+    int32_t max_node_id = 0;
+    for (int i = 0; i < group_size; ++i) {
+        ucg_location_t location;
+        ucg_rank_t rank = ucg_rank_map_eval(&vgroup->rank_map, i);
+        status = ucg_group_get_location(group, rank, &location);
+        if (status != UCG_OK) {
+            ucg_error("Failed to get location of rank %d", rank);
+            goto err_free_nodes;
+        }
+        node_of[i] = location.node_id;
+        max_node_id = ucg_max(max_node_id, location.node_id);
+    }
+
+    int32_t *node_idx = ucg_malloc((max_node_id + 1) * sizeof(int32_t), "alltoallv node idx");
+    if (node_idx == NULL) {
+        status = UCG_ERR_NO_MEMORY;
+        goto err_free_nodes;
+    }
+    for (int i = 0; i <= max_node_id; ++i) {
+        node_idx[i] = -1;
+    }
+    int32_t nnode = 0;
+    for (int i = 0; i < group_size; ++i) {
+        if (node_idx[node_of[i]] == -1) {
+            node_idx[node_of[i]] = nnode++;
+        }
+        node_of[i] = node_idx[node_of[i]];
+    }
+
+    memset(node_start, 0, (nnode + 1) * sizeof(int32_t));
+    for (int i = 0; i < group_size; ++i) {
+        ++node_start[node_of[i] + 1];
+    }
+    for (int i = 0; i < nnode; ++i) {
+        node_start[i + 1] += node_start[i];
+        /* reuse node_idx as the cursor of each node */
+        node_idx[i] = node_start[i];
+    }
+    for (int i = 0; i < group_size; ++i) {
+        node_ranks[node_idx[node_of[i]]++] = i;
+    }
+    ucg_free(node_idx);
+
+    op->alltoallv.node_aware.nnode = nnode;
+    op->alltoallv.node_aware.node_of = node_of;
+    op->alltoallv.node_aware.node_start = node_start;
+    op->alltoallv.node_aware.node_ranks = node_ranks;
+    op->alltoallv.node_aware.leader = node_ranks[node_start[node_of[vgroup->myrank]]];
+    return UCG_OK;
+
+err_free_nodes:
+    ucg_free(node_of);
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_na_op_init(ucg_planc_ucx_op_t *op,
+                                                       ucg_planc_ucx_group_t *ucx_group)
+{
+    ucg_planc_ucx_op_init(op, ucx_group);
+    op->alltoallv.node_aware.node_of = NULL;
+    op->alltoallv.node_aware.meta = NULL;
+    op->alltoallv.node_aware.staging_size = 0;
+
+    ucg_status_t status = ucg_planc_ucx_alltoallv_na_init_nodes(op);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    int64_t meta_size = 2 * (int64_t)vgroup->size * sizeof(int64_t);
+    if (vgroup->myrank != op->alltoallv.node_aware.leader) {
+        return ucg_planc_ucx_alltoallv_na_reserve(op, meta_size);
+    }
+
+    int32_t mynode = op->alltoallv.node_aware.node_of[vgroup->myrank];
+    int32_t nlocal = UCG_ALLTOALLV_NA_NODE_SIZE(op, mynode);
+    op->alltoallv.node_aware.meta = ucg_malloc(nlocal * meta_size, "alltoallv meta");
+    if (op->alltoallv.node_aware.meta == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    return UCG_OK;
+}
+
+ucg_planc_ucx_op_t *ucg_planc_ucx_alltoallv_node_aware_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                              ucg_vgroup_t *vgroup,
+                                                              const ucg_coll_args_t *args)
+{
+    UCG_CHECK_NULL(NULL, ucx_group, vgroup, args);
+
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                              ucg_planc_ucx_alltoallv_na_op_trigger,
+                                              ucg_planc_ucx_alltoallv_na_op_progress,
+                                              ucg_planc_ucx_alltoallv_na_op_discard,
+                                              args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    status = ucg_planc_ucx_alltoallv_na_op_init(ucx_op, ucx_group);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize alltoallv ucx op");
+        ucg_planc_ucx_alltoallv_na_op_discard(&ucx_op->super);
+        goto err;
+    }
+    return ucx_op;
+
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_node_aware_prepare(ucg_vgroup_t *vgroup,
+                                                        const ucg_coll_args_t *args,
+                                                        ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status = ucg_planc_ucx_alltoallv_check(vgroup, args);
+    if (status != UCG_OK) {
+        return status;
+    }
+    if (!ucg_dt_is_contiguous(args->alltoallv.sendtype) ||
+        !ucg_dt_is_contiguous(args->alltoallv.recvtype)) {
+        ucg_info("Alltoallv node-aware don't support non-contiguous datatype");
+        return UCG_ERR_UNSUPPORTED;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *na_op = ucg_planc_ucx_alltoallv_node_aware_op_new(ucx_group,
+                                                                          vgroup, args);
+    if (na_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &na_op->super;
+    return UCG_OK;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "alltoallv.h"
+#include "planc_ucx_plan.h"
+#include "planc_ucx_p2p.h"
+#include "core/ucg_group.h"
+#include "util/ucg_log.h"
+#include "util/ucg_math.h"
+
+enum {
+    UCG_ALLTOALLV_PAIRWISE_POST = UCG_BIT(0),
+};
+
+/**
+ * In step i, send to and receive from one peer only. If the group size is
+ * power of two, the peer is (myrank ^ i) so that the processes exchange in
+ * pairs, otherwise send to (myrank + i) and receive from (myrank - i).
+ */
+static void ucg_planc_ucx_alltoallv_pairwise_peers(ucg_vgroup_t *vgroup, int32_t step,
+                                                   ucg_rank_t *sendpeer,
+                                                   ucg_rank_t *recvpeer)
+{
+    uint32_t group_size = vgroup->size;
+    ucg_rank_t myrank = vgroup->myrank;
+    if (ucg_is_pow2(group_size)) {
+        *sendpeer = *recvpeer = myrank ^ step;
+        return;
+    }
+    *sendpeer = (myrank + step) % group_size;
+    *recvpeer = (myrank - step + group_size) % group_size;
+    return;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_pairwise_op_progress(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status = UCG_OK;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_vgroup_t *vgroup = op->super.vgroup;
+    uint32_t group_size = vgroup->size;
+    int32_t *step = &op->alltoallv.pairwise.step;
+    ucg_planc_ucx_p2p_params_t params;
+    ucg_planc_ucx_op_set_p2p_params(op, &params);
+
+    while (*step < group_size) {
+        if (ucg_test_and_clear_flags(&op->flags, UCG_ALLTOALLV_PAIRWISE_POST)) {
+            ucg_rank_t sendpeer;
+            ucg_rank_t recvpeer;
+            ucg_planc_ucx_alltoallv_pairwise_peers(vgroup, *step, &sendpeer, &recvpeer);
+            status = ucg_planc_ucx_alltoallv_exchange(op, sendpeer, recvpeer, &params);
+            UCG_CHECK_GOTO(status, out);
+        }
+        status = ucg_planc_ucx_p2p_testall(op->ucx_group, params.state);
+        UCG_CHECK_GOTO(status, out);
+        op->flags |= UCG_ALLTOALLV_PAIRWISE_POST;
+        ++(*step);
+    }
+out:
+    op->super.super.status = status;
+    return status;
+}
+
+static ucg_status_t ucg_planc_ucx_alltoallv_pairwise_op_trigger(ucg_plan_op_t *ucg_op)
+{
+    ucg_status_t status;
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_planc_ucx_op_reset(op);
+    op->alltoallv.pairwise.step = 0;
+    op->flags = UCG_ALLTOALLV_PAIRWISE_POST;
+    status = ucg_planc_ucx_alltoallv_pairwise_op_progress(ucg_op);
+    return status == UCG_INPROGRESS ? UCG_OK : status;
+}
+
+ucg_planc_ucx_op_t *ucg_planc_ucx_alltoallv_pairwise_op_new(ucg_planc_ucx_group_t *ucx_group,
+                                                            ucg_vgroup_t *vgroup,
+                                                            const ucg_coll_args_t *args)
+{
+    UCG_CHECK_NULL(NULL, ucx_group, vgroup, args);
+
+    ucg_planc_ucx_op_t *ucx_op = ucg_mpool_get(&ucx_group->context->op_mp);
+    if (ucx_op == NULL) {
+        goto err;
+    }
+
+    ucg_status_t status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, &ucx_op->super, vgroup,
+                                              ucg_planc_ucx_alltoallv_pairwise_op_trigger,
+                                              ucg_planc_ucx_alltoallv_pairwise_op_progress,
+                                              ucg_planc_ucx_op_discard,
+                                              args);
+    if (status != UCG_OK) {
+        ucg_error("Failed to initialize super of ucx op");
+        goto err_free_op;
+    }
+
+    ucg_planc_ucx_op_init(ucx_op, ucx_group);
+    return ucx_op;
+
+err_free_op:
+    ucg_mpool_put(ucx_op);
+err:
+    return NULL;
+}
+
+ucg_status_t ucg_planc_ucx_alltoallv_pairwise_prepare(ucg_vgroup_t *vgroup,
+                                                      const ucg_coll_args_t *args,
+                                                      ucg_plan_op_t **op)
+{
+    UCG_CHECK_NULL_INVALID(vgroup, args, op);
+
+    ucg_status_t status = ucg_planc_ucx_alltoallv_check(vgroup, args);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(vgroup, ucg_planc_ucx_group_t);
+    ucg_planc_ucx_op_t *pairwise_op = ucg_planc_ucx_alltoallv_pairwise_op_new(ucx_group,
+                                                                              vgroup, args);
+    if (pairwise_op == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    *op = &pairwise_op->super;
+    return UCG_OK;
+}
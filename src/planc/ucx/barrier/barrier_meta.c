@@ -142,6 +142,16 @@ err:
     return NULL;
 }
 
+/* Both fan-in and fan-out inside the node are done by a barrier of the node. */
+static ucg_status_t ucg_planc_ucx_barrier_add_node_op(ucg_plan_meta_op_t *meta_op,
+                                                      ucg_planc_ucx_group_t *ucx_group)
+{
+    ucg_coll_args_t barrier_args = {
+        .type = UCG_COLL_TYPE_BARRIER,
+    };
+    return ucg_planc_ucx_add_node_op(meta_op, ucx_group, &barrier_args);
+}
+
 static ucg_status_t ucg_planc_ucx_barrier_add_bcast_topo_group_op(ucg_plan_meta_op_t *meta_op,
                                                                   ucg_planc_ucx_group_t *ucx_group,
                                                                   ucg_vgroup_t *vgroup,
@@ -161,6 +171,13 @@ static ucg_status_t ucg_planc_ucx_barrier_add_bcast_topo_group_op(ucg_plan_meta_
         return UCG_ERR_NO_RESOURCE;
     }
 
+    if (type == UCG_TOPO_GROUP_TYPE_NODE) {
+        ucg_status_t status = ucg_planc_ucx_barrier_add_node_op(meta_op, ucx_group);
+        if (status != UCG_ERR_UNSUPPORTED) {
+            return status;
+        }
+    }
+
     ucg_planc_ucx_op_t *ucx_op;
     ucx_op = ucg_planc_ucx_bcast_kntree_op_new(ucx_group,
                                                &topo_group->super,
@@ -190,6 +207,13 @@ static ucg_status_t ucg_planc_ucx_barrier_add_fanin_topo_group_op(ucg_plan_meta_
         return UCG_ERR_NO_RESOURCE;
     }
 
+    if (type == UCG_TOPO_GROUP_TYPE_NODE) {
+        ucg_status_t status = ucg_planc_ucx_barrier_add_node_op(meta_op, ucx_group);
+        if (status != UCG_ERR_UNSUPPORTED) {
+            return status;
+        }
+    }
+
     ucg_planc_ucx_op_t *ucx_op;
     ucx_op = ucg_planc_ucx_fanin_kntree_op_new(ucx_group, &topo_group->super,
                                                args, config);
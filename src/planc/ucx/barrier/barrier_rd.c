@@ -202,6 +202,7 @@ ucg_status_t ucg_planc_ucx_barrier_rd_prepare(ucg_vgroup_t *vgroup,
     if (rd_op == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
+    rd_op->super.rebind = ucg_plan_op_rebind_buffers;
     *op = &rd_op->super;
     return UCG_OK;
 }
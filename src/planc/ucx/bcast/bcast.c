@@ -11,31 +11,38 @@
 
 static ucg_plan_attr_t ucg_planc_ucx_bcast_plan_attr[] = {
     {ucg_planc_ucx_bcast_bntree_prepare,
-     1, "Binomial tree", PLAN_DOMAIN},
+     1, "Binomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_bcast_bntree_cost},
 
     {ucg_planc_ucx_bcast_na_bntree_prepare,
-     2, "Node-aware binomial tree", PLAN_DOMAIN},
+     2, "Node-aware binomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_bcast_na_bntree_cost},
 
     {ucg_planc_ucx_bcast_na_kntree_and_bntree_prepare,
-     3, "Node-aware k-nomial tree and binomial tree", PLAN_DOMAIN},
+     3, "Node-aware k-nomial tree and binomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_bcast_na_kntree_and_bntree_cost},
 
     {ucg_planc_ucx_bcast_na_kntree_prepare,
-     4, "Node-aware k-nomial tree", PLAN_DOMAIN},
+     4, "Node-aware k-nomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_bcast_na_kntree_cost},
 
     {ucg_planc_ucx_bcast_na_inc_prepare,
      5, "Node-aware in-network-computing", PLAN_DOMAIN},
 
     {ucg_planc_ucx_bcast_ring_prepare,
-     6, "Ring", PLAN_DOMAIN},
+     6, "Ring", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_bcast_ring_cost},
 
     {ucg_planc_ucx_bcast_nta_kntree_prepare,
      7, "Net-topo-aware k-nomial tree", PLAN_DOMAIN},
 
     {ucg_planc_ucx_bcast_van_de_geijn_prepare,
-     8, "van de Geijn(scatter+allgather)", PLAN_DOMAIN},
+     8, "van de Geijn(scatter+allgather)", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_bcast_van_de_geijn_cost},
 
     {ucg_planc_ucx_bcast_kntree_prepare,
-     10, "K-nomial tree", PLAN_DOMAIN},
+     10, "K-nomial tree", PLAN_DOMAIN,
+     .cost = ucg_planc_ucx_bcast_kntree_cost},
 
     {NULL},
 };
@@ -78,6 +85,27 @@ static ucg_config_field_t bcast_config_table[] = {
 UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(UCG_COLL_TYPE_BCAST, bcast_config_table,
                                     sizeof(ucg_planc_ucx_bcast_config_t))
 
+const ucg_planc_ucx_bcast_config_t*
+ucg_planc_ucx_bcast_cost_config(const ucg_plan_cost_params_t *params)
+{
+    /* Defaults of bcast_config_table */
+    static const ucg_planc_ucx_bcast_config_t default_config = {
+        .kntree_degree = 8,
+        .root_adjust = 0,
+        .nta_kntree_inter_degree = 2,
+        .nta_kntree_intra_degree = 2,
+        .na_kntree_inter_degree = 8,
+        .na_kntree_intra_degree = 2,
+    };
+    if (params->vgroup == NULL) {
+        return &default_config;
+    }
+
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(params->vgroup, ucg_planc_ucx_group_t);
+    return UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, bcast,
+                                                       UCG_COLL_TYPE_BCAST);
+}
+
 void ucg_planc_ucx_bcast_set_plan_attr(ucg_vgroup_t *vgroup,
                                        ucg_plan_attr_t *default_plan_attr)
 {
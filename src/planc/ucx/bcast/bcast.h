@@ -45,6 +45,12 @@ typedef struct ucg_planc_ucx_bcast {
 void ucg_planc_ucx_bcast_set_plan_attr(ucg_vgroup_t *vgroup,
                                        ucg_plan_attr_t *default_plan_attr);
 
+/**
+ * @brief Get the configuration that the plan estimated by params uses.
+ */
+const ucg_planc_ucx_bcast_config_t*
+ucg_planc_ucx_bcast_cost_config(const ucg_plan_cost_params_t *params);
+
 /* xxx_op_new routines are provided for internal algorithm combination */
 ucg_planc_ucx_op_t *ucg_planc_ucx_bcast_kntree_op_new(ucg_planc_ucx_group_t *ucx_group,
                                                       ucg_vgroup_t *vgroup,
@@ -84,6 +90,17 @@ ucg_status_t ucg_planc_ucx_bcast_van_de_geijn_prepare(ucg_vgroup_t *vgroup,
                                                       const ucg_coll_args_t *args,
                                                       ucg_plan_op_t **op);
 
+/* xxx_cost routines are provided for core layer to estimate the plans */
+double ucg_planc_ucx_bcast_bntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_bcast_na_bntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_bcast_na_kntree_and_bntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_bcast_na_kntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_bcast_ring_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_bcast_van_de_geijn_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_bcast_kntree_cost(const ucg_plan_cost_params_t *params);
+double ucg_planc_ucx_bcast_na_kntree_op_cost(const ucg_plan_cost_params_t *params,
+                                             const ucg_planc_ucx_bcast_config_t *config);
+
 /* helper for adding op to meta op. */
 ucg_status_t ucg_planc_ucx_bcast_add_adjust_root_op(ucg_plan_meta_op_t *meta_op,
                                                     ucg_planc_ucx_group_t *ucx_group,
@@ -31,6 +31,15 @@ ucg_status_t ucg_planc_ucx_bcast_bntree_prepare(ucg_vgroup_t *vgroup,
     if (ucx_op == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
+    ucx_op->super.rebind = ucg_plan_op_rebind_buffers;
     *op = &ucx_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_bcast_bntree_cost(const ucg_plan_cost_params_t *params)
+{
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NET, &level, &nprocs);
+    return ucg_plan_cost_kntree(params->model, level, nprocs, 2, params->msg_size);
 }
\ No newline at end of file
@@ -147,6 +147,13 @@ ucg_status_t ucg_planc_ucx_bcast_add_topo_group_kntree_op(ucg_plan_meta_op_t *me
     if (old_root != UCG_TOPO_GROUP_LEADER && config->root_adjust) {
         adjust_args->bcast.root = UCG_TOPO_GROUP_LEADER;
     }
+    if (type == UCG_TOPO_GROUP_TYPE_NODE && adjust_args->bcast.root == UCG_TOPO_GROUP_LEADER) {
+        ucg_status_t status = ucg_planc_ucx_add_node_op(meta_op, ucx_group, adjust_args);
+        if (status != UCG_ERR_UNSUPPORTED) {
+            adjust_args->bcast.root = old_root;
+            return status;
+        }
+    }
     ucg_planc_ucx_op_t *ucx_op;
     ucx_op = ucg_planc_ucx_bcast_kntree_op_new(ucx_group,
                                                &topo_group->super,
@@ -29,4 +29,12 @@ ucg_status_t ucg_planc_ucx_bcast_na_bntree_prepare(ucg_vgroup_t *vgroup,
     }
     *op = &meta_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_bcast_na_bntree_cost(const ucg_plan_cost_params_t *params)
+{
+    ucg_planc_ucx_bcast_config_t config = *ucg_planc_ucx_bcast_cost_config(params);
+    config.na_kntree_inter_degree = 2;
+    config.na_kntree_intra_degree = 2;
+    return ucg_planc_ucx_bcast_na_kntree_op_cost(params, &config);
 }
\ No newline at end of file
@@ -93,4 +93,23 @@ ucg_status_t ucg_planc_ucx_bcast_na_kntree_prepare(ucg_vgroup_t *vgroup,
     }
     *op = &meta_op->super;
     return UCG_OK;
+}
+
+double ucg_planc_ucx_bcast_na_kntree_op_cost(const ucg_plan_cost_params_t *params,
+                                             const ucg_planc_ucx_bcast_config_t *config)
+{
+    const ucg_plan_cost_model_t *model = params->model;
+    ucg_plan_cost_level_t inter_level, intra_level;
+    uint32_t nnode, ppn;
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NODE_LEADER, &inter_level, &nnode);
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NODE, &intra_level, &ppn);
+    return ucg_plan_cost_kntree(model, inter_level, nnode, config->na_kntree_inter_degree,
+                                params->msg_size) +
+           ucg_plan_cost_kntree(model, intra_level, ppn, config->na_kntree_intra_degree,
+                                params->msg_size);
+}
+
+double ucg_planc_ucx_bcast_na_kntree_cost(const ucg_plan_cost_params_t *params)
+{
+    return ucg_planc_ucx_bcast_na_kntree_op_cost(params, ucg_planc_ucx_bcast_cost_config(params));
 }
\ No newline at end of file
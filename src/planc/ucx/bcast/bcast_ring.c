@@ -112,10 +112,20 @@ ucg_status_t ucg_planc_ucx_bcast_ring_prepare(ucg_vgroup_t *vgroup,
     }
     ucg_planc_ucx_op_init(ucx_op, ucx_group);
     ucg_algo_ring_iter_init(&ucx_op->bcast.ring_iter, vgroup->size, vgroup->myrank);
+    ucx_op->super.rebind = ucg_plan_op_rebind_buffers;
     *op = &ucx_op->super;
     return UCG_OK;
 
 err_free_op:
     ucg_mpool_put(ucx_op);
     return status;
+}
+
+double ucg_planc_ucx_bcast_ring_cost(const ucg_plan_cost_params_t *params)
+{
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NET, &level, &nprocs);
+    /* The message goes around the ring hop by hop. */
+    return (nprocs - 1) * ucg_plan_cost_p2p(params->model, level, params->msg_size);
 }
\ No newline at end of file
@@ -278,10 +278,22 @@ ucg_status_t ucg_planc_ucx_bcast_van_de_geijn_prepare(ucg_vgroup_t *vgroup,
     ucg_algo_ring_iter_t *ring_iter = &ucx_op->bcast.van_de_geijn.ring_iter;
     ucg_algo_ring_iter_init(ring_iter, vgroup->size, vgroup->myrank);
     ucg_planc_ucx_op_init(ucx_op, ucx_group);
+    ucx_op->super.rebind = ucg_plan_op_rebind_buffers;
     *op = &ucx_op->super;
     return UCG_OK;
 
 err_free_op:
     ucg_mpool_put(ucx_op);
     return status;
+}
+
+double ucg_planc_ucx_bcast_van_de_geijn_cost(const ucg_plan_cost_params_t *params)
+{
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(params->topo, UCG_TOPO_GROUP_TYPE_NET, &level, &nprocs);
+    /* Binomial scatter moves the same bytes in the same rounds as recursive
+       doubling allgather. */
+    return ucg_plan_cost_rd_allgather(params->model, level, nprocs, params->msg_size) +
+           ucg_plan_cost_ring_allgather(params->model, level, nprocs, params->msg_size);
 }
\ No newline at end of file
@@ -11,9 +11,17 @@
 #include "util/ucg_malloc.h"
 #include "util/ucg_helper.h"
 #include "util/ucg_cpu.h"
+#include "util/ucg_math.h"
 
 #define PLANC_UCX_CONFIG_PREFIX "PLANC_UCX_"
 
+const char *ucg_planc_ucx_wireup_names[] = {
+    [UCG_PLANC_UCX_WIREUP_NONE]         = "none",
+    [UCG_PLANC_UCX_WIREUP_PLAN_PEERS]   = "plan_peers",
+    [UCG_PLANC_UCX_WIREUP_ALL]          = "all",
+    NULL,
+};
+
 static ucg_config_field_t ucg_planc_ucx_config_table[] = {
     {"BCAST_ATTR", "", UCG_PLAN_ATTR_DESC,
      ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_BCAST]),
@@ -35,6 +43,10 @@ static ucg_config_field_t ucg_planc_ucx_config_table[] = {
      ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_SCATTERV]),
      UCG_CONFIG_TYPE_STRING},
 
+    {"GATHERV_ATTR", "", UCG_PLAN_ATTR_DESC,
+     ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_GATHERV]),
+     UCG_CONFIG_TYPE_STRING},
+
     {"ALLGATHERV_ATTR", "", UCG_PLAN_ATTR_DESC,
      ucg_offsetof(ucg_planc_ucx_config_t, plan_attr[UCG_COLL_TYPE_ALLGATHERV]),
      UCG_CONFIG_TYPE_STRING},
@@ -54,6 +66,12 @@ static ucg_config_field_t ucg_planc_ucx_config_table[] = {
      ucg_offsetof(ucg_planc_ucx_config_t, estimated_num_ppn),
      UCG_CONFIG_TYPE_UINT},
 
+    {"STAGING_POOL_SIZE", "64m",
+     "Maximum memory of the staging buffers cached for reuse by collective operations, "
+     "0 disables the cache",
+     ucg_offsetof(ucg_planc_ucx_config_t, staging_pool_size),
+     UCG_CONFIG_TYPE_MEMUNITS},
+
     {"USE_OOB", "try",
      "The value can be \n"
      " - yes  : Forcibly use oob. If the oob does not exist, a failure will occur. \n"
@@ -70,6 +88,23 @@ static ucg_config_field_t ucg_planc_ucx_config_table[] = {
      ucg_offsetof(ucg_planc_ucx_config_t, planm),
      UCG_CONFIG_TYPE_STRING_ARRAY},
 
+    {"USE_WAKEUP", "y",
+     "Request the event notification of the ucp worker, which lets ucg_request_wait()\n"
+     "sleep instead of busy polling. It's not used with the oob ucp resources",
+     ucg_offsetof(ucg_planc_ucx_config_t, use_wakeup),
+     UCG_CONFIG_TYPE_BOOL},
+
+    {"WIREUP", "none",
+     "Endpoints created and flushed in parallel when a group is created, so that the\n"
+     "first collective operations don't wait for the connection establishment.\n"
+     "The others are created on first use\n"
+     " - none       : create all endpoints on first use\n"
+     " - plan_peers : the peers of the builtin plans registered in the group, with\n"
+     "                the peers of every root for the rooted collectives\n"
+     " - all        : all members of the group",
+     ucg_offsetof(ucg_planc_ucx_config_t, wireup),
+     UCG_CONFIG_TYPE_ENUM(ucg_planc_ucx_wireup_names)},
+
     {NULL}
 };
 UCG_CONFIG_REGISTER_TABLE(ucg_planc_ucx_config_table, "UCG PlanC UCX", PLANC_UCX_CONFIG_PREFIX,
@@ -295,6 +330,22 @@ err_free_cfg:
     return status;
 }
 
+/* The smaller the context is, the more bits of the tag are left to the op seq. */
+static ucg_status_t ucg_planc_ucx_context_init_tag(ucg_planc_ucx_context_t *ctx)
+{
+    uint32_t size = ctx->ucg_context->oob_group.size;
+    ctx->tag_rank_bits = ucg_ilog2(size - 1) + 1;
+    if (ctx->tag_rank_bits > UCG_PLANC_UCX_MAX_RANK_BITS) {
+        ucg_error("Too many processes(%u), at most %lu are supported", size,
+                  UCG_BIT(UCG_PLANC_UCX_MAX_RANK_BITS));
+        return UCG_ERR_UNSUPPORTED;
+    }
+    ctx->tag_seq_bits = 64 - ctx->tag_rank_bits - UCG_PLANC_UCX_GROUP_BITS;
+    ucg_debug("tag bits: op seq %u, rank %u, group id %u", ctx->tag_seq_bits,
+              ctx->tag_rank_bits, UCG_PLANC_UCX_GROUP_BITS);
+    return UCG_OK;
+}
+
 static ucg_status_t ucg_planc_ucx_context_init_ucp_context(ucg_planc_ucx_context_t *ctx)
 {
     ucs_status_t ucs_status;
@@ -311,13 +362,14 @@ static ucg_status_t ucg_planc_ucx_context_init_ucp_context(ucg_planc_ucx_context
     ucp_params.field_mask = UCP_PARAM_FIELD_FEATURES |
                             UCP_PARAM_FIELD_TAG_SENDER_MASK |
                             UCP_PARAM_FIELD_REQUEST_SIZE |
-                            UCP_PARAM_FIELD_REQUEST_INIT |
                             UCP_PARAM_FIELD_ESTIMATED_NUM_EPS |
                             UCP_PARAM_FIELD_ESTIMATED_NUM_PPN;
     ucp_params.features = UCP_FEATURE_TAG;
-    ucp_params.tag_sender_mask = UCG_PLANC_UCX_TAG_SENDER_MASK;
+    if (ctx->config.use_wakeup) {
+        ucp_params.features |= UCP_FEATURE_WAKEUP;
+    }
+    ucp_params.tag_sender_mask = UCG_PLANC_UCX_TAG_SENDER_MASK(ctx->tag_rank_bits);
     ucp_params.request_size = sizeof(ucg_planc_ucx_p2p_req_t);
-    ucp_params.request_init = ucg_planc_ucx_p2p_req_init;
     ucp_params.estimated_num_eps = ctx->ucg_context->oob_group.size;
     ucp_params.estimated_num_ppn = ctx->ucg_context->oob_group.num_local_procs;
     if (ctx->config.estimated_num_eps > 0) {
@@ -340,14 +392,17 @@ err:
     return ucg_status_s2g(ucs_status);
 }
 
-static ucg_status_t ucg_planc_ucx_context_init_ucp_worker(ucg_planc_ucx_context_t *ctx)
+static ucg_status_t ucg_planc_ucx_context_init_ucp_worker(ucg_planc_ucx_context_t *ctx,
+                                                           ucg_thread_mode_t thread_mode)
 {
     ucs_status_t ucs_status;
     ucp_worker_params_t worker_params;
+    ucp_worker_attr_t worker_attr;
     ucp_worker_h ucp_worker;
 
     worker_params.field_mask = UCP_WORKER_PARAM_FIELD_THREAD_MODE;
-    worker_params.thread_mode = UCS_THREAD_MODE_SINGLE;
+    worker_params.thread_mode = (thread_mode == UCG_THREAD_MODE_MULTI) ?
+                                UCS_THREAD_MODE_MULTI : UCS_THREAD_MODE_SINGLE;
 
     ucs_status = ucp_worker_create(ctx->ucp_context, &worker_params, &ucp_worker);
     if (ucs_status != UCS_OK) {
@@ -355,6 +410,27 @@ static ucg_status_t ucg_planc_ucx_context_init_ucp_worker(ucg_planc_ucx_context_
         goto err;
     }
 
+    /* UCX built without multi-thread support may give a lower thread mode. */
+    worker_attr.field_mask = UCP_WORKER_ATTR_FIELD_THREAD_MODE;
+    ucs_status = ucp_worker_query(ucp_worker, &worker_attr);
+    if (ucs_status != UCS_OK) {
+        ucg_error("Failed to query ucp worker, %s", ucs_status_string(ucs_status));
+        ucp_worker_destroy(ucp_worker);
+        goto err;
+    }
+    ctx->thread_mode = (worker_attr.thread_mode == UCS_THREAD_MODE_MULTI) ?
+                       UCG_THREAD_MODE_MULTI : UCG_THREAD_MODE_SINGLE;
+
+    if (ctx->config.use_wakeup) {
+        ucs_status = ucp_worker_get_efd(ucp_worker, &ctx->efd);
+        if (ucs_status != UCS_OK) {
+            /* Not fatal, ucg_request_wait() keeps busy polling. */
+            ucg_info("Failed to get ucp worker efd, %s", ucs_status_string(ucs_status));
+            ctx->efd = -1;
+            ucs_status = UCS_OK;
+        }
+    }
+
     ctx->ucp_worker = ucp_worker;
     ctx->worker_address = NULL;
 
@@ -395,6 +471,12 @@ ucg_status_t ucg_planc_ucx_context_init(const ucg_planc_params_t *params,
     }
 
     ctx->ucg_context = params->context;
+    ctx->efd = -1;
+
+    status = ucg_planc_ucx_context_init_tag(ctx);
+    if (status != UCG_OK) {
+        goto err_free_ctx;
+    }
 
     status = ucg_planc_ucx_context_fill_config(ctx, cfg);
     if (status != UCG_OK) {
@@ -431,9 +513,15 @@ ucg_status_t ucg_planc_ucx_context_init(const ucg_planc_params_t *params,
         max_op_size = (planm->op_size > max_op_size) ? planm->op_size : max_op_size;
     }
 
-    status = ucg_mpool_init(&ctx->op_mp, 0, max_op_size,
-                            0, UCG_CACHE_LINE_SIZE, UCG_ELEMS_PER_CHUNK,
-                            UINT_MAX, NULL, "planc ucx op mpool");
+    if (params->thread_mode == UCG_THREAD_MODE_MULTI) {
+        status = ucg_mpool_init_mt(&ctx->op_mp, 0, max_op_size,
+                                   0, UCG_CACHE_LINE_SIZE, UCG_ELEMS_PER_CHUNK,
+                                   UINT_MAX, NULL, "planc ucx op mpool");
+    } else {
+        status = ucg_mpool_init(&ctx->op_mp, 0, max_op_size,
+                                0, UCG_CACHE_LINE_SIZE, UCG_ELEMS_PER_CHUNK,
+                                UINT_MAX, NULL, "planc ucx op mpool");
+    }
     if (status != UCG_OK) {
         ucg_error("Failed to create mpool");
         goto err_free_planm_rscs;
@@ -460,7 +548,7 @@ ucg_status_t ucg_planc_ucx_context_init(const ucg_planc_params_t *params,
             goto err_free_mpool;
         }
 
-        status = ucg_planc_ucx_context_init_ucp_worker(ctx);
+        status = ucg_planc_ucx_context_init_ucp_worker(ctx, params->thread_mode);
         if (status != UCG_OK) {
             goto err_cleanup_context;
         }
@@ -474,9 +562,34 @@ ucg_status_t ucg_planc_ucx_context_init(const ucg_planc_params_t *params,
         }
     }
 
+    ucg_lock_type_t lock_type = UCG_LOCK_TYPE_NONE;
+    if (params->thread_mode == UCG_THREAD_MODE_MULTI) {
+        lock_type = UCG_LOCK_TYPE_SPINLOCK;
+    }
+    status = ucg_lock_init(&ctx->eps_lock, lock_type);
+    if (status != UCG_OK) {
+        goto err_free_eps;
+    }
+
+    /* The UCP context of OOB is not available, the buffers are not registered then. */
+    status = ucg_planc_ucx_staging_pool_init(&ctx->staging_pool, ctx->ucp_context,
+                                             ctx->config.staging_pool_size,
+                                             params->thread_mode);
+    if (status != UCG_OK) {
+        ucg_error("Failed to init staging pool");
+        goto err_destroy_eps_lock;
+    }
+
     *context = (ucg_planc_context_h)ctx;
     return UCG_OK;
 
+err_destroy_eps_lock:
+    ucg_lock_destroy(&ctx->eps_lock);
+err_free_eps:
+    ucg_free(ctx->eps);
+    if (ctx->config.use_oob != UCG_NO) {
+        goto err_free_mpool;
+    }
 err_destroy_worker:
     ucp_worker_destroy(ctx->ucp_worker);
 err_cleanup_context:
@@ -503,6 +616,8 @@ void ucg_planc_ucx_context_cleanup(ucg_planc_context_h context)
     }
     ucg_free(ctx->planm_rscs);
     ucg_mpool_cleanup(&ctx->op_mp, 1);
+    ucg_planc_ucx_staging_pool_cleanup(&ctx->staging_pool);
+    ucg_lock_destroy(&ctx->eps_lock);
     ucg_free(ctx->eps);
 
     if (ctx->config.use_oob == UCG_NO) {
@@ -524,6 +639,14 @@ ucg_status_t ucg_planc_ucx_context_query(ucg_planc_context_h context,
     ucs_status_t ucs_status = UCS_OK;
     ucg_planc_ucx_context_t *ctx = (ucg_planc_ucx_context_t *)context;
 
+    if (attr->field_mask & UCG_PLANC_CONTEXT_ATTR_FIELD_THREAD_MODE) {
+        attr->thread_mode = ctx->thread_mode;
+    }
+
+    if (attr->field_mask & UCG_PLANC_CONTEXT_ATTR_FIELD_REQ_ID_BITS) {
+        attr->req_id_bits = ucg_min(ctx->tag_seq_bits, 32u);
+    }
+
     if (ctx->config.use_oob == UCG_YES) {
         if (attr->field_mask & UCG_PLANC_CONTEXT_ATTR_FIELD_ADDR_LEN) {
             attr->addr_len = 0;
@@ -552,4 +675,28 @@ ucg_status_t ucg_planc_ucx_context_query(ucg_planc_context_h context,
 
 out:
     return ucg_status_s2g(ucs_status);
-}
\ No newline at end of file
+}
+int ucg_planc_ucx_context_progress(ucg_planc_context_h context)
+{
+    ucg_planc_ucx_context_t *ctx = (ucg_planc_ucx_context_t *)context;
+    return ucp_worker_progress(ctx->ucp_worker);
+}
+
+ucg_status_t ucg_planc_ucx_context_arm(ucg_planc_context_h context, int *fd)
+{
+    ucg_planc_ucx_context_t *ctx = (ucg_planc_ucx_context_t *)context;
+    if (ctx->efd < 0) {
+        return UCG_ERR_UNSUPPORTED;
+    }
+
+    ucs_status_t ucs_status = ucp_worker_arm(ctx->ucp_worker);
+    if (ucs_status == UCS_ERR_BUSY) {
+        return UCG_INPROGRESS;
+    }
+    if (ucs_status != UCS_OK) {
+        ucg_error("Failed to arm ucp worker, %s", ucs_status_string(ucs_status));
+        return ucg_status_s2g(ucs_status);
+    }
+    *fd = ctx->efd;
+    return UCG_OK;
+}
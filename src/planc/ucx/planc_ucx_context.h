@@ -14,6 +14,7 @@
 #include "core/ucg_context.h"
 #include "core/ucg_request.h"
 #include "util/ucg_mpool.h"
+#include "planc_ucx_staging.h"
 
 typedef enum {
     UCX_BUILTIN,
@@ -21,6 +22,17 @@ typedef enum {
     UCX_MODULE_LAST,
 } ucx_module_type_t;
 
+/** Endpoints created when the group is created, others are created on first use. */
+typedef enum {
+    UCG_PLANC_UCX_WIREUP_NONE, /**< No endpoint. */
+    UCG_PLANC_UCX_WIREUP_PLAN_PEERS, /**< Endpoints to the peers of the builtin plans
+                                          registered in the group. */
+    UCG_PLANC_UCX_WIREUP_ALL, /**< Endpoints to all members. */
+    UCG_PLANC_UCX_WIREUP_LAST,
+} ucg_planc_ucx_wireup_t;
+
+extern const char *ucg_planc_ucx_wireup_names[];
+
 typedef struct ucg_planc_ucx_config_bundle {
     ucg_config_field_t *table;
     char data[];
@@ -35,8 +47,11 @@ typedef struct ucg_planc_ucx_config {
     int n_polls;
     int estimated_num_eps;
     int estimated_num_ppn;
+    size_t staging_pool_size;
     ucg_ternary_auto_value_t use_oob;
     ucg_config_names_array_t planm;
+    int use_wakeup;
+    ucg_planc_ucx_wireup_t wireup;
 } ucg_planc_ucx_config_t;
 
 typedef struct ucg_planc_ucx_resource_planm {
@@ -55,9 +70,20 @@ typedef struct ucg_planc_ucx_context {
 
     /* The length of the eps array is determined by @ref ucg_oob_group_t::size */
     ucp_ep_h *eps;
+    /* protect the creation of eps */
+    ucg_lock_t eps_lock;
+    /* thread mode that the worker supports */
+    ucg_thread_mode_t thread_mode;
+    /* event fd of the worker, -1 if the events can not be notified */
+    int efd;
+    /* bits of the source rank and the op seq in the tag */
+    uint32_t tag_rank_bits;
+    uint32_t tag_seq_bits;
 
     /* pool of @ref ucg_planc_ucx_op_t */
     ucg_mpool_t op_mp;
+    /* pool of @ref ucg_planc_ucx_op_t::staging_area */
+    ucg_planc_ucx_staging_pool_t staging_pool;
 
     int32_t num_planm_rscs;
     ucg_planc_ucx_resource_planm_t *planm_rscs;
@@ -84,5 +110,7 @@ ucg_status_t ucg_planc_ucx_context_init(const ucg_planc_params_t *params,
 void ucg_planc_ucx_context_cleanup(ucg_planc_context_h context);
 ucg_status_t ucg_planc_ucx_context_query(ucg_planc_context_h context,
                                          ucg_planc_context_attr_t *attr);
+int ucg_planc_ucx_context_progress(ucg_planc_context_h context);
+ucg_status_t ucg_planc_ucx_context_arm(ucg_planc_context_h context, int *fd);
 
 #endif
\ No newline at end of file
@@ -63,11 +63,14 @@ ucg_planc_ucx_t UCG_PLANC_OBJNAME(ucx) = {
     .super.context_init     = ucg_planc_ucx_context_init,
     .super.context_cleanup  = ucg_planc_ucx_context_cleanup,
     .super.context_query    = ucg_planc_ucx_context_query,
+    .super.context_progress = ucg_planc_ucx_context_progress,
+    .super.context_arm      = ucg_planc_ucx_context_arm,
 
     .super.group_create     = ucg_planc_ucx_group_create,
     .super.group_destroy    = ucg_planc_ucx_group_destroy,
 
     .super.get_plans        = ucg_planc_ucx_get_plans,
+    .super.get_plans_tag    = ucg_planc_ucx_get_plans_tag,
 };
 
 ucg_planc_ucx_t *ucg_planc_ucx_instance()
@@ -4,6 +4,7 @@
 
 #include "planc_ucx_group.h"
 #include "planc_ucx_global.h"
+#include "planc_ucx_wireup.h"
 #include "util/ucg_malloc.h"
 #include "util/ucg_helper.h"
 #include "util/ucg_log.h"
@@ -18,6 +19,14 @@ ucg_status_t ucg_planc_ucx_group_create(ucg_planc_context_h context,
 
     ucg_status_t status;
     ucg_planc_ucx_group_t *ucx_group;
+    ucg_planc_ucx_context_t *ctx = (ucg_planc_ucx_context_t *)context;
+
+    /* The tag has no room for the larger ranks. */
+    if (params->group->size > UCG_BIT(ctx->tag_rank_bits)) {
+        ucg_error("Group size %u exceeds the %u rank bits of the tag",
+                  params->group->size, ctx->tag_rank_bits);
+        return UCG_ERR_UNSUPPORTED;
+    }
 
     ucx_group = ucg_calloc(1, sizeof(ucg_planc_ucx_group_t), "ucg planc ucx group");
     if (ucx_group == NULL) {
@@ -30,13 +39,18 @@ ucg_status_t ucg_planc_ucx_group_create(ucg_planc_context_h context,
         goto err_free_ucx_group;
     }
 
-    ucx_group->context = (ucg_planc_ucx_context_t *)context;
+    ucx_group->context = ctx;
     for (int i = 0; i < UCG_ALGO_GROUP_TYPE_LAST; ++i) {
         ucx_group->groups[i].super.myrank = UCG_INVALID_RANK;
         ucx_group->groups[i].super.group = params->group;
         ucx_group->groups[i].state = UCG_ALGO_GROUP_STATE_NOT_INIT;
     }
 
+    /* The endpoints that are not wired up are created on first use. */
+    if (ucg_planc_ucx_group_wireup(ucx_group) != UCG_OK) {
+        ucg_warn("Failed to wire up ucx group, fall back to on-demand connection");
+    }
+
     *planc_group = (ucg_planc_group_h)ucx_group;
     return UCG_OK;
 
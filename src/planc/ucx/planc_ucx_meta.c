@@ -4,6 +4,7 @@
 
 #include "planc_ucx_meta.h"
 #include "planc_ucx_p2p.h"
+#include "core/ucg_context.h"
 #include "util/ucg_log.h"
 
 static ucg_status_t ucg_planc_ucx_empty_op_trigger(ucg_plan_op_t *ucg_op)
@@ -68,4 +69,34 @@ ucg_status_t ucg_planc_ucx_add_empty_op(ucg_plan_meta_op_t *meta_op,
         return UCG_ERR_NO_MEMORY;
     }
     return ucg_plan_meta_op_add(meta_op, &ucx_op->super);
+}
+
+ucg_status_t ucg_planc_ucx_add_node_op(ucg_plan_meta_op_t *meta_op,
+                                       ucg_planc_ucx_group_t *ucx_group,
+                                       const ucg_coll_args_t *args)
+{
+    ucg_group_t *group = ucx_group->super.super.group;
+    ucg_resource_planc_t *planc_rscs = group->context->planc_rscs;
+    for (int i = 0; i < group->num_planc_groups; ++i) {
+        ucg_planc_t *planc = planc_rscs[i].planc;
+        if (planc->node_op_prepare == NULL) {
+            continue;
+        }
+
+        ucg_plan_op_t *op = NULL;
+        ucg_status_t status = planc->node_op_prepare(group->planc_groups[i], args, &op);
+        if (status == UCG_ERR_UNSUPPORTED) {
+            continue;
+        }
+        if (status != UCG_OK) {
+            return status;
+        }
+
+        status = ucg_plan_meta_op_add(meta_op, op);
+        if (status != UCG_OK) {
+            op->discard(op);
+        }
+        return status;
+    }
+    return UCG_ERR_UNSUPPORTED;
 }
\ No newline at end of file
@@ -12,4 +12,18 @@ ucg_status_t ucg_planc_ucx_add_empty_op(ucg_plan_meta_op_t *meta_op,
                                         ucg_planc_ucx_group_t *ucx_group,
                                         ucg_vgroup_t *vgroup);
 
+/**
+ * @brief Add the operation among the processes of my node.
+ *
+ * The operation is provided by the first PlanC that implements it for the
+ * node, e.g. through shared memory. The ranks in args are node-local ranks,
+ * i.e. ranks of the @ref UCG_TOPO_GROUP_TYPE_NODE topo group.
+ *
+ * @retval UCG_ERR_UNSUPPORTED No PlanC supports the operation, use the
+ *                             algorithms of PlanC UCX instead.
+ */
+ucg_status_t ucg_planc_ucx_add_node_op(ucg_plan_meta_op_t *meta_op,
+                                       ucg_planc_ucx_group_t *ucx_group,
+                                       const ucg_coll_args_t *args);
+
 #endif
\ No newline at end of file
@@ -14,13 +14,16 @@
 #include "util/ucg_malloc.h"
 #include "util/ucg_log.h"
 #include "util/ucg_helper.h"
+#include "util/ucg_atomic.h"
 
-static ucp_tag_t ucg_planc_ucx_make_tag(uint16_t tag, ucg_rank_t rank,
-                                        uint32_t group_id)
+static ucp_tag_t ucg_planc_ucx_make_tag(const ucg_planc_ucx_context_t *ctx, uint32_t tag,
+                                        ucg_rank_t rank, uint32_t group_id)
 {
-    return ((((uint64_t)(tag)) << UCG_PLANC_UCX_SEQ_BITS_OFFSET) |
+    uint32_t seq_offset = ctx->tag_rank_bits + UCG_PLANC_UCX_GROUP_BITS;
+    return ((((uint64_t)(tag)) << seq_offset) |
             (((uint64_t)(rank)) << UCG_PLANC_UCX_RANK_BITS_OFFSET) |
-            (((uint64_t)(group_id)) << UCG_PLANC_UCX_ID_BITS_OFFSET));
+            ((((uint64_t)(group_id)) & UCG_MASK(UCG_PLANC_UCX_GROUP_BITS)) <<
+             UCG_PLANC_UCX_ID_BITS_OFFSET));
 }
 
 static void* ucg_planc_ucx_p2p_start_pack(void *context, const void *buffer,
@@ -120,68 +123,172 @@ static ucp_ep_h ucg_planc_ucx_p2p_get_ucp_ep(ucg_vgroup_t *vgroup, ucg_rank_t vr
     ucg_planc_ucx_context_t *ucx_context = ucx_group->context;
 
     if (ucx_context->config.use_oob == UCG_YES) {
-        void* group = vgroup->group->oob_group.group;
-        return ucg_planc_ucx_get_oob_ucp_ep(group, group_rank);
+        /* The endpoints are looked up by the user's group, which derived groups come from. */
+        ucg_rank_t oob_rank;
+        void *group = ucg_group_get_root_oob_group(vgroup->group, group_rank, &oob_rank);
+        return ucg_planc_ucx_get_oob_ucp_ep(group, oob_rank);
     }
 
     if (ucx_context->eps[ctx_rank] != NULL) {
         return ucx_context->eps[ctx_rank];
     }
 
+    /* The groups of different threads may connect to the same process. */
+    ucg_lock_enter(&ucx_context->eps_lock);
+    ucp_ep_h ep = ucx_context->eps[ctx_rank];
+    if (ep != NULL) {
+        goto out;
+    }
+
     ucg_context_t *context = vgroup->group->context;
     ucg_planc_ucx_t *planc_ucx = ucg_planc_ucx_instance();
+    /* With lazy address, it's looked up in the OOB key-value store now. */
     void *ucp_addr = ucg_context_get_proc_addr(context, ctx_rank, &planc_ucx->super);
+    if (ucp_addr == NULL) {
+        ucg_error("Failed to get ucp address of rank %d", ctx_rank);
+        goto out;
+    }
     ucp_ep_params_t params = {
         .field_mask = UCP_EP_PARAM_FIELD_REMOTE_ADDRESS,
         .address = (ucp_address_t*)ucp_addr
     };
-    ucp_ep_h ep;
     ucs_status_t status = ucp_ep_create(ucx_context->ucp_worker, &params, &ep);
     if (status != UCS_OK) {
         ucg_error("Failed to create ucp ep, %s", ucs_status_string(status));
-        return NULL;
+        ep = NULL;
+        goto out;
     }
 
     ucx_context->eps[ctx_rank] = ep;
+out:
+    ucg_lock_leave(&ucx_context->eps_lock);
     return ep;
 }
 
-static void ucg_planc_ucx_p2p_isend_done(void *request, ucs_status_t status,
-                                         void *user_data)
+ucg_status_t ucg_planc_ucx_p2p_connect(ucg_planc_ucx_group_t *ucx_group,
+                                      ucg_vgroup_t *vgroup, const ucg_rank_t *vranks,
+                                      uint32_t count)
+{
+    if (count == 0) {
+        return UCG_OK;
+    }
+
+    ucs_status_ptr_t *ucp_reqs = ucg_calloc(count, sizeof(ucs_status_ptr_t), "ucx flush reqs");
+    if (ucp_reqs == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    /* Create all endpoints first, so that their wire-up messages overlap. */
+    ucg_status_t status = UCG_OK;
+    uint32_t i;
+    for (i = 0; i < count; ++i) {
+        ucp_ep_h ep = ucg_planc_ucx_p2p_get_ucp_ep(vgroup, vranks[i], ucx_group);
+        if (ep == NULL) {
+            status = UCG_ERR_NO_RESOURCE;
+            break;
+        }
+        ucp_request_param_t req_param = {
+            .op_attr_mask = 0,
+        };
+        ucs_status_ptr_t ucp_req = ucp_ep_flush_nbx(ep, &req_param);
+        if (UCS_PTR_IS_ERR(ucp_req)) {
+            ucg_error("Failed to flush ucp ep of rank %d, %s", vranks[i],
+                      ucs_status_string(UCS_PTR_STATUS(ucp_req)));
+            status = ucg_status_s2g(UCS_PTR_STATUS(ucp_req));
+            break;
+        }
+        ucp_reqs[i] = ucp_req;
+    }
+
+    /* The issued flushes must complete before their requests are released. */
+    ucp_worker_h ucp_worker = ucx_group->context->ucp_worker;
+    for (uint32_t j = 0; j < i; ++j) {
+        if (ucp_reqs[j] == NULL) {
+            continue;
+        }
+        ucs_status_t ucs_status;
+        while ((ucs_status = ucp_request_check_status(ucp_reqs[j])) == UCS_INPROGRESS) {
+            ucp_worker_progress(ucp_worker);
+        }
+        ucp_request_free(ucp_reqs[j]);
+        if (ucs_status != UCS_OK && status == UCG_OK) {
+            ucg_error("Failed to flush ucp ep of rank %d, %s", vranks[j],
+                      ucs_status_string(ucs_status));
+            status = ucg_status_s2g(ucs_status);
+        }
+    }
+    ucg_free(ucp_reqs);
+    return status;
+}
+
+/*
+ * Once the counter drops, another thread may complete the op and release it. The
+ * counter is dropped under the ready list lock, which the completion of the owner
+ * takes too, so the op is still alive when it wakes up the owner.
+ */
+static void ucg_planc_ucx_p2p_done(ucg_planc_ucx_p2p_state_t *state,
+                                   volatile uint32_t *inflight_cnt)
+{
+    ucg_request_t *request = state->request;
+    ucg_request_t *owner = (request != NULL) ? request->owner : NULL;
+    if (owner == NULL) {
+        ucg_atomic_sub32(inflight_cnt, 1);
+        return;
+    }
+
+    ucg_lock_t *lock = &owner->group->rlist_lock;
+    ucg_lock_enter(lock);
+    ucg_atomic_sub32(inflight_cnt, 1);
+    ucg_request_wakeup(request);
+    ucg_lock_leave(lock);
+    return;
+}
+
+static void ucg_planc_ucx_p2p_isend_done_keep(void *request, ucs_status_t status,
+                                              void *user_data)
 {
     ucg_planc_ucx_p2p_state_t *state = (ucg_planc_ucx_p2p_state_t*)user_data;
     if (status != UCS_OK) {
         ucg_error("Failed to send, %s", ucs_status_string(status));
         state->status = UCG_ERR_IO_ERROR;
     }
-    --state->inflight_send_cnt;
-    ucg_planc_ucx_p2p_req_t *req = (ucg_planc_ucx_p2p_req_t*)request;
-    if (req->free_in_cb) {
-        ucp_request_free(request);
-    }
+    ucg_planc_ucx_p2p_done(state, &state->inflight_send_cnt);
     return;
 }
 
-static void ucg_planc_ucx_p2p_irecv_done(void *request, ucs_status_t status,
-                                         const ucp_tag_recv_info_t *info,
+static void ucg_planc_ucx_p2p_isend_done(void *request, ucs_status_t status,
                                          void *user_data)
+{
+    ucg_planc_ucx_p2p_isend_done_keep(request, status, user_data);
+    ucp_request_free(request);
+    return;
+}
+
+static void ucg_planc_ucx_p2p_irecv_done_keep(void *request, ucs_status_t status,
+                                              const ucp_tag_recv_info_t *info,
+                                              void *user_data)
 {
     ucg_planc_ucx_p2p_state_t *state = (ucg_planc_ucx_p2p_state_t*)user_data;
     if (status != UCS_OK) {
         ucg_error("Failed to receive, %s", ucs_status_string(status));
         state->status = UCG_ERR_IO_ERROR;
     }
-    --state->inflight_recv_cnt;
-    ucg_planc_ucx_p2p_req_t *req = (ucg_planc_ucx_p2p_req_t*)request;
-    if (req->free_in_cb) {
-        ucp_request_free(request);
-    }
+    ucg_planc_ucx_p2p_done(state, &state->inflight_recv_cnt);
+    return;
+}
+
+static void ucg_planc_ucx_p2p_irecv_done(void *request, ucs_status_t status,
+                                         const ucp_tag_recv_info_t *info,
+                                         void *user_data)
+{
+    ucg_planc_ucx_p2p_irecv_done_keep(request, status, info, user_data);
+    ucp_request_free(request);
     return;
 }
 
 ucg_status_t ucg_planc_ucx_p2p_isend(const void *buffer, int32_t count,
                                      ucg_dt_t *dt, ucg_rank_t vrank,
-                                     uint16_t tag, ucg_vgroup_t *vgroup,
+                                     uint32_t tag, ucg_vgroup_t *vgroup,
                                      ucg_planc_ucx_p2p_params_t *params)
 {
     UCG_CHECK_NULL_INVALID(dt, vgroup, params, params->ucx_group, params->state);
@@ -203,32 +310,33 @@ ucg_status_t ucg_planc_ucx_p2p_isend(const void *buffer, int32_t count,
 
     ucg_planc_ucx_p2p_state_t *state = params->state;
     ucg_group_t *group = params->ucx_group->super.super.group;
-    uint64_t ucp_tag = ucg_planc_ucx_make_tag(tag, group->myrank, group->id);
+    uint64_t ucp_tag = ucg_planc_ucx_make_tag(params->ucx_group->context, tag,
+                                              group->myrank, group->id);
+    /* Always completed by the callback, which releases the ucp request unless the
+       caller keeps it. */
     ucp_request_param_t req_param = {
         .op_attr_mask = UCP_OP_ATTR_FIELD_CALLBACK |
                         UCP_OP_ATTR_FIELD_DATATYPE |
-                        UCP_OP_ATTR_FIELD_USER_DATA,
+                        UCP_OP_ATTR_FIELD_USER_DATA |
+                        UCP_OP_ATTR_FLAG_NO_IMM_CMPL,
         .datatype = ucp_dt,
-        .cb.send = ucg_planc_ucx_p2p_isend_done,
+        .cb.send = (params->request == NULL) ? ucg_planc_ucx_p2p_isend_done :
+                                               ucg_planc_ucx_p2p_isend_done_keep,
         .user_data = (void*)state,
     };
     ucg_debug("isend: %d to %d, tag 0x%lX, count %d, size %u, extent %u",
               group->myrank, ucg_rank_map_eval(&vgroup->rank_map, vrank),
               ucp_tag, count, ucg_dt_size(dt), ucg_dt_extent(dt));
+    /* The callback may be called by another thread before the send returns. */
+    ucg_atomic_add32(&state->inflight_send_cnt, 1);
     ucs_status_ptr_t ucp_req = ucp_tag_send_nbx(ep, buffer, count, ucp_tag, &req_param);
-    if (ucp_req == NULL || UCS_PTR_IS_ERR(ucp_req)) {
+    if (UCS_PTR_IS_ERR(ucp_req)) {
+        ucg_atomic_sub32(&state->inflight_send_cnt, 1);
         return ucg_status_s2g(UCS_PTR_STATUS(ucp_req));
     }
-    /* If another thread is executing ucp_worker_progress(), the following is
-       not thread-safe. */
 
-    /* Send is not finished. */
-    ((ucg_planc_ucx_p2p_req_t*)ucp_req)->free_in_cb = 1;
-    ++state->inflight_send_cnt;
     if (params->request != NULL) {
-        ucg_planc_ucx_p2p_req_t **req = params->request;
-        *req = (ucg_planc_ucx_p2p_req_t*)ucp_req;
-        (*req)->free_in_cb = 0;
+        *params->request = (ucg_planc_ucx_p2p_req_t*)ucp_req;
     }
     return UCG_OK;
 }
@@ -240,7 +348,7 @@ static ucp_worker_h ucg_planc_ucx_p2p_get_ucp_worker(ucg_planc_ucx_p2p_params_t
 
 ucg_status_t ucg_planc_ucx_p2p_irecv(void *buffer, int32_t count,
                                      ucg_dt_t *dt, ucg_rank_t vrank,
-                                     uint16_t tag, ucg_vgroup_t *vgroup,
+                                     uint32_t tag, ucg_vgroup_t *vgroup,
                                      ucg_planc_ucx_p2p_params_t *params)
 {
     UCG_CHECK_NULL_INVALID(dt, vgroup, params, params->ucx_group, params->state);
@@ -258,36 +366,33 @@ ucg_status_t ucg_planc_ucx_p2p_irecv(void *buffer, int32_t count,
     ucg_planc_ucx_p2p_state_t *state = params->state;
     ucg_rank_t sender_group_rank = ucg_rank_map_eval(&vgroup->rank_map, vrank);
     ucg_group_t *group = vgroup->group;
-    uint64_t ucp_tag = ucg_planc_ucx_make_tag(tag, sender_group_rank, group->id);
+    uint64_t ucp_tag = ucg_planc_ucx_make_tag(params->ucx_group->context, tag,
+                                              sender_group_rank, group->id);
     ucp_request_param_t req_param = {
         .op_attr_mask = UCP_OP_ATTR_FIELD_CALLBACK |
                         UCP_OP_ATTR_FIELD_DATATYPE |
-                        UCP_OP_ATTR_FIELD_USER_DATA,
+                        UCP_OP_ATTR_FIELD_USER_DATA |
+                        UCP_OP_ATTR_FLAG_NO_IMM_CMPL,
         .datatype = ucp_dt,
-        .cb.recv = ucg_planc_ucx_p2p_irecv_done,
+        .cb.recv = (params->request == NULL) ? ucg_planc_ucx_p2p_irecv_done :
+                                               ucg_planc_ucx_p2p_irecv_done_keep,
         .user_data = (void*)state,
     };
     ucg_debug("irecv: %d to %d, tag 0x%lX, count %d, size %u, extent %u",
               sender_group_rank, group->myrank, ucp_tag, count, ucg_dt_size(dt),
               ucg_dt_extent(dt));
     ucp_worker_h ucp_worker = ucg_planc_ucx_p2p_get_ucp_worker(params);
+    ucg_atomic_add32(&state->inflight_recv_cnt, 1);
     ucs_status_ptr_t ucp_req = ucp_tag_recv_nbx(ucp_worker, buffer, count, ucp_tag,
                                                 UCG_PLANC_UCX_TAG_MASK, &req_param);
-    if (ucp_req == NULL || UCS_PTR_IS_ERR(ucp_req)) {
+    if (UCS_PTR_IS_ERR(ucp_req)) {
+        ucg_atomic_sub32(&state->inflight_recv_cnt, 1);
         return ucg_status_s2g(UCS_PTR_STATUS(ucp_req));
     }
-    /* If another thread is executing ucp_worker_progress(), the following is
-       not thread-safe. */
 
-    /* Receive is not finished. */
-    ++state->inflight_recv_cnt;
-    ((ucg_planc_ucx_p2p_req_t*)ucp_req)->free_in_cb = 1;
     if (params->request != NULL) {
-        ucg_planc_ucx_p2p_req_t **req = params->request;
-        *req = (ucg_planc_ucx_p2p_req_t*)ucp_req;
-        (*req)->free_in_cb = 0;
+        *params->request = (ucg_planc_ucx_p2p_req_t*)ucp_req;
     }
-
     return UCG_OK;
 }
 
@@ -305,7 +410,7 @@ ucg_status_t ucg_planc_ucx_p2p_test(ucg_planc_ucx_group_t *ucx_group,
     while (polls++ < n_polls) {
         ucs_status_t status = ucp_request_check_status(*req);
         if (status != UCS_INPROGRESS) {
-            (*req)->free_in_cb = 1;
+            /* The callbacks of the kept requests don't touch them. */
             ucp_request_free(*req);
             *req = NULL;
             return ucg_status_s2g(status);
@@ -321,6 +426,11 @@ ucg_status_t ucg_planc_ucx_p2p_testall(ucg_planc_ucx_group_t *ucx_group,
     if (state->inflight_send_cnt == 0 && state->inflight_recv_cnt == 0) {
         return state->status;
     }
+    /* The worker is progressed once before the event-driven op is tested, and the
+       op is tested again when the next p2p request completes. */
+    if (state->request != NULL) {
+        return UCG_INPROGRESS;
+    }
 
     ucg_planc_ucx_context_t *context = ucx_group->context;
     ucp_worker_h ucp_worker = context->ucp_worker;
@@ -335,9 +445,3 @@ ucg_status_t ucg_planc_ucx_p2p_testall(ucg_planc_ucx_group_t *ucx_group,
     return UCG_INPROGRESS;
 }
 
-void ucg_planc_ucx_p2p_req_init(void *request)
-{
-    ucg_planc_ucx_p2p_req_t *req = (ucg_planc_ucx_p2p_req_t*)request;
-    req->free_in_cb = 1;
-    return;
-}
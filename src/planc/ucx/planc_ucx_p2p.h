@@ -9,6 +9,7 @@
 #include "planc_ucx_def.h"
 #include "core/ucg_dt.h"
 #include "core/ucg_vgroup.h"
+#include "core/ucg_request.h"
 
 #include <ucp/api/ucp.h>
 
@@ -24,34 +25,39 @@
 /**
  * UCG tag structure:
  *
- * 01234567 01234567 | 01234567 01234567 01234567 | 01234567 01234567 01234567
- *                   |                            |
- *     op seq (16)   |      source rank (24)      |        group id (24)
- *                   |                            |
+ * 01234567 01234567 ... | 01234567 ... | 01234567 01234567 01234567
+ *                       |              |
+ *   op seq (64 - R - 24)| src rank (R) |        group id (24)
+ *                       |              |
+ *
+ * R is the number of bits of the largest rank of the context, so the bits that
+ * small jobs don't need for the rank widen the op seq, which is the request id.
  */
-#define UCG_PLANC_UCX_SEQ_BITS 16
-#define UCG_PLANC_UCX_RANK_BITS 24
+#define UCG_PLANC_UCX_MAX_RANK_BITS 24
 #define UCG_PLANC_UCX_GROUP_BITS 24
 
-#define UCG_PLANC_UCX_SEQ_BITS_OFFSET   (UCG_PLANC_UCX_RANK_BITS + UCG_PLANC_UCX_GROUP_BITS)
 #define UCG_PLANC_UCX_RANK_BITS_OFFSET  (UCG_PLANC_UCX_GROUP_BITS)
 #define UCG_PLANC_UCX_ID_BITS_OFFSET    0
 
 #define UCG_PLANC_UCX_TAG_MASK          -1
 
-#define UCG_PLANC_UCX_TAG_SENDER_MASK   UCG_MASK(UCG_PLANC_UCX_RANK_BITS + UCG_PLANC_UCX_GROUP_BITS)
+#define UCG_PLANC_UCX_TAG_SENDER_MASK(_rank_bits) \
+    UCG_MASK((_rank_bits) + UCG_PLANC_UCX_GROUP_BITS)
 
 typedef struct ucg_planc_ucx_p2p_req {
     /* trade-off, sizeof(ompi_request_t)=160 */
     uint8_t prev[160];
-    int free_in_cb;
 } ucg_planc_ucx_p2p_req_t;
 
+/* The counters are counted before posting and dropped by the completion callbacks,
+   which may be called by any thread progressing the worker. */
 typedef struct ucg_planc_ucx_p2p_state {
     /** It's only going to be UCG_OK or UCG_ERR_IO_ERROR */
     ucg_status_t status;
-    int inflight_send_cnt;
-    int inflight_recv_cnt;
+    volatile uint32_t inflight_send_cnt;
+    volatile uint32_t inflight_recv_cnt;
+    /** Woken up when a p2p request completes, can be NULL. */
+    ucg_request_t *request;
 } ucg_planc_ucx_p2p_state_t;
 
 typedef struct ucg_planc_ucx_p2p_params {
@@ -59,7 +65,8 @@ typedef struct ucg_planc_ucx_p2p_params {
     ucg_planc_ucx_group_t *ucx_group;
     /** Recording isend/irecv state, can not be NULL. */
     ucg_planc_ucx_p2p_state_t *state;
-    /** Saving the pending p2p request, can be NULL. */
+    /** Saving the pending p2p request, can be NULL. The caller owns the saved
+        request and releases it by @ref ucg_planc_ucx_p2p_test. */
     ucg_planc_ucx_p2p_req_t **request;
 } ucg_planc_ucx_p2p_params_t;
 
@@ -78,7 +85,7 @@ typedef struct ucg_planc_ucx_p2p_params {
  */
 ucg_status_t ucg_planc_ucx_p2p_isend(const void *buffer, int32_t count,
                                      ucg_dt_t *dt, ucg_rank_t vrank,
-                                     uint16_t tag, ucg_vgroup_t *vgroup,
+                                     uint32_t tag, ucg_vgroup_t *vgroup,
                                      ucg_planc_ucx_p2p_params_t *params);
 
 /**
@@ -96,7 +103,7 @@ ucg_status_t ucg_planc_ucx_p2p_isend(const void *buffer, int32_t count,
  */
 ucg_status_t ucg_planc_ucx_p2p_irecv(void *buffer, int32_t count,
                                      ucg_dt_t *dt, ucg_rank_t vrank,
-                                     uint16_t tag, ucg_vgroup_t *vgroup,
+                                     uint32_t tag, ucg_vgroup_t *vgroup,
                                      ucg_planc_ucx_p2p_params_t *params);
 
 /**
@@ -119,6 +126,10 @@ ucg_status_t ucg_planc_ucx_p2p_test(ucg_planc_ucx_group_t *ucx_group,
 /**
  * @brief Check whether all p2p requests are done.
  *
+ * The worker is only progressed when the state has no request to wake up, the
+ * events of an event-driven op are delivered by @ref ucg_progress or
+ * @ref ucg_request_test before the op is tested.
+ *
  * @param [in] ucx_group        UCX group in which the p2p take places.
  * @param [in] state            Send/Receive state.
  * @retval UCG_INPROGRESS Some requests are in progress.
@@ -129,9 +140,19 @@ ucg_status_t ucg_planc_ucx_p2p_testall(ucg_planc_ucx_group_t *ucx_group,
                                        ucg_planc_ucx_p2p_state_t *state);
 
 /**
- * @brief Request initialization function registered with ucp
+ * @brief Create the endpoints of the peers and wait until they are connected.
+ *
+ * The endpoints are flushed together, so the wire-up of all peers takes about
+ * as long as the wire-up of one peer.
+ *
+ * @param [in] ucx_group        UCX group in which the peers are.
+ * @param [in] vgroup           Virtual group of the ranks.
+ * @param [in] vranks           Ranks of the peers in the vgroup.
+ * @param [in] count            Number of peers.
  */
-void ucg_planc_ucx_p2p_req_init(void *request);
+ucg_status_t ucg_planc_ucx_p2p_connect(ucg_planc_ucx_group_t *ucx_group,
+                                      ucg_vgroup_t *vgroup, const ucg_rank_t *vranks,
+                                      uint32_t count);
 
 static inline void ucg_planc_ucx_p2p_state_reset(ucg_planc_ucx_p2p_state_t *state)
 {
@@ -38,6 +38,9 @@ static ucg_status_t ucg_planc_ucx_get_default_plan_attr(ucg_vgroup_t *vgroup,
         case UCG_COLL_TYPE_BARRIER:
             ucg_planc_ucx_barrier_set_plan_attr(vgroup, default_plan_attr);
             break;
+        case UCG_COLL_TYPE_ALLTOALLV:
+            ucg_planc_ucx_alltoallv_set_plan_attr(vgroup, default_plan_attr);
+            break;
         case UCG_COLL_TYPE_SCATTERV:
             ucg_planc_ucx_scatterv_set_plan_attr(vgroup, default_plan_attr);
             break;
@@ -57,42 +60,56 @@ static ucg_status_t ucg_planc_ucx_get_default_plan_attr(ucg_vgroup_t *vgroup,
     return UCG_OK;
 }
 
+ucg_status_t ucg_planc_ucx_get_builtin_plan_attr(ucg_planc_ucx_group_t *ucx_group,
+                                                 ucg_coll_type_t coll_type,
+                                                 ucg_plan_attr_t *plan_attr)
+{
+    ucg_vgroup_t *vgroup = &ucx_group->super.super;
+    ucg_status_t status = ucg_planc_ucx_get_default_plan_attr(vgroup, coll_type, plan_attr);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    char *user_plan_attr = ucx_group->context->config.plan_attr[coll_type];
+    for (ucg_plan_attr_t *attr = plan_attr; !UCG_PLAN_ATTR_IS_LAST(attr); ++attr) {
+        attr->vgroup = vgroup;
+        /* apply user-configured attribute */
+        status = ucg_plan_attr_update(attr, user_plan_attr);
+        if (status != UCG_OK) {
+            ucg_warn("Failed to update plan attribute(%s), using default", user_plan_attr);
+        }
+    }
+    return UCG_OK;
+}
+
 static ucg_status_t ucg_planc_ucx_get_builtin_plans(ucg_planc_group_h planc_group, ucg_plans_t *plans)
 {
     UCG_CHECK_NULL_INVALID(planc_group, plans);
 
     ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(planc_group, ucg_planc_ucx_group_t);
-    ucg_vgroup_t *vgroup = &ucx_group->super.super;
-    ucg_planc_ucx_context_t *context = ucx_group->context;
 
     ucg_plan_params_t params;
     params.mem_type = UCG_MEM_TYPE_HOST;
 
     ucg_status_t status = UCG_OK;
     ucg_plan_attr_t *default_plan_attr = NULL;
-    const int32_t max_plan_num = 128;  // max algo num of all coll op, usually enough
-    default_plan_attr = ucg_malloc(max_plan_num * sizeof(ucg_plan_attr_t), "default plan attr");
+    default_plan_attr = ucg_malloc(UCG_PLANC_UCX_BUILTIN_PLAN_MAX * sizeof(ucg_plan_attr_t),
+                                   "default plan attr");
     if (default_plan_attr == NULL) {
         return UCG_ERR_NO_MEMORY;
     }
 
     ucg_coll_type_t coll_type = UCG_COLL_TYPE_BCAST;
     for (; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
-        ucg_status_t stat = ucg_planc_ucx_get_default_plan_attr(vgroup, coll_type, default_plan_attr);
+        ucg_status_t stat = ucg_planc_ucx_get_builtin_plan_attr(ucx_group, coll_type,
+                                                                default_plan_attr);
         if (stat != UCG_OK) {
             continue;
         }
 
         params.coll_type = coll_type;
-        char *user_plan_attr = context->config.plan_attr[coll_type];
         for (ucg_plan_attr_t *attr = default_plan_attr; !UCG_PLAN_ATTR_IS_LAST(attr); ++attr) {
             params.attr = *attr;
-            params.attr.vgroup = vgroup;
-            /* apply user-configured attribute */
-            status = ucg_plan_attr_update(&params.attr, user_plan_attr);
-            if (status != UCG_OK) {
-                ucg_warn("Failed to update plan attribute(%s), using default", user_plan_attr);
-            }
             /* add plan */
             status = ucg_plans_add(plans, &params);
             if (status != UCG_OK) {
@@ -130,4 +147,17 @@ ucg_status_t ucg_planc_ucx_get_plans(ucg_planc_group_h planc_group, ucg_plans_t
     }
 
     return status;
-}
\ No newline at end of file
+}
+ucg_status_t ucg_planc_ucx_get_plans_tag(ucg_planc_group_h planc_group, uint64_t *tag)
+{
+    UCG_CHECK_NULL_INVALID(planc_group, tag);
+
+    /* The builtin plans only depend on the shape of the group, the plans of the
+       planm modules may depend on more. */
+    ucg_planc_ucx_group_t *ucx_group = ucg_derived_of(planc_group, ucg_planc_ucx_group_t);
+    if (ucx_group->context->num_planm_rscs > 0) {
+        return UCG_ERR_UNSUPPORTED;
+    }
+    *tag = 0;
+    return UCG_OK;
+}
@@ -18,11 +18,15 @@
 #include "reduce/reduce.h"
 #include "scatterv/scatterv.h"
 #include "gatherv/gatherv.h"
+#include "alltoallv/alltoallv.h"
 
 #ifndef UCG_PLANC_UCX_DEFAULT_SCORE
     #define UCG_PLANC_UCX_DEFAULT_SCORE 90
 #endif
 
+/* Max number of the builtin plans of a coll type, usually enough */
+#define UCG_PLANC_UCX_BUILTIN_PLAN_MAX 128
+
 #define UCG_PLANC_UCX_BUILTIN_ALGO_REGISTER(_coll_type, _config, _size) \
     UCG_PLANC_UCX_ALGO_REGISTER(_coll_type, UCX_BUILTIN, _config, _size)
 
@@ -40,7 +44,7 @@ typedef struct ucg_planc_ucx_op {
     ucg_plan_op_t super;
     ucg_planc_ucx_group_t *ucx_group;
     ucg_planc_ucx_p2p_state_t p2p_state;
-    uint16_t tag;
+    uint32_t tag;
     /* Abstracted fields, the concrete op determines how to use these. */
     uint64_t flags;
     void *staging_area;
@@ -52,6 +56,7 @@ typedef struct ucg_planc_ucx_op {
         ucg_planc_ucx_allgatherv_t allgatherv;
         ucg_planc_ucx_reduce_t reduce;
         ucg_planc_ucx_scatterv_t scatterv;
+        ucg_planc_ucx_alltoallv_t alltoallv;
     };
 } ucg_planc_ucx_op_t;
 
@@ -73,13 +78,33 @@ typedef struct ucg_planc_ucx_algo_table {
 
 UCG_PLAN_ATTR_TABLE_DECLARE(ucg_planc_ucx);
 
-static inline ucg_status_t ucg_planc_ucx_op_discard(ucg_plan_op_t *ucg_op)
+/**
+ * @brief Get the staging area of the op from the staging pool of the context.
+ */
+static inline ucg_status_t ucg_planc_ucx_op_alloc_staging(ucg_planc_ucx_op_t *op, size_t size)
 {
-    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+    ucg_assert(op->staging_area == NULL);
+    op->staging_area = ucg_planc_ucx_staging_get(&op->ucx_group->context->staging_pool, size);
+    return op->staging_area == NULL ? UCG_ERR_NO_MEMORY : UCG_OK;
+}
 
+/**
+ * @brief Put the staging area of the op back to the staging pool.
+ */
+static inline void ucg_planc_ucx_op_free_staging(ucg_planc_ucx_op_t *op)
+{
     if (op->staging_area != NULL) {
-        ucg_free(op->staging_area);
+        ucg_planc_ucx_staging_put(&op->ucx_group->context->staging_pool, op->staging_area);
+        op->staging_area = NULL;
     }
+    return;
+}
+
+static inline ucg_status_t ucg_planc_ucx_op_discard(ucg_plan_op_t *ucg_op)
+{
+    ucg_planc_ucx_op_t *op = ucg_derived_of(ucg_op, ucg_planc_ucx_op_t);
+
+    ucg_planc_ucx_op_free_staging(op);
     UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
     ucg_mpool_put(op);
     return UCG_OK;
@@ -90,6 +115,9 @@ static inline void ucg_planc_ucx_op_init(ucg_planc_ucx_op_t *op,
 {
     op->ucx_group = ucx_group;
     ucg_planc_ucx_p2p_state_reset(&op->p2p_state);
+    /* All progress of the op is made by the completions of p2p requests. */
+    op->p2p_state.request = &op->super.super;
+    op->super.super.event_driven = 1;
     op->flags = 0;
     op->staging_area = NULL;
     return;
@@ -118,4 +146,17 @@ static inline void ucg_planc_ucx_op_set_p2p_params(ucg_planc_ucx_op_t *op,
 
 ucg_status_t ucg_planc_ucx_get_plans(ucg_planc_group_h planc_group, ucg_plans_t *plans);
 
+/**
+ * @brief Get the attributes of the builtin plans that the group registers.
+ *
+ * The user-configured attributes are applied, the deprecated plans are not
+ * registered. The array ends with {NULL} and holds UCG_PLANC_UCX_BUILTIN_PLAN_MAX
+ * attributes at most.
+ */
+ucg_status_t ucg_planc_ucx_get_builtin_plan_attr(ucg_planc_ucx_group_t *ucx_group,
+                                                 ucg_coll_type_t coll_type,
+                                                 ucg_plan_attr_t *plan_attr);
+
+ucg_status_t ucg_planc_ucx_get_plans_tag(ucg_planc_group_h planc_group, uint64_t *tag);
+
 #endif
\ No newline at end of file
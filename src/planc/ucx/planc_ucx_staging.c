@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include <ucp/api/ucp.h>
+
+#include "planc_ucx_staging.h"
+#include "util/ucg_cpu.h"
+#include "util/ucg_helper.h"
+#include "util/ucg_log.h"
+#include "util/ucg_malloc.h"
+
+/* The chunk header is put in front of the buffer and keeps it aligned. */
+#define UCG_PLANC_UCX_STAGING_HDR_SIZE UCG_CACHE_LINE_SIZE
+#define UCG_PLANC_UCX_STAGING_NO_CLASS -1
+
+struct ucg_planc_ucx_staging_chunk {
+    ucg_planc_ucx_staging_chunk_t *next;
+    /* NULL if the buffer is not registered. */
+    ucp_mem_h memh;
+    /* capacity of the buffer */
+    size_t size;
+    /* UCG_PLANC_UCX_STAGING_NO_CLASS if the chunk does not belong to the pool */
+    int class_idx;
+};
+
+static inline void *ucg_planc_ucx_staging_chunk_buffer(ucg_planc_ucx_staging_chunk_t *chunk)
+{
+    return (char *)chunk + UCG_PLANC_UCX_STAGING_HDR_SIZE;
+}
+
+static inline ucg_planc_ucx_staging_chunk_t *ucg_planc_ucx_staging_chunk_of(void *buffer)
+{
+    return (ucg_planc_ucx_staging_chunk_t *)((char *)buffer - UCG_PLANC_UCX_STAGING_HDR_SIZE);
+}
+
+static int ucg_planc_ucx_staging_class(size_t size)
+{
+    size_t class_size = 1ul << UCG_PLANC_UCX_STAGING_MIN_SHIFT;
+    for (int i = 0; i < UCG_PLANC_UCX_STAGING_CLASS_NUM; ++i) {
+        if (size <= class_size) {
+            return i;
+        }
+        class_size <<= 1;
+    }
+    return UCG_PLANC_UCX_STAGING_NO_CLASS;
+}
+
+static ucg_planc_ucx_staging_chunk_t *ucg_planc_ucx_staging_chunk_alloc(ucg_planc_ucx_staging_pool_t *pool,
+                                                                        size_t size, int class_idx)
+{
+    UCG_STATIC_ASSERT(sizeof(ucg_planc_ucx_staging_chunk_t) <= UCG_PLANC_UCX_STAGING_HDR_SIZE);
+
+    void *ptr = NULL;
+    int rc = ucg_posix_memalign(&ptr, UCG_CACHE_LINE_SIZE,
+                                UCG_PLANC_UCX_STAGING_HDR_SIZE + size,
+                                "planc ucx staging chunk");
+    if (rc != 0 || ptr == NULL) {
+        return NULL;
+    }
+
+    ucg_planc_ucx_staging_chunk_t *chunk = (ucg_planc_ucx_staging_chunk_t *)ptr;
+    chunk->next = NULL;
+    chunk->memh = NULL;
+    chunk->size = size;
+    chunk->class_idx = class_idx;
+    if (class_idx == UCG_PLANC_UCX_STAGING_NO_CLASS || pool->ucp_context == NULL) {
+        return chunk;
+    }
+
+    /* The buffer is still usable without registration, UCP registers it on demand. */
+    ucp_mem_map_params_t params;
+    params.field_mask = UCP_MEM_MAP_PARAM_FIELD_ADDRESS |
+                        UCP_MEM_MAP_PARAM_FIELD_LENGTH;
+    params.address = ucg_planc_ucx_staging_chunk_buffer(chunk);
+    params.length = size;
+    ucs_status_t ucs_status = ucp_mem_map(pool->ucp_context, &params, &chunk->memh);
+    if (ucs_status != UCS_OK) {
+        ucg_debug("Failed to register staging buffer of %zu bytes, %s",
+                  size, ucs_status_string(ucs_status));
+        chunk->memh = NULL;
+    }
+    return chunk;
+}
+
+static void ucg_planc_ucx_staging_chunk_free(ucg_planc_ucx_staging_pool_t *pool,
+                                             ucg_planc_ucx_staging_chunk_t *chunk)
+{
+    if (chunk->memh != NULL) {
+        ucp_mem_unmap(pool->ucp_context, chunk->memh);
+    }
+    ucg_free(chunk);
+    return;
+}
+
+/* Release the free chunks until the new chunk of size bytes fits in the cap. */
+static void ucg_planc_ucx_staging_pool_shrink(ucg_planc_ucx_staging_pool_t *pool, size_t size)
+{
+    for (int i = UCG_PLANC_UCX_STAGING_CLASS_NUM - 1; i >= 0; --i) {
+        while (pool->size + size > pool->max_size && pool->free_list[i] != NULL) {
+            ucg_planc_ucx_staging_chunk_t *chunk = pool->free_list[i];
+            pool->free_list[i] = chunk->next;
+            pool->size -= chunk->size;
+            ucg_planc_ucx_staging_chunk_free(pool, chunk);
+        }
+    }
+    return;
+}
+
+ucg_status_t ucg_planc_ucx_staging_pool_init(ucg_planc_ucx_staging_pool_t *pool,
+                                             ucp_context_h ucp_context,
+                                             size_t max_size,
+                                             ucg_thread_mode_t thread_mode)
+{
+    UCG_CHECK_NULL_INVALID(pool);
+
+    ucg_lock_type_t lock_type = UCG_LOCK_TYPE_NONE;
+    if (thread_mode == UCG_THREAD_MODE_MULTI) {
+        lock_type = UCG_LOCK_TYPE_SPINLOCK;
+    }
+    ucg_status_t status = ucg_lock_init(&pool->lock, lock_type);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    pool->ucp_context = ucp_context;
+    pool->max_size = max_size;
+    pool->size = 0;
+    for (int i = 0; i < UCG_PLANC_UCX_STAGING_CLASS_NUM; ++i) {
+        pool->free_list[i] = NULL;
+    }
+    pool->hits = 0;
+    pool->misses = 0;
+    return UCG_OK;
+}
+
+void ucg_planc_ucx_staging_pool_cleanup(ucg_planc_ucx_staging_pool_t *pool)
+{
+    UCG_CHECK_NULL_VOID(pool);
+
+    ucg_debug("staging pool: %lu hits, %lu misses, %zu bytes",
+              pool->hits, pool->misses, pool->size);
+    for (int i = 0; i < UCG_PLANC_UCX_STAGING_CLASS_NUM; ++i) {
+        while (pool->free_list[i] != NULL) {
+            ucg_planc_ucx_staging_chunk_t *chunk = pool->free_list[i];
+            pool->free_list[i] = chunk->next;
+            pool->size -= chunk->size;
+            ucg_planc_ucx_staging_chunk_free(pool, chunk);
+        }
+    }
+    if (pool->size != 0) {
+        ucg_warn("%zu bytes of staging buffers are not put back", pool->size);
+    }
+    ucg_lock_destroy(&pool->lock);
+    return;
+}
+
+void *ucg_planc_ucx_staging_get(ucg_planc_ucx_staging_pool_t *pool, size_t size)
+{
+    ucg_planc_ucx_staging_chunk_t *chunk = NULL;
+    int class_idx = ucg_planc_ucx_staging_class(size);
+
+    ucg_lock_enter(&pool->lock);
+    if (class_idx != UCG_PLANC_UCX_STAGING_NO_CLASS && pool->free_list[class_idx] != NULL) {
+        chunk = pool->free_list[class_idx];
+        pool->free_list[class_idx] = chunk->next;
+        ++pool->hits;
+        goto out;
+    }
+
+    ++pool->misses;
+    if (class_idx != UCG_PLANC_UCX_STAGING_NO_CLASS) {
+        size = 1ul << (UCG_PLANC_UCX_STAGING_MIN_SHIFT + class_idx);
+        if (pool->size + size > pool->max_size) {
+            ucg_planc_ucx_staging_pool_shrink(pool, size);
+        }
+        if (pool->size + size > pool->max_size) {
+            class_idx = UCG_PLANC_UCX_STAGING_NO_CLASS;
+        }
+    }
+    chunk = ucg_planc_ucx_staging_chunk_alloc(pool, size, class_idx);
+    if (chunk == NULL) {
+        goto out;
+    }
+    if (class_idx != UCG_PLANC_UCX_STAGING_NO_CLASS) {
+        pool->size += size;
+    }
+
+out:
+    ucg_lock_leave(&pool->lock);
+    return chunk == NULL ? NULL : ucg_planc_ucx_staging_chunk_buffer(chunk);
+}
+
+void ucg_planc_ucx_staging_put(ucg_planc_ucx_staging_pool_t *pool, void *buffer)
+{
+    if (buffer == NULL) {
+        return;
+    }
+
+    ucg_planc_ucx_staging_chunk_t *chunk = ucg_planc_ucx_staging_chunk_of(buffer);
+    if (chunk->class_idx == UCG_PLANC_UCX_STAGING_NO_CLASS) {
+        ucg_planc_ucx_staging_chunk_free(pool, chunk);
+        return;
+    }
+
+    ucg_assert(chunk->class_idx < UCG_PLANC_UCX_STAGING_CLASS_NUM);
+    ucg_lock_enter(&pool->lock);
+    chunk->next = pool->free_list[chunk->class_idx];
+    pool->free_list[chunk->class_idx] = chunk;
+    ucg_lock_leave(&pool->lock);
+    return;
+}
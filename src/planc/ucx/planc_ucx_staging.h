@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_UCX_STAGING_H_
+#define UCG_PLANC_UCX_STAGING_H_
+
+#include <ucp/api/ucp_def.h>
+
+#include "ucg/api/ucg.h"
+#include "util/ucg_lock.h"
+
+/* Size class i holds the buffers of (256 << i) bytes, i.e. 256B ... 1GB */
+#define UCG_PLANC_UCX_STAGING_MIN_SHIFT 8
+#define UCG_PLANC_UCX_STAGING_CLASS_NUM 23
+
+typedef struct ucg_planc_ucx_staging_chunk ucg_planc_ucx_staging_chunk_t;
+
+/**
+ * @brief Pool of staging buffers used by the plan ops.
+ *
+ * The buffers are grouped into power-of-two size classes and kept in the pool
+ * after use, so ops of the same size do not allocate memory again. The buffers
+ * are registered to UCP once when they are allocated, so that the transfers
+ * using them hit the registration cache.
+ */
+typedef struct ucg_planc_ucx_staging_pool {
+    /* NULL if the buffers are not registered. */
+    ucp_context_h ucp_context;
+    ucg_lock_t lock;
+    /* Maximum memory of the buffers held by the pool, 0 disables the pool. */
+    size_t max_size;
+    /* Memory of the buffers held by the pool, both free and in use. */
+    size_t size;
+    ucg_planc_ucx_staging_chunk_t *free_list[UCG_PLANC_UCX_STAGING_CLASS_NUM];
+    /* Statistics */
+    uint64_t hits;
+    uint64_t misses;
+} ucg_planc_ucx_staging_pool_t;
+
+/**
+ * @brief Initialize the staging buffer pool.
+ *
+ * @param [in] ucp_context      UCP context to register the buffers, can be NULL
+ * @param [in] max_size         Memory cap of the pool
+ * @param [in] thread_mode      Thread mode of the owner context
+ */
+ucg_status_t ucg_planc_ucx_staging_pool_init(ucg_planc_ucx_staging_pool_t *pool,
+                                             ucp_context_h ucp_context,
+                                             size_t max_size,
+                                             ucg_thread_mode_t thread_mode);
+
+/**
+ * @brief Release all the buffers of the pool.
+ *
+ * All the buffers got from the pool should be put back before.
+ */
+void ucg_planc_ucx_staging_pool_cleanup(ucg_planc_ucx_staging_pool_t *pool);
+
+/**
+ * @brief Get a buffer of at least size bytes.
+ *
+ * If the buffer is larger than the largest size class or the pool is full, a
+ * buffer out of the pool is allocated and it's released when put back.
+ *
+ * @return NULL if failed to allocate memory.
+ */
+void *ucg_planc_ucx_staging_get(ucg_planc_ucx_staging_pool_t *pool, size_t size);
+
+/**
+ * @brief Put the buffer back to the pool.
+ */
+void ucg_planc_ucx_staging_put(ucg_planc_ucx_staging_pool_t *pool, void *buffer);
+
+#endif
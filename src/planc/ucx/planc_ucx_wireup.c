@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "planc_ucx_wireup.h"
+#include "planc_ucx_plan.h"
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "util/algo/ucg_kntree.h"
+#include "util/algo/ucg_rd.h"
+#include "util/algo/ucg_rh.h"
+#include "util/algo/ucg_ring.h"
+#include "util/ucg_malloc.h"
+#include "util/ucg_log.h"
+
+static void ucg_planc_ucx_wireup_add_peer(uint8_t *peers, const ucg_vgroup_t *vgroup,
+                                          ucg_rank_t vrank)
+{
+    if (vrank == UCG_INVALID_RANK || vrank == vgroup->myrank) {
+        return;
+    }
+    peers[ucg_rank_map_eval(&vgroup->rank_map, vrank)] = 1;
+    return;
+}
+
+/* The topo group of the member, NULL if it's not in it. */
+static ucg_vgroup_t* ucg_planc_ucx_wireup_topo(ucg_planc_ucx_group_t *ucx_group,
+                                               ucg_topo_group_type_t type)
+{
+    ucg_topo_t *topo = ucx_group->super.super.group->topo;
+    ucg_topo_group_t *topo_group = ucg_topo_get_group(topo, type);
+    if (topo_group == NULL || topo_group->state != UCG_TOPO_GROUP_STATE_ENABLE ||
+        topo_group->super.myrank == UCG_INVALID_RANK) {
+        return NULL;
+    }
+    return &topo_group->super;
+}
+
+/* The trees of every root if rooted, the root is given by each request. */
+static void ucg_planc_ucx_wireup_add_kntree(uint8_t *peers, const ucg_vgroup_t *vgroup,
+                                            int degree, int rooted)
+{
+    if (vgroup == NULL || vgroup->size <= 1 || degree < 2) {
+        return;
+    }
+
+    int num_roots = rooted ? vgroup->size : 1;
+    for (ucg_rank_t root = 0; root < num_roots; ++root) {
+        for (int leftmost = 0; leftmost <= 1; ++leftmost) {
+            ucg_algo_kntree_iter_t kntree;
+            ucg_algo_kntree_iter_init(&kntree, vgroup->size, degree, root, vgroup->myrank,
+                                      leftmost);
+            ucg_planc_ucx_wireup_add_peer(peers, vgroup,
+                                          ucg_algo_kntree_iter_parent_value(&kntree));
+            for (ucg_rank_t child = ucg_algo_kntree_iter_child_value(&kntree);
+                 child != UCG_INVALID_RANK;
+                 ucg_algo_kntree_iter_child_inc(&kntree),
+                 child = ucg_algo_kntree_iter_child_value(&kntree)) {
+                ucg_planc_ucx_wireup_add_peer(peers, vgroup, child);
+            }
+        }
+    }
+    return;
+}
+
+static void ucg_planc_ucx_wireup_add_rd(uint8_t *peers, const ucg_vgroup_t *vgroup)
+{
+    if (vgroup == NULL || vgroup->size <= 1) {
+        return;
+    }
+
+    ucg_algo_rd_iter_t rd;
+    ucg_algo_rd_iter_init(&rd, vgroup->size, vgroup->myrank);
+    for (ucg_rank_t peer = ucg_algo_rd_iter_value(&rd); peer != UCG_INVALID_RANK;
+         ucg_algo_rd_iter_inc(&rd), peer = ucg_algo_rd_iter_value(&rd)) {
+        ucg_planc_ucx_wireup_add_peer(peers, vgroup, peer);
+    }
+    return;
+}
+
+static void ucg_planc_ucx_wireup_add_rh(uint8_t *peers, const ucg_vgroup_t *vgroup)
+{
+    if (vgroup == NULL || vgroup->size <= 1) {
+        return;
+    }
+
+    ucg_algo_rh_iterator_t rh;
+    ucg_rank_t peer;
+    ucg_algo_rh_iter_init(&rh, vgroup->size, vgroup->myrank);
+    ucg_algo_rh_get_extra(&rh, &peer);
+    ucg_planc_ucx_wireup_add_peer(peers, vgroup, peer);
+    ucg_algo_rh_get_proxy(&rh, &peer);
+    ucg_planc_ucx_wireup_add_peer(peers, vgroup, peer);
+    for (ucg_algo_rh_get_next_base(&rh, &peer); peer != UCG_INVALID_RANK;
+         ucg_algo_rh_get_next_base(&rh, &peer)) {
+        ucg_planc_ucx_wireup_add_peer(peers, vgroup, peer);
+    }
+    return;
+}
+
+static void ucg_planc_ucx_wireup_add_ring(uint8_t *peers, const ucg_vgroup_t *vgroup)
+{
+    if (vgroup == NULL || vgroup->size <= 1) {
+        return;
+    }
+
+    ucg_algo_ring_iter_t ring;
+    ucg_algo_ring_iter_init(&ring, vgroup->size, vgroup->myrank);
+    ucg_planc_ucx_wireup_add_peer(peers, vgroup, ucg_algo_ring_iter_left_value(&ring));
+    ucg_planc_ucx_wireup_add_peer(peers, vgroup, ucg_algo_ring_iter_right_value(&ring));
+    return;
+}
+
+static void ucg_planc_ucx_wireup_add_all(uint8_t *peers, const ucg_vgroup_t *vgroup)
+{
+    if (vgroup == NULL) {
+        return;
+    }
+
+    for (ucg_rank_t vrank = 0; vrank < vgroup->size; ++vrank) {
+        ucg_planc_ucx_wireup_add_peer(peers, vgroup, vrank);
+    }
+    return;
+}
+
+/* The root sends to rank 0 first, any member may be the root. */
+static void ucg_planc_ucx_wireup_add_root_adjust(uint8_t *peers, const ucg_vgroup_t *vgroup)
+{
+    if (vgroup->myrank == 0) {
+        ucg_planc_ucx_wireup_add_all(peers, vgroup);
+    } else {
+        ucg_planc_ucx_wireup_add_peer(peers, vgroup, 0);
+    }
+    return;
+}
+
+/* The tree is rooted at 0 if the root is adjusted, otherwise at the root of each request. */
+static void ucg_planc_ucx_wireup_add_bcast_kntree(uint8_t *peers, const ucg_vgroup_t *vgroup,
+                                                  int degree, uint8_t root_adjust)
+{
+    if (root_adjust) {
+        ucg_planc_ucx_wireup_add_root_adjust(peers, vgroup);
+    }
+    ucg_planc_ucx_wireup_add_kntree(peers, vgroup, degree, !root_adjust);
+    return;
+}
+
+/* The offset groups exchange the reduced parts of the rabenseifner plans. */
+static void ucg_planc_ucx_wireup_add_offset_group(uint8_t *peers,
+                                                  ucg_planc_ucx_group_t *ucx_group,
+                                                  ucg_planc_ucx_algo_group_type_t type)
+{
+    ucg_vgroup_t *vgroup = &ucx_group->super.super;
+    ucg_topo_t *topo = vgroup->group->topo;
+    /* The same conditions as the plans, they don't build the groups otherwise. */
+    if (topo->ppn == UCG_TOPO_PPX_UNBALANCED ||
+        (type == UCG_ALGO_GROUP_TYPE_SOCKET_LEADER && topo->pps == UCG_TOPO_PPX_UNBALANCED)) {
+        return;
+    }
+
+    ucg_status_t status = type == UCG_ALGO_GROUP_TYPE_NODE_LEADER ?
+                          ucg_planc_ucx_create_node_leader_algo_group(ucx_group, vgroup) :
+                          ucg_planc_ucx_create_socket_leader_algo_group(ucx_group, vgroup);
+    ucg_planc_ucx_algo_group_t *algo_group = &ucx_group->groups[type];
+    if (status == UCG_OK && algo_group->state == UCG_ALGO_GROUP_STATE_ENABLE) {
+        ucg_planc_ucx_wireup_add_rd(peers, &algo_group->super);
+    }
+    return;
+}
+
+/* Levels of the node-aware and socket-aware plans below the node leaders. */
+static const ucg_topo_group_type_t ucg_planc_ucx_wireup_na_levels[] = {
+    UCG_TOPO_GROUP_TYPE_NODE,
+};
+static const ucg_topo_group_type_t ucg_planc_ucx_wireup_sa_levels[] = {
+    UCG_TOPO_GROUP_TYPE_SOCKET,
+    UCG_TOPO_GROUP_TYPE_SOCKET_LEADER,
+};
+
+typedef struct ucg_planc_ucx_wireup_tree {
+    /* 1 for the socket-aware plan, 0 for the node-aware one */
+    int socket_aware;
+    int intra_degree;
+    /* degree of the trees among the node leaders, 0 for recursive doubling */
+    int inter_degree;
+} ucg_planc_ucx_wireup_tree_t;
+
+/* Fan in through the levels to the node leaders, which reduce, then fan out. */
+static void ucg_planc_ucx_wireup_add_tree(uint8_t *peers, ucg_planc_ucx_group_t *ucx_group,
+                                          const ucg_planc_ucx_wireup_tree_t *tree)
+{
+    const ucg_topo_group_type_t *levels = ucg_planc_ucx_wireup_na_levels;
+    int num_levels = sizeof(ucg_planc_ucx_wireup_na_levels) / sizeof(levels[0]);
+    if (tree->socket_aware) {
+        levels = ucg_planc_ucx_wireup_sa_levels;
+        num_levels = sizeof(ucg_planc_ucx_wireup_sa_levels) / sizeof(levels[0]);
+    }
+    for (int i = 0; i < num_levels; ++i) {
+        ucg_planc_ucx_wireup_add_kntree(peers, ucg_planc_ucx_wireup_topo(ucx_group, levels[i]),
+                                        tree->intra_degree, 0);
+    }
+
+    ucg_vgroup_t *leaders = ucg_planc_ucx_wireup_topo(ucx_group,
+                                                      UCG_TOPO_GROUP_TYPE_NODE_LEADER);
+    if (tree->inter_degree == 0) {
+        ucg_planc_ucx_wireup_add_rd(peers, leaders);
+    } else {
+        ucg_planc_ucx_wireup_add_kntree(peers, leaders, tree->inter_degree, 0);
+    }
+    return;
+}
+
+static void ucg_planc_ucx_wireup_bcast(uint8_t *peers, ucg_planc_ucx_group_t *ucx_group,
+                                       int32_t id)
+{
+    ucg_planc_ucx_bcast_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, bcast,
+                                                         UCG_COLL_TYPE_BCAST);
+    ucg_vgroup_t *vgroup = &ucx_group->super.super;
+    ucg_topo_group_type_t inter_type = UCG_TOPO_GROUP_TYPE_NODE_LEADER;
+    ucg_topo_group_type_t intra_type = UCG_TOPO_GROUP_TYPE_NODE;
+    int inter_degree = config->na_kntree_inter_degree;
+    int intra_degree = config->na_kntree_intra_degree;
+    switch (id) {
+        case 1:
+            ucg_planc_ucx_wireup_add_bcast_kntree(peers, vgroup, 2, config->root_adjust);
+            return;
+        case 2:
+            inter_degree = 2;
+            intra_degree = 2;
+            break;
+        case 3:
+            intra_degree = 2;
+            break;
+        case 4:
+            break;
+        case 6:
+            ucg_planc_ucx_wireup_add_ring(peers, vgroup);
+            return;
+        case 7:
+            inter_type = UCG_TOPO_GROUP_TYPE_SUBNET_LEADER;
+            intra_type = UCG_TOPO_GROUP_TYPE_SUBNET;
+            inter_degree = config->nta_kntree_inter_degree;
+            intra_degree = config->nta_kntree_intra_degree;
+            break;
+        case 8:
+            ucg_planc_ucx_wireup_add_kntree(peers, vgroup, 2, 1);
+            ucg_planc_ucx_wireup_add_ring(peers, vgroup);
+            return;
+        case 10:
+            ucg_planc_ucx_wireup_add_bcast_kntree(peers, vgroup, config->kntree_degree,
+                                                  config->root_adjust);
+            return;
+        default:
+            /* The in-network-computing plans send nothing through the endpoints. */
+            return;
+    }
+
+    /* The topo-aware plans always move the root to rank 0, the leader of the topo groups. */
+    ucg_planc_ucx_wireup_add_root_adjust(peers, vgroup);
+    ucg_planc_ucx_wireup_add_kntree(peers, ucg_planc_ucx_wireup_topo(ucx_group, inter_type),
+                                    inter_degree, 0);
+    ucg_planc_ucx_wireup_add_kntree(peers, ucg_planc_ucx_wireup_topo(ucx_group, intra_type),
+                                    intra_degree, 0);
+    return;
+}
+
+static void ucg_planc_ucx_wireup_allreduce(uint8_t *peers, ucg_planc_ucx_group_t *ucx_group,
+                                           int32_t id)
+{
+    ucg_planc_ucx_allreduce_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, allreduce,
+                                                         UCG_COLL_TYPE_ALLREDUCE);
+    ucg_vgroup_t *vgroup = &ucx_group->super.super;
+    /* The fanin and fanout trees are the same ones reversed, count both degrees. */
+    ucg_planc_ucx_wireup_tree_t trees[2] = {
+        {0, config->fanin_intra_degree, config->fanin_inter_degree},
+        {0, config->fanout_intra_degree, config->fanout_inter_degree},
+    };
+    int socket_aware = id == 3 || id == 6 || id == 8;
+    ucg_vgroup_t *topo_vgroup;
+    switch (id) {
+        case 1:
+            ucg_planc_ucx_wireup_add_rd(peers, vgroup);
+            return;
+        case 2:
+        case 3:
+            trees[0].intra_degree = trees[1].intra_degree = 2;
+            trees[0].inter_degree = trees[1].inter_degree = 0;
+            break;
+        case 4:
+            ucg_planc_ucx_wireup_add_ring(peers, vgroup);
+            return;
+        case 5:
+        case 6:
+            trees[0].inter_degree = trees[1].inter_degree = 0;
+            break;
+        case 7:
+        case 8:
+            break;
+        case 12:
+            ucg_planc_ucx_wireup_add_rh(peers, vgroup);
+            return;
+        case 13:
+            topo_vgroup = ucg_planc_ucx_wireup_topo(ucx_group, UCG_TOPO_GROUP_TYPE_NODE);
+            ucg_planc_ucx_wireup_add_rh(peers, topo_vgroup);
+            ucg_planc_ucx_wireup_add_offset_group(peers, ucx_group,
+                                                  UCG_ALGO_GROUP_TYPE_NODE_LEADER);
+            return;
+        case 14:
+            topo_vgroup = ucg_planc_ucx_wireup_topo(ucx_group, UCG_TOPO_GROUP_TYPE_SOCKET);
+            ucg_planc_ucx_wireup_add_rh(peers, topo_vgroup);
+            ucg_planc_ucx_wireup_add_offset_group(peers, ucx_group,
+                                                  UCG_ALGO_GROUP_TYPE_SOCKET_LEADER);
+            ucg_planc_ucx_wireup_add_offset_group(peers, ucx_group,
+                                                  UCG_ALGO_GROUP_TYPE_NODE_LEADER);
+            return;
+        case 15:
+            topo_vgroup = ucg_planc_ucx_wireup_topo(ucx_group, UCG_TOPO_GROUP_TYPE_SUBNET);
+            ucg_planc_ucx_wireup_add_kntree(peers, topo_vgroup,
+                                            config->nta_kntree_intra_degree, 0);
+            topo_vgroup = ucg_planc_ucx_wireup_topo(ucx_group, UCG_TOPO_GROUP_TYPE_SUBNET_LEADER);
+            ucg_planc_ucx_wireup_add_rd(peers, topo_vgroup);
+            return;
+        default:
+            /* The in-network-computing plans send nothing through the endpoints. */
+            return;
+    }
+
+    for (int i = 0; i < sizeof(trees) / sizeof(trees[0]); ++i) {
+        trees[i].socket_aware = socket_aware;
+        ucg_planc_ucx_wireup_add_tree(peers, ucx_group, &trees[i]);
+    }
+    return;
+}
+
+static void ucg_planc_ucx_wireup_barrier(uint8_t *peers, ucg_planc_ucx_group_t *ucx_group,
+                                         int32_t id)
+{
+    ucg_planc_ucx_barrier_config_t *config;
+    config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(ucx_group->context, barrier,
+                                                         UCG_COLL_TYPE_BARRIER);
+    ucg_planc_ucx_wireup_tree_t trees[2] = {
+        {0, config->fanin_intra_degree, config->fanin_inter_degree},
+        {0, config->fanout_intra_degree, config->fanout_inter_degree},
+    };
+    switch (id) {
+        case 1:
+            ucg_planc_ucx_wireup_add_rd(peers, &ucx_group->super.super);
+            return;
+        case 2:
+        case 3:
+            trees[0].intra_degree = trees[1].intra_degree = 2;
+            trees[0].inter_degree = trees[1].inter_degree = 0;
+            break;
+        case 4:
+        case 5:
+            trees[0].inter_degree = trees[1].inter_degree = 0;
+            break;
+        case 6:
+        case 7:
+            break;
+        default:
+            /* The in-network-computing plans send nothing through the endpoints. */
+            return;
+    }
+
+    for (int i = 0; i < sizeof(trees) / sizeof(trees[0]); ++i) {
+        /* The socket-aware plans have the odd ids except 1. */
+        trees[i].socket_aware = id % 2 == 1;
+        ucg_planc_ucx_wireup_add_tree(peers, ucx_group, &trees[i]);
+    }
+    return;
+}
+
+static void ucg_planc_ucx_wireup_add_plan(uint8_t *peers, ucg_planc_ucx_group_t *ucx_group,
+                                          ucg_coll_type_t coll_type, int32_t id)
+{
+    ucg_planc_ucx_context_t *context = ucx_group->context;
+    ucg_vgroup_t *vgroup = &ucx_group->super.super;
+    switch (coll_type) {
+        case UCG_COLL_TYPE_BCAST:
+            ucg_planc_ucx_wireup_bcast(peers, ucx_group, id);
+            break;
+        case UCG_COLL_TYPE_ALLREDUCE:
+            ucg_planc_ucx_wireup_allreduce(peers, ucx_group, id);
+            break;
+        case UCG_COLL_TYPE_BARRIER:
+            ucg_planc_ucx_wireup_barrier(peers, ucx_group, id);
+            break;
+        case UCG_COLL_TYPE_ALLTOALLV:
+            if (id == 3) {
+                /* Local exchange and the exchange of the node leaders. */
+                ucg_topo_group_type_t type = UCG_TOPO_GROUP_TYPE_NODE;
+                ucg_planc_ucx_wireup_add_all(peers, ucg_planc_ucx_wireup_topo(ucx_group, type));
+                type = UCG_TOPO_GROUP_TYPE_NODE_LEADER;
+                ucg_planc_ucx_wireup_add_all(peers, ucg_planc_ucx_wireup_topo(ucx_group, type));
+            } else {
+                ucg_planc_ucx_wireup_add_all(peers, vgroup);
+            }
+            break;
+        case UCG_COLL_TYPE_ALLGATHERV:
+            /* The neighbor exchange pairs with the left and right ones in turn. */
+            ucg_planc_ucx_wireup_add_ring(peers, vgroup);
+            break;
+        case UCG_COLL_TYPE_SCATTERV:
+            if (id == 2) {
+                ucg_planc_ucx_scatterv_config_t *config;
+                config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(context, scatterv,
+                                                                     UCG_COLL_TYPE_SCATTERV);
+                ucg_planc_ucx_wireup_add_kntree(peers, vgroup, config->kntree_degree, 1);
+            } else {
+                ucg_planc_ucx_wireup_add_all(peers, vgroup);
+            }
+            break;
+        case UCG_COLL_TYPE_GATHERV:
+            ucg_planc_ucx_wireup_add_all(peers, vgroup);
+            break;
+        case UCG_COLL_TYPE_REDUCE: {
+            ucg_planc_ucx_reduce_config_t *config;
+            config = UCG_PLANC_UCX_CONTEXT_BUILTIN_CONFIG_BUNDLE(context, reduce,
+                                                                 UCG_COLL_TYPE_REDUCE);
+            ucg_planc_ucx_wireup_add_kntree(peers, vgroup, config->kntree_degree, 1);
+            break;
+        }
+        default:
+            break;
+    }
+    return;
+}
+
+/*
+ * The union of the peers of the builtin plans registered in the group. The plans
+ * of the planm modules are connected on first use.
+ */
+static ucg_status_t ucg_planc_ucx_wireup_plan_peers(ucg_planc_ucx_group_t *ucx_group,
+                                                    uint8_t *peers)
+{
+    ucg_plan_attr_t *plan_attr = ucg_malloc(UCG_PLANC_UCX_BUILTIN_PLAN_MAX *
+                                            sizeof(ucg_plan_attr_t), "ucx wireup plan attr");
+    if (plan_attr == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    for (ucg_coll_type_t coll_type = 0; coll_type < UCG_COLL_TYPE_LAST; ++coll_type) {
+        if (ucg_planc_ucx_get_builtin_plan_attr(ucx_group, coll_type, plan_attr) != UCG_OK) {
+            continue;
+        }
+        for (ucg_plan_attr_t *attr = plan_attr; !UCG_PLAN_ATTR_IS_LAST(attr); ++attr) {
+            if (!attr->deprecated) {
+                ucg_planc_ucx_wireup_add_plan(peers, ucx_group, coll_type, attr->id);
+            }
+        }
+    }
+    ucg_free(plan_attr);
+    return UCG_OK;
+}
+
+ucg_status_t ucg_planc_ucx_group_wireup(ucg_planc_ucx_group_t *ucx_group)
+{
+    ucg_planc_ucx_context_t *context = ucx_group->context;
+    ucg_vgroup_t *vgroup = &ucx_group->super.super;
+    /* The endpoints of the oob are connected by its owner. */
+    if (context->config.wireup == UCG_PLANC_UCX_WIREUP_NONE ||
+        context->config.use_oob == UCG_YES || vgroup->size <= 1) {
+        return UCG_OK;
+    }
+
+    uint32_t size = vgroup->size;
+    uint8_t *peers = ucg_calloc(size, sizeof(uint8_t), "ucx wireup peers");
+    ucg_rank_t *ranks = ucg_malloc(size * sizeof(ucg_rank_t), "ucx wireup ranks");
+    ucg_status_t status = UCG_ERR_NO_MEMORY;
+    if (peers == NULL || ranks == NULL) {
+        goto out;
+    }
+
+    if (context->config.wireup == UCG_PLANC_UCX_WIREUP_ALL) {
+        memset(peers, 1, size);
+        peers[vgroup->myrank] = 0;
+    } else {
+        status = ucg_planc_ucx_wireup_plan_peers(ucx_group, peers);
+        if (status != UCG_OK) {
+            goto out;
+        }
+    }
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+        if (peers[i]) {
+            ranks[count++] = i;
+        }
+    }
+    status = ucg_planc_ucx_p2p_connect(ucx_group, vgroup, ranks, count);
+    ucg_debug("Wired up %u of %u members of group %u, %s", count, size,
+              vgroup->group->id, ucg_status_string(status));
+
+out:
+    if (ranks != NULL) {
+        ucg_free(ranks);
+    }
+    if (peers != NULL) {
+        ucg_free(peers);
+    }
+    return status;
+}
@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PLANC_UCX_WIREUP_H_
+#define UCG_PLANC_UCX_WIREUP_H_
+
+#include "planc_ucx_group.h"
+
+/**
+ * @brief Create and flush the endpoints selected by UCG_PLANC_UCX_WIREUP.
+ *
+ * It's called when the group is created, the topology of the group is known
+ * by then. The endpoints that are not created here are created on first use.
+ */
+ucg_status_t ucg_planc_ucx_group_wireup(ucg_planc_ucx_group_t *ucx_group);
+
+#endif
@@ -165,9 +165,7 @@ static ucg_status_t ucg_planc_ucx_reduce_kntree_op_discard(ucg_plan_op_t *ucg_op
         ucg_free(op->reduce.requests);
     }
 
-    if (op->staging_area != NULL) {
-        ucg_free(op->staging_area);
-    }
+    ucg_planc_ucx_op_free_staging(op);
 
     UCG_CLASS_DESTRUCT(ucg_plan_op_t, &op->super);
     ucg_mpool_put(op);
@@ -196,15 +194,12 @@ ucg_status_t ucg_planc_ucx_reduce_kntree_op_init(ucg_planc_ucx_op_t *op,
         requests_count++;
         ucg_algo_kntree_iter_child_inc(iter);
     }
-    op->staging_area = ucg_malloc(data_size * requests_count, "reduce kntree op staging area");
-    if (op->staging_area == NULL) {
-        status = UCG_ERR_NO_MEMORY;
-    }
+    status = ucg_planc_ucx_op_alloc_staging(op, data_size * requests_count);
 
     op->reduce.requests = ucg_malloc(sizeof(ucg_planc_ucx_p2p_req_t *) * requests_count,
                                      "reduce kntree requests");
     if (op->reduce.requests == NULL) {
-        ucg_free(op->staging_area);
+        ucg_planc_ucx_op_free_staging(op);
         status = UCG_ERR_NO_MEMORY;
     }
 
@@ -41,5 +41,10 @@ void ucg_planc_ucx_scatterv_set_plan_attr(ucg_vgroup_t *vgroup,
         attr->range = range;
         attr->score = UCG_PLANC_UCX_DEFAULT_SCORE;
     }
+
+    /* The message size is the total bytes sent by root. The k-nomial tree
+       saves the latency of small messages but forwards them multiple times. */
+    const int32_t score = UCG_PLANC_UCX_DEFAULT_SCORE + 1;
+    ucg_plan_attr_array_update(default_plan_attr, 2, 0, 32768, score);
     return;
 }
\ No newline at end of file
@@ -247,9 +247,10 @@ static ucg_status_t ucg_planc_ucx_scatterv_kntree_op_params(ucg_planc_ucx_op_t *
                 int32_t idx = (myrank + i + 1) % group_size;
                 size += (int64_t)op->scatterv.kntree.sendcounts[idx] * op->scatterv.kntree.sdtype_size;
             }
-            op->staging_area = ucg_malloc(size, "scatterv kntree staging area");
-            if (op->staging_area == NULL) {
-                return UCG_ERR_NO_MEMORY;
+            ucg_planc_ucx_op_free_staging(op);
+            status = ucg_planc_ucx_op_alloc_staging(op, size);
+            if (status != UCG_OK) {
+                return status;
             }
         }
     }
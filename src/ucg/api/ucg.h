@@ -92,6 +92,12 @@ extern "C" {
  */
 #define UCG_INVALID_RANK ((ucg_rank_t)-1)
 
+/**
+ * @ingroup UCG_GROUP
+ * @brief Color of the processes that don't join any group of @ref ucg_group_split.
+ */
+#define UCG_UNDEFINED_COLOR (-1)
+
 
 /*
  *******************************************************************************
@@ -295,6 +301,7 @@ typedef enum {
     UCG_PARAMS_FIELD_OOB_GROUP = UCG_BIT(0), /**< Out Of Band communication group */
     UCG_PARAMS_FIELD_LOCATION_CB = UCG_BIT(1), /**< Callback to get location of process */
     UCG_PARAMS_FIELD_THREAD_MODE = UCG_BIT(2), /**< Context thread mode */
+    UCG_PARAMS_FIELD_OOB_KVS = UCG_BIT(3), /**< Out Of Band key-value store */
 } ucg_params_field_t;
 
 /**
@@ -557,6 +564,31 @@ typedef struct {
     void *group;
 } ucg_oob_group_t;
 
+/**
+ * @ingroup UCG_CONTEXT
+ * @brief OOB key-value store, e.g. the one of PMIx.
+ *
+ * It lets the processes fetch the address of a peer when it's first needed
+ * instead of gathering the addresses of all processes during initialization.
+ */
+typedef struct {
+    /**
+     * Publish the data of the calling process. All processes of the OOB group
+     * call it together, the data can be looked up by the others once it returns.
+     */
+    ucg_status_t (*publish)(const void *data, uint32_t size, void *arg);
+
+    /**
+     * Look up the data published by the process of rank in the OOB group. If data
+     * is NULL, only the size is returned. Otherwise @b size is the capacity of data
+     * and UCG_ERR_TRUNCATE is returned if it's not enough.
+     */
+    ucg_status_t (*lookup)(ucg_rank_t rank, void *data, uint32_t *size, void *arg);
+
+    /** User-defined argument passed to the callbacks */
+    void *arg;
+} ucg_oob_kvs_t;
+
 /**
  * @ingroup UCG_CONTEXT
  * @brief Get location callback.
@@ -601,6 +633,13 @@ typedef struct {
      * UCG_THREAD_MODE_MULTI is valid when UCG is built with UCG_ENABLE_MT.
      */
     ucg_thread_mode_t thread_mode;
+
+    /**
+     * Key-value store of the processes in oob_group. If it's specified, the
+     * addresses are fetched on demand according to UCG_LAZY_ADDRESS.
+     * This is an optional field. Corresponding bit is UCG_PARAMS_FIELD_OOB_KVS.
+     */
+    ucg_oob_kvs_t oob_kvs;
 } ucg_params_t;
 
 /**
@@ -861,8 +900,15 @@ ucg_status_t ucg_op_init(const ucg_op_params_t *params, ucg_op_h op, uint32_t op
  * configuration is used to initialize a UCG context.
  * The format of runtime environment is "${USER_ENV_PREFIX}_UCG_${CONFIG_NAME}".
  *
+ * The tuning file adjusts the plans selected by the plan components, each line
+ * is "<planc> <coll> [N:<nodes>] [P:<ppn>] [G:<group size>] I:<id> S:<score>
+ * [R:<message size>]", e.g. "ucx allreduce N:4-5 P:64-65 R:0-8192 I:5 S:100".
+ * The ranges are "start-end" with end excluded, no upper limit if there is no
+ * "-end". Text after '#' is ignored. The rules of a planc that the context
+ * doesn't load are ignored with a warning.
+ *
  * @param [in]  env_prefix  User defined prefix of environment. Ignore if NULL.
- * @param [in]  filename    If non-NULL, read configuration from the file.
+ * @param [in]  filename    If non-NULL, read the tuning file.
  * @param [out] config      Configuration descriptor.
  * @retval UCG_OK Success.
  * @retval Otherwise Failure.
@@ -1008,6 +1054,51 @@ ucg_status_t ucg_group_create(ucg_context_h context, const ucg_group_params_t *p
  */
 void ucg_group_destroy(ucg_group_h group);
 
+/**
+ * @ingroup UCG_GROUP
+ * @brief Split UCG Communication Group
+ *
+ * The processes of the parent group with the same color form a new group, in
+ * which they are ranked by key and then by their rank in the parent group. It's
+ * called by all processes of the parent group, which run one allgather of the
+ * colors. The rank map and topology of the new group are derived from the
+ * parent. The allgathers of the OOB group of the new group run over the parent
+ * while the new group is created, in which all processes of the parent take
+ * part, and over the new group afterwards. The parent must not be used by other
+ * threads meanwhile.
+ *
+ * @param [in]  parent      Parent group.
+ * @param [in]  color       Non-negative color, or UCG_UNDEFINED_COLOR to not join
+ *                          any group.
+ * @param [in]  key         Rank order in the new group.
+ * @param [in]  id          Group id, see @ref ucg_group_params_t.id.
+ * @param [out] group       Communication group, NULL if color is UCG_UNDEFINED_COLOR.
+ * @retval UCG_OK Success.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_group_split(ucg_group_h parent, int32_t color, int32_t key,
+                             uint32_t id, ucg_group_h *group);
+
+/**
+ * @ingroup UCG_GROUP
+ * @brief Create UCG Communication Group from the ranks of a parent group
+ *
+ * The process with ranks[i] in the parent group has rank i in the new group.
+ * It's called by all processes of the parent group with the same ranks, the
+ * processes that aren't in ranks get NULL. The new group has the same OOB group
+ * as the one created by @ref ucg_group_split.
+ *
+ * @param [in]  parent      Parent group.
+ * @param [in]  ranks       Ranks of the members in the parent group.
+ * @param [in]  size        Size of the new group.
+ * @param [in]  id          Group id, see @ref ucg_group_params_t.id.
+ * @param [out] group       Communication group, NULL if the caller isn't in ranks.
+ * @retval UCG_OK Success.
+ * @retval Otherwise Failure.
+ */
+ucg_status_t ucg_group_create_from_ranks(ucg_group_h parent, const ucg_rank_t *ranks,
+                                         uint32_t size, uint32_t id, ucg_group_h *group);
+
 /**
  * @ingroup UCG_REQUEST
  * @brief Create a persistent broadcast request.
@@ -1231,6 +1322,8 @@ ucg_status_t ucg_request_allgatherv_init(const void *sendbuf, int sendcount,
  * @retval UCG_OK Start successfully, next step is to invoke @ref ucg_request_test
  *         to check status and progress the request.
  * @retval UCG_INPROGRESS The request is already started, wrong way to use
+ * @retval UCG_ERR_NO_RESOURCE Too many requests of the group are in flight, progress
+ *         the oldest one and start the request again.
  * @retval Otherwise Failed to start the request. The request can only be cleanup
  *         through @ref ucg_request_cleanup
  */
@@ -1249,6 +1342,23 @@ ucg_status_t ucg_request_start(ucg_request_h request);
  */
 ucg_status_t ucg_request_test(ucg_request_h request);
 
+/**
+ * @ingroup UCG_REQUEST
+ * @brief Wait for the completion of the request.
+ *
+ * The request is progressed in a busy loop for the time of UCG_WAIT_SPIN_TIME,
+ * then the routine sleeps until the network has new events or
+ * UCG_WAIT_BLOCK_TIMEOUT expires, and progresses it again. It keeps busy polling
+ * if the plan of the request or the one it waits for can not notify the events.
+ *
+ * @param [in] request      Collective request
+ * @retval UCG_OK The request is completed successfully, can be cleanup or start
+ *         again
+ * @retval Otherwise Failed to progress the request. The request can only be cleanup
+ *         through @ref ucg_request_cleanup
+ */
+ucg_status_t ucg_request_wait(ucg_request_h request);
+
 /**
  * @ingroup UCG_REQUEST
  * @brief Free the request.
@@ -8,6 +8,7 @@
 #include <ucs/arch/atomic.h>
 
 #define ucg_atomic_fadd32(_ptr, _val)   ucs_atomic_fadd32(_ptr, _val)
+#define ucg_atomic_add32(_ptr, _val)    ucs_atomic_add32(_ptr, _val)
 #define ucg_atomic_sub32(_ptr, _val)    ucs_atomic_sub32(_ptr, _val)
 #define ucg_atomic_add64(_ptr, _val)    ucs_atomic_add64(_ptr, _val)
 #define ucg_atomic_sub64(_ptr, _val)    ucs_atomic_sub64(_ptr, _val)
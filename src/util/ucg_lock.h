@@ -109,11 +109,27 @@ static inline void ucg_lock_leave(ucg_lock_t *lock)
     pthread_mutex_unlock(&lock->mutex);
     return;
 }
+
+/* 1 for lock success, 0 for failed */
+static inline int ucg_lock_try_enter(ucg_lock_t *lock)
+{
+    if (lock->type == UCG_LOCK_TYPE_NONE) {
+        return 1;
+    }
+
+    if (lock->type == UCG_LOCK_TYPE_SPINLOCK) {
+        return ucg_recursive_spin_trylock(&lock->spinlock);
+    }
+
+    ucg_assert(lock->type == UCG_LOCK_TYPE_MUTEX);
+    return pthread_mutex_trylock(&lock->mutex) == 0;
+}
 #else
 #define ucg_lock_init(_lock, _type) ({UCG_UNUSED(_lock, _type); UCG_OK;})
 #define ucg_lock_destroy(_lock)     UCG_UNUSED(_lock)
 #define ucg_lock_enter(_lock)       UCG_UNUSED(_lock)
 #define ucg_lock_leave(_lock)       UCG_UNUSED(_lock)
+#define ucg_lock_try_enter(_lock)   ({UCG_UNUSED(_lock); 1;})
 #endif //UCG_ENABLE_MT
 
 #endif
\ No newline at end of file
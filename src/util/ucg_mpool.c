@@ -74,8 +74,8 @@ ucg_status_t ucg_mpool_init(ucg_mpool_t *mp, size_t priv_size,
     if (status != UCG_OK) {
         return status;
     }
-    status = ucg_lock_init(&mp->lock, UCG_LOCK_TYPE_NONE);
-    return status;
+    mp->mt = 0;
+    return UCG_OK;
 }
 
 ucg_status_t ucg_mpool_init_mt(ucg_mpool_t *mp, size_t priv_size,
@@ -89,9 +89,13 @@ ucg_status_t ucg_mpool_init_mt(ucg_mpool_t *mp, size_t priv_size,
     if (status != UCG_OK) {
         return status;
     }
-    ucg_lock_destroy(&mp->lock);
-    status = ucg_lock_init(&mp->lock, UCG_LOCK_TYPE_SPINLOCK);
-    return status;
+    status = ucg_spinlock_init(&mp->lock, 0);
+    if (status != UCG_OK) {
+        ucg_mpool_cleanup(mp, 0);
+        return status;
+    }
+    mp->mt = 1;
+    return UCG_OK;
 }
 
 void ucg_mpool_cleanup(ucg_mpool_t *mp, int check_leak)
@@ -104,7 +108,9 @@ void ucg_mpool_cleanup(ucg_mpool_t *mp, int check_leak)
     ucs_ops = mp->super.data->ops;
     ucs_mpool_cleanup(&mp->super, check_leak);
     ucg_free(ucs_ops);
-    ucg_lock_destroy(&mp->lock);
+    if (mp->mt) {
+        ucg_spinlock_destroy(&mp->lock);
+    }
     return;
 }
 
@@ -113,10 +119,12 @@ void *ucg_mpool_get(ucg_mpool_t *mp)
     if (mp == NULL) {
         return NULL;
     }
-    void *obj = NULL;
-    ucg_lock_enter(&mp->lock);
-    obj = ucs_mpool_get(&mp->super);
-    ucg_lock_leave(&mp->lock);
+    if (!mp->mt) {
+        return ucs_mpool_get(&mp->super);
+    }
+    ucg_spin_lock(&mp->lock);
+    void *obj = ucs_mpool_get(&mp->super);
+    ucg_spin_unlock(&mp->lock);
     return obj;
 }
 
@@ -128,9 +136,13 @@ void ucg_mpool_put(void *obj)
     /* depends on the implementation of ucs mpool. */
     ucs_mpool_elem_t *elem = (ucs_mpool_elem_t *)obj - 1;
     ucg_mpool_t *mp = ucg_derived_of(elem->mpool, ucg_mpool_t);
-    ucg_lock_enter(&mp->lock);
+    if (!mp->mt) {
+        ucs_mpool_put(obj);
+        return;
+    }
+    ucg_spin_lock(&mp->lock);
     ucs_mpool_put(obj);
-    ucg_lock_leave(&mp->lock);
+    ucg_spin_unlock(&mp->lock);
     return;
 }
 
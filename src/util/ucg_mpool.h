@@ -61,7 +61,10 @@ typedef struct ucg_mpool_ops {
 struct ucg_mpool {
     ucs_mpool_t super;          /**< UCS memory pool */
     ucg_mpool_ops_t *ops;       /**< UCG mpool ops */
-    ucg_lock_t lock;
+    int mt;                     /**< Whether the lock is used */
+    /* Get and put never nest, so the plain spinlock is enough, it's cheaper
+       than the recursive one which checks the owner thread. */
+    ucg_spinlock_t lock;
 };
 
 /**
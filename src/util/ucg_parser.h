@@ -35,6 +35,8 @@
 #define UCG_CONFIG_TYPE_MEMUNITS        UCS_CONFIG_TYPE_MEMUNITS
 #define UCG_CONFIG_TYPE_BOOL            UCS_CONFIG_TYPE_BOOL
 #define UCG_CONFIG_TYPE_TERNARY         UCS_CONFIG_TYPE_TERNARY
+#define UCG_CONFIG_TYPE_TIME            UCS_CONFIG_TYPE_TIME
+#define UCG_CONFIG_TYPE_BW              UCS_CONFIG_TYPE_BW
 
 static inline ucg_status_t
 ucg_config_parser_fill_opts(void *opts, ucg_config_field_t *fields,
@@ -6,6 +6,7 @@
 #define UCG_TIME_H_
 
 #include <sys/time.h>
+#include <time.h>
 
 /**
  * @brief return the micro-seconds(us) of now
@@ -19,4 +20,16 @@ static inline uint64_t ucg_get_time_us()
     return tv.tv_sec * factor + tv.tv_usec;
 }
 
+/**
+ * @brief return the nano-seconds(ns) of monotonic clock
+ */
+static inline uint64_t ucg_get_time_ns()
+{
+    static uint64_t factor = 1000000000;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * factor + ts.tv_nsec;
+}
+
 #endif
\ No newline at end of file
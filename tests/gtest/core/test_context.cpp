@@ -10,8 +10,12 @@ extern "C" {
 #include "core/ucg_group.h"
 #include "planc/ucg_planc.h"
 #include "core/ucg_global.h"
+#include "util/ucg_time.h"
 }
 
+#include <poll.h>
+#include <unistd.h>
+
 using namespace test;
 
 class test_ucg_config : public testing::Test {
@@ -373,4 +377,173 @@ TEST_F(test_ucg_context, get_location)
     }
 
     ucg_cleanup(context);
-}
\ No newline at end of file
+}
+
+TEST_F(test_ucg_context, progress_thread)
+{
+    ucg_config_h config;
+    ASSERT_EQ(ucg_config_read(NULL, NULL, &config), UCG_OK);
+    ASSERT_EQ(ucg_config_modify(config, "PROGRESS_THREAD", "y"), UCG_OK);
+    ASSERT_EQ(ucg_config_modify(config, "PROGRESS_THREAD_SPIN_TIME", "0"), UCG_OK);
+
+    // The caller asks for single thread mode.
+    ucg_context_h context;
+    ASSERT_EQ(ucg_init(&test_stub_context_params, config, &context), UCG_OK);
+#ifdef UCG_ENABLE_MT
+    ASSERT_TRUE(context->progress_thread.active);
+    ASSERT_TRUE(context->thread_mode == UCG_THREAD_MODE_MULTI);
+#else
+    ASSERT_FALSE(context->progress_thread.active);
+#endif
+    // Progress together with the thread.
+    for (int i = 0; i < 100; ++i) {
+        ucg_progress(context);
+    }
+    // Expect the thread to be joined.
+    ucg_cleanup(context);
+    ucg_config_release(config);
+}
+
+/* Every process publishes the same data in the simulated key-value store. */
+static std::vector<uint8_t> test_kvs_data;
+static int test_kvs_lookups = 0;
+
+static ucg_status_t test_kvs_publish(const void *data, uint32_t size, void *arg)
+{
+    test_kvs_data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+    return UCG_OK;
+}
+
+static ucg_status_t test_kvs_lookup(ucg_rank_t rank, void *data, uint32_t *size, void *arg)
+{
+    ++test_kvs_lookups;
+    if (data != NULL) {
+        if (*size < test_kvs_data.size()) {
+            return UCG_ERR_TRUNCATE;
+        }
+        memcpy(data, test_kvs_data.data(), test_kvs_data.size());
+    }
+    *size = test_kvs_data.size();
+    return UCG_OK;
+}
+
+TEST_F(test_ucg_context, lazy_address)
+{
+    ucg_config_h config;
+    ASSERT_EQ(ucg_config_read(NULL, NULL, &config), UCG_OK);
+    ASSERT_EQ(ucg_config_modify(config, "LAZY_ADDRESS", "y"), UCG_OK);
+
+    // No key-value store.
+    ucg_context_h context;
+    ASSERT_EQ(ucg_init(&test_stub_context_params, config, &context), UCG_ERR_INVALID_PARAM);
+
+    ucg_params_t params = test_stub_context_params;
+    params.field_mask |= UCG_PARAMS_FIELD_OOB_KVS;
+    params.oob_kvs.publish = test_kvs_publish;
+    params.oob_kvs.lookup = test_kvs_lookup;
+    params.oob_kvs.arg = NULL;
+    test_kvs_lookups = 0;
+    ASSERT_EQ(ucg_init(&params, config, &context), UCG_OK);
+    ASSERT_EQ(context->procs.store.count, 0);
+    ASSERT_FALSE(test_kvs_data.empty());
+
+    // Locations are available without lookup.
+    ucg_location_t location;
+    for (int i = 0; i < params.oob_group.size; ++i) {
+        ASSERT_EQ(ucg_context_get_location(context, i, &location), UCG_OK);
+    }
+    ASSERT_EQ(test_kvs_lookups, 0);
+
+    // Looked up once when first needed.
+    ucg_planc_t *planc = context->planc_rscs[0].planc;
+    ucg_rank_t peer = params.oob_group.size - 1;
+    ASSERT_TRUE(context->procs.info[peer] == NULL);
+    void *addr = ucg_context_get_proc_addr(context, peer, planc);
+    ASSERT_TRUE(context->procs.info[peer] != NULL);
+    int lookups = test_kvs_lookups;
+    ASSERT_GT(lookups, 0);
+    ASSERT_EQ(ucg_context_get_proc_addr(context, peer, planc), addr);
+    ASSERT_EQ(test_kvs_lookups, lookups);
+
+    ucg_cleanup(context);
+    ucg_config_release(config);
+}
+
+static int test_wait_fd = -1;
+static ucg_status_t test_wait_arm_status = UCG_OK;
+
+static ucg_status_t test_wait_arm(ucg_planc_context_h context, int *fd)
+{
+    *fd = test_wait_fd;
+    return test_wait_arm_status;
+}
+
+TEST(test_ucg_context_wait, arm)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    test_wait_fd = fds[0];
+
+    ucg_planc_t planc = {};
+    ucg_resource_planc_t rsc = {};
+    rsc.planc = &planc;
+    struct pollfd wait_fds[1];
+    ucg_context_t context = {};
+    context.num_planc_rscs = 1;
+    context.planc_rscs = &rsc;
+    context.wait_fds = wait_fds;
+    context.wait_block_timeout = 10000;
+    ucg_list_head_init(&context.glist);
+
+    // Not able to notify the events.
+    ASSERT_EQ(ucg_context_wait(&context), UCG_ERR_UNSUPPORTED);
+
+    // Events not progressed yet, don't sleep.
+    planc.context_arm = test_wait_arm;
+    test_wait_arm_status = UCG_INPROGRESS;
+    ASSERT_EQ(ucg_context_wait(&context), UCG_INPROGRESS);
+
+    // Woken up by the event instead of the timeout.
+    test_wait_arm_status = UCG_OK;
+    ASSERT_EQ(write(fds[1], "e", 1), 1);
+    uint64_t start = ucg_get_time_ns();
+    ASSERT_EQ(ucg_context_wait(&context), UCG_OK);
+    ASSERT_LT(ucg_get_time_ns() - start, 1000000000UL);
+
+    // Timed out without events.
+    char c;
+    ASSERT_EQ(read(fds[0], &c, 1), 1);
+    context.wait_block_timeout = 1;
+    ASSERT_EQ(ucg_context_wait(&context), UCG_OK);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(test_ucg_context_wait, polled_planc)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    test_wait_fd = fds[0];
+    test_wait_arm_status = UCG_OK;
+
+    // The first planc polls its ops, the second one notifies the events.
+    ucg_planc_t plancs[2] = {};
+    plancs[1].context_arm = test_wait_arm;
+    ucg_resource_planc_t rscs[2] = {};
+    rscs[0].planc = &plancs[0];
+    rscs[1].planc = &plancs[1];
+    struct pollfd wait_fds[2];
+    ucg_context_t context = {};
+    context.num_planc_rscs = 2;
+    context.planc_rscs = rscs;
+    context.wait_fds = wait_fds;
+    context.wait_block_timeout = 1;
+    ucg_list_head_init(&context.glist);
+
+    // Sleep on the events of the other planc, the waiter polls the ops of the first.
+    ASSERT_EQ(ucg_context_wait(&context), UCG_OK);
+
+    close(fds[0]);
+    close(fds[1]);
+}
@@ -3,6 +3,7 @@
 */
 
 #include <gtest/gtest.h>
+#include <vector>
 #include "stub.h"
 
 extern "C" {
@@ -742,4 +743,62 @@ TEST_F(test_ucg_op, user)
         ASSERT_EQ(expect[i].data1, target[i].data1);
         ASSERT_EQ(expect[i].data2, target[i].data2);
     }
-}
\ No newline at end of file
+}
+template<typename T>
+static void check_isa_bit_exact(ucg_op_type_t op_type, ucg_dt_type_t dt_type, ucg_op_isa_t isa)
+{
+    /* Odd counts cover the remainder of the vectorized loops. */
+    const std::vector<int32_t> counts = {1, 7, 31, 64, 65, 1000, 4099};
+    ucg_op_func_t scalar = ucg_op_predefined_func(op_type, dt_type, UCG_OP_ISA_SCALAR);
+    ucg_op_func_t vector = ucg_op_predefined_func(op_type, dt_type, isa);
+    ASSERT_NE(scalar, nullptr);
+    ASSERT_NE(vector, nullptr);
+
+    for (auto count : counts) {
+        std::vector<T> source(count);
+        std::vector<T> expect(count);
+        std::vector<T> target(count);
+        for (int32_t i = 0; i < count; ++i) {
+            /* Keep the signed products away from overflow. */
+            source[i] = (T)(rand() % 2001 - 1000);
+            expect[i] = (T)(rand() % 2001 - 1000);
+        }
+        target = expect;
+        ASSERT_EQ(scalar(NULL, source.data(), expect.data(), count, NULL), UCG_OK);
+        ASSERT_EQ(vector(NULL, source.data(), target.data(), count, NULL), UCG_OK);
+        ASSERT_EQ(memcmp(expect.data(), target.data(), count * sizeof(T)), 0)
+            << "op " << op_type << " dt " << dt_type << " isa " << isa << " count " << count;
+    }
+}
+
+TEST(test_ucg_op_isa, selected)
+{
+    ASSERT_EQ(ucg_dt_global_init(), UCG_OK);
+    EXPECT_TRUE(ucg_op_isa_is_supported(ucg_op_get_isa()));
+    EXPECT_EQ(ucg_op_predefined_func(UCG_OP_TYPE_USER, UCG_DT_TYPE_INT32, UCG_OP_ISA_SCALAR),
+              nullptr);
+    EXPECT_EQ(ucg_op_predefined_func(UCG_OP_TYPE_SUM, UCG_DT_TYPE_USER, UCG_OP_ISA_SCALAR),
+              nullptr);
+    ucg_dt_global_cleanup();
+}
+
+TEST(test_ucg_op_isa, integer_bit_exact)
+{
+    for (int isa = UCG_OP_ISA_SCALAR + 1; isa < UCG_OP_ISA_LAST; ++isa) {
+        if (!ucg_op_isa_is_supported((ucg_op_isa_t)isa)) {
+            continue;
+        }
+        for (int op = UCG_OP_TYPE_MAX; op < UCG_OP_TYPE_PREDEFINED_LAST; ++op) {
+            ucg_op_type_t op_type = (ucg_op_type_t)op;
+            ucg_op_isa_t op_isa = (ucg_op_isa_t)isa;
+            check_isa_bit_exact<int8_t>(op_type, UCG_DT_TYPE_INT8, op_isa);
+            check_isa_bit_exact<int16_t>(op_type, UCG_DT_TYPE_INT16, op_isa);
+            check_isa_bit_exact<int32_t>(op_type, UCG_DT_TYPE_INT32, op_isa);
+            check_isa_bit_exact<int64_t>(op_type, UCG_DT_TYPE_INT64, op_isa);
+            check_isa_bit_exact<uint8_t>(op_type, UCG_DT_TYPE_UINT8, op_isa);
+            check_isa_bit_exact<uint16_t>(op_type, UCG_DT_TYPE_UINT16, op_isa);
+            check_isa_bit_exact<uint32_t>(op_type, UCG_DT_TYPE_UINT32, op_isa);
+            check_isa_bit_exact<uint64_t>(op_type, UCG_DT_TYPE_UINT64, op_isa);
+        }
+    }
+}
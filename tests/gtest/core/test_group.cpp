@@ -6,8 +6,13 @@
 
 #include "stub.h"
 
+#include <vector>
+
 extern "C" {
 #include "core/ucg_group.h"
+#include "core/ucg_request.h"
+#include "core/ucg_dt.h"
+#include "planc/ucg_planc.h"
 }
 
 using namespace test;
@@ -50,6 +55,354 @@ TEST_F(test_ucg_group, create)
     ucg_group_destroy(group);
 }
 
+TEST_F(test_ucg_group, create_from_ranks)
+{
+    ucg_group_h parent = NULL;
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &parent), UCG_OK);
+
+    ucg_group_h group = NULL;
+    ucg_rank_t ranks[] = {3, 0, 4};
+    ASSERT_EQ(ucg_group_create_from_ranks(parent, ranks, 3, 3, &group), UCG_OK);
+    ASSERT_TRUE(group != NULL);
+    ASSERT_TRUE(ucg_group_is_derived(group));
+    ASSERT_EQ(group->id, 3);
+    ASSERT_EQ(group->size, 3);
+    ASSERT_EQ(group->myrank, 1);
+    ASSERT_EQ(ucg_group_get_ctx_rank(group, 0), ucg_group_get_ctx_rank(parent, 3));
+    ASSERT_EQ(ucg_group_get_ctx_rank(group, 2), ucg_group_get_ctx_rank(parent, 4));
+    ucg_group_destroy(group);
+
+    // The caller isn't a member.
+    ucg_rank_t others[] = {1, 2};
+    group = parent;
+    ASSERT_EQ(ucg_group_create_from_ranks(parent, others, 2, 3, &group), UCG_OK);
+    ASSERT_TRUE(group == NULL);
+    ucg_group_destroy(parent);
+}
+
+TEST_F(test_ucg_group, create_from_ranks_invalid_args)
+{
+    ucg_group_h parent = NULL;
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &parent), UCG_OK);
+
+    ucg_group_h group = NULL;
+#ifdef UCG_ENABLE_CHECK_PARAMS
+    ASSERT_EQ(ucg_group_create_from_ranks(parent, NULL, 2, 3, &group), UCG_ERR_INVALID_PARAM);
+#endif
+    ucg_rank_t duplicate[] = {0, 2, 0};
+    ASSERT_EQ(ucg_group_create_from_ranks(parent, duplicate, 3, 3, &group),
+              UCG_ERR_INVALID_PARAM);
+    ucg_rank_t out_of_range[] = {0, 5};
+    ASSERT_EQ(ucg_group_create_from_ranks(parent, out_of_range, 2, 3, &group),
+              UCG_ERR_INVALID_PARAM);
+    ucg_group_destroy(parent);
+}
+
+TEST_F(test_ucg_group, split_undefined_color)
+{
+    ucg_group_h parent = NULL;
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &parent), UCG_OK);
+
+    ucg_group_h group = parent;
+    ASSERT_EQ(ucg_group_split(parent, UCG_UNDEFINED_COLOR, 0, 3, &group), UCG_OK);
+    ASSERT_TRUE(group == NULL);
+    ucg_group_destroy(parent);
+}
+
+TEST_F(test_ucg_group, split_fail_allgather)
+{
+    ucg_group_h parent = NULL;
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &parent), UCG_OK);
+
+    ucg_group_h group = NULL;
+    stub::mock(stub::PLAN_OP_PROGRESS, {stub::FAILURE});
+    ASSERT_NE(ucg_group_split(parent, 0, 0, 3, &group), UCG_OK);
+    ucg_group_destroy(parent);
+}
+
+/* Allgatherv that gives this process's data to every slot, as if all processes sent the same. */
+static ucg_status_t test_mirror_op_trigger(ucg_plan_op_t *op)
+{
+    const ucg_coll_allgatherv_args_t *args = &op->super.args.allgatherv;
+    uint32_t dt_size = ucg_dt_size(args->recvtype);
+    for (uint32_t i = 0; i < op->super.group->size; ++i) {
+        memcpy((uint8_t*)args->recvbuf + args->displs[i] * dt_size, args->sendbuf,
+               args->sendcount * ucg_dt_size(args->sendtype));
+    }
+    op->super.status = UCG_OK;
+    return UCG_OK;
+}
+
+static ucg_status_t test_mirror_op_progress(ucg_plan_op_t *op)
+{
+    return op->super.status;
+}
+
+static ucg_status_t test_mirror_op_discard(ucg_plan_op_t *op)
+{
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, op);
+    free(op);
+    return UCG_OK;
+}
+
+static ucg_status_t test_mirror_prepare(ucg_vgroup_t *vgroup, const ucg_coll_args_t *args,
+                                        ucg_plan_op_t **op)
+{
+    ucg_plan_op_t *new_op = (ucg_plan_op_t*)malloc(sizeof(ucg_plan_op_t));
+    ucg_status_t status = UCG_CLASS_CONSTRUCT(ucg_plan_op_t, new_op, vgroup,
+                                              test_mirror_op_trigger,
+                                              test_mirror_op_progress,
+                                              test_mirror_op_discard,
+                                              args);
+    if (status != UCG_OK) {
+        abort();
+    }
+    *op = new_op;
+    return UCG_OK;
+}
+
+static ucg_status_t test_mirror_get_plans(ucg_planc_group_h planc_group, ucg_plans_t *plans)
+{
+    ucg_plan_params_t params = {};
+    params.mem_type = UCG_MEM_TYPE_HOST;
+    params.coll_type = UCG_COLL_TYPE_ALLGATHERV;
+    params.attr.prepare = test_mirror_prepare;
+    params.attr.name = "mirror";
+    params.attr.domain = "gtest";
+    params.attr.range.end = UCG_PLAN_RANGE_MAX;
+    params.attr.vgroup = (ucg_vgroup_t*)planc_group;
+    params.attr.score = 1;
+    return ucg_plans_add(plans, &params);
+}
+
+static int test_oob_planc_creates = 0;
+
+/* Exchange through the OOB group of the group when it's created, as shm, hccl and ucx do. */
+static ucg_status_t test_oob_planc_group_create(ucg_planc_context_h context,
+                                                const ucg_planc_group_params_t *params,
+                                                ucg_planc_group_h *planc_group)
+{
+    ucg_group_t *group = params->group;
+    std::vector<int32_t> infos(group->size);
+    int32_t myinfo = 7;
+    ucg_status_t status = group->oob_group.allgather(&myinfo, infos.data(), sizeof(myinfo),
+                                                     group->oob_group.group);
+    if (status != UCG_OK) {
+        return status;
+    }
+    for (uint32_t i = 0; i < group->size; ++i) {
+        if (infos[i] != myinfo) {
+            return UCG_ERR_INVALID_PARAM;
+        }
+    }
+
+    ucg_planc_group_t *new_planc_group = (ucg_planc_group_t*)malloc(sizeof(ucg_planc_group_t));
+    status = UCG_CLASS_CONSTRUCT(ucg_planc_group_t, new_planc_group, group);
+    if (status != UCG_OK) {
+        abort();
+    }
+    ++test_oob_planc_creates;
+    *planc_group = new_planc_group;
+    return UCG_OK;
+}
+
+class test_ucg_group_oob_planc : public test_ucg_group {
+protected:
+    void SetUp() override
+    {
+        for (int i = 0; i < ucg_planc_count(); ++i) {
+            ucg_planc_t *planc = ucg_planc_get_by_idx(i);
+            m_group_create.push_back(planc->group_create);
+            m_get_plans.push_back(planc->get_plans);
+        }
+        test_oob_planc_creates = 0;
+    }
+
+    void TearDown() override
+    {
+        set_plancs(m_group_create, m_get_plans);
+    }
+
+    void set_plancs(const std::vector<ucg_planc_group_create_func_t> &group_create,
+                    const std::vector<ucg_planc_get_plans_func_t> &get_plans)
+    {
+        for (int i = 0; i < ucg_planc_count(); ++i) {
+            ucg_planc_t *planc = ucg_planc_get_by_idx(i);
+            planc->group_create = group_create[i];
+            planc->get_plans = get_plans[i];
+        }
+    }
+
+    /* The parent exchanges with the mirror allgatherv if mirror, the plancs of the
+       groups derived from it exchange through the OOB group. */
+    ucg_group_h create_parent(bool mirror = true)
+    {
+        int count = ucg_planc_count();
+        std::vector<ucg_planc_get_plans_func_t> mirror_plans(count, test_mirror_get_plans);
+        set_plancs(m_group_create, mirror ? mirror_plans : m_get_plans);
+        ucg_group_h parent = NULL;
+        EXPECT_EQ(ucg_group_create(m_context, &test_stub_group_params, &parent), UCG_OK);
+        std::vector<ucg_planc_group_create_func_t> oob_create(count, test_oob_planc_group_create);
+        set_plancs(oob_create, mirror ? mirror_plans : m_get_plans);
+        return parent;
+    }
+
+    std::vector<ucg_planc_group_create_func_t> m_group_create;
+    std::vector<ucg_planc_get_plans_func_t> m_get_plans;
+};
+
+TEST_F(test_ucg_group_oob_planc, split)
+{
+    ucg_group_h parent = create_parent();
+    ASSERT_TRUE(parent != NULL);
+
+    ucg_group_h group = NULL;
+    ASSERT_EQ(ucg_group_split(parent, 0, 0, 3, &group), UCG_OK);
+    ASSERT_TRUE(group != NULL);
+    ASSERT_TRUE(ucg_group_is_derived(group));
+    ASSERT_EQ(test_oob_planc_creates, ucg_planc_count());
+
+    // The allgathers of the running group, as the ones of the hccl plans, run in it.
+    int32_t myinfo = 9;
+    std::vector<int32_t> infos(group->size);
+    ASSERT_EQ(group->oob_group.allgather(&myinfo, infos.data(), sizeof(myinfo),
+                                         group->oob_group.group), UCG_OK);
+    for (uint32_t i = 0; i < group->size; ++i) {
+        ASSERT_EQ(infos[i], myinfo);
+    }
+
+    // The new group doesn't need the parent any more.
+    ucg_group_destroy(parent);
+    ASSERT_EQ(group->oob_group.allgather(&myinfo, infos.data(), sizeof(myinfo),
+                                         group->oob_group.group), UCG_OK);
+    ucg_group_destroy(group);
+}
+
+TEST_F(test_ucg_group_oob_planc, split_undefined_color)
+{
+    ucg_group_h parent = create_parent();
+    ASSERT_TRUE(parent != NULL);
+
+    ucg_group_h group = parent;
+    ASSERT_EQ(ucg_group_split(parent, UCG_UNDEFINED_COLOR, 0, 3, &group), UCG_OK);
+    ASSERT_TRUE(group == NULL);
+    ASSERT_EQ(test_oob_planc_creates, 0);
+    ucg_group_destroy(parent);
+}
+
+TEST_F(test_ucg_group_oob_planc, create_from_ranks)
+{
+    ucg_group_h parent = create_parent();
+    ASSERT_TRUE(parent != NULL);
+
+    ucg_group_h group = NULL;
+    ucg_rank_t ranks[] = {3, 0, 4};
+    ASSERT_EQ(ucg_group_create_from_ranks(parent, ranks, 3, 3, &group), UCG_OK);
+    ASSERT_TRUE(group != NULL);
+
+    // The ucx endpoints of the OOB group are looked up in the user's group, which
+    // the group derived from a derived group comes from as well.
+    ucg_group_h child = NULL;
+    ucg_rank_t child_ranks[] = {1, 2};
+    ASSERT_EQ(ucg_group_create_from_ranks(group, child_ranks, 2, 4, &child), UCG_OK);
+    ASSERT_TRUE(child != NULL);
+    ucg_rank_t root_rank = UCG_INVALID_RANK;
+    ASSERT_TRUE(ucg_group_get_root_oob_group(child, 1, &root_rank) ==
+                parent->oob_group.group);
+    ASSERT_EQ(root_rank, 4);
+    ASSERT_TRUE(ucg_group_get_root_oob_group(parent, 1, &root_rank) ==
+                parent->oob_group.group);
+    ASSERT_EQ(root_rank, 1);
+    ucg_group_destroy(child);
+    ucg_group_destroy(group);
+    ucg_group_destroy(parent);
+}
+
+TEST_F(test_ucg_group_oob_planc, create_fail_allgather)
+{
+    // The allgatherv of the parent gets nothing from the other members.
+    ucg_group_h parent = create_parent(false);
+    ASSERT_TRUE(parent != NULL);
+
+    ucg_group_h group = NULL;
+    ucg_rank_t ranks[] = {3, 0, 4};
+    ASSERT_NE(ucg_group_create_from_ranks(parent, ranks, 3, 3, &group), UCG_OK);
+    ASSERT_TRUE(group == NULL);
+    ucg_group_destroy(parent);
+}
+
+static uint64_t test_plans_tag = 0;
+
+static ucg_status_t test_get_plans_tag(ucg_planc_group_h planc_group, uint64_t *tag)
+{
+    *tag = test_plans_tag;
+    return UCG_OK;
+}
+
+static void test_set_get_plans_tag(ucg_planc_get_plans_tag_func_t func)
+{
+    for (int i = 0; i < ucg_planc_count(); ++i) {
+        ucg_planc_get_by_idx(i)->get_plans_tag = func;
+    }
+}
+
+TEST_F(test_ucg_group, share_plans_by_tag)
+{
+    ucg_group_h group1;
+    ucg_group_h group2;
+    ucg_group_h group3;
+    // The plancs don't tell whether the plans can be shared.
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &group1), UCG_OK);
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &group2), UCG_OK);
+    ASSERT_NE(group1->plans, group2->plans);
+    ucg_group_destroy(group2);
+    ucg_group_destroy(group1);
+
+    test_set_get_plans_tag(test_get_plans_tag);
+    test_plans_tag = 1;
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &group1), UCG_OK);
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &group2), UCG_OK);
+    test_plans_tag = 2;
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &group3), UCG_OK);
+    test_set_get_plans_tag(NULL);
+    // Same shape, but the planc groups of the third one are in another state.
+    ASSERT_EQ(group1->plans, group2->plans);
+    ASSERT_NE(group1->plans, group3->plans);
+    ucg_group_destroy(group3);
+    ucg_group_destroy(group2);
+    ucg_group_destroy(group1);
+}
+
+TEST_F(test_ucg_group, query_and_force_plans)
+{
+    ucg_group_h group;
+    ASSERT_EQ(ucg_group_create(m_context, &test_stub_group_params, &group), UCG_OK);
+
+    // Each planc adds the stub plan.
+    ucg_plan_info_t infos[2];
+    uint32_t count = 1;
+    ASSERT_EQ(ucg_group_query_plans(group, UCG_COLL_TYPE_BCAST, UCG_MEM_TYPE_HOST,
+                                    infos, &count), UCG_ERR_TRUNCATE);
+    ASSERT_EQ(count, 2u);
+    ASSERT_EQ(ucg_group_query_plans(group, UCG_COLL_TYPE_BCAST, UCG_MEM_TYPE_HOST,
+                                    infos, &count), UCG_OK);
+    ASSERT_STREQ(infos[0].planc, "fake");
+    ASSERT_STREQ(infos[1].planc, "fake2");
+    ASSERT_EQ(infos[1].id, 0);
+
+    ucg_plan_t **forced = &group->forced_plans[UCG_COLL_TYPE_BCAST][UCG_MEM_TYPE_HOST];
+    ASSERT_EQ(ucg_group_force_plan(group, UCG_COLL_TYPE_BCAST, UCG_MEM_TYPE_HOST,
+                                   "fake2", 1), UCG_ERR_NOT_FOUND);
+    ASSERT_TRUE(*forced == NULL);
+    ASSERT_EQ(ucg_group_force_plan(group, UCG_COLL_TYPE_BCAST, UCG_MEM_TYPE_HOST,
+                                   "fake2", 0), UCG_OK);
+    ASSERT_TRUE(*forced != NULL);
+    ASSERT_EQ(ucg_group_force_plan(group, UCG_COLL_TYPE_BCAST, UCG_MEM_TYPE_HOST,
+                                   NULL, 0), UCG_OK);
+    ASSERT_TRUE(*forced == NULL);
+    ucg_group_destroy(group);
+}
+
 #ifdef UCG_ENABLE_CHECK_PARAMS
 TEST_F(test_ucg_group, create_invalid_args)
 {
@@ -147,4 +500,49 @@ TEST_F(test_ucg_group, create_fail_init_topo)
     stub::mock(stub::CALLOC, {stub::FAILURE}, "ucg topo");
     ASSERT_NE(ucg_group_create(m_context, &test_stub_group_params, &group), UCG_OK);
 }
-#endif
\ No newline at end of file
+#endif
+
+TEST(test_ucg_group_req_id, window)
+{
+    ucg_context_t context = {};
+    context.req_id_window = 4;
+    ucg_group_t group = {};
+    group.context = &context;
+    ucg_list_head_init(&group.id_list);
+
+    ucg_plan_op_t ops[5] = {};
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(ucg_group_alloc_req_id(&group, &ops[i].super), UCG_OK);
+        ASSERT_EQ(ops[i].super.id, (uint32_t)i + 1);
+    }
+
+    // Completing a request that isn't the oldest doesn't free the id.
+    ucg_group_free_req_id(&group, &ops[3].super);
+
+    // Id 5 is the same as id 1 in the low 2 bits, retry after the oldest request.
+    ASSERT_EQ(ucg_group_alloc_req_id(&group, &ops[4].super), UCG_ERR_NO_RESOURCE);
+    ASSERT_EQ(group.unique_req_id, 4);
+    ucg_group_free_req_id(&group, &ops[0].super);
+    ASSERT_EQ(ucg_group_alloc_req_id(&group, &ops[4].super), UCG_OK);
+    ASSERT_EQ(ops[4].super.id, 5);
+    ASSERT_EQ(ops[1].super.id, 2);
+
+    ucg_group_free_req_id(&group, &ops[1].super);
+    ucg_group_free_req_id(&group, &ops[2].super);
+    ucg_group_free_req_id(&group, &ops[4].super);
+}
+
+TEST(test_ucg_group_req_id, skip_invalid)
+{
+    ucg_context_t context = {};
+    context.req_id_window = UINT32_MAX;
+    ucg_group_t group = {};
+    group.context = &context;
+    group.unique_req_id = UINT32_MAX;
+    ucg_list_head_init(&group.id_list);
+
+    ucg_request_t request;
+    ASSERT_EQ(ucg_group_alloc_req_id(&group, &request), UCG_OK);
+    ASSERT_EQ(request.id, 1);
+    ucg_group_free_req_id(&group, &request);
+}
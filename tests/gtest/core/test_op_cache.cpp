@@ -0,0 +1,150 @@
+/*
+* Copyright (c) Huawei Rechnologies Co., Ltd. 2022-2022. All rights reserved.
+*/
+
+#include "test_plan.h"
+
+extern "C" {
+#include "core/ucg_op_cache.h"
+}
+
+#include <vector>
+
+static ucg_dt_t predefined_dt = {UCG_DT_TYPE_INT32,
+                                 (ucg_dt_flag_t)(UCG_DT_FLAG_IS_PREDEFINED |
+                                                 UCG_DT_FLAG_IS_CONTIGUOUS),
+                                 4, 4};
+static ucg_dt_t user_dt = {UCG_DT_TYPE_USER, UCG_DT_FLAG_IS_CONTIGUOUS, 4, 4};
+static ucg_op_t predefined_op = {UCG_OP_TYPE_SUM,
+                                 (ucg_op_flag_t)(UCG_OP_FLAG_IS_PREDEFINED |
+                                                 UCG_OP_FLAG_IS_PERSISTENT)};
+static ucg_coll_args_t allreduce_args(const void *sendbuf, void *recvbuf, int32_t count)
+{
+    ucg_coll_args_t args = {};
+    args.type = UCG_COLL_TYPE_ALLREDUCE;
+    args.info.mem_type = UCG_MEM_TYPE_HOST;
+    args.allreduce.sendbuf = sendbuf;
+    args.allreduce.recvbuf = recvbuf;
+    args.allreduce.count = count;
+    args.allreduce.dt = &predefined_dt;
+    args.allreduce.op = &predefined_op;
+    return args;
+}
+
+class test_ucg_op_cache : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        discarded() = 0;
+    }
+};
+
+TEST_F(test_ucg_op_cache, key)
+{
+    int sendbuf[8];
+    int recvbuf[8];
+    ucg_op_cache_key_t key1;
+    ucg_op_cache_key_t key2;
+
+    ucg_coll_args_t args = allreduce_args(sendbuf, recvbuf, 8);
+    ASSERT_EQ(ucg_op_cache_key_init(&key1, &args), UCG_OK);
+    /* Buffers are not part of the key. */
+    args = allreduce_args(recvbuf, sendbuf, 8);
+    ASSERT_EQ(ucg_op_cache_key_init(&key2, &args), UCG_OK);
+    EXPECT_EQ(memcmp(&key1, &key2, sizeof(key1)), 0);
+
+    args = allreduce_args(UCG_IN_PLACE, recvbuf, 8);
+    ASSERT_EQ(ucg_op_cache_key_init(&key2, &args), UCG_OK);
+    EXPECT_NE(memcmp(&key1, &key2, sizeof(key1)), 0);
+
+    args = allreduce_args(sendbuf, recvbuf, 4);
+    ASSERT_EQ(ucg_op_cache_key_init(&key2, &args), UCG_OK);
+    EXPECT_NE(memcmp(&key1, &key2, sizeof(key1)), 0);
+
+    /* User datatype may be freed and reused, not cacheable. */
+    args.allreduce.dt = &user_dt;
+    EXPECT_EQ(ucg_op_cache_key_init(&key2, &args), UCG_ERR_UNSUPPORTED);
+
+    args = {};
+    args.type = UCG_COLL_TYPE_ALLTOALLV;
+    EXPECT_EQ(ucg_op_cache_key_init(&key2, &args), UCG_ERR_UNSUPPORTED);
+}
+
+TEST_F(test_ucg_op_cache, reuse)
+{
+    int sendbuf[8];
+    int recvbuf[8];
+    ucg_op_cache_t cache;
+    ASSERT_EQ(ucg_op_cache_init(&cache, 4), UCG_OK);
+
+    ucg_coll_args_t args = allreduce_args(sendbuf, recvbuf, 8);
+    ucg_plan_op_t *op = new_op(nullptr, &args);
+    ASSERT_EQ(ucg_op_cache_put(&cache, op), UCG_OK);
+    EXPECT_EQ(discarded(), 0);
+
+    ucg_op_cache_key_t key;
+    ucg_coll_args_t new_args = allreduce_args(recvbuf, sendbuf, 8);
+    ASSERT_EQ(ucg_op_cache_key_init(&key, &new_args), UCG_OK);
+    ASSERT_EQ(ucg_op_cache_get(&cache, &key), op);
+    /* The op is taken out of the cache. */
+    EXPECT_EQ(ucg_op_cache_get(&cache, &key), nullptr);
+
+    ASSERT_EQ(op->rebind(op, &new_args), UCG_OK);
+    EXPECT_EQ(op->super.args.allreduce.sendbuf, recvbuf);
+    EXPECT_EQ(op->super.args.allreduce.recvbuf, sendbuf);
+
+    ASSERT_EQ(ucg_op_cache_put(&cache, op), UCG_OK);
+    ucg_op_cache_cleanup(&cache);
+    EXPECT_EQ(discarded(), 1);
+}
+
+TEST_F(test_ucg_op_cache, evict_least_recently_cached)
+{
+    int buf[8];
+    ucg_op_cache_t cache;
+    ASSERT_EQ(ucg_op_cache_init(&cache, 2), UCG_OK);
+
+    std::vector<ucg_coll_args_t> args;
+    for (int32_t count = 1; count <= 3; ++count) {
+        args.push_back(allreduce_args(buf, buf, count));
+    }
+    for (auto &a : args) {
+        ASSERT_EQ(ucg_op_cache_put(&cache, new_op(nullptr, &a)), UCG_OK);
+    }
+    EXPECT_EQ(discarded(), 1);
+
+    ucg_op_cache_key_t key;
+    ASSERT_EQ(ucg_op_cache_key_init(&key, &args[0]), UCG_OK);
+    EXPECT_EQ(ucg_op_cache_get(&cache, &key), nullptr);
+    for (size_t i = 1; i < args.size(); ++i) {
+        ASSERT_EQ(ucg_op_cache_key_init(&key, &args[i]), UCG_OK);
+        ucg_plan_op_t *op = ucg_op_cache_get(&cache, &key);
+        ASSERT_NE(op, nullptr);
+        EXPECT_EQ(op->super.args.allreduce.count, args[i].allreduce.count);
+        op->discard(op);
+    }
+    ucg_op_cache_cleanup(&cache);
+}
+
+TEST_F(test_ucg_op_cache, discard_uncacheable)
+{
+    int buf[8];
+    ucg_op_cache_t cache;
+
+    ASSERT_EQ(ucg_op_cache_init(&cache, 0), UCG_OK);
+    ucg_coll_args_t args = allreduce_args(buf, buf, 8);
+    EXPECT_EQ(ucg_op_cache_put(&cache, new_op(nullptr, &args)), UCG_OK);
+    EXPECT_EQ(discarded(), 1);
+    ucg_op_cache_cleanup(&cache);
+
+    ASSERT_EQ(ucg_op_cache_init(&cache, 4), UCG_OK);
+    /* Op without rebind */
+    EXPECT_EQ(ucg_op_cache_put(&cache, new_op(nullptr, &args, false)), UCG_OK);
+    EXPECT_EQ(discarded(), 2);
+    /* Failed op */
+    ucg_plan_op_t *op = new_op(nullptr, &args);
+    op->super.status = UCG_ERR_NO_RESOURCE;
+    EXPECT_EQ(ucg_op_cache_put(&cache, op), UCG_OK);
+    EXPECT_EQ(discarded(), 3);
+    ucg_op_cache_cleanup(&cache);
+}
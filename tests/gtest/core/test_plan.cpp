@@ -4,6 +4,8 @@
 
 #include "test_plan.h"
 
+#include <tuple>
+
 extern "C" {
 #include "core/ucg_vgroup.h"
 }
@@ -17,28 +19,6 @@ static ucg_dt_t dt = {UCG_DT_TYPE_INT8};
 static ucg_coll_type_t coll_type = UCG_COLL_TYPE_BCAST;
 static ucg_mem_type_t mem_type = UCG_MEM_TYPE_HOST;
 
-/**
- * For fallback
- */
-static ucg_status_t prepare_unsupported(ucg_vgroup_t *vgroup,
-                                        const ucg_coll_args_t *args,
-                                        ucg_plan_op_t **op)
-{
-    return UCG_ERR_UNSUPPORTED;
-}
-
-static ucg_status_t prepare_ok(ucg_vgroup_t *vgroup,
-                               const ucg_coll_args_t *args,
-                               ucg_plan_op_t **op)
-{
-    /**
-     * Just easy for test, we can use different value of group to
-     * check ucg_plan_prepare() function
-     */
-    *op = (ucg_plan_op_t *)vgroup;
-    return UCG_OK;
-}
-
 static void dump_plan(ucg_list_link_t *list)
 {
 #ifdef TEST_UCG_PLAN_ENABLE_DUMP_PLAN
@@ -82,7 +62,7 @@ TEST(test_ucg_plan, invalid_args)
     EXPECT_EQ(ucg_plans_init(nullptr), UCG_ERR_INVALID_PARAM);
     EXPECT_EQ(ucg_plans_add(nullptr, nullptr), UCG_ERR_INVALID_PARAM);
     EXPECT_EQ(ucg_plans_merge(nullptr, nullptr), UCG_ERR_INVALID_PARAM);
-    EXPECT_EQ(ucg_plans_prepare(nullptr, nullptr, 0, nullptr), UCG_ERR_INVALID_PARAM);
+    EXPECT_EQ(ucg_plans_prepare(nullptr, nullptr, 0, nullptr, nullptr), UCG_ERR_INVALID_PARAM);
 
     ucg_plans_cleanup(plans);
 }
@@ -169,12 +149,156 @@ TEST(test_ucg_plan, call_fallback)
         },
     };
     uint32_t size = 128;
-    ASSERT_EQ(ucg_plans_prepare(plans, &args, size, &op), UCG_OK);
+    /* The plans are selectable after the tables are built. */
+    EXPECT_EQ(ucg_plans_prepare(plans, &args, size, nullptr, &op), UCG_ERR_NOT_FOUND);
+    ASSERT_EQ(ucg_plans_build(plans), UCG_OK);
+    ASSERT_EQ(ucg_plans_prepare(plans, &args, size, nullptr, &op), UCG_OK);
     EXPECT_EQ(op, OP_PTR(11));
 
     ucg_plans_cleanup(plans);
 }
 
+TEST(test_ucg_plan, prepare_lookup_table)
+{
+    ucg_plans_t *plans = nullptr;
+    std::vector<ucg_plan_params_t> params {
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {0, 100}, VGRP_PTR(10), 10}},
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {200, 300}, VGRP_PTR(11), 10}},
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {250, 1000}, VGRP_PTR(12), 12}},
+        {mem_type, coll_type, {prepare_unsupported, 0, "", "", 0, {500, 600}, VGRP_PTR(13), 20}},
+    };
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+
+    for (auto &p : params) {
+        ASSERT_EQ(ucg_plans_add(plans, &p), UCG_OK);
+    }
+    ASSERT_EQ(ucg_plans_build(plans), UCG_OK);
+
+    /* The message size equals to the count. */
+    ucg_dt_t dt_byte = dt;
+    dt_byte.size = 1;
+    /* {message size, expected op}, nullptr means no plan */
+    std::vector<std::pair<int32_t, ucg_plan_op_t*>> expect = {
+        {0, OP_PTR(10)}, {99, OP_PTR(10)}, {100, nullptr}, {199, nullptr},
+        {200, OP_PTR(11)}, {249, OP_PTR(11)}, {250, OP_PTR(12)}, {499, OP_PTR(12)},
+        {500, OP_PTR(12)}, {599, OP_PTR(12)}, {600, OP_PTR(12)}, {999, OP_PTR(12)},
+        {1000, nullptr},
+    };
+    uint32_t size = 128;
+    for (auto &e : expect) {
+        ucg_plan_op_t *op = NULL;
+        ucg_coll_args_t args = {
+            .type = coll_type,
+            .bcast = {
+                .count = e.first,
+                .dt = &dt_byte,
+            },
+        };
+        args.info.mem_type = mem_type;
+        if (e.second == nullptr) {
+            EXPECT_EQ(ucg_plans_prepare(plans, &args, size, nullptr, &op), UCG_ERR_NOT_FOUND);
+        } else {
+            ASSERT_EQ(ucg_plans_prepare(plans, &args, size, nullptr, &op), UCG_OK);
+            EXPECT_EQ(op, e.second);
+        }
+    }
+
+    ucg_plans_cleanup(plans);
+}
+
+TEST(test_ucg_plan, prepare_lookup_table_beyond_4g)
+{
+    const uint64_t GB = 1ull << 30;
+    ucg_plans_t *plans = nullptr;
+    std::vector<ucg_plan_params_t> params {
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {0, 4 * GB}, VGRP_PTR(10), 10}},
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {4 * GB, 8 * GB}, VGRP_PTR(11), 10}},
+    };
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+
+    for (auto &p : params) {
+        ASSERT_EQ(ucg_plans_add(plans, &p), UCG_OK);
+    }
+    ASSERT_EQ(ucg_plans_build(plans), UCG_OK);
+
+    /* The message size is 4 times the count. */
+    ucg_dt_t dt_int32 = dt;
+    dt_int32.size = 4;
+    /* {count, expected op}, nullptr means no plan */
+    std::vector<std::pair<int32_t, ucg_plan_op_t*>> expect = {
+        {1, OP_PTR(10)}, {(int32_t)(GB - 1), OP_PTR(10)}, {(int32_t)GB, OP_PTR(11)},
+        {(int32_t)(GB + 1), OP_PTR(11)}, {INT32_MAX, OP_PTR(11)},
+    };
+    uint32_t size = 128;
+    for (auto &e : expect) {
+        ucg_plan_op_t *op = NULL;
+        ucg_coll_args_t args = {
+            .type = coll_type,
+            .bcast = {
+                .count = e.first,
+                .dt = &dt_int32,
+            },
+        };
+        args.info.mem_type = mem_type;
+        ASSERT_EQ(ucg_plans_prepare(plans, &args, size, nullptr, &op), UCG_OK);
+        EXPECT_EQ(op, e.second);
+    }
+
+    ucg_plans_cleanup(plans);
+}
+
+TEST(test_ucg_plan, prepare_bound_plans)
+{
+    ucg_plans_t *plans = nullptr;
+    std::vector<ucg_plan_params_t> params {
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {0, 100}, VGRP_PTR(10), 10}},
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {100, 200}, VGRP_PTR(11), 10}},
+        {mem_type, coll_type, {prepare_ok, 0, "", "", 0, {200, 300}, VGRP_PTR(12), 10}},
+    };
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+
+    for (auto &p : params) {
+        ASSERT_EQ(ucg_plans_add(plans, &p), UCG_OK);
+    }
+    ASSERT_EQ(ucg_plans_build(plans), UCG_OK);
+
+    /* The plans of 10 and 11 are provided by the planc groups of the builder,
+       another group sharing the plans executes them with its own planc groups. */
+    ucg_planc_group_h builder[] = {(ucg_planc_group_h)11, (ucg_planc_group_h)10};
+    ucg_planc_group_h other[] = {(ucg_planc_group_h)21, (ucg_planc_group_h)20};
+    // The plan of 12 is executed by its own vgroup, so the plans can't be shared.
+    ASSERT_FALSE(ucg_plans_bind(plans, builder, 2));
+
+    ucg_dt_t dt_byte = dt;
+    dt_byte.size = 1;
+    /* {message size, expected op of builder, expected op of other} */
+    std::vector<std::tuple<int32_t, ucg_plan_op_t*, ucg_plan_op_t*>> expect = {
+        {0, OP_PTR(10), OP_PTR(20)}, {100, OP_PTR(11), OP_PTR(21)},
+        {200, OP_PTR(12), OP_PTR(12)},
+    };
+    uint32_t size = 128;
+    for (auto &e : expect) {
+        ucg_plan_op_t *op = NULL;
+        ucg_coll_args_t args = {
+            .type = coll_type,
+            .bcast = {
+                .count = std::get<0>(e),
+                .dt = &dt_byte,
+            },
+        };
+        args.info.mem_type = mem_type;
+        ASSERT_EQ(ucg_plans_prepare(plans, &args, size, builder, &op), UCG_OK);
+        EXPECT_EQ(op, std::get<1>(e));
+        ASSERT_EQ(ucg_plans_prepare(plans, &args, size, other, &op), UCG_OK);
+        EXPECT_EQ(op, std::get<2>(e));
+        /* Without the planc groups, the plans are executed by their vgroups. */
+        ASSERT_EQ(ucg_plans_prepare(plans, &args, size, nullptr, &op), UCG_OK);
+        EXPECT_EQ(op, std::get<1>(e));
+    }
+
+    ucg_plans_cleanup(plans);
+}
+
 TEST(test_ucg_plan, marge_list)
 {
     ucg_plans_t *dst = nullptr;
@@ -552,6 +676,28 @@ TEST(test_ucg_plan_attr_update, range)
     ASSERT_TRUE(attr.range.end == UCG_PLAN_RANGE_MAX);
 }
 
+TEST(test_ucg_plan_attr_update, range_beyond_4g)
+{
+    ucg_vgroup_t vgroup = {
+        .myrank = 0,
+        .size = 10,
+        .rank_map = {
+            .type = UCG_RANK_MAP_TYPE_FULL,
+            .size = 10,
+        },
+    };
+    ucg_plan_attr_t attr = {prepare_ok, 1, "", "", 0, {1000, 2000}, &vgroup, 10};
+    const char *update = "I:1R:4294967295-4294967297";
+    ASSERT_EQ(ucg_plan_attr_update(&attr, update), UCG_OK);
+    ASSERT_EQ(attr.range.start, 4294967295ull);
+    ASSERT_EQ(attr.range.end, 4294967297ull);
+
+    update = "I:1R:8589934592-";
+    ASSERT_EQ(ucg_plan_attr_update(&attr, update), UCG_OK);
+    ASSERT_EQ(attr.range.start, 8589934592ull);
+    ASSERT_EQ(attr.range.end, UCG_PLAN_RANGE_MAX);
+}
+
 TEST(test_ucg_plan_attr_update, range_invalid_fmt)
 {
     ucg_vgroup_t vgroup = {
@@ -608,4 +754,20 @@ TEST(test_ucg_plan_attr_update, group_size_invalid_fmt)
     /* start >= end */
     update = "I:1G:10-10I:11G:1-1000";
     ASSERT_EQ(ucg_plan_attr_update(&attr, update), UCG_ERR_INVALID_PARAMS);
-}
\ No newline at end of file
+}
+TEST(test_ucg_plan_meta_op, event_driven)
+{
+    ucg_plan_meta_op_t meta_op = {};
+    meta_op.super.super.event_driven = 1;
+    ucg_plan_op_t event_op = {};
+    event_op.super.event_driven = 1;
+    ucg_plan_op_t polled_op = {};
+
+    ASSERT_EQ(ucg_plan_meta_op_add(&meta_op, &event_op), UCG_OK);
+    ASSERT_EQ(meta_op.super.super.event_driven, 1);
+    // One polled op makes the whole meta op polled.
+    ASSERT_EQ(ucg_plan_meta_op_add(&meta_op, &polled_op), UCG_OK);
+    ASSERT_EQ(meta_op.super.super.event_driven, 0);
+    ASSERT_EQ(ucg_plan_meta_op_add(&meta_op, &event_op), UCG_OK);
+    ASSERT_EQ(meta_op.super.super.event_driven, 0);
+}
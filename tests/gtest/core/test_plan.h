@@ -14,7 +14,7 @@ extern "C" {
 #include <gtest/gtest.h>
 
 static const size_t KB = 1024;
-static const size_t KB = 1024 * 1024;
+static const size_t MB = 1024 * 1024;
 
 static inline ucg_plan_t assign_from_params(const ucg_plan_params_t *params,
     uint64_t start, uint64_t end)
@@ -24,22 +24,77 @@ static inline ucg_plan_t assign_from_params(const ucg_plan_params_t *params,
     ucg_list_head_init(&plan.list);
     ucg_list_head_init(&plan.fallback);
 
-    plan.attr.prepare = params->atte.prepare;
-    plan.attr.vgroup = params->atte.vgroup;
-    plan.attr.score = params->atte.score;
+    plan.attr.prepare = params->attr.prepare;
+    plan.attr.vgroup = params->attr.vgroup;
+    plan.attr.score = params->attr.score;
     plan.attr.range.start = start;
     plan.attr.range.end = end;
 
     return plan;
 }
 
+/* Number of ops released by discard(). */
+static inline int& discarded()
+{
+    static int count = 0;
+    return count;
+}
+
+static inline ucg_status_t discard(ucg_plan_op_t *op)
+{
+    ++discarded();
+    UCG_CLASS_DESTRUCT(ucg_plan_op_t, op);
+    delete op;
+    return UCG_OK;
+}
+
+/* Allocate an op that is released by its discard(). */
+static inline ucg_plan_op_t* new_op(ucg_vgroup_t *vgroup, const ucg_coll_args_t *args,
+                                    bool rebind = true)
+{
+    ucg_plan_op_t *op = new ucg_plan_op_t;
+    EXPECT_EQ(UCG_CLASS_CONSTRUCT(ucg_plan_op_t, op, vgroup, nullptr, nullptr,
+                                  discard, args), UCG_OK);
+    if (rebind) {
+        op->rebind = ucg_plan_op_rebind_buffers;
+    }
+    return op;
+}
+
+/**
+ * Just easy for test, the vgroup is returned as the op, so the different values
+ * of vgroup tell which plan is selected.
+ */
+static inline ucg_status_t prepare_ok(ucg_vgroup_t *vgroup, const ucg_coll_args_t *args,
+                                      ucg_plan_op_t **op)
+{
+    *op = (ucg_plan_op_t *)vgroup;
+    return UCG_OK;
+}
+
+/* Same as prepare_ok(), but the op is allocated by new_op(). */
+static inline ucg_status_t prepare_new_op(ucg_vgroup_t *vgroup, const ucg_coll_args_t *args,
+                                          ucg_plan_op_t **op)
+{
+    *op = new_op(vgroup, args);
+    return UCG_OK;
+}
+
+/* For fallback */
+static inline ucg_status_t prepare_unsupported(ucg_vgroup_t *vgroup,
+                                               const ucg_coll_args_t *args,
+                                               ucg_plan_op_t **op)
+{
+    return UCG_ERR_UNSUPPORTED;
+}
+
 struct test_expect_plan_data {
     test_expect_plan_data(const ucg_plan_params_t *params, uint64_t start, uint64_t end)
     {
         plan = assign_from_params(params, start, end);
     }
 
-    test_expect_plan_data(const ucg_plan_t &p, const std::vector<>ucg_plan_t> &v)
+    test_expect_plan_data(const ucg_plan_t &p, const std::vector<ucg_plan_t> &v)
     {
         plan = p;
         fallback = v;
@@ -79,7 +134,7 @@ struct test_expect_plan_data {
         int idx = 0;
         ucg_plan_t *fb;
         ASSERT_EQ(fallback.size(), ucg_list_length(&p->fallback));
-        ucg_list_for_each(fb, &p->fallback, fall_back) {
+        ucg_list_for_each(fb, &p->fallback, fallback) {
             EXPECT_EQ(is_same_plan(fb, &fallback[idx]), true);
             ++idx;
         }
@@ -0,0 +1,219 @@
+/*
+* Copyright (c) Huawei Rechnologies Co., Ltd. 2022-2022. All rights reserved.
+*/
+
+#include "test_plan.h"
+
+extern "C" {
+#include "core/ucg_plan_cost.h"
+#include "core/ucg_context.h"
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "core/ucg_vgroup.h"
+}
+
+/* Cost of a flat algorithm whose latency term dominates. */
+static double cost_latency_bound(const ucg_plan_cost_params_t *params)
+{
+    ucg_plan_cost_level_t level = ucg_plan_cost_top_level(params->topo);
+    return ucg_plan_cost_rd(params->model, level, params->topo->size, params->msg_size);
+}
+
+/* Cost of a flat algorithm whose bandwidth term dominates. */
+static double cost_bandwidth_bound(const ucg_plan_cost_params_t *params)
+{
+    ucg_plan_cost_level_t level = ucg_plan_cost_top_level(params->topo);
+    uint32_t nprocs = params->topo->size;
+    return ucg_plan_cost_ring_reduce_scatter(params->model, level, nprocs, params->msg_size) +
+           ucg_plan_cost_ring_allgather(params->model, level, nprocs, params->msg_size);
+}
+
+class test_ucg_plan_cost : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        ucg_plan_cost_link_t socket = {0.3e-6, 20e9};
+        ucg_plan_cost_link_t node = {0.6e-6, 10e9};
+        ucg_plan_cost_link_t net = {2e-6, 10e9};
+        m_model.links[UCG_PLAN_COST_LEVEL_SOCKET] = socket;
+        m_model.links[UCG_PLAN_COST_LEVEL_NODE] = node;
+        m_model.links[UCG_PLAN_COST_LEVEL_NET] = net;
+        m_model.reduce_bandwidth = 8e9;
+
+        /* 4 nodes, 2 sockets per node, 8 processes per socket */
+        m_topo.ppn = 16;
+        m_topo.pps = 8;
+        m_group.size = 64;
+        m_group.topo = &m_topo;
+        m_group.context = &m_context;
+        m_vgroup.size = 64;
+        m_vgroup.group = &m_group;
+        m_context.use_cost_model = 1;
+        m_context.cost_model = m_model;
+    }
+
+    void add_plan(ucg_plans_t *plans, int id, ucg_plan_cost_func_t cost,
+                  uint32_t score, int8_t score_fixed = 0,
+                  ucg_plan_prepare_func_t prepare = prepare_ok)
+    {
+        ucg_plan_params_t params = {};
+        params.mem_type = UCG_MEM_TYPE_HOST;
+        params.coll_type = UCG_COLL_TYPE_ALLREDUCE;
+        params.attr.prepare = prepare;
+        params.attr.id = id;
+        params.attr.name = "test";
+        params.attr.domain = "test";
+        params.attr.range.start = 0;
+        params.attr.range.end = UCG_PLAN_RANGE_MAX;
+        params.attr.vgroup = &m_vgroup;
+        params.attr.score = score;
+        params.attr.cost = cost;
+        params.attr.score_fixed = score_fixed;
+        ASSERT_EQ(ucg_plans_add(plans, &params), UCG_OK);
+        ASSERT_EQ(ucg_plans_build(plans), UCG_OK);
+    }
+
+    const ucg_plan_table_entry_t *entry(ucg_plans_t *plans)
+    {
+        const ucg_plan_table_t *table;
+        table = &plans->tables[UCG_COLL_TYPE_ALLREDUCE][UCG_MEM_TYPE_HOST];
+        return &table->entries[0];
+    }
+
+    ucg_plan_cost_model_t m_model;
+    ucg_context_t m_context = {};
+    ucg_topo_t m_topo = {};
+    ucg_group_t m_group = {};
+    ucg_vgroup_t m_vgroup = {};
+};
+
+TEST_F(test_ucg_plan_cost, estimators)
+{
+    ucg_plan_cost_level_t net = UCG_PLAN_COST_LEVEL_NET;
+    ASSERT_EQ(ucg_plan_cost_kntree(&m_model, net, 1, 4, 1024), 0);
+    ASSERT_EQ(ucg_plan_cost_rd(&m_model, net, 1, 1024), 0);
+
+    /* 3 rounds of binomial tree among 8 processes */
+    ASSERT_DOUBLE_EQ(ucg_plan_cost_kntree(&m_model, net, 8, 2, 0), 3 * 2e-6);
+    /* 2 rounds of 4-nomial tree, the degree is not larger than the processes */
+    ASSERT_DOUBLE_EQ(ucg_plan_cost_kntree(&m_model, net, 16, 4, 0), 2 * 2e-6);
+    ASSERT_DOUBLE_EQ(ucg_plan_cost_kntree(&m_model, net, 2, 8, 0), 2e-6);
+    /* The extra processes of non-power-of-two take 2 steps more. */
+    ASSERT_DOUBLE_EQ(ucg_plan_cost_rd(&m_model, net, 6, 0), 4 * 2e-6);
+
+    /* The faster level, the smaller cost. */
+    ASSERT_LT(ucg_plan_cost_kntree(&m_model, UCG_PLAN_COST_LEVEL_SOCKET, 8, 2, 4096),
+              ucg_plan_cost_kntree(&m_model, UCG_PLAN_COST_LEVEL_NODE, 8, 2, 4096));
+    ASSERT_LT(ucg_plan_cost_kntree(&m_model, UCG_PLAN_COST_LEVEL_NODE, 8, 2, 4096),
+              ucg_plan_cost_kntree(&m_model, net, 8, 2, 4096));
+
+    /* Recursive doubling wins the small message, ring wins the large one. */
+    double ring_small = ucg_plan_cost_ring_reduce_scatter(&m_model, net, 64, 8) +
+                        ucg_plan_cost_ring_allgather(&m_model, net, 64, 8);
+    ASSERT_LT(ucg_plan_cost_rd(&m_model, net, 64, 8), ring_small);
+    double ring_large = ucg_plan_cost_ring_reduce_scatter(&m_model, net, 64, 1 << 24) +
+                        ucg_plan_cost_ring_allgather(&m_model, net, 64, 1 << 24);
+    ASSERT_GT(ucg_plan_cost_rd(&m_model, net, 64, 1 << 24), ring_large);
+    double rabenseifner = ucg_plan_cost_rh_reduce_scatter(&m_model, net, 64, 1 << 24) +
+                          ucg_plan_cost_rd_allgather(&m_model, net, 64, 1 << 24);
+    ASSERT_GT(ucg_plan_cost_rd(&m_model, net, 64, 1 << 24), rabenseifner);
+}
+
+TEST_F(test_ucg_plan_cost, topo)
+{
+    ucg_plan_cost_topo_t topo;
+    ucg_plan_cost_topo_init(&topo, &m_vgroup);
+    ASSERT_EQ(topo.size, 64);
+    ASSERT_EQ(topo.nnode, 4);
+    ASSERT_EQ(topo.ppn, 16);
+    ASSERT_EQ(topo.pps, 8);
+    ASSERT_EQ(ucg_plan_cost_top_level(&topo), UCG_PLAN_COST_LEVEL_NET);
+
+    ucg_plan_cost_level_t level;
+    uint32_t nprocs;
+    ucg_plan_cost_topo_group(&topo, UCG_TOPO_GROUP_TYPE_NODE, &level, &nprocs);
+    ASSERT_EQ(level, UCG_PLAN_COST_LEVEL_NODE);
+    ASSERT_EQ(nprocs, 16);
+    ucg_plan_cost_topo_group(&topo, UCG_TOPO_GROUP_TYPE_NODE_LEADER, &level, &nprocs);
+    ASSERT_EQ(level, UCG_PLAN_COST_LEVEL_NET);
+    ASSERT_EQ(nprocs, 4);
+    ucg_plan_cost_topo_group(&topo, UCG_TOPO_GROUP_TYPE_SOCKET, &level, &nprocs);
+    ASSERT_EQ(level, UCG_PLAN_COST_LEVEL_SOCKET);
+    ASSERT_EQ(nprocs, 8);
+    ucg_plan_cost_topo_group(&topo, UCG_TOPO_GROUP_TYPE_SOCKET_LEADER, &level, &nprocs);
+    ASSERT_EQ(level, UCG_PLAN_COST_LEVEL_NODE);
+    ASSERT_EQ(nprocs, 2);
+    ucg_plan_cost_topo_group(&topo, UCG_TOPO_GROUP_TYPE_NET, &level, &nprocs);
+    ASSERT_EQ(level, UCG_PLAN_COST_LEVEL_NET);
+    ASSERT_EQ(nprocs, 64);
+
+    /* Unbalanced nodes and sockets use the ceiling of the average. */
+    m_topo.ppn = UCG_TOPO_PPX_UNBALANCED;
+    m_topo.pps = UCG_TOPO_PPX_UNBALANCED;
+    m_topo.detail.nnode = 3;
+    m_topo.detail.nsocket = 2;
+    ucg_plan_cost_topo_init(&topo, &m_vgroup);
+    ASSERT_EQ(topo.nnode, 3);
+    ASSERT_EQ(topo.ppn, 22);
+    ASSERT_EQ(topo.pps, 11);
+
+    /* Single socket */
+    m_topo.ppn = 8;
+    m_topo.pps = 8;
+    m_group.size = 8;
+    ucg_plan_cost_topo_init(&topo, &m_vgroup);
+    ASSERT_EQ(topo.nnode, 1);
+    ASSERT_EQ(ucg_plan_cost_top_level(&topo), UCG_PLAN_COST_LEVEL_SOCKET);
+}
+
+TEST_F(test_ucg_plan_cost, cheapest)
+{
+    ucg_plans_t *plans = NULL;
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+    add_plan(plans, 1, cost_latency_bound, 20);
+    add_plan(plans, 2, cost_bandwidth_bound, 10);
+    add_plan(plans, 3, NULL, 5);
+    const ucg_plan_table_entry_t *ent = entry(plans);
+    ASSERT_EQ(ent->num_plans, 3);
+
+    ASSERT_EQ(ucg_plan_table_entry_cheapest(ent, nullptr, 8), 0);
+    ASSERT_EQ(ucg_plan_table_entry_cheapest(ent, nullptr, 1 << 24), 1);
+    ASSERT_EQ(ent->plans[1]->attr.id, 2);
+
+    /* The estimate is not used if the cost model is disabled. */
+    m_context.use_cost_model = 0;
+    ASSERT_EQ(ucg_plan_table_entry_cheapest(ent, nullptr, 1 << 24), 0);
+    m_context.use_cost_model = 1;
+    ucg_plans_cleanup(plans);
+
+    /* The score given by user overrides the estimate. */
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+    add_plan(plans, 1, cost_latency_bound, 20, 1);
+    add_plan(plans, 2, cost_bandwidth_bound, 10);
+    ASSERT_EQ(ucg_plan_table_entry_cheapest(entry(plans), nullptr, 1 << 24), 0);
+    ucg_plans_cleanup(plans);
+
+    /* The first-class plan is not modeled. */
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+    add_plan(plans, 1, NULL, 20);
+    add_plan(plans, 2, cost_bandwidth_bound, 10);
+    ASSERT_EQ(ucg_plan_table_entry_cheapest(entry(plans), nullptr, 1 << 24), 0);
+    ucg_plans_cleanup(plans);
+
+    /* The other plans are the fallback of the cheapest one. */
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+    add_plan(plans, 1, cost_latency_bound, 20);
+    add_plan(plans, 2, cost_bandwidth_bound, 10, 0, prepare_unsupported);
+    ASSERT_EQ(ucg_plan_table_entry_cheapest(entry(plans), nullptr, 1 << 24), 1);
+    ucg_dt_t dt = {UCG_DT_TYPE_INT8};
+    dt.size = 1;
+    dt.extent = 1;
+    ucg_coll_args_t args = {};
+    args.type = UCG_COLL_TYPE_ALLREDUCE;
+    args.allreduce.count = 1 << 24;
+    args.allreduce.dt = &dt;
+    ucg_plan_op_t *op = NULL;
+    ASSERT_EQ(ucg_plans_prepare(plans, &args, m_group.size, nullptr, &op), UCG_OK);
+    ASSERT_EQ(op, (ucg_plan_op_t *)&m_vgroup);
+    ucg_plans_cleanup(plans);
+}
@@ -0,0 +1,288 @@
+/*
+* Copyright (c) Huawei Rechnologies Co., Ltd. 2022-2022. All rights reserved.
+*/
+
+#include "test_plan.h"
+
+extern "C" {
+#include "core/ucg_group.h"
+#include "core/ucg_plan_tuner.h"
+#include "core/ucg_plan_select.h"
+}
+
+static ucg_dt_t dt = {UCG_DT_TYPE_INT32,
+                      (ucg_dt_flag_t)(UCG_DT_FLAG_IS_PREDEFINED |
+                                      UCG_DT_FLAG_IS_CONTIGUOUS),
+                      4, 4};
+/* Each plan prepares the op with its own vgroup. */
+static char vgroup_a;
+static char vgroup_b;
+static char vgroup_c;
+
+class test_ucg_plan_tuner : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        m_group = {};
+        m_group.size = 1;
+        ASSERT_EQ(ucg_plans_init(&m_group.plans), UCG_OK);
+    }
+
+    void TearDown() override
+    {
+        ucg_plan_tuner_cleanup(&m_group.tuner);
+        ucg_plans_cleanup(m_group.plans);
+    }
+
+    void add_plan(int32_t id, ucg_vgroup_t *vgroup, uint32_t score,
+                  ucg_plan_prepare_func_t prepare = prepare_new_op)
+    {
+        ucg_plan_params_t params = {};
+        params.mem_type = UCG_MEM_TYPE_HOST;
+        params.coll_type = UCG_COLL_TYPE_BCAST;
+        params.attr.prepare = prepare;
+        params.attr.id = id;
+        params.attr.name = "test";
+        params.attr.domain = "test";
+        params.attr.range.start = 0;
+        params.attr.range.end = UCG_PLAN_RANGE_MAX;
+        params.attr.vgroup = vgroup;
+        params.attr.score = score;
+        ASSERT_EQ(ucg_plans_add(m_group.plans, &params), UCG_OK);
+        ASSERT_EQ(ucg_plans_build(m_group.plans), UCG_OK);
+    }
+
+    ucg_coll_args_t args(int32_t count)
+    {
+        ucg_coll_args_t args = {};
+        args.type = UCG_COLL_TYPE_BCAST;
+        args.info.mem_type = UCG_MEM_TYPE_HOST;
+        args.bcast.buffer = m_buffer;
+        args.bcast.count = count;
+        args.bcast.dt = &dt;
+        return args;
+    }
+
+    ucg_plan_tuner_bucket_t* bucket(int32_t count)
+    {
+        ucg_coll_args_t coll_args = args(count);
+        return ucg_plan_tuner_get(&m_group, &coll_args);
+    }
+
+    /* Decide the plan of one op and return its vgroup, NULL if not tuned. */
+    ucg_vgroup_t* decide(int32_t count, ucg_request_tune_t *tune = nullptr,
+                         ucg_status_t expected = UCG_OK)
+    {
+        ucg_coll_args_t coll_args = args(count);
+        ucg_plan_tuner_bucket_t *tuner_bucket = ucg_plan_tuner_get(&m_group, &coll_args);
+        EXPECT_TRUE(tuner_bucket != nullptr);
+        int32_t plan = -1;
+        int timed = 0;
+        EXPECT_EQ(ucg_plan_tuner_decide(&m_group, tuner_bucket, &coll_args, &plan, &timed),
+                  expected);
+        if (tune != nullptr) {
+            tune->bucket = timed ? tuner_bucket : nullptr;
+            tune->plan = plan;
+        }
+        if (expected != UCG_OK || plan == -1) {
+            return nullptr;
+        }
+        return tuner_bucket->entry->plans[plan]->attr.vgroup;
+    }
+
+    /* Decide the plan of one op and complete it in elapsed nanoseconds. */
+    ucg_vgroup_t* run(int32_t count, uint64_t elapsed)
+    {
+        ucg_request_tune_t tune;
+        ucg_vgroup_t *vgroup = decide(count, &tune);
+        if (tune.bucket != nullptr) {
+            ucg_plan_tuner_sample(tune.bucket, tune.plan, elapsed);
+        }
+        return vgroup;
+    }
+
+    ucg_group_t m_group;
+    int32_t m_buffer[4096];
+};
+
+#define VGRP_PTR(_val) (ucg_vgroup_t *)(_val)
+
+TEST_F(test_ucg_plan_tuner, disabled)
+{
+    add_plan(1, VGRP_PTR(&vgroup_a), 10);
+    add_plan(2, VGRP_PTR(&vgroup_b), 5);
+    ASSERT_EQ(ucg_plan_tuner_init(&m_group.tuner, 0, nullptr), UCG_OK);
+
+    ASSERT_TRUE(bucket(8) == nullptr);
+}
+
+TEST_F(test_ucg_plan_tuner, rotate_and_pin)
+{
+    add_plan(1, VGRP_PTR(&vgroup_a), 10);
+    add_plan(2, VGRP_PTR(&vgroup_b), 5);
+    ASSERT_EQ(ucg_plan_tuner_init(&m_group.tuner, 2, nullptr), UCG_OK);
+
+    /* The first op of each plan warms up and is not timed. */
+    ucg_request_tune_t tune;
+    ASSERT_EQ(decide(8, &tune), VGRP_PTR(&vgroup_a));
+    ASSERT_TRUE(tune.bucket == nullptr);
+    ASSERT_EQ(decide(8, &tune), VGRP_PTR(&vgroup_b));
+    ASSERT_TRUE(tune.bucket == nullptr);
+
+    for (int i = 0; i < 2; ++i) {
+        ASSERT_EQ(run(8, 200), VGRP_PTR(&vgroup_a));
+        ASSERT_EQ(run(8, 100), VGRP_PTR(&vgroup_b));
+    }
+
+    /* The faster plan is pinned although its score is lower. */
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(decide(8, &tune), VGRP_PTR(&vgroup_b));
+        ASSERT_TRUE(tune.bucket == nullptr);
+    }
+    ASSERT_EQ(bucket(8)->state, UCG_PLAN_TUNER_STATE_PINNED);
+
+    /* Sizes in another bucket are tuned on their own. */
+    ASSERT_EQ(decide(1024), VGRP_PTR(&vgroup_a));
+}
+
+TEST_F(test_ucg_plan_tuner, ops_not_cached_while_tuning)
+{
+    add_plan(1, VGRP_PTR(&vgroup_a), 10);
+    add_plan(2, VGRP_PTR(&vgroup_b), 5);
+    ASSERT_EQ(ucg_plan_tuner_init(&m_group.tuner, 1, nullptr), UCG_OK);
+
+    ucg_coll_args_t coll_args = args(8);
+    ucg_plan_op_t *op = nullptr;
+    ASSERT_EQ(ucg_plan_select_prepare(&m_group, &coll_args, &op), UCG_OK);
+    ASSERT_TRUE(op->rebind == NULL);
+    op->discard(op);
+}
+
+TEST_F(test_ucg_plan_tuner, vsize_agreed_when_started)
+{
+    m_group.size = 2;
+    ASSERT_EQ(ucg_plan_tuner_init(&m_group.tuner, 1, nullptr), UCG_OK);
+
+    /* The counts differ between the members, nothing is exchanged until the start. */
+    int32_t counts[2] = {8, 8};
+    int32_t displs[2] = {0, 8};
+    ucg_coll_args_t coll_args = {};
+    coll_args.type = UCG_COLL_TYPE_ALLTOALLV;
+    coll_args.info.mem_type = UCG_MEM_TYPE_HOST;
+    coll_args.alltoallv.sendbuf = m_buffer;
+    coll_args.alltoallv.sendcounts = counts;
+    coll_args.alltoallv.sdispls = displs;
+    coll_args.alltoallv.sendtype = &dt;
+    coll_args.alltoallv.recvbuf = m_buffer + 16;
+    coll_args.alltoallv.recvcounts = counts;
+    coll_args.alltoallv.rdispls = displs;
+    coll_args.alltoallv.recvtype = &dt;
+    ucg_plan_op_t *op = nullptr;
+    ASSERT_EQ(ucg_plan_select_prepare(&m_group, &coll_args, &op), UCG_OK);
+    ASSERT_TRUE(op->rebind == NULL);
+    ASSERT_TRUE(op->vgroup == NULL);
+    op->discard(op);
+}
+
+TEST_F(test_ucg_plan_tuner, skip_unsupported)
+{
+    add_plan(1, VGRP_PTR(&vgroup_a), 10, prepare_unsupported);
+    add_plan(2, VGRP_PTR(&vgroup_b), 5);
+    add_plan(3, VGRP_PTR(&vgroup_c), 1);
+    ASSERT_EQ(ucg_plan_tuner_init(&m_group.tuner, 1, nullptr), UCG_OK);
+
+    ASSERT_EQ(decide(8), VGRP_PTR(&vgroup_b));
+    ASSERT_EQ(decide(8), VGRP_PTR(&vgroup_c));
+    ASSERT_EQ(run(8, 100), VGRP_PTR(&vgroup_b));
+    ASSERT_EQ(run(8, 50), VGRP_PTR(&vgroup_c));
+    ASSERT_EQ(decide(8), VGRP_PTR(&vgroup_c));
+}
+
+TEST_F(test_ucg_plan_tuner, late_sample_ignored)
+{
+    add_plan(1, VGRP_PTR(&vgroup_a), 10);
+    add_plan(2, VGRP_PTR(&vgroup_b), 5);
+    ASSERT_EQ(ucg_plan_tuner_init(&m_group.tuner, 1, nullptr), UCG_OK);
+
+    ucg_request_tune_t tune_a;
+    ucg_request_tune_t tune_b;
+    decide(8);
+    decide(8);
+    ASSERT_EQ(decide(8, &tune_a), VGRP_PTR(&vgroup_a));
+    ASSERT_EQ(decide(8, &tune_b), VGRP_PTR(&vgroup_b));
+    ucg_plan_tuner_sample(tune_a.bucket, tune_a.plan, 100);
+    ucg_plan_tuner_sample(tune_b.bucket, tune_b.plan, 200);
+    ASSERT_EQ(decide(8), VGRP_PTR(&vgroup_a));
+
+    /* Completed after pinning, does not change the winner. */
+    ucg_plan_tuner_sample(tune_b.bucket, tune_b.plan, 0);
+    ASSERT_EQ(decide(8), VGRP_PTR(&vgroup_a));
+}
+
+TEST_F(test_ucg_plan_tuner, agree_on_disabled_plans)
+{
+    m_group.size = 2;
+    add_plan(1, VGRP_PTR(&vgroup_a), 10);
+    add_plan(2, VGRP_PTR(&vgroup_b), 5);
+    ASSERT_EQ(ucg_plan_tuner_init(&m_group.tuner, 1, nullptr), UCG_OK);
+
+    /* Both plans prepare here, but the first one fails on the other member. */
+    ucg_plan_tuner_bucket_t *tuner_bucket = bucket(8);
+    decide(8, nullptr, UCG_INPROGRESS);
+    ASSERT_EQ(tuner_bucket->values[0], 0u);
+    ASSERT_EQ(tuner_bucket->values[1], 0u);
+    tuner_bucket->values[0] = 1;
+    ucg_plan_tuner_agreed(&m_group, tuner_bucket, UCG_OK);
+
+    ASSERT_EQ(decide(8), VGRP_PTR(&vgroup_b));
+    ASSERT_EQ(run(8, 100), VGRP_PTR(&vgroup_b));
+    decide(8, nullptr, UCG_INPROGRESS);
+    ASSERT_EQ(tuner_bucket->values[0], UINT64_MAX);
+    ASSERT_EQ(tuner_bucket->values[1], 100u);
+    ucg_plan_tuner_agreed(&m_group, tuner_bucket, UCG_OK);
+    ASSERT_EQ(decide(8), VGRP_PTR(&vgroup_b));
+}
+
+TEST_F(test_ucg_plan_tuner, pin_slowest_member)
+{
+    m_group.size = 2;
+    add_plan(1, VGRP_PTR(&vgroup_a), 10);
+    add_plan(2, VGRP_PTR(&vgroup_b), 5);
+    ASSERT_EQ(ucg_plan_tuner_init(&m_group.tuner, 1, nullptr), UCG_OK);
+
+    ucg_plan_tuner_bucket_t *tuner_bucket = bucket(8);
+    decide(8, nullptr, UCG_INPROGRESS);
+    ucg_plan_tuner_agreed(&m_group, tuner_bucket, UCG_OK);
+    decide(8);
+    decide(8);
+    ASSERT_EQ(run(8, 100), VGRP_PTR(&vgroup_a));
+    ASSERT_EQ(run(8, 200), VGRP_PTR(&vgroup_b));
+
+    /* The first plan is faster here, but slower on the other member. */
+    decide(8, nullptr, UCG_INPROGRESS);
+    tuner_bucket->values[0] = 500;
+    ucg_plan_tuner_agreed(&m_group, tuner_bucket, UCG_OK);
+    ASSERT_EQ(decide(8), VGRP_PTR(&vgroup_b));
+}
+
+TEST_F(test_ucg_plan_tuner, stop_when_agreement_fails)
+{
+    m_group.size = 2;
+    add_plan(1, VGRP_PTR(&vgroup_a), 10);
+    add_plan(2, VGRP_PTR(&vgroup_b), 5);
+    ASSERT_EQ(ucg_plan_tuner_init(&m_group.tuner, 1, nullptr), UCG_OK);
+
+    ucg_plan_tuner_bucket_t *tuner_bucket = bucket(8);
+    decide(8, nullptr, UCG_INPROGRESS);
+    ucg_plan_tuner_agreed(&m_group, tuner_bucket, UCG_ERR_NO_RESOURCE);
+    ASSERT_EQ(tuner_bucket->state, UCG_PLAN_TUNER_STATE_STOPPED);
+    ASSERT_TRUE(decide(8) == nullptr);
+
+    /* The plans are selected as if not tuned, and the ops can be cached again. */
+    ucg_coll_args_t coll_args = args(8);
+    ucg_plan_op_t *op = nullptr;
+    ASSERT_EQ(ucg_plan_select_prepare(&m_group, &coll_args, &op), UCG_OK);
+    ASSERT_EQ(op->vgroup, VGRP_PTR(&vgroup_a));
+    ASSERT_TRUE(op->rebind != NULL);
+    op->discard(op);
+}
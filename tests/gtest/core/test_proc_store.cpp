@@ -0,0 +1,141 @@
+/*
+* Copyright (c) Huawei Rechnologies Co., Ltd. 2022-2022. All rights reserved.
+*/
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "core/ucg_proc_store.h"
+}
+
+#include <stdio.h>
+#include <vector>
+
+typedef std::vector<uint8_t> entry_t;
+
+/* Bytes that look like the worker address of a process in node. */
+static entry_t fake_address(uint32_t node, uint32_t rank, uint32_t size)
+{
+    entry_t entry(size);
+    uint32_t seed = node * 2654435761u + 1;
+    for (uint32_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245u + 12345;
+        entry[i] = (uint8_t)(seed >> 16);
+    }
+    // Unique id at the beginning and a few process-specific bytes scattered
+    // in the interface addresses.
+    for (uint32_t i = 0; i < 8; ++i) {
+        entry[4 + i] = (uint8_t)(rank >> (i % 4 * 8)) ^ (uint8_t)i;
+    }
+    for (uint32_t offset = 64; offset + 2 <= size; offset += 96) {
+        entry[offset] = (uint8_t)rank;
+        entry[offset + 1] = (uint8_t)(rank >> 8);
+    }
+    return entry;
+}
+
+static void expect_entry(const ucg_proc_store_t *store, uint32_t index, const entry_t &entry)
+{
+    ASSERT_EQ(ucg_proc_store_size(store, index), entry.size());
+    entry_t decoded(entry.size());
+    ucg_proc_store_get(store, index, decoded.data());
+    ASSERT_TRUE(decoded == entry);
+}
+
+TEST(test_ucg_proc_store, raw)
+{
+    ucg_proc_store_t store;
+    ASSERT_EQ(ucg_proc_store_init(&store, 3), UCG_OK);
+
+    std::vector<entry_t> entries = {fake_address(0, 0, 100), fake_address(1, 1, 37),
+                                    entry_t(1, 0xab)};
+    for (const entry_t &entry : entries) {
+        ASSERT_EQ(ucg_proc_store_add(&store, entry.data(), entry.size(),
+                                     UCG_PROC_STORE_NO_BASE), UCG_OK);
+    }
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        ASSERT_TRUE(ucg_proc_store_is_base(&store, i));
+        expect_entry(&store, i, entries[i]);
+    }
+    ucg_proc_store_cleanup(&store);
+}
+
+TEST(test_ucg_proc_store, difference)
+{
+    ucg_proc_store_t store;
+    ASSERT_EQ(ucg_proc_store_init(&store, 5), UCG_OK);
+
+    entry_t base = fake_address(0, 0, 400);
+    entry_t same = base;
+    entry_t peer = fake_address(0, 1, 400);
+    // Longer and shorter than the base.
+    entry_t longer = fake_address(0, 2, 500);
+    entry_t shorter = fake_address(0, 3, 300);
+    std::vector<entry_t> entries = {base, same, peer, longer, shorter};
+
+    ASSERT_EQ(ucg_proc_store_add(&store, base.data(), base.size(),
+                                 UCG_PROC_STORE_NO_BASE), UCG_OK);
+    uint64_t used = store.offsets[1];
+    for (uint32_t i = 1; i < entries.size(); ++i) {
+        ASSERT_EQ(ucg_proc_store_add(&store, entries[i].data(), entries[i].size(), 0), UCG_OK);
+        ASSERT_FALSE(ucg_proc_store_is_base(&store, i));
+    }
+    // Only the differences are stored.
+    ASSERT_LT(store.offsets[2] - store.offsets[1], 16);
+    ASSERT_LT(store.offsets[5] - used, (uint64_t)(400 + 500 + 300) / 4);
+    for (uint32_t i = 0; i < entries.size(); ++i) {
+        expect_entry(&store, i, entries[i]);
+    }
+    ucg_proc_store_cleanup(&store);
+}
+
+TEST(test_ucg_proc_store, no_gain)
+{
+    ucg_proc_store_t store;
+    ASSERT_EQ(ucg_proc_store_init(&store, 2), UCG_OK);
+
+    entry_t base = fake_address(0, 0, 200);
+    entry_t other = fake_address(1, 1, 200);
+    ASSERT_EQ(ucg_proc_store_add(&store, base.data(), base.size(),
+                                 UCG_PROC_STORE_NO_BASE), UCG_OK);
+    ASSERT_EQ(ucg_proc_store_add(&store, other.data(), other.size(), 0), UCG_OK);
+    // Stored as it is, so it can be a base too.
+    ASSERT_TRUE(ucg_proc_store_is_base(&store, 1));
+    ASSERT_EQ(store.offsets[2] - store.offsets[1], store.offsets[1]);
+    expect_entry(&store, 1, other);
+    ucg_proc_store_cleanup(&store);
+}
+
+TEST(test_ucg_proc_store, memory_100k)
+{
+    const uint32_t nprocs = 100000;
+    const uint32_t ppn = 128;
+    const uint32_t max_size = 512;
+    ucg_proc_store_t store;
+    ASSERT_EQ(ucg_proc_store_init(&store, nprocs), UCG_OK);
+
+    uint32_t base = UCG_PROC_STORE_NO_BASE;
+    for (uint32_t rank = 0; rank < nprocs; ++rank) {
+        uint32_t node = rank / ppn;
+        if (rank % ppn == 0) {
+            base = UCG_PROC_STORE_NO_BASE;
+        }
+        // Some nodes have more devices.
+        entry_t entry = fake_address(node, rank, max_size - node % 4 * 32);
+        ASSERT_EQ(ucg_proc_store_add(&store, entry.data(), entry.size(), base), UCG_OK);
+        if (base == UCG_PROC_STORE_NO_BASE) {
+            base = rank;
+        }
+    }
+
+    uint64_t padded = (uint64_t)max_size * nprocs;
+    uint64_t stored = ucg_proc_store_memory(&store);
+    printf("%u processes: padded %lu bytes, stored %lu bytes\n", nprocs, padded, stored);
+    ASSERT_LT(stored, padded / 4);
+
+    for (uint32_t rank = 0; rank < nprocs; rank += 997) {
+        uint32_t node = rank / ppn;
+        expect_entry(&store, rank, fake_address(node, rank, max_size - node % 4 * 32));
+    }
+    ucg_proc_store_cleanup(&store);
+}
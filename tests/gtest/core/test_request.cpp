@@ -432,4 +432,127 @@ TEST_T(test_ucg_request, cleanup_invalid_args)
 {
     ASSERT_EQ(ucg_request_cleanup(NULL), UCG_ERR_INVALID_PARAM);
 }
-#endif
\ No newline at end of file
+#endif
+
+TEST(test_ucg_request_msg_size, beyond_4g)
+{
+    const uint64_t GB = 1ull << 30;
+    ucg_dt_t dt = {
+        .type = UCG_DT_TYPE_INT32,
+        .size = 4,
+    };
+    uint64_t msize = 0;
+
+    /* 4 GiB - 4, 4 GiB and 8 GiB - 4 */
+    int32_t counts[] = {(int32_t)(GB - 1), (int32_t)GB, INT32_MAX};
+    for (int32_t count : counts) {
+        ucg_coll_args_t args = {};
+        args.type = UCG_COLL_TYPE_BCAST;
+        args.bcast.count = count;
+        args.bcast.dt = &dt;
+        ASSERT_EQ(ucg_request_msg_size(&args, 16, &msize), UCG_OK);
+        ASSERT_EQ(msize, 4ull * count);
+
+        args.type = UCG_COLL_TYPE_ALLREDUCE;
+        args.allreduce.count = count;
+        args.allreduce.dt = &dt;
+        ASSERT_EQ(ucg_request_msg_size(&args, 16, &msize), UCG_OK);
+        ASSERT_EQ(msize, 4ull * count);
+    }
+
+    /* The average of allgatherv is not truncated either. */
+    const int32_t recvcounts[4] = {(int32_t)GB, (int32_t)GB, (int32_t)GB, (int32_t)GB};
+    ucg_coll_args_t args = {};
+    args.type = UCG_COLL_TYPE_ALLGATHERV;
+    args.allgatherv.sendtype = &dt;
+    args.allgatherv.recvcounts = recvcounts;
+    args.allgatherv.recvtype = &dt;
+    ASSERT_EQ(ucg_request_msg_size(&args, 4, &msize), UCG_OK);
+    ASSERT_EQ(msize, 4 * GB);
+}
+
+TEST(test_ucg_request_vsize, local)
+{
+    ucg_dt_t dt = {
+        .type = UCG_DT_TYPE_INT32,
+        .size = 4,
+    };
+    ucg_coll_vsize_t vsize;
+
+    const int32_t counts[4] = {1, 1, 1, 5};
+    ucg_coll_args_t args = {};
+    args.type = UCG_COLL_TYPE_SCATTERV;
+    args.scatterv.sendcounts = counts;
+    args.scatterv.sendtype = &dt;
+    args.scatterv.root = 1;
+    ucg_request_vsize_local(&args, 4, 1, &vsize);
+    ASSERT_EQ(vsize.total, 32);
+    ASSERT_EQ(vsize.max_peer, 20);
+    ASSERT_EQ(vsize.imbalance, 250);
+    /* Send counts are only significant at root. */
+    ucg_request_vsize_local(&args, 4, 0, &vsize);
+    ASSERT_EQ(vsize.total, 0);
+    ASSERT_EQ(vsize.max_peer, 0);
+
+    args = {};
+    args.type = UCG_COLL_TYPE_GATHERV;
+    args.gatherv.recvcounts = counts;
+    args.gatherv.recvtype = &dt;
+    args.gatherv.root = 0;
+    ucg_request_vsize_local(&args, 4, 0, &vsize);
+    ASSERT_EQ(vsize.total, 32);
+
+    /* The larger of both directions. */
+    const int32_t balanced[4] = {2, 2, 2, 2};
+    args = {};
+    args.type = UCG_COLL_TYPE_ALLTOALLV;
+    args.alltoallv.sendcounts = balanced;
+    args.alltoallv.sendtype = &dt;
+    args.alltoallv.recvcounts = counts;
+    args.alltoallv.recvtype = &dt;
+    ucg_request_vsize_local(&args, 4, 2, &vsize);
+    ASSERT_EQ(vsize.total, 32);
+    ASSERT_EQ(vsize.max_peer, 20);
+    ASSERT_EQ(vsize.imbalance, 250);
+
+    uint64_t msize = 0;
+    args.vsize = vsize;
+    ASSERT_EQ(ucg_request_msg_size(&args, 4, &msize), UCG_OK);
+    ASSERT_EQ(msize, 20);
+    args.type = UCG_COLL_TYPE_SCATTERV;
+    ASSERT_EQ(ucg_request_msg_size(&args, 4, &msize), UCG_OK);
+    ASSERT_EQ(msize, 32);
+}
+
+TEST(test_ucg_request_wakeup, ready_list)
+{
+    ucg_context_t context = {};
+    ucg_group_t group = {};
+    group.context = &context;
+    ucg_list_head_init(&group.rlist);
+
+    ucg_request_t request = {};
+    request.group = &group;
+    request.status = UCG_INPROGRESS;
+    request.event_driven = 1;
+    ucg_request_t subrequest = {};
+
+    // Not started, nobody to wake up.
+    ucg_request_wakeup(&subrequest);
+    ASSERT_TRUE(ucg_list_is_empty(&group.rlist));
+
+    // Woken up once however many completions.
+    request.owner = &request;
+    subrequest.owner = &request;
+    ucg_request_wakeup(&subrequest);
+    ucg_request_wakeup(&request);
+    ASSERT_EQ(ucg_list_length(&group.rlist), 1);
+    ASSERT_EQ(request.ready, 1);
+
+    // Completed request is not woken up.
+    ucg_list_del(&request.list);
+    request.ready = 0;
+    request.status = UCG_OK;
+    ucg_request_wakeup(&subrequest);
+    ASSERT_TRUE(ucg_list_is_empty(&group.rlist));
+}
@@ -0,0 +1,186 @@
+/*
+* Copyright (c) Huawei Rechnologies Co., Ltd. 2022-2022. All rights reserved.
+*/
+
+#include "test_plan.h"
+
+extern "C" {
+#include "core/ucg_tune_file.h"
+#include "core/ucg_group.h"
+#include "core/ucg_topo.h"
+#include "core/ucg_vgroup.h"
+}
+
+#include <cstdio>
+#include <unistd.h>
+#include <string>
+
+class test_ucg_tune_file : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        snprintf(m_filename, sizeof(m_filename), "/tmp/ucg_tune_file_XXXXXX");
+        int fd = mkstemp(m_filename);
+        ASSERT_NE(fd, -1);
+        close(fd);
+    }
+
+    void TearDown() override
+    {
+        remove(m_filename);
+    }
+
+    void write_file(const std::string &content)
+    {
+        FILE *file = fopen(m_filename, "w");
+        ASSERT_TRUE(file != NULL);
+        fputs(content.c_str(), file);
+        fclose(file);
+    }
+
+    char m_filename[64];
+};
+
+TEST_F(test_ucg_tune_file, load)
+{
+    write_file("# planc coll dimensions plan\n"
+               "\n"
+               "ucx allreduce N:4-5 P:64-65 R:0-8192 I:5 S:100\n"
+               "ucx bcast G:16- I:3 S:20 # trailing comment\n");
+
+    ucg_tune_file_t file;
+    ASSERT_EQ(ucg_tune_file_load(&file, m_filename), UCG_OK);
+    ASSERT_EQ(file.num_rules, 2);
+
+    ucg_tune_rule_t *rule = &file.rules[0];
+    ASSERT_STREQ(rule->planc, "ucx");
+    ASSERT_EQ(rule->coll_type, UCG_COLL_TYPE_ALLREDUCE);
+    ASSERT_EQ(rule->node_cnt.start, 4);
+    ASSERT_EQ(rule->node_cnt.end, 5);
+    ASSERT_EQ(rule->ppn.start, 64);
+    ASSERT_EQ(rule->ppn.end, 65);
+    ASSERT_EQ(rule->group_size.start, 0);
+    ASSERT_EQ(rule->group_size.end, UCG_PLAN_RANGE_MAX);
+    ASSERT_EQ(rule->range.start, 0);
+    ASSERT_EQ(rule->range.end, 8192);
+    ASSERT_EQ(rule->id, 5);
+    ASSERT_EQ(rule->score, 100);
+
+    rule = &file.rules[1];
+    ASSERT_EQ(rule->coll_type, UCG_COLL_TYPE_BCAST);
+    ASSERT_EQ(rule->group_size.start, 16);
+    ASSERT_EQ(rule->group_size.end, UCG_PLAN_RANGE_MAX);
+    ASSERT_EQ(rule->range.end, UCG_PLAN_RANGE_MAX);
+
+    ucg_tune_file_t copy;
+    ASSERT_EQ(ucg_tune_file_copy(&copy, &file), UCG_OK);
+    ASSERT_EQ(copy.num_rules, 2);
+    ASSERT_EQ(memcmp(copy.rules, file.rules, 2 * sizeof(ucg_tune_rule_t)), 0);
+    ucg_tune_file_cleanup(&copy);
+    ucg_tune_file_cleanup(&file);
+}
+
+TEST_F(test_ucg_tune_file, invalid)
+{
+    const char *lines[] = {
+        "ucx allreduce R:0-8192 S:100\n",           /* no id */
+        "ucx allreduce R:0-8192 I:5\n",             /* no score */
+        "ucx allgather I:5 S:100\n",                /* unknown collective */
+        "ucx allreduce R:8192-0 I:5 S:100\n",       /* empty range */
+        "ucx allreduce X:1 I:5 S:100\n",            /* unknown dimension */
+        "ucx allreduce I:5a S:100\n",
+        "ucx\n",
+    };
+    for (const char *line : lines) {
+        write_file(line);
+        ucg_tune_file_t file;
+        ASSERT_EQ(ucg_tune_file_load(&file, m_filename), UCG_ERR_INVALID_PARAM) << line;
+    }
+
+    ucg_tune_file_t file;
+    ASSERT_NE(ucg_tune_file_load(&file, "/nonexistent/ucg_tune_file"), UCG_OK);
+}
+
+TEST_F(test_ucg_tune_file, add_plans)
+{
+    write_file("ucx bcast N:2-3 P:4-5 R:0-1024 I:1 S:100\n"
+               "ucx bcast N:3- I:1 S:100\n"             /* other node count */
+               "ucx bcast G:8-9 R:1024- I:1 S:50\n"
+               "ucx bcast I:2 S:100\n"                  /* other plan */
+               "ucx allreduce I:1 S:100\n"              /* other collective */
+               "shm bcast I:1 S:100\n");                /* other planc */
+    ucg_tune_file_t file;
+    ASSERT_EQ(ucg_tune_file_load(&file, m_filename), UCG_OK);
+
+    ucg_topo_t topo = {};
+    topo.ppn = 4;
+    ucg_group_t group = {};
+    group.size = 8;
+    group.topo = &topo;
+    ucg_vgroup_t vgroup = {};
+    vgroup.size = 8;
+    vgroup.group = &group;
+
+    ucg_plans_t *plans = NULL;
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+    ucg_plan_params_t params = {};
+    params.mem_type = UCG_MEM_TYPE_HOST;
+    params.coll_type = UCG_COLL_TYPE_BCAST;
+    params.attr.prepare = prepare_ok;
+    params.attr.id = 1;
+    params.attr.name = "test";
+    params.attr.domain = "test";
+    params.attr.range.start = 0;
+    params.attr.range.end = UCG_PLAN_RANGE_MAX;
+    params.attr.vgroup = &vgroup;
+    params.attr.score = 10;
+    ASSERT_EQ(ucg_plans_add(plans, &params), UCG_OK);
+    ASSERT_EQ(ucg_tune_file_add_plans(&file, "ucx", plans), UCG_OK);
+    ASSERT_EQ(ucg_plans_build(plans), UCG_OK);
+
+    const ucg_plan_table_t *table = &plans->tables[UCG_COLL_TYPE_BCAST][UCG_MEM_TYPE_HOST];
+    ASSERT_EQ(table->num_entries, 2);
+    ASSERT_EQ(table->entries[0].range.end, 1024);
+    ASSERT_EQ(table->entries[0].plans[0]->attr.score, 100);
+    ASSERT_EQ(table->entries[1].range.start, 1024);
+    ASSERT_EQ(table->entries[1].plans[0]->attr.score, 50);
+    /* The builtin plan is the fallback. */
+    ASSERT_EQ(table->entries[1].num_plans, 2);
+    ASSERT_EQ(table->entries[1].plans[1]->attr.score, 10);
+    ucg_plans_cleanup(plans);
+
+    /* Rules with node count or ppn are not applied to unbalanced nodes. */
+    topo.ppn = UCG_TOPO_PPX_UNBALANCED;
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+    ASSERT_EQ(ucg_plans_add(plans, &params), UCG_OK);
+    ASSERT_EQ(ucg_tune_file_add_plans(&file, "ucx", plans), UCG_OK);
+    ASSERT_EQ(ucg_plans_build(plans), UCG_OK);
+    table = &plans->tables[UCG_COLL_TYPE_BCAST][UCG_MEM_TYPE_HOST];
+    ASSERT_EQ(table->num_entries, 2);
+    ASSERT_EQ(table->entries[0].range.end, 1024);
+    ASSERT_EQ(table->entries[0].plans[0]->attr.score, 10);
+    ucg_plans_cleanup(plans);
+
+    /* The rules only apply to the plans of their planc. */
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+    ASSERT_EQ(ucg_plans_add(plans, &params), UCG_OK);
+    ucg_plans_set_planc(plans, 0);
+    ASSERT_EQ(ucg_tune_file_add_plans(&file, "shm", plans), UCG_OK);
+    ASSERT_EQ(ucg_plans_build(plans), UCG_OK);
+    table = &plans->tables[UCG_COLL_TYPE_BCAST][UCG_MEM_TYPE_HOST];
+    ASSERT_EQ(table->num_entries, 1);
+    ASSERT_EQ(table->entries[0].plans[0]->attr.score, 10);
+    ucg_plans_cleanup(plans);
+
+    /* Deprecated plan is not added. */
+    params.attr.deprecated = 1;
+    ASSERT_EQ(ucg_plans_init(&plans), UCG_OK);
+    ASSERT_EQ(ucg_plans_add(plans, &params), UCG_OK);
+    ASSERT_EQ(ucg_tune_file_add_plans(&file, "ucx", plans), UCG_OK);
+    ASSERT_EQ(ucg_plans_build(plans), UCG_OK);
+    table = &plans->tables[UCG_COLL_TYPE_BCAST][UCG_MEM_TYPE_HOST];
+    ASSERT_EQ(table->num_entries, 0);
+    ucg_plans_cleanup(plans);
+
+    ucg_tune_file_cleanup(&file);
+}
@@ -0,0 +1,198 @@
+/*
+* Copyright (c) Huawei Rechnologies Co., Ltd. 2022-2022. All rights reserved.
+*/
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "planc/shm/planc_shm_plan.h"
+#include "planc/shm/barrier/barrier.h"
+#include "planc/shm/bcast/bcast.h"
+#include "core/ucg_dt.h"
+}
+
+#include <cstring>
+#include <functional>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* The processes of one node share the segment created before fork. */
+class test_planc_shm_op : public testing::Test {
+protected:
+    static const uint32_t NPROCS = 4;
+    static const size_t SLOT_SIZE = 64;
+    /* Seconds before a hanging process is killed. */
+    static const uint32_t TIMEOUT = 10;
+
+    void SetUp() override
+    {
+        m_seg_size = sizeof(ucg_planc_shm_hdr_t) +
+                     NPROCS * (sizeof(ucg_planc_shm_ctrl_t) + SLOT_SIZE);
+        m_seg = mmap(NULL, m_seg_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        ASSERT_NE(m_seg, MAP_FAILED);
+        memset(m_seg, 0, m_seg_size);
+    }
+
+    void TearDown() override
+    {
+        munmap(m_seg, m_seg_size);
+    }
+
+    /* Run the function in every process of the node, true if all of them succeed. */
+    bool run(std::function<bool(ucg_planc_shm_group_t*)> func)
+    {
+        pid_t pids[NPROCS];
+        for (uint32_t rank = 0; rank < NPROCS; ++rank) {
+            pids[rank] = fork();
+            if (pids[rank] == 0) {
+                alarm(TIMEOUT);
+                _exit(run_one(rank, func) ? 0 : 1);
+            }
+        }
+
+        bool success = true;
+        for (uint32_t rank = 0; rank < NPROCS; ++rank) {
+            int status;
+            if (pids[rank] < 0 || waitpid(pids[rank], &status, 0) != pids[rank] ||
+                !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                success = false;
+            }
+        }
+        return success;
+    }
+
+    bool run_one(uint32_t rank, std::function<bool(ucg_planc_shm_group_t*)> func)
+    {
+        ucg_planc_shm_context_t context;
+        memset(&context, 0, sizeof(context));
+        if (ucg_mpool_init(&context.op_mp, 0, sizeof(ucg_planc_shm_op_t), 0,
+                           UCG_CACHE_LINE_SIZE, UCG_ELEMS_PER_CHUNK, -1, NULL,
+                           "gtest shm op") != UCG_OK) {
+            return false;
+        }
+
+        ucg_planc_shm_group_t shm_group;
+        memset(&shm_group, 0, sizeof(shm_group));
+        shm_group.context = &context;
+        shm_group.node_group.myrank = rank;
+        shm_group.node_group.size = NPROCS;
+        shm_group.seg = m_seg;
+        shm_group.seg_size = m_seg_size;
+        shm_group.slot_size = SLOT_SIZE;
+        shm_group.seq = 0;
+        ucg_list_head_init(&shm_group.ops);
+
+        bool success = func(&shm_group);
+        ucg_mpool_cleanup(&context.op_mp, 1);
+        return success;
+    }
+
+    static ucg_plan_op_t* bcast_new(ucg_planc_shm_group_t *shm_group, uint8_t *buffer,
+                                    int32_t count)
+    {
+        ucg_coll_args_t args = {};
+        args.type = UCG_COLL_TYPE_BCAST;
+        args.bcast.buffer = buffer;
+        args.bcast.count = count;
+        args.bcast.dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT8);
+        args.bcast.root = 0;
+        ucg_planc_shm_op_t *op = NULL;
+        if (ucg_planc_shm_bcast_flat_op_new(shm_group, &shm_group->node_group,
+                                            &args, &op) != UCG_OK) {
+            return NULL;
+        }
+        return &op->super;
+    }
+
+    static bool wait(ucg_plan_op_t *op)
+    {
+        ucg_status_t status;
+        do {
+            status = op->progress(op);
+        } while (status == UCG_INPROGRESS);
+        return status == UCG_OK;
+    }
+
+    static bool check(const uint8_t *buffer, int32_t count, uint8_t value)
+    {
+        for (int32_t i = 0; i < count; ++i) {
+            if (buffer[i] != value) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void *m_seg;
+    size_t m_seg_size;
+};
+
+TEST_F(test_planc_shm_op, prepared_op_not_block_others)
+{
+    ASSERT_TRUE(run([](ucg_planc_shm_group_t *shm_group) {
+        /* init(A); init(B); start(B); wait(B); start(A); wait(A) */
+        const int32_t count = 3 * SLOT_SIZE;
+        uint8_t buffer[count];
+        memset(buffer, shm_group->node_group.myrank == 0 ? 1 : 0, count);
+        ucg_plan_op_t *op_a = bcast_new(shm_group, buffer, count);
+        ucg_coll_args_t args = {};
+        args.type = UCG_COLL_TYPE_BARRIER;
+        ucg_planc_shm_op_t *shm_op_b = NULL;
+        if (op_a == NULL ||
+            ucg_planc_shm_barrier_flat_op_new(shm_group, &shm_group->node_group,
+                                              &args, &shm_op_b) != UCG_OK) {
+            return false;
+        }
+        ucg_plan_op_t *op_b = &shm_op_b->super;
+
+        bool success = op_b->trigger(op_b) == UCG_OK && wait(op_b) &&
+                       op_a->trigger(op_a) == UCG_OK && wait(op_a) &&
+                       check(buffer, count, 1);
+        op_a->discard(op_a);
+        op_b->discard(op_b);
+        return success;
+    }));
+}
+
+TEST_F(test_planc_shm_op, reserved_ops_keep_start_order)
+{
+    ASSERT_TRUE(run([](ucg_planc_shm_group_t *shm_group) {
+        /* Request A has two node phases and request B has one. The second phase
+           of A is triggered before or after B depending on the process, the
+           ops still run in the order of the starts. */
+        const int32_t count = 2 * SLOT_SIZE;
+        ucg_rank_t myrank = shm_group->node_group.myrank;
+        uint8_t buffer_a1[count], buffer_a2[count], buffer_b[count];
+        memset(buffer_a1, myrank == 0 ? 1 : 0, count);
+        memset(buffer_a2, myrank == 0 ? 2 : 0, count);
+        memset(buffer_b, myrank == 0 ? 3 : 0, count);
+        ucg_plan_op_t *op_a1 = bcast_new(shm_group, buffer_a1, count);
+        ucg_plan_op_t *op_a2 = bcast_new(shm_group, buffer_a2, count);
+        ucg_plan_op_t *op_b = bcast_new(shm_group, buffer_b, count);
+        if (op_a1 == NULL || op_a2 == NULL || op_b == NULL) {
+            return false;
+        }
+
+        /* Start A, as the meta op does. */
+        op_a1->reserve(op_a1);
+        op_a2->reserve(op_a2);
+        bool success = op_a1->trigger(op_a1) == UCG_OK && wait(op_a1);
+        /* Start B. */
+        if (myrank % 2 == 0) {
+            success = success && op_b->trigger(op_b) == UCG_OK &&
+                      op_a2->trigger(op_a2) == UCG_OK;
+        } else {
+            success = success && op_a2->trigger(op_a2) == UCG_OK &&
+                      op_b->trigger(op_b) == UCG_OK;
+        }
+        success = success && wait(op_a2) && wait(op_b) &&
+                  check(buffer_a1, count, 1) && check(buffer_a2, count, 2) &&
+                  check(buffer_b, count, 3);
+        op_a1->discard(op_a1);
+        op_a2->discard(op_a2);
+        op_b->discard(op_b);
+        return success;
+    }));
+}
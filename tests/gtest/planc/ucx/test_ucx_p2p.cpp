@@ -0,0 +1,194 @@
+/*
+* Copyright (c) Huawei Rechnologies Co., Ltd. 2022-2022. All rights reserved.
+*/
+
+#include <gtest/gtest.h>
+#include "stub.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "core/ucg_group.h"
+#include "core/ucg_dt.h"
+#include "planc/ucx/planc_ucx_context.h"
+#include "planc/ucx/planc_ucx_group.h"
+#include "planc/ucx/planc_ucx_p2p.h"
+}
+
+using namespace test;
+
+#define TEST_P2P_THREADS    4
+#define TEST_P2P_ITERS      1000
+
+/* The messages are sent to myself, the completions are delivered by any thread. */
+class test_planc_ucx_p2p : public testing::Test {
+public:
+    static void SetUpTestSuite()
+    {
+        stub::init();
+
+        m_context.oob_group.myrank = 0;
+        m_context.oob_group.size = 2;
+        ucg_planc_params_t params;
+        params.context = &m_context;
+        params.thread_mode = UCG_THREAD_MODE_MULTI;
+        ucg_planc_config_h config;
+        ucg_planc_ucx_config_read(NULL, NULL, &config);
+        ucg_planc_ucx_config_modify(config, "USE_OOB", "no");
+        ucg_planc_ucx_context_init(&params, config, &m_planc_context);
+        ucg_planc_ucx_config_release(config);
+
+        ucg_planc_ucx_context_t *ctx = (ucg_planc_ucx_context_t*)m_planc_context;
+        ucp_address_t *address;
+        size_t length;
+        ucp_worker_get_address(ctx->ucp_worker, &address, &length);
+        ucp_ep_params_t ep_params;
+        ep_params.field_mask = UCP_EP_PARAM_FIELD_REMOTE_ADDRESS;
+        ep_params.address = address;
+        ucp_ep_create(ctx->ucp_worker, &ep_params, &ctx->eps[0]);
+        ucp_worker_release_address(ctx->ucp_worker, address);
+
+        m_group.context = &m_context;
+        m_group.myrank = 0;
+        m_group.size = 1;
+        m_group.rank_map.type = UCG_RANK_MAP_TYPE_FULL;
+        m_group.rank_map.size = 1;
+        ucg_list_head_init(&m_group.rlist);
+        ucg_lock_init(&m_group.rlist_lock, UCG_LOCK_TYPE_SPINLOCK);
+        m_vgroup.myrank = 0;
+        m_vgroup.size = 1;
+        m_vgroup.rank_map = m_group.rank_map;
+        m_vgroup.group = &m_group;
+        m_ucx_group.context = ctx;
+        m_ucx_group.super.super.group = &m_group;
+    }
+
+    static void TearDownTestSuite()
+    {
+        ucg_lock_destroy(&m_group.rlist_lock);
+        ucg_planc_ucx_context_cleanup(m_planc_context);
+        stub::cleanup();
+    }
+
+    /* Progress the worker in another thread while the test threads post and test. */
+    static bool run(std::function<bool(int)> func)
+    {
+        std::atomic<bool> stop(false);
+        std::thread progress([&stop]() {
+            while (!stop.load()) {
+                ucg_planc_ucx_context_progress(m_planc_context);
+            }
+        });
+
+        std::vector<int> success(TEST_P2P_THREADS, 0);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < TEST_P2P_THREADS; ++t) {
+            threads.emplace_back([&func, &success, t]() {
+                success[t] = func(t);
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        stop.store(true);
+        progress.join();
+
+        for (int t = 0; t < TEST_P2P_THREADS; ++t) {
+            if (!success[t]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static ucg_context_t m_context;
+    static ucg_planc_context_h m_planc_context;
+    static ucg_group_t m_group;
+    static ucg_vgroup_t m_vgroup;
+    static ucg_planc_ucx_group_t m_ucx_group;
+};
+ucg_context_t test_planc_ucx_p2p::m_context = {};
+ucg_planc_context_h test_planc_ucx_p2p::m_planc_context = NULL;
+ucg_group_t test_planc_ucx_p2p::m_group = {};
+ucg_vgroup_t test_planc_ucx_p2p::m_vgroup = {};
+ucg_planc_ucx_group_t test_planc_ucx_p2p::m_ucx_group = {};
+
+TEST_F(test_planc_ucx_p2p, mt_testall)
+{
+    ASSERT_TRUE(run([](int t) {
+        ucg_dt_t *dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT64);
+        /* The even threads are woken up, the odd ones poll. */
+        ucg_request_t request = {};
+        request.group = &m_group;
+        request.status = UCG_INPROGRESS;
+        request.event_driven = 1;
+        request.owner = &request;
+        ucg_planc_ucx_p2p_state_t state;
+        ucg_planc_ucx_p2p_state_reset(&state);
+        state.request = (t % 2 == 0) ? &request : NULL;
+        ucg_planc_ucx_p2p_params_t params = {&m_ucx_group, &state, NULL};
+
+        for (uint64_t i = 0; i < TEST_P2P_ITERS; ++i) {
+            uint64_t sendbuf = ((uint64_t)t << 32) | i;
+            uint64_t recvbuf = 0;
+            if (ucg_planc_ucx_p2p_irecv(&recvbuf, 1, dt, 0, t, &m_vgroup, &params) != UCG_OK ||
+                ucg_planc_ucx_p2p_isend(&sendbuf, 1, dt, 0, t, &m_vgroup, &params) != UCG_OK) {
+                return false;
+            }
+            ucg_status_t status;
+            while ((status = ucg_planc_ucx_p2p_testall(&m_ucx_group, &state)) == UCG_INPROGRESS) {
+                std::this_thread::yield();
+            }
+            if (status != UCG_OK || recvbuf != sendbuf) {
+                return false;
+            }
+        }
+
+        /* Woken up by the completions. */
+        ucg_lock_enter(&m_group.rlist_lock);
+        bool woken = request.ready == (t % 2 == 0);
+        if (request.ready) {
+            ucg_list_del(&request.list);
+        }
+        ucg_lock_leave(&m_group.rlist_lock);
+        return woken;
+    }));
+}
+
+TEST_F(test_planc_ucx_p2p, mt_kept_request)
+{
+    ASSERT_TRUE(run([](int t) {
+        ucg_dt_t *dt = ucg_dt_get_predefined(UCG_DT_TYPE_UINT64);
+        ucg_planc_ucx_p2p_state_t state;
+        ucg_planc_ucx_p2p_state_reset(&state);
+        ucg_planc_ucx_p2p_params_t params = {&m_ucx_group, &state, NULL};
+
+        for (uint64_t i = 0; i < TEST_P2P_ITERS; ++i) {
+            uint64_t sendbuf = ((uint64_t)t << 32) | i;
+            uint64_t recvbuf = 0;
+            /* The request may be completed by the progress thread before it's saved. */
+            ucg_planc_ucx_p2p_req_t *request = NULL;
+            params.request = &request;
+            if (ucg_planc_ucx_p2p_irecv(&recvbuf, 1, dt, 0, t, &m_vgroup, &params) != UCG_OK) {
+                return false;
+            }
+            params.request = NULL;
+            if (ucg_planc_ucx_p2p_isend(&sendbuf, 1, dt, 0, t, &m_vgroup, &params) != UCG_OK) {
+                return false;
+            }
+            ucg_status_t status;
+            while ((status = ucg_planc_ucx_p2p_test(&m_ucx_group, &request)) == UCG_INPROGRESS);
+            if (status != UCG_OK || request != NULL || recvbuf != sendbuf) {
+                return false;
+            }
+            while ((status = ucg_planc_ucx_p2p_testall(&m_ucx_group, &state)) == UCG_INPROGRESS);
+            if (status != UCG_OK) {
+                return false;
+            }
+        }
+        return true;
+    }));
+}
@@ -0,0 +1,92 @@
+/*
+* Copyright (c) Huawei Rechnologies Co., Ltd. 2022-2022. All rights reserved.
+*/
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "planc/ucx/planc_ucx_staging.h"
+}
+
+#include <cstring>
+
+class test_planc_ucx_staging : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(ucg_planc_ucx_staging_pool_init(&m_pool, NULL, 64 * 1024,
+                                                  UCG_THREAD_MODE_SINGLE), UCG_OK);
+    }
+
+    void TearDown() override
+    {
+        ucg_planc_ucx_staging_pool_cleanup(&m_pool);
+    }
+
+    ucg_planc_ucx_staging_pool_t m_pool;
+};
+
+TEST_F(test_planc_ucx_staging, reuse_same_class)
+{
+    void *buf = ucg_planc_ucx_staging_get(&m_pool, 1000);
+    ASSERT_TRUE(buf != NULL);
+    memset(buf, 0, 1000);
+    ucg_planc_ucx_staging_put(&m_pool, buf);
+    ASSERT_EQ(m_pool.misses, 1);
+
+    /* 1000 and 1024 are in the same size class */
+    void *buf2 = ucg_planc_ucx_staging_get(&m_pool, 1024);
+    ASSERT_EQ(buf2, buf);
+    ASSERT_EQ(m_pool.hits, 1);
+    ucg_planc_ucx_staging_put(&m_pool, buf2);
+
+    void *buf3 = ucg_planc_ucx_staging_get(&m_pool, 1025);
+    ASSERT_NE(buf3, buf);
+    ASSERT_EQ(m_pool.misses, 2);
+    ucg_planc_ucx_staging_put(&m_pool, buf3);
+}
+
+TEST_F(test_planc_ucx_staging, in_use_not_shared)
+{
+    void *buf1 = ucg_planc_ucx_staging_get(&m_pool, 512);
+    void *buf2 = ucg_planc_ucx_staging_get(&m_pool, 512);
+    ASSERT_TRUE(buf1 != NULL && buf2 != NULL);
+    ASSERT_NE(buf1, buf2);
+    ucg_planc_ucx_staging_put(&m_pool, buf1);
+    ucg_planc_ucx_staging_put(&m_pool, buf2);
+    ASSERT_EQ(m_pool.size, 1024);
+}
+
+TEST_F(test_planc_ucx_staging, memory_cap)
+{
+    /* Larger than the cap, allocated out of the pool. */
+    void *buf = ucg_planc_ucx_staging_get(&m_pool, 128 * 1024);
+    ASSERT_TRUE(buf != NULL);
+    memset(buf, 0, 128 * 1024);
+    ASSERT_EQ(m_pool.size, 0);
+    ucg_planc_ucx_staging_put(&m_pool, buf);
+    ASSERT_EQ(m_pool.size, 0);
+
+    /* The free buffers are released to make room for the new one. */
+    void *small = ucg_planc_ucx_staging_get(&m_pool, 32 * 1024);
+    ucg_planc_ucx_staging_put(&m_pool, small);
+    void *large = ucg_planc_ucx_staging_get(&m_pool, 64 * 1024);
+    ASSERT_TRUE(large != NULL);
+    ASSERT_EQ(m_pool.size, 64 * 1024);
+    ucg_planc_ucx_staging_put(&m_pool, large);
+}
+
+TEST_F(test_planc_ucx_staging, disabled)
+{
+    ucg_planc_ucx_staging_pool_t pool;
+    ASSERT_EQ(ucg_planc_ucx_staging_pool_init(&pool, NULL, 0, UCG_THREAD_MODE_SINGLE), UCG_OK);
+    void *buf = ucg_planc_ucx_staging_get(&pool, 100);
+    ASSERT_TRUE(buf != NULL);
+    ucg_planc_ucx_staging_put(&pool, buf);
+    buf = ucg_planc_ucx_staging_get(&pool, 100);
+    ucg_planc_ucx_staging_put(&pool, buf);
+    ASSERT_EQ(pool.hits, 0);
+    ASSERT_EQ(pool.misses, 2);
+    ASSERT_EQ(pool.size, 0);
+    ucg_planc_ucx_staging_pool_cleanup(&pool);
+}
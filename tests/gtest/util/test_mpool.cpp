@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Huawei Rechnologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include <gtest/gtest.h>
+
+#include <climits>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "util/ucg_mpool.h"
+#include "util/ucg_cpu.h"
+}
+
+#define TEST_MPOOL_THREADS  8
+#define TEST_MPOOL_ITERS    10000
+#define TEST_MPOOL_BATCH    16
+
+TEST(test_ucg_mpool, get_put)
+{
+    ucg_mpool_t mp;
+    ASSERT_EQ(ucg_mpool_init(&mp, 0, sizeof(uint64_t), 0, UCG_CACHE_LINE_SIZE,
+                             UCG_ELEMS_PER_CHUNK, UINT_MAX, NULL, "test mpool"), UCG_OK);
+    void *obj1 = ucg_mpool_get(&mp);
+    void *obj2 = ucg_mpool_get(&mp);
+    ASSERT_TRUE(obj1 != NULL && obj2 != NULL);
+    ASSERT_NE(obj1, obj2);
+    ucg_mpool_put(obj1);
+    ucg_mpool_put(obj2);
+    ucg_mpool_cleanup(&mp, 1);
+}
+
+TEST(test_ucg_mpool, mt_get_put)
+{
+    ucg_mpool_t mp;
+    ASSERT_EQ(ucg_mpool_init_mt(&mp, 0, sizeof(uint64_t), 0, UCG_CACHE_LINE_SIZE,
+                                UCG_ELEMS_PER_CHUNK, UINT_MAX, NULL, "test mt mpool"), UCG_OK);
+
+    std::vector<int> failures(TEST_MPOOL_THREADS, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < TEST_MPOOL_THREADS; ++t) {
+        threads.emplace_back([&mp, &failures, t]() {
+            uint64_t *objs[TEST_MPOOL_BATCH];
+            for (int i = 0; i < TEST_MPOOL_ITERS; ++i) {
+                for (int j = 0; j < TEST_MPOOL_BATCH; ++j) {
+                    objs[j] = (uint64_t*)ucg_mpool_get(&mp);
+                    *objs[j] = ((uint64_t)t << 32) | j;
+                }
+                std::this_thread::yield();
+                // An element handed out twice is overwritten by the other thread.
+                for (int j = 0; j < TEST_MPOOL_BATCH; ++j) {
+                    if (*objs[j] != (((uint64_t)t << 32) | j)) {
+                        ++failures[t];
+                    }
+                    ucg_mpool_put(objs[j]);
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (int t = 0; t < TEST_MPOOL_THREADS; ++t) {
+        ASSERT_EQ(failures[t], 0);
+    }
+    // All elements are returned.
+    ucg_mpool_cleanup(&mp, 1);
+}
@@ -0,0 +1,461 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_perf.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+const ucg_perf_dt_t ucg_perf_dts[UCG_DT_TYPE_PREDEFINED_LAST] = {
+    {"int8", UCG_DT_TYPE_INT8, 1},
+    {"int16", UCG_DT_TYPE_INT16, 2},
+    {"int32", UCG_DT_TYPE_INT32, 4},
+    {"int64", UCG_DT_TYPE_INT64, 8},
+    {"uint8", UCG_DT_TYPE_UINT8, 1},
+    {"uint16", UCG_DT_TYPE_UINT16, 2},
+    {"uint32", UCG_DT_TYPE_UINT32, 4},
+    {"uint64", UCG_DT_TYPE_UINT64, 8},
+    {"fp16", UCG_DT_TYPE_FP16, 2},
+    {"fp32", UCG_DT_TYPE_FP32, 4},
+    {"fp64", UCG_DT_TYPE_FP64, 8},
+};
+
+const ucg_perf_op_t ucg_perf_ops[UCG_OP_TYPE_PREDEFINED_LAST] = {
+    {"max", UCG_OP_TYPE_MAX},
+    {"min", UCG_OP_TYPE_MIN},
+    {"sum", UCG_OP_TYPE_SUM},
+    {"prod", UCG_OP_TYPE_PROD},
+};
+
+static ucg_request_info_t perf_request_info = {
+    .field_mask = UCG_REQUEST_INFO_FIELD_MEM_TYPE,
+    .mem_type = UCG_MEM_TYPE_HOST,
+};
+
+/* Every peer block has the same size, so v-collectives are laid out densely. */
+static void perf_fill_counts(ucg_perf_t *perf, int32_t count)
+{
+    uint32_t nprocs = perf->params->nprocs;
+    for (uint32_t i = 0; i < nprocs; ++i) {
+        perf->counts[i] = count;
+        perf->displs[i] = (int32_t)i * count;
+    }
+    return;
+}
+
+static ucg_status_t perf_bcast_init(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                                    ucg_request_h *request)
+{
+    return ucg_request_bcast_init(perf->recvbuf, pcase->count, perf->dts[pcase->dt_type],
+                                  pcase->root, perf->group, &perf_request_info, request);
+}
+
+static ucg_status_t perf_allreduce_init(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                                        ucg_request_h *request)
+{
+    return ucg_request_allreduce_init(perf->sendbuf, perf->recvbuf, pcase->count,
+                                      perf->dts[pcase->dt_type], perf->ops[pcase->op_type],
+                                      perf->group, &perf_request_info, request);
+}
+
+static ucg_status_t perf_barrier_init(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                                      ucg_request_h *request)
+{
+    return ucg_request_barrier_init(perf->group, &perf_request_info, request);
+}
+
+static ucg_status_t perf_alltoallv_init(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                                        ucg_request_h *request)
+{
+    ucg_dt_h dt = perf->dts[pcase->dt_type];
+    perf_fill_counts(perf, pcase->count);
+    return ucg_request_alltoallv_init(perf->sendbuf, perf->counts, perf->displs, dt,
+                                      perf->recvbuf, perf->counts, perf->displs, dt,
+                                      perf->group, &perf_request_info, request);
+}
+
+static ucg_status_t perf_scatterv_init(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                                       ucg_request_h *request)
+{
+    ucg_dt_h dt = perf->dts[pcase->dt_type];
+    perf_fill_counts(perf, pcase->count);
+    return ucg_request_scatterv_init(perf->sendbuf, perf->counts, perf->displs, dt,
+                                     perf->recvbuf, pcase->count, dt, pcase->root,
+                                     perf->group, &perf_request_info, request);
+}
+
+static ucg_status_t perf_gatherv_init(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                                      ucg_request_h *request)
+{
+    ucg_dt_h dt = perf->dts[pcase->dt_type];
+    perf_fill_counts(perf, pcase->count);
+    return ucg_request_gatherv_init(perf->sendbuf, pcase->count, dt, perf->recvbuf,
+                                    perf->counts, perf->displs, dt, pcase->root,
+                                    perf->group, &perf_request_info, request);
+}
+
+static ucg_status_t perf_allgatherv_init(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                                         ucg_request_h *request)
+{
+    ucg_dt_h dt = perf->dts[pcase->dt_type];
+    perf_fill_counts(perf, pcase->count);
+    return ucg_request_allgatherv_init(perf->sendbuf, pcase->count, dt, perf->recvbuf,
+                                       perf->counts, perf->displs, dt, perf->group,
+                                       &perf_request_info, request);
+}
+
+/* Bus bandwidth factors follow the convention of nccl-tests. */
+static double perf_busbw_one(uint32_t nprocs)
+{
+    return 1.0;
+}
+
+static double perf_busbw_none(uint32_t nprocs)
+{
+    return 0.0;
+}
+
+static double perf_busbw_allreduce(uint32_t nprocs)
+{
+    return 2.0 * (nprocs - 1) / nprocs;
+}
+
+static double perf_busbw_gather(uint32_t nprocs)
+{
+    return (double)(nprocs - 1) / nprocs;
+}
+
+static uint64_t perf_total_bytes_one(uint64_t bytes, uint32_t nprocs)
+{
+    return bytes;
+}
+
+static uint64_t perf_total_bytes_all(uint64_t bytes, uint32_t nprocs)
+{
+    return bytes * nprocs;
+}
+
+const ucg_perf_coll_t ucg_perf_colls[UCG_PERF_COLL_LAST] = {
+    [UCG_PERF_COLL_BCAST] = {
+        "bcast", UCG_PERF_COLL_FLAG_ROOTED, perf_bcast_init,
+        perf_busbw_one, perf_total_bytes_one
+    },
+    [UCG_PERF_COLL_ALLREDUCE] = {
+        "allreduce", UCG_PERF_COLL_FLAG_REDUCE, perf_allreduce_init,
+        perf_busbw_allreduce, perf_total_bytes_one
+    },
+    [UCG_PERF_COLL_BARRIER] = {
+        "barrier", UCG_PERF_COLL_FLAG_NO_DATA | UCG_PERF_COLL_FLAG_NO_MSG_SIZE,
+        perf_barrier_init,
+        perf_busbw_none, perf_total_bytes_one
+    },
+    [UCG_PERF_COLL_ALLTOALLV] = {
+        "alltoallv", UCG_PERF_COLL_FLAG_NO_MSG_SIZE, perf_alltoallv_init,
+        perf_busbw_gather, perf_total_bytes_all
+    },
+    [UCG_PERF_COLL_SCATTERV] = {
+        "scatterv", UCG_PERF_COLL_FLAG_ROOTED | UCG_PERF_COLL_FLAG_NO_MSG_SIZE,
+        perf_scatterv_init,
+        perf_busbw_gather, perf_total_bytes_all
+    },
+    [UCG_PERF_COLL_GATHERV] = {
+        "gatherv", UCG_PERF_COLL_FLAG_ROOTED | UCG_PERF_COLL_FLAG_NO_MSG_SIZE,
+        perf_gatherv_init,
+        perf_busbw_gather, perf_total_bytes_all
+    },
+    [UCG_PERF_COLL_ALLGATHERV] = {
+        "allgatherv", 0, perf_allgatherv_init,
+        perf_busbw_gather, perf_total_bytes_all
+    },
+};
+
+/* Resident memory of the process in KB, 0 if unknown. */
+static double perf_get_rss_kb()
+{
+    long pages = 0;
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (file == NULL) {
+        return 0;
+    }
+    if (fscanf(file, "%*s %ld", &pages) != 1) {
+        pages = 0;
+    }
+    fclose(file);
+    return (double)pages * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+static double perf_get_time_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+static ucg_status_t perf_report_init(ucg_perf_t *perf, double time_ms, double rss_kb)
+{
+    uint32_t size = perf->oob->size;
+    double local[2] = {time_ms, rss_kb};
+    double *all = malloc(sizeof(local) * size);
+    if (all == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    ucg_status_t status = perf_oob_allgather(local, all, sizeof(local), perf->oob);
+    if (status != UCG_OK || perf->oob->myrank != 0) {
+        goto out;
+    }
+
+    double sum[2] = {0, 0};
+    double max[2] = {0, 0};
+    for (uint32_t i = 0; i < size; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            sum[j] += all[i * 2 + j];
+            if (max[j] < all[i * 2 + j]) {
+                max[j] = all[i * 2 + j];
+            }
+        }
+    }
+    printf("# ucg_init of %u processes (%s addresses): avg %.3f ms, max %.3f ms, "
+           "memory avg %.1f KB, max %.1f KB\n", size,
+           perf->params->lazy_address ? "lazy" : "allgathered",
+           sum[0] / size, max[0], sum[1] / size, max[1]);
+
+out:
+    free(all);
+    return status;
+}
+
+static ucg_status_t perf_init_context(ucg_perf_t *perf)
+{
+    ucg_status_t status;
+    ucg_config_h config;
+    status = ucg_config_read(NULL, NULL, &config);
+    if (status != UCG_OK) {
+        return status;
+    }
+
+    ucg_params_t params;
+    params.field_mask = UCG_PARAMS_FIELD_OOB_GROUP |
+                        UCG_PARAMS_FIELD_LOCATION_CB |
+                        UCG_PARAMS_FIELD_THREAD_MODE;
+    perf_oob_fill_group(perf->oob, &params.oob_group);
+    params.get_location = perf_oob_get_location;
+    params.thread_mode = perf->params->threads > 1 ? UCG_THREAD_MODE_MULTI :
+                                                     UCG_THREAD_MODE_SINGLE;
+    if (perf->params->lazy_address) {
+        params.field_mask |= UCG_PARAMS_FIELD_OOB_KVS;
+        perf_oob_fill_kvs(perf->oob, &params.oob_kvs);
+    }
+
+    double rss_kb = perf_get_rss_kb();
+    double time_ms = perf_get_time_ms();
+    status = ucg_init(&params, config, &perf->context);
+    ucg_config_release(config);
+    if (status != UCG_OK || !perf->params->report_init) {
+        return status;
+    }
+    return perf_report_init(perf, perf_get_time_ms() - time_ms,
+                            perf_get_rss_kb() - rss_kb);
+}
+
+static ucg_status_t perf_create_group(ucg_perf_t *perf, uint32_t id)
+{
+    ucg_group_params_t params;
+    params.field_mask = UCG_GROUP_PARAMS_FIELD_ID |
+                        UCG_GROUP_PARAMS_FIELD_SIZE |
+                        UCG_GROUP_PARAMS_FIELD_MYRANK |
+                        UCG_GROUP_PARAMS_FIELD_RANK_MAP |
+                        UCG_GROUP_PARAMS_FIELD_OOB_GROUP;
+    params.id = id;
+    params.size = perf->oob->size;
+    params.myrank = perf->oob->myrank;
+    params.rank_map.type = UCG_RANK_MAP_TYPE_FULL;
+    params.rank_map.size = params.size;
+    perf_oob_fill_group(perf->oob, &params.oob_group);
+    return ucg_group_create(perf->context, &params, &perf->group);
+}
+
+static ucg_status_t perf_create_dts(ucg_perf_t *perf)
+{
+    ucg_status_t status;
+    for (int i = 0; i < UCG_DT_TYPE_PREDEFINED_LAST; ++i) {
+        ucg_dt_params_t params;
+        params.field_mask = UCG_DT_PARAMS_FIELD_TYPE;
+        params.type = ucg_perf_dts[i].type;
+        status = ucg_dt_create(&params, &perf->dts[i]);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+
+    for (int i = 0; i < UCG_OP_TYPE_PREDEFINED_LAST; ++i) {
+        ucg_op_params_t params;
+        params.field_mask = UCG_OP_PARAMS_FIELD_TYPE;
+        params.type = ucg_perf_ops[i].type;
+        status = ucg_op_create(&params, &perf->ops[i]);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    return UCG_OK;
+}
+
+static void perf_destroy_dts(ucg_perf_t *perf)
+{
+    for (int i = 0; i < UCG_OP_TYPE_PREDEFINED_LAST; ++i) {
+        if (perf->ops[i] != NULL) {
+            ucg_op_destroy(perf->ops[i]);
+            perf->ops[i] = NULL;
+        }
+    }
+    for (int i = 0; i < UCG_DT_TYPE_PREDEFINED_LAST; ++i) {
+        if (perf->dts[i] != NULL) {
+            ucg_dt_destroy(perf->dts[i]);
+            perf->dts[i] = NULL;
+        }
+    }
+    return;
+}
+
+static ucg_status_t perf_alloc_buffers(ucg_perf_t *perf)
+{
+    const ucg_perf_params_t *params = perf->params;
+    long page_size = sysconf(_SC_PAGESIZE);
+    /* v-collectives need one block per peer. */
+    perf->buf_size = params->max_bytes * params->nprocs;
+    if (perf->buf_size == 0) {
+        perf->buf_size = page_size;
+    }
+
+    if (posix_memalign(&perf->sendbuf, page_size, perf->buf_size) != 0) {
+        goto err;
+    }
+    if (posix_memalign(&perf->recvbuf, page_size, perf->buf_size) != 0) {
+        goto err_free_sendbuf;
+    }
+    /* Zero keeps floating-point reductions away from NaN and denormals. */
+    memset(perf->sendbuf, 0, perf->buf_size);
+    memset(perf->recvbuf, 0, perf->buf_size);
+
+    perf->counts = malloc(params->nprocs * sizeof(int32_t));
+    if (perf->counts == NULL) {
+        goto err_free_recvbuf;
+    }
+    perf->displs = malloc(params->nprocs * sizeof(int32_t));
+    if (perf->displs == NULL) {
+        goto err_free_counts;
+    }
+    return UCG_OK;
+
+err_free_counts:
+    free(perf->counts);
+    perf->counts = NULL;
+err_free_recvbuf:
+    free(perf->recvbuf);
+    perf->recvbuf = NULL;
+err_free_sendbuf:
+    free(perf->sendbuf);
+    perf->sendbuf = NULL;
+err:
+    return UCG_ERR_NO_MEMORY;
+}
+
+static void perf_free_buffers(ucg_perf_t *perf)
+{
+    free(perf->displs);
+    free(perf->counts);
+    free(perf->recvbuf);
+    free(perf->sendbuf);
+    perf->displs = NULL;
+    perf->counts = NULL;
+    perf->recvbuf = NULL;
+    perf->sendbuf = NULL;
+    return;
+}
+
+static void perf_cleanup_workers(ucg_perf_t *perf, uint32_t count)
+{
+    if (perf->workers == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        ucg_group_destroy(perf->workers[i].group);
+        perf_free_buffers(&perf->workers[i]);
+    }
+    free(perf->workers);
+    perf->workers = NULL;
+    return;
+}
+
+/* Every thread has its own group, so that the collectives of the threads are matched
+   independently. The groups are created in the same order on all ranks. */
+static ucg_status_t perf_init_workers(ucg_perf_t *perf)
+{
+    uint32_t num_workers = perf->params->threads - 1;
+    if (num_workers == 0) {
+        return UCG_OK;
+    }
+
+    perf->workers = calloc(num_workers, sizeof(ucg_perf_t));
+    if (perf->workers == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    ucg_status_t status;
+    for (uint32_t i = 0; i < num_workers; ++i) {
+        ucg_perf_t *worker = &perf->workers[i];
+        *worker = *perf;
+        worker->workers = NULL;
+        status = perf_alloc_buffers(worker);
+        if (status != UCG_OK) {
+            perf_cleanup_workers(perf, i);
+            return status;
+        }
+        status = perf_create_group(worker, i + 1);
+        if (status != UCG_OK) {
+            perf_free_buffers(worker);
+            perf_cleanup_workers(perf, i);
+            return status;
+        }
+    }
+    return UCG_OK;
+}
+
+ucg_status_t perf_init(ucg_perf_t *perf, const ucg_perf_params_t *params,
+                       ucg_perf_oob_t *oob)
+{
+    ucg_status_t status;
+    memset(perf, 0, sizeof(*perf));
+    perf->params = params;
+    perf->oob = oob;
+
+    UCG_PERF_CHECK_GOTO(perf_alloc_buffers(perf), err);
+    UCG_PERF_CHECK_GOTO(perf_create_dts(perf), err_destroy_dts);
+    UCG_PERF_CHECK_GOTO(perf_init_context(perf), err_destroy_dts);
+    UCG_PERF_CHECK_GOTO(perf_create_group(perf, 0), err_cleanup_context);
+    UCG_PERF_CHECK_GOTO(perf_init_workers(perf), err_destroy_group);
+    return UCG_OK;
+
+err_destroy_group:
+    ucg_group_destroy(perf->group);
+err_cleanup_context:
+    ucg_cleanup(perf->context);
+err_destroy_dts:
+    perf_destroy_dts(perf);
+    perf_free_buffers(perf);
+err:
+    return status;
+}
+
+void perf_cleanup(ucg_perf_t *perf)
+{
+    perf_cleanup_workers(perf, perf->params->threads - 1);
+    ucg_group_destroy(perf->group);
+    ucg_cleanup(perf->context);
+    perf_destroy_dts(perf);
+    perf_free_buffers(perf);
+    return;
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_perf.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define PERF_OOB_SPIN_COUNT 1000
+
+/* get_location callback has no user argument, so keep the rank's oob here. */
+static ucg_perf_oob_t *perf_oob_self = NULL;
+
+static uint32_t perf_oob_ppn(const ucg_perf_oob_t *oob)
+{
+    return (oob->size + oob->nnodes - 1) / oob->nnodes;
+}
+
+static uint32_t perf_oob_num_local_procs(const ucg_perf_oob_t *oob)
+{
+    uint32_t ppn = perf_oob_ppn(oob);
+    uint32_t node_start = oob->myrank / ppn * ppn;
+    uint32_t node_end = node_start + ppn;
+    if (node_end > oob->size) {
+        node_end = oob->size;
+    }
+    return node_end - node_start;
+}
+
+ucg_status_t perf_oob_launch(const ucg_perf_params_t *params, ucg_perf_oob_t *oob,
+                             int *is_launcher)
+{
+    memset(oob, 0, sizeof(*oob));
+    oob->size = params->nprocs;
+    oob->nnodes = params->nnodes;
+    oob->nsockets = params->nsockets;
+    oob->shm_size = sizeof(ucg_perf_shm_t) +
+                    (size_t)oob->size * (UCG_PERF_OOB_SLOT_SIZE + UCG_PERF_OOB_KVS_SIZE);
+    oob->shm = mmap(NULL, oob->shm_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (oob->shm == MAP_FAILED) {
+        fprintf(stderr, "Failed to map %zu bytes of shared memory\n", oob->shm_size);
+        return UCG_ERR_NO_MEMORY;
+    }
+    memset(oob->shm, 0, sizeof(ucg_perf_shm_t));
+
+    oob->pids = calloc(oob->size, sizeof(pid_t));
+    if (oob->pids == NULL) {
+        munmap(oob->shm, oob->shm_size);
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    /* Avoid duplicating buffered output in every child. */
+    fflush(stdout);
+    fflush(stderr);
+    for (uint32_t i = 0; i < oob->size; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "Failed to fork rank %u\n", i);
+            oob->shm->abort = 1;
+            for (uint32_t j = 0; j < i; ++j) {
+                kill(oob->pids[j], SIGKILL);
+                waitpid(oob->pids[j], NULL, 0);
+            }
+            perf_oob_finalize(oob);
+            return UCG_ERR_NO_RESOURCE;
+        }
+        if (pid == 0) {
+            free(oob->pids);
+            oob->pids = NULL;
+            oob->myrank = i;
+            perf_oob_self = oob;
+            *is_launcher = 0;
+            return UCG_OK;
+        }
+        oob->pids[i] = pid;
+    }
+
+    *is_launcher = 1;
+    return UCG_OK;
+}
+
+int perf_oob_wait(ucg_perf_oob_t *oob)
+{
+    int ret = 0;
+    uint32_t nalive = oob->size;
+    while (nalive > 0) {
+        int wstatus;
+        pid_t pid = wait(&wstatus);
+        if (pid < 0) {
+            break;
+        }
+        --nalive;
+        if ((WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0) || ret != 0) {
+            continue;
+        }
+
+        uint32_t rank;
+        for (rank = 0; rank < oob->size; ++rank) {
+            if (oob->pids[rank] == pid) {
+                break;
+            }
+        }
+        if (WIFSIGNALED(wstatus)) {
+            fprintf(stderr, "Rank %u was killed by signal %d\n", rank, WTERMSIG(wstatus));
+        } else {
+            fprintf(stderr, "Rank %u exited with status %d\n", rank, WEXITSTATUS(wstatus));
+        }
+        /* The remaining ranks can never finish a collective, stop them. */
+        ret = -1;
+        __atomic_store_n(&oob->shm->abort, 1, __ATOMIC_RELEASE);
+        for (uint32_t i = 0; i < oob->size; ++i) {
+            if (oob->pids[i] != pid) {
+                kill(oob->pids[i], SIGKILL);
+            }
+        }
+    }
+    return ret;
+}
+
+void perf_oob_finalize(ucg_perf_oob_t *oob)
+{
+    if (oob->pids != NULL) {
+        free(oob->pids);
+        oob->pids = NULL;
+    }
+    if (oob->shm != NULL) {
+        munmap(oob->shm, oob->shm_size);
+        oob->shm = NULL;
+    }
+    perf_oob_self = NULL;
+    return;
+}
+
+/* Sense-reversing centralized barrier. */
+void perf_oob_barrier(ucg_perf_oob_t *oob)
+{
+    ucg_perf_shm_t *shm = oob->shm;
+    uint32_t sense = !oob->sense;
+    oob->sense = sense;
+
+    if (__atomic_add_fetch(&shm->count, 1, __ATOMIC_ACQ_REL) == oob->size) {
+        __atomic_store_n(&shm->count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&shm->sense, sense, __ATOMIC_RELEASE);
+        return;
+    }
+
+    int spin = 0;
+    while (__atomic_load_n(&shm->sense, __ATOMIC_ACQUIRE) != sense) {
+        if (__atomic_load_n(&shm->abort, __ATOMIC_ACQUIRE)) {
+            _exit(1);
+        }
+        /* The ranks may oversubscribe the cores, give the cpu away. */
+        if (++spin == PERF_OOB_SPIN_COUNT) {
+            spin = 0;
+            sched_yield();
+        }
+    }
+    return;
+}
+
+ucg_status_t perf_oob_allgather(const void *sendbuf, void *recvbuf,
+                                int32_t count, void *group)
+{
+    ucg_perf_oob_t *oob = (ucg_perf_oob_t*)group;
+    uint8_t *slots = oob->shm->slots;
+    uint8_t *myslot = slots + (size_t)oob->myrank * UCG_PERF_OOB_SLOT_SIZE;
+
+    /* Large data is exchanged in multiple rounds of one slot each. */
+    int32_t offset = 0;
+    do {
+        int32_t length = count - offset;
+        if (length > UCG_PERF_OOB_SLOT_SIZE) {
+            length = UCG_PERF_OOB_SLOT_SIZE;
+        }
+        memcpy(myslot, (const uint8_t*)sendbuf + offset, length);
+        perf_oob_barrier(oob);
+        for (uint32_t i = 0; i < oob->size; ++i) {
+            memcpy((uint8_t*)recvbuf + (size_t)i * count + offset,
+                   slots + (size_t)i * UCG_PERF_OOB_SLOT_SIZE, length);
+        }
+        /* Nobody may overwrite its slot before all ranks copied it. */
+        perf_oob_barrier(oob);
+        offset += length;
+    } while (offset < count);
+
+    return UCG_OK;
+}
+
+static uint8_t* perf_oob_kvs_entry(ucg_perf_oob_t *oob, ucg_rank_t rank)
+{
+    uint8_t *entries = oob->shm->slots + (size_t)oob->size * UCG_PERF_OOB_SLOT_SIZE;
+    return entries + (size_t)rank * UCG_PERF_OOB_KVS_SIZE;
+}
+
+static ucg_status_t perf_oob_kvs_publish(const void *data, uint32_t size, void *arg)
+{
+    ucg_perf_oob_t *oob = (ucg_perf_oob_t*)arg;
+    uint8_t *entry = perf_oob_kvs_entry(oob, oob->myrank);
+    ucg_status_t status = UCG_OK;
+    if (size > UCG_PERF_OOB_KVS_SIZE - sizeof(uint32_t)) {
+        fprintf(stderr, "Failed to publish %u bytes, too large\n", size);
+        size = 0;
+        status = UCG_ERR_NO_RESOURCE;
+    }
+    memcpy(entry + sizeof(uint32_t), data, size);
+    memcpy(entry, &size, sizeof(uint32_t));
+    /* Still wait for the others, they are publishing together. */
+    perf_oob_barrier(oob);
+    return status;
+}
+
+static ucg_status_t perf_oob_kvs_lookup(ucg_rank_t rank, void *data, uint32_t *size,
+                                        void *arg)
+{
+    ucg_perf_oob_t *oob = (ucg_perf_oob_t*)arg;
+    if (rank < 0 || rank >= (ucg_rank_t)oob->size) {
+        return UCG_ERR_INVALID_PARAM;
+    }
+
+    const uint8_t *entry = perf_oob_kvs_entry(oob, rank);
+    uint32_t length;
+    memcpy(&length, entry, sizeof(uint32_t));
+    if (length == 0) {
+        return UCG_ERR_NOT_FOUND;
+    }
+    if (data != NULL) {
+        if (*size < length) {
+            return UCG_ERR_TRUNCATE;
+        }
+        memcpy(data, entry + sizeof(uint32_t), length);
+    }
+    *size = length;
+    return UCG_OK;
+}
+
+ucg_status_t perf_oob_get_location(ucg_rank_t rank, ucg_location_t *location)
+{
+    ucg_perf_oob_t *oob = perf_oob_self;
+    if (oob == NULL || rank < 0 || rank >= (ucg_rank_t)oob->size) {
+        return UCG_ERR_INVALID_PARAM;
+    }
+
+    uint32_t ppn = perf_oob_ppn(oob);
+    uint32_t pps = (ppn + oob->nsockets - 1) / oob->nsockets;
+    location->field_mask = UCG_LOCATION_FIELD_SUBNET_ID |
+                           UCG_LOCATION_FIELD_NODE_ID |
+                           UCG_LOCATION_FIELD_SOCKET_ID;
+    location->subnet_id = 0;
+    location->node_id = rank / ppn;
+    location->socket_id = (rank % ppn) / pps;
+    return UCG_OK;
+}
+
+void perf_oob_fill_group(ucg_perf_oob_t *oob, ucg_oob_group_t *oob_group)
+{
+    oob_group->allgather = perf_oob_allgather;
+    oob_group->myrank = oob->myrank;
+    oob_group->size = oob->size;
+    oob_group->num_local_procs = perf_oob_num_local_procs(oob);
+    oob_group->group = oob;
+    return;
+}
+
+void perf_oob_fill_kvs(ucg_perf_oob_t *oob, ucg_oob_kvs_t *oob_kvs)
+{
+    oob_kvs->publish = perf_oob_kvs_publish;
+    oob_kvs->lookup = perf_oob_kvs_lookup;
+    oob_kvs->arg = oob;
+    return;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_perf.h"
+
+#include "core/ucg_group.h"
+
+#include <string.h>
+#include <ctype.h>
+
+#define PERF_PLAN_ENV_PREFIX    "UCG_PLANC_"
+
+static const ucg_coll_type_t perf_plan_coll_types[UCG_PERF_COLL_LAST] = {
+    [UCG_PERF_COLL_BCAST] = UCG_COLL_TYPE_BCAST,
+    [UCG_PERF_COLL_ALLREDUCE] = UCG_COLL_TYPE_ALLREDUCE,
+    [UCG_PERF_COLL_BARRIER] = UCG_COLL_TYPE_BARRIER,
+    [UCG_PERF_COLL_ALLTOALLV] = UCG_COLL_TYPE_ALLTOALLV,
+    [UCG_PERF_COLL_SCATTERV] = UCG_COLL_TYPE_SCATTERV,
+    [UCG_PERF_COLL_GATHERV] = UCG_COLL_TYPE_GATHERV,
+    [UCG_PERF_COLL_ALLGATHERV] = UCG_COLL_TYPE_ALLGATHERV,
+};
+
+ucg_status_t perf_plan_query(ucg_perf_t *perf, ucg_perf_coll_type_t coll_type,
+                             ucg_perf_plans_t *plans)
+{
+    ucg_plan_info_t infos[UCG_PERF_MAX_PLANS];
+    uint32_t count = UCG_PERF_MAX_PLANS;
+    ucg_status_t status = ucg_group_query_plans(perf->group, perf_plan_coll_types[coll_type],
+                                                UCG_MEM_TYPE_HOST, infos, &count);
+    if (status == UCG_ERR_TRUNCATE) {
+        fprintf(stderr, "Too many plans, ignore %u plans\n", count - UCG_PERF_MAX_PLANS);
+        count = UCG_PERF_MAX_PLANS;
+    } else if (status != UCG_OK) {
+        return status;
+    }
+
+    /* The infos are sorted by planc and id. */
+    for (uint32_t i = 0; i < count; ++i) {
+        ucg_perf_plan_t *plan = &plans->plans[i];
+        plan->id = infos[i].id;
+        snprintf(plan->planc, sizeof(plan->planc), "%s", infos[i].planc);
+        snprintf(plan->name, sizeof(plan->name), "%s", infos[i].name);
+    }
+    plans->count = count;
+    return UCG_OK;
+}
+
+const ucg_perf_plan_t *perf_plan_find(const ucg_perf_plans_t *plans, const char *planc,
+                                      int32_t id)
+{
+    for (uint32_t i = 0; i < plans->count; ++i) {
+        if (plans->plans[i].id == id && !strcmp(plans->plans[i].planc, planc)) {
+            return &plans->plans[i];
+        }
+    }
+    return NULL;
+}
+
+static void perf_plan_upper(char *dst, size_t size, const char *src)
+{
+    size_t len = 0;
+    for (; *src != '\0' && len < size - 1; ++src) {
+        dst[len++] = toupper(*src);
+    }
+    dst[len] = '\0';
+    return;
+}
+
+void perf_plan_env_name(ucg_perf_coll_type_t coll_type, const char *planc,
+                        char *name, size_t size)
+{
+    char planc_upper[UCG_PERF_MAX_PLANC_LEN];
+    char coll_upper[32];
+    perf_plan_upper(planc_upper, sizeof(planc_upper), planc);
+    perf_plan_upper(coll_upper, sizeof(coll_upper), ucg_perf_colls[coll_type].name);
+    snprintf(name, size, "%s%s_%s_ATTR", PERF_PLAN_ENV_PREFIX, planc_upper, coll_upper);
+    return;
+}
+
+/* All groups of the benchmark select the same plan. */
+static ucg_status_t perf_plan_force_groups(ucg_perf_t *perf, ucg_perf_coll_type_t coll_type,
+                                           const char *planc, int32_t id)
+{
+    uint32_t num_workers = perf->workers == NULL ? 0 : perf->params->threads - 1;
+    for (uint32_t i = 0; i <= num_workers; ++i) {
+        ucg_perf_t *group_perf = i == 0 ? perf : &perf->workers[i - 1];
+        ucg_status_t status = ucg_group_force_plan(group_perf->group,
+                                                   perf_plan_coll_types[coll_type],
+                                                   UCG_MEM_TYPE_HOST, planc, id);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    return UCG_OK;
+}
+
+ucg_status_t perf_plan_force(ucg_perf_t *perf, ucg_perf_coll_type_t coll_type,
+                             const ucg_perf_plan_t *plan)
+{
+    return perf_plan_force_groups(perf, coll_type, plan->planc, plan->id);
+}
+
+void perf_plan_unforce(ucg_perf_t *perf, ucg_perf_coll_type_t coll_type)
+{
+    perf_plan_force_groups(perf, coll_type, NULL, 0);
+    return;
+}
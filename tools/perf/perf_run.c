@@ -0,0 +1,530 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_perf.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Measured iterations of one thread, the first thread runs on the caller. */
+typedef struct ucg_perf_thread {
+    ucg_perf_t *perf; /* Group and buffers of the thread */
+    ucg_request_h *requests;
+    uint32_t count;
+    int first;
+    pthread_mutex_t *lock; /* Held until the barrier is initialized */
+    pthread_barrier_t *barrier;
+    ucg_status_t status;
+    double elapsed_us; /* Wall time of all threads, set by the first one */
+    double cpu_us; /* CPU time of the process, set by the first one */
+} ucg_perf_thread_t;
+
+static double perf_get_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+static double perf_get_cpu_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+static ucg_status_t perf_request_complete(ucg_perf_t *perf, ucg_request_h request)
+{
+    if (perf->params->wait) {
+        return ucg_request_wait(request);
+    }
+
+    ucg_status_t status;
+    while ((status = ucg_request_test(request)) == UCG_INPROGRESS) {
+        ucg_progress(perf->context);
+    }
+    return status;
+}
+
+static ucg_status_t perf_request_run(ucg_perf_t *perf, ucg_request_h request)
+{
+    ucg_status_t status = ucg_request_start(request);
+    if (status != UCG_OK) {
+        return status;
+    }
+    if (perf->params->wait) {
+        return ucg_request_wait(request);
+    }
+    /* A single collective doesn't need the others progressed. */
+    do {
+        status = ucg_request_test(request);
+    } while (status == UCG_INPROGRESS);
+    return status;
+}
+
+/* Busy loop without calling into UCG, like the computation of an application. */
+static void perf_compute(uint32_t compute_us)
+{
+    double end = perf_get_time_us() + compute_us;
+    while (perf_get_time_us() < end) {
+    }
+    return;
+}
+
+/* Start all requests, then wait for them in order while progressing the others. */
+static ucg_status_t perf_requests_run(ucg_perf_t *perf, ucg_request_h *requests,
+                                      uint32_t count, uint32_t compute_us)
+{
+    if (count == 1 && compute_us == 0) {
+        return perf_request_run(perf, requests[0]);
+    }
+
+    ucg_status_t status;
+    for (uint32_t i = 0; i < count; ++i) {
+        /* Too many requests in flight, the oldest ones complete while progressing. */
+        while ((status = ucg_request_start(requests[i])) == UCG_ERR_NO_RESOURCE) {
+            ucg_progress(perf->context);
+        }
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    perf_compute(compute_us);
+    for (uint32_t i = 0; i < count; ++i) {
+        status = perf_request_complete(perf, requests[i]);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    return UCG_OK;
+}
+
+/* Returns the first failure of all ranks, so that every rank takes the same path. */
+static ucg_status_t perf_agree_status(ucg_perf_t *perf, ucg_status_t status)
+{
+    uint32_t nprocs = perf->oob->size;
+    int32_t local = status;
+    int32_t *all = malloc(nprocs * sizeof(int32_t));
+    if (all == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    perf_oob_allgather(&local, all, sizeof(int32_t), perf->oob);
+    status = UCG_OK;
+    for (uint32_t i = 0; i < nprocs; ++i) {
+        if (all[i] != UCG_OK) {
+            status = (ucg_status_t)all[i];
+            break;
+        }
+    }
+    free(all);
+    return status;
+}
+
+static ucg_status_t perf_reduce_result(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                                       double local_us, double local_cpu,
+                                       double local_overlap, ucg_perf_result_t *result)
+{
+    uint32_t nprocs = perf->oob->size;
+    double *all = malloc(nprocs * 3 * sizeof(double));
+    if (all == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    double local[3] = {local_us, local_cpu, local_overlap};
+    perf_oob_allgather(local, all, sizeof(local), perf->oob);
+    result->min_us = all[0];
+    result->max_us = all[0];
+    double sum = 0;
+    double cpu_sum = 0;
+    double overlap_sum = 0;
+    for (uint32_t i = 0; i < nprocs; ++i) {
+        double us = all[3 * i];
+        if (us < result->min_us) {
+            result->min_us = us;
+        }
+        if (us > result->max_us) {
+            result->max_us = us;
+        }
+        sum += us;
+        cpu_sum += all[3 * i + 1];
+        overlap_sum += all[3 * i + 2];
+    }
+    free(all);
+    result->avg_us = sum / nprocs;
+    result->cpu = cpu_sum / nprocs;
+    result->overlap = overlap_sum / nprocs;
+
+    const ucg_perf_coll_t *coll = &ucg_perf_colls[pcase->coll];
+    uint64_t total_bytes = coll->total_bytes(pcase->bytes, nprocs);
+    result->algbw = 0;
+    if (result->avg_us > 0) {
+        result->algbw = total_bytes / (result->avg_us * 1e3);
+    }
+    result->busbw = result->algbw * coll->busbw_factor(nprocs);
+    return UCG_OK;
+}
+
+/*
+ * Run the iterations again with the computation, the overlap is the part of the
+ * shorter of the collectives and the computation that is hidden by the other.
+ */
+static ucg_status_t perf_run_overlap(ucg_perf_t *perf, ucg_request_h *requests,
+                                     uint32_t count, double coll_us, double *overlap)
+{
+    const ucg_perf_params_t *params = perf->params;
+    ucg_status_t status;
+
+    perf_oob_barrier(perf->oob);
+    double start = perf_get_time_us();
+    for (uint32_t i = 0; i < params->iters; ++i) {
+        status = perf_requests_run(perf, requests, count, params->compute_us);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    double total_us = (perf_get_time_us() - start) / params->iters;
+
+    double compute_us = params->compute_us;
+    double shorter = (coll_us < compute_us) ? coll_us : compute_us;
+    *overlap = 0;
+    if (shorter > 0) {
+        *overlap = (coll_us + compute_us - total_us) * 100 / shorter;
+    }
+    if (*overlap < 0) {
+        *overlap = 0;
+    } else if (*overlap > 100) {
+        *overlap = 100;
+    }
+    return UCG_OK;
+}
+
+static ucg_perf_t *perf_get_thread(ucg_perf_t *perf, uint32_t thread)
+{
+    return thread == 0 ? perf : &perf->workers[thread - 1];
+}
+
+static void *perf_thread_run(void *arg)
+{
+    ucg_perf_thread_t *thread = (ucg_perf_thread_t*)arg;
+    ucg_perf_t *perf = thread->perf;
+    const ucg_perf_params_t *params = perf->params;
+    ucg_status_t status = UCG_OK;
+
+    if (!thread->first) {
+        pthread_mutex_lock(thread->lock);
+        pthread_mutex_unlock(thread->lock);
+    }
+
+    for (uint32_t i = 0; i < params->warmup && status == UCG_OK; ++i) {
+        status = perf_requests_run(perf, thread->requests, thread->count, 0);
+    }
+
+    /* The first thread synchronizes the processes while the others wait. */
+    pthread_barrier_wait(thread->barrier);
+    if (thread->first) {
+        perf_oob_barrier(perf->oob);
+    }
+    pthread_barrier_wait(thread->barrier);
+    double start = perf_get_time_us();
+    double cpu_start = perf_get_cpu_time_us();
+    for (uint32_t i = 0; i < params->iters && status == UCG_OK; ++i) {
+        status = perf_requests_run(perf, thread->requests, thread->count, 0);
+    }
+    pthread_barrier_wait(thread->barrier);
+    thread->elapsed_us = perf_get_time_us() - start;
+    thread->cpu_us = perf_get_cpu_time_us() - cpu_start;
+    thread->status = status;
+    return NULL;
+}
+
+/* Run the warmup and measured iterations in all threads, each on its own requests. */
+static ucg_status_t perf_run_threads(ucg_perf_t *perf, ucg_request_h *requests,
+                                     uint32_t count, double *elapsed_us, double *cpu_us)
+{
+    uint32_t nthreads = perf->params->threads;
+    ucg_perf_thread_t *threads = calloc(nthreads, sizeof(ucg_perf_thread_t));
+    pthread_t *tids = calloc(nthreads, sizeof(pthread_t));
+    if (threads == NULL || tids == NULL) {
+        free(tids);
+        free(threads);
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_barrier_t barrier;
+    for (uint32_t t = 0; t < nthreads; ++t) {
+        threads[t].perf = perf_get_thread(perf, t);
+        threads[t].requests = &requests[t * count];
+        threads[t].count = count;
+        threads[t].first = (t == 0);
+        threads[t].lock = &lock;
+        threads[t].barrier = &barrier;
+        threads[t].status = UCG_ERR_NO_RESOURCE;
+    }
+
+    /* The barrier counts only the threads that are really started. */
+    uint32_t started = 1;
+    pthread_mutex_lock(&lock);
+    for (; started < nthreads; ++started) {
+        if (pthread_create(&tids[started], NULL, perf_thread_run, &threads[started]) != 0) {
+            fprintf(stderr, "Failed to create thread %u\n", started);
+            break;
+        }
+    }
+    pthread_barrier_init(&barrier, NULL, started);
+    pthread_mutex_unlock(&lock);
+
+    perf_thread_run(&threads[0]);
+    ucg_status_t status = UCG_OK;
+    for (uint32_t t = 0; t < nthreads; ++t) {
+        if (t > 0 && t < started) {
+            pthread_join(tids[t], NULL);
+        }
+        if (status == UCG_OK) {
+            status = threads[t].status;
+        }
+    }
+    pthread_barrier_destroy(&barrier);
+
+    *elapsed_us = threads[0].elapsed_us;
+    *cpu_us = threads[0].cpu_us;
+    free(tids);
+    free(threads);
+    return status;
+}
+
+ucg_status_t perf_run_case(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                           ucg_perf_result_t *result)
+{
+    const ucg_perf_params_t *params = perf->params;
+    uint32_t count = params->outstanding;
+    uint32_t total = count * params->threads;
+    ucg_status_t status = UCG_OK;
+
+    memset(result, 0, sizeof(*result));
+    ucg_request_h *requests = calloc(total, sizeof(ucg_request_h));
+    if (requests == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+
+    /* The requests of the threads are created in the same order on all ranks. */
+    for (uint32_t i = 0; i < total && status == UCG_OK; ++i) {
+        status = ucg_perf_colls[pcase->coll].init(perf_get_thread(perf, i / count), pcase,
+                                                  &requests[i]);
+    }
+    result->status = perf_agree_status(perf, status);
+    if (result->status != UCG_OK) {
+        /* Not fatal, e.g. no plan supports the case. */
+        status = UCG_OK;
+        goto out;
+    }
+
+    double elapsed;
+    double cpu_time;
+    status = perf_run_threads(perf, requests, count, &elapsed, &cpu_time);
+    if (status != UCG_OK) {
+        goto out;
+    }
+    double cpu = 0;
+    if (elapsed > 0) {
+        cpu = cpu_time * 100 / elapsed;
+    }
+
+    double overlap = 0;
+    if (params->compute_us > 0) {
+        status = perf_run_overlap(perf, requests, count, elapsed / params->iters, &overlap);
+        if (status != UCG_OK) {
+            goto out;
+        }
+    }
+
+    /* The threads run concurrently, so the time of one collective is divided by the
+       number in flight in all threads. */
+    status = perf_reduce_result(perf, pcase, elapsed / params->iters / total, cpu, overlap,
+                                result);
+
+out:
+    for (uint32_t i = 0; i < total; ++i) {
+        if (requests[i] != NULL) {
+            ucg_request_cleanup(requests[i]);
+        }
+    }
+    free(requests);
+    return status;
+}
+
+uint32_t perf_make_cases(const ucg_perf_params_t *params, ucg_perf_coll_type_t coll_type,
+                         ucg_perf_case_t *cases)
+{
+    const ucg_perf_coll_t *coll = &ucg_perf_colls[coll_type];
+    uint32_t num_dts = (coll->flags & UCG_PERF_COLL_FLAG_NO_DATA) ? 1 : params->num_dts;
+    uint32_t num_ops = (coll->flags & UCG_PERF_COLL_FLAG_REDUCE) ? params->num_ops : 1;
+    uint32_t num_roots = 1;
+    if (coll->flags & UCG_PERF_COLL_FLAG_ROOTED) {
+        num_roots = params->all_roots ? params->nprocs : params->num_roots;
+    }
+
+    uint32_t num_cases = 0;
+    ucg_perf_case_t pcase;
+    pcase.coll = coll_type;
+    for (uint32_t d = 0; d < num_dts; ++d) {
+        pcase.dt_type = params->dts[d];
+        uint32_t dt_size = ucg_perf_dts[pcase.dt_type].size;
+        for (uint32_t o = 0; o < num_ops; ++o) {
+            pcase.op_type = params->ops[o];
+            for (uint32_t r = 0; r < num_roots; ++r) {
+                pcase.root = params->all_roots ? (ucg_rank_t)r : params->roots[r];
+                if (coll->flags & UCG_PERF_COLL_FLAG_NO_DATA) {
+                    pcase.bytes = 0;
+                    pcase.count = 0;
+                    if (cases != NULL) {
+                        cases[num_cases] = pcase;
+                    }
+                    ++num_cases;
+                    continue;
+                }
+                for (uint64_t bytes = params->min_bytes; bytes <= params->max_bytes;
+                     bytes = (bytes == 0) ? 1 : bytes * params->step_factor) {
+                    pcase.count = (int32_t)(bytes / dt_size);
+                    pcase.bytes = (uint64_t)pcase.count * dt_size;
+                    if (pcase.count == 0) {
+                        continue;
+                    }
+                    if (cases != NULL) {
+                        cases[num_cases] = pcase;
+                    }
+                    ++num_cases;
+                }
+            }
+        }
+    }
+    return num_cases;
+}
+
+int perf_is_same_series(const ucg_perf_case_t *case1, const ucg_perf_case_t *case2)
+{
+    return case1->coll == case2->coll && case1->dt_type == case2->dt_type &&
+           case1->op_type == case2->op_type && case1->root == case2->root;
+}
+
+int perf_is_root(const ucg_perf_t *perf)
+{
+    return perf->oob->myrank == 0;
+}
+
+void perf_print_series(const ucg_perf_params_t *params, const char *title,
+                       const ucg_perf_case_t *pcase)
+{
+    const ucg_perf_coll_t *coll = &ucg_perf_colls[pcase->coll];
+    printf("\n# %s: %s", title, coll->name);
+    if (!(coll->flags & UCG_PERF_COLL_FLAG_NO_DATA)) {
+        printf("  Datatype: %s", ucg_perf_dts[pcase->dt_type].name);
+    }
+    if (coll->flags & UCG_PERF_COLL_FLAG_REDUCE) {
+        printf("  Op: %s", ucg_perf_ops[pcase->op_type].name);
+    }
+    if (coll->flags & UCG_PERF_COLL_FLAG_ROOTED) {
+        printf("  Root: %d", pcase->root);
+    }
+    printf("  Processes: %u  Nodes: %u", params->nprocs, params->nnodes);
+    if (params->threads > 1) {
+        printf("  Threads: %u", params->threads);
+    }
+    printf("\n");
+    return;
+}
+
+static void perf_print_header(ucg_perf_t *perf, const ucg_perf_case_t *pcase)
+{
+    if (!perf_is_root(perf)) {
+        return;
+    }
+
+    perf_print_series(perf->params, "Collective", pcase);
+    printf("# %12s %10s %8s %10s %10s %10s %12s %12s", "bytes", "count", "iters",
+           "min(us)", "avg(us)", "max(us)", "algbw(GB/s)", "busbw(GB/s)");
+    if (perf->params->wait) {
+        printf(" %8s", "cpu(%)");
+    }
+    if (perf->params->compute_us > 0) {
+        printf(" %11s", "overlap(%)");
+    }
+    printf("\n");
+    fflush(stdout);
+    return;
+}
+
+static void perf_print_result(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                              const ucg_perf_result_t *result)
+{
+    if (!perf_is_root(perf)) {
+        return;
+    }
+
+    if (result->status != UCG_OK) {
+        printf("  %12lu %10d %8s  %s\n", pcase->bytes, pcase->count, "-",
+               ucg_status_string(result->status));
+    } else {
+        printf("  %12lu %10d %8u %10.2f %10.2f %10.2f %12.3f %12.3f", pcase->bytes,
+               pcase->count, perf->params->iters, result->min_us, result->avg_us,
+               result->max_us, result->algbw, result->busbw);
+        if (perf->params->wait) {
+            printf(" %8.1f", result->cpu);
+        }
+        if (perf->params->compute_us > 0) {
+            printf(" %11.1f", result->overlap);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+    return;
+}
+
+ucg_status_t perf_run_coll(ucg_perf_t *perf, ucg_perf_coll_type_t coll_type)
+{
+    ucg_status_t status = UCG_OK;
+    uint32_t num_cases = perf_make_cases(perf->params, coll_type, NULL);
+    if (num_cases == 0) {
+        return UCG_OK;
+    }
+
+    ucg_perf_case_t *cases = malloc(num_cases * sizeof(ucg_perf_case_t));
+    if (cases == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    perf_make_cases(perf->params, coll_type, cases);
+
+    for (uint32_t i = 0; i < num_cases; ++i) {
+        if (i == 0 || !perf_is_same_series(&cases[i - 1], &cases[i])) {
+            perf_print_header(perf, &cases[i]);
+        }
+        ucg_perf_result_t result;
+        status = perf_run_case(perf, &cases[i], &result);
+        perf_print_result(perf, &cases[i], &result);
+        if (status != UCG_OK) {
+            break;
+        }
+    }
+
+    free(cases);
+    return status;
+}
+
+ucg_status_t perf_run(ucg_perf_t *perf)
+{
+    ucg_status_t status;
+    for (int c = 0; c < UCG_PERF_COLL_LAST; ++c) {
+        if (!(perf->params->colls & UCG_BIT(c))) {
+            continue;
+        }
+        status = perf_run_coll(perf, (ucg_perf_coll_type_t)c);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    return UCG_OK;
+}
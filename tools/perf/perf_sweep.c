@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_perf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PERF_SWEEP_UNSUPPORTED (-1.0)
+
+static double *perf_sweep_latency(const ucg_perf_sweep_t *sweep, uint32_t column)
+{
+    return sweep->latency + (size_t)column * sweep->num_cases;
+}
+
+static ucg_status_t perf_sweep_run(ucg_perf_t *perf, const ucg_perf_sweep_t *sweep,
+                                   uint32_t column)
+{
+    ucg_status_t status;
+    double *latency = perf_sweep_latency(sweep, column);
+    for (uint32_t i = 0; i < sweep->num_cases; ++i) {
+        ucg_perf_result_t result;
+        status = perf_run_case(perf, &sweep->cases[i], &result);
+        if (status != UCG_OK) {
+            return status;
+        }
+        latency[i] = (result.status == UCG_OK) ? result.avg_us : PERF_SWEEP_UNSUPPORTED;
+    }
+    return UCG_OK;
+}
+
+static ucg_status_t perf_sweep_run_plan(ucg_perf_t *perf, const ucg_perf_sweep_t *sweep,
+                                        uint32_t plan_idx)
+{
+    const ucg_perf_plan_t *plan = &sweep->plans.plans[plan_idx];
+    if (perf->oob->myrank == 0) {
+        printf("# Sweeping %s plan %s:%d (%s)\n", ucg_perf_colls[sweep->coll].name,
+               plan->planc, plan->id, plan->name);
+        fflush(stdout);
+    }
+
+    ucg_status_t status = perf_plan_force(perf, sweep->coll, plan);
+    if (status != UCG_OK) {
+        return status;
+    }
+    status = perf_sweep_run(perf, sweep, plan_idx + 1);
+    perf_plan_unforce(perf, sweep->coll);
+    return status;
+}
+
+int32_t perf_sweep_best(const ucg_perf_sweep_t *sweep, uint32_t case_idx,
+                        double *best_latency)
+{
+    int32_t best = -1;
+    for (uint32_t p = 0; p < sweep->plans.count; ++p) {
+        double latency = perf_sweep_latency(sweep, p + 1)[case_idx];
+        if (latency < 0) {
+            continue;
+        }
+        if (best < 0 || latency < *best_latency) {
+            best = p;
+            *best_latency = latency;
+        }
+    }
+    return best;
+}
+
+static void perf_sweep_print_latency(double latency)
+{
+    if (latency < 0) {
+        printf(" %10s", "-");
+    } else {
+        printf(" %10.2f", latency);
+    }
+    return;
+}
+
+/* Same as the value of option -p. */
+static void perf_sweep_plan_title(const ucg_perf_plan_t *plan, char *title, size_t size)
+{
+    snprintf(title, size, "%s:%d", plan->planc, plan->id);
+    return;
+}
+
+static void perf_sweep_print(const ucg_perf_params_t *params, const ucg_perf_sweep_t *sweep)
+{
+    const ucg_perf_plans_t *plans = &sweep->plans;
+    for (uint32_t i = 0; i < sweep->num_cases; ++i) {
+        const ucg_perf_case_t *pcase = &sweep->cases[i];
+        if (i == 0 || !perf_is_same_series(&sweep->cases[i - 1], pcase)) {
+            perf_print_series(params, "Sweep", pcase);
+            for (uint32_t p = 0; p < plans->count; ++p) {
+                char title[32];
+                perf_sweep_plan_title(&plans->plans[p], title, sizeof(title));
+                printf("#   %-10s %s\n", title, plans->plans[p].name);
+            }
+            printf("# %12s %10s", "bytes", "default");
+            for (uint32_t p = 0; p < plans->count; ++p) {
+                char title[32];
+                perf_sweep_plan_title(&plans->plans[p], title, sizeof(title));
+                printf(" %10s", title);
+            }
+            printf(" %8s %8s\n", "best", "gain");
+        }
+
+        printf("  %12lu", pcase->bytes);
+        double default_latency = perf_sweep_latency(sweep, 0)[i];
+        perf_sweep_print_latency(default_latency);
+        for (uint32_t p = 0; p < plans->count; ++p) {
+            perf_sweep_print_latency(perf_sweep_latency(sweep, p + 1)[i]);
+        }
+
+        double best_latency = 0;
+        int32_t best = perf_sweep_best(sweep, i, &best_latency);
+        if (best < 0) {
+            printf(" %8s %8s\n", "-", "-");
+            continue;
+        }
+        char title[32];
+        perf_sweep_plan_title(&plans->plans[best], title, sizeof(title));
+        /* How much faster the best plan is than the default selection. */
+        if (default_latency > 0 && best_latency > 0) {
+            printf(" %8s %7.2fx\n", title, default_latency / best_latency);
+        } else {
+            printf(" %8s %8s\n", title, "-");
+        }
+    }
+    fflush(stdout);
+    return;
+}
+
+void perf_sweep_cleanup(ucg_perf_sweep_t *sweep)
+{
+    free(sweep->latency);
+    free(sweep->cases);
+    sweep->latency = NULL;
+    sweep->cases = NULL;
+    return;
+}
+
+ucg_status_t perf_sweep_coll(const ucg_perf_params_t *params, ucg_perf_oob_t *oob,
+                             ucg_perf_coll_type_t coll_type, ucg_perf_sweep_t *sweep)
+{
+    ucg_status_t status;
+    ucg_perf_t perf;
+
+    memset(sweep, 0, sizeof(*sweep));
+    sweep->coll = coll_type;
+    sweep->num_cases = perf_make_cases(params, coll_type, NULL);
+    if (sweep->num_cases == 0) {
+        return UCG_OK;
+    }
+    sweep->cases = malloc(sweep->num_cases * sizeof(ucg_perf_case_t));
+    if (sweep->cases == NULL) {
+        return UCG_ERR_NO_MEMORY;
+    }
+    perf_make_cases(params, coll_type, sweep->cases);
+
+    /* The default selection is measured first, it also tells which plans exist. */
+    UCG_PERF_CHECK_GOTO(perf_init(&perf, params, oob), err);
+    UCG_PERF_CHECK_GOTO(perf_plan_query(&perf, coll_type, &sweep->plans), err_cleanup);
+    sweep->latency = malloc((size_t)(sweep->plans.count + 1) * sweep->num_cases *
+                            sizeof(double));
+    if (sweep->latency == NULL) {
+        status = UCG_ERR_NO_MEMORY;
+        goto err_cleanup;
+    }
+    status = perf_sweep_run(&perf, sweep, 0);
+    if (status != UCG_OK) {
+        goto err_cleanup;
+    }
+
+    for (uint32_t p = 0; p < sweep->plans.count; ++p) {
+        status = perf_sweep_run_plan(&perf, sweep, p);
+        if (status != UCG_OK) {
+            goto err_cleanup;
+        }
+    }
+    perf_cleanup(&perf);
+    return UCG_OK;
+
+err_cleanup:
+    perf_cleanup(&perf);
+err:
+    perf_sweep_cleanup(sweep);
+    return status;
+}
+
+static void perf_sweep_print_tuned(const ucg_perf_sweep_t *sweep, FILE *tune_file)
+{
+    char name[64];
+    char attr[UCG_PERF_MAX_ATTR_LEN];
+    int tuned = 0;
+    /* One attribute per planc, the plans are sorted by planc. */
+    for (uint32_t p = 0; p < sweep->plans.count; ++p) {
+        const char *planc = sweep->plans.plans[p].planc;
+        if ((p > 0 && !strcmp(sweep->plans.plans[p - 1].planc, planc)) ||
+            perf_tune_attr(sweep, planc, attr, sizeof(attr)) != UCG_OK) {
+            continue;
+        }
+
+        perf_plan_env_name(sweep->coll, planc, name, sizeof(name));
+        printf("%s# Tuned: %s=%s\n", tuned ? "" : "\n", name, attr);
+        if (tune_file != NULL) {
+            fprintf(tune_file, "export %s=%s\n", name, attr);
+        }
+        tuned = 1;
+    }
+    if (!tuned) {
+        printf("\n# No tuned plan attribute for %s\n", ucg_perf_colls[sweep->coll].name);
+    }
+    fflush(stdout);
+    return;
+}
+
+ucg_status_t perf_sweep(const ucg_perf_params_t *params, ucg_perf_oob_t *oob)
+{
+    ucg_status_t status = UCG_OK;
+    FILE *tune_file = NULL;
+    if (oob->myrank == 0 && params->tune_file != NULL) {
+        tune_file = fopen(params->tune_file, "w");
+        if (tune_file == NULL) {
+            fprintf(stderr, "Failed to open %s\n", params->tune_file);
+            return UCG_ERR_IO_ERROR;
+        }
+    }
+
+    for (int c = 0; c < UCG_PERF_COLL_LAST; ++c) {
+        if (!(params->colls & UCG_BIT(c))) {
+            continue;
+        }
+
+        ucg_perf_sweep_t sweep;
+        status = perf_sweep_coll(params, oob, (ucg_perf_coll_type_t)c, &sweep);
+        if (status != UCG_OK) {
+            break;
+        }
+        if (oob->myrank == 0) {
+            perf_sweep_print(params, &sweep);
+            perf_sweep_print_tuned(&sweep, tune_file);
+        }
+        perf_sweep_cleanup(&sweep);
+    }
+
+    if (tune_file != NULL) {
+        fclose(tune_file);
+    }
+    return status;
+}
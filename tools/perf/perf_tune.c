@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#include "ucg_perf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Above the builtin scores, so that tuned plans take precedence. */
+#define PERF_TUNE_SCORE_BASE 100
+
+/**
+ * @brief Plans measured at one message size, aggregated over all series.
+ */
+typedef struct perf_tune_bucket {
+    uint64_t bytes; /* Start of the bucket, it ends at the start of the next one */
+    int32_t winner; /* Plan index, negative if no plan supports all series */
+} perf_tune_bucket_t;
+
+#define PERF_TUNE_RANGE_MAX UINT64_MAX
+
+/**
+ * @brief Range and score of one plan in the tuned attribute.
+ */
+typedef struct perf_tune_plan {
+    int used;
+    uint64_t start;
+    uint64_t end; /* PERF_TUNE_RANGE_MAX means no upper bound */
+    uint32_t depth; /* Nested ranges get higher scores */
+} perf_tune_plan_t;
+
+static int perf_tune_compare_bytes(const void *a, const void *b)
+{
+    uint64_t bytes1 = *(const uint64_t*)a;
+    uint64_t bytes2 = *(const uint64_t*)b;
+    return (bytes1 > bytes2) - (bytes1 < bytes2);
+}
+
+/* Distinct message sizes of the sweep in ascending order. */
+static uint32_t perf_tune_sizes(const ucg_perf_sweep_t *sweep, uint64_t *sizes)
+{
+    if (ucg_perf_colls[sweep->coll].flags & UCG_PERF_COLL_FLAG_NO_MSG_SIZE) {
+        sizes[0] = 0;
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < sweep->num_cases; ++i) {
+        sizes[i] = sweep->cases[i].bytes;
+    }
+    qsort(sizes, sweep->num_cases, sizeof(uint64_t), perf_tune_compare_bytes);
+    uint32_t num_sizes = 0;
+    for (uint32_t i = 0; i < sweep->num_cases; ++i) {
+        if (num_sizes == 0 || sizes[num_sizes - 1] != sizes[i]) {
+            sizes[num_sizes++] = sizes[i];
+        }
+    }
+    return num_sizes;
+}
+
+/* The winner of a size is the plan with the least total latency over all series. */
+static int32_t perf_tune_winner(const ucg_perf_sweep_t *sweep, uint64_t bytes)
+{
+    int ignore_size = ucg_perf_colls[sweep->coll].flags & UCG_PERF_COLL_FLAG_NO_MSG_SIZE;
+    int32_t winner = -1;
+    double winner_latency = 0;
+    for (uint32_t p = 0; p < sweep->plans.count; ++p) {
+        const double *latency = sweep->latency + (size_t)(p + 1) * sweep->num_cases;
+        double total = 0;
+        uint32_t i;
+        for (i = 0; i < sweep->num_cases; ++i) {
+            if (!ignore_size && sweep->cases[i].bytes != bytes) {
+                continue;
+            }
+            if (latency[i] < 0) {
+                break;
+            }
+            total += latency[i];
+        }
+        if (i < sweep->num_cases) {
+            continue;
+        }
+        if (winner < 0 || total < winner_latency) {
+            winner = p;
+            winner_latency = total;
+        }
+    }
+    return winner;
+}
+
+/* Sizes that no plan supports are served by the plan of the neighbour bucket. */
+static int perf_tune_fill_gaps(perf_tune_bucket_t *buckets, uint32_t num_buckets)
+{
+    int32_t last = -1;
+    for (uint32_t i = 0; i < num_buckets; ++i) {
+        if (buckets[i].winner < 0) {
+            buckets[i].winner = last;
+        }
+        last = buckets[i].winner;
+    }
+    for (uint32_t i = num_buckets; i > 0; --i) {
+        if (buckets[i - 1].winner < 0) {
+            buckets[i - 1].winner = last;
+        }
+        last = buckets[i - 1].winner;
+    }
+    return last >= 0;
+}
+
+/**
+ * Each plan takes one range only, so a plan winning several disjoint runs gets
+ * the range covering all of them, and the plans winning in between get nested
+ * ranges with higher scores. Runs are walked with a stack of open ranges; a run
+ * of a plan whose range was already closed can not be expressed and is left to
+ * the innermost open plan.
+ */
+static uint32_t perf_tune_assign(const ucg_perf_sweep_t *sweep,
+                                 const perf_tune_bucket_t *buckets,
+                                 uint32_t num_buckets, perf_tune_plan_t *plans)
+{
+    int32_t stack[UCG_PERF_MAX_PLANS];
+    int closed[UCG_PERF_MAX_PLANS] = {0};
+    uint32_t num_lost = 0;
+    uint32_t top = 0;
+
+    memset(plans, 0, sweep->plans.count * sizeof(perf_tune_plan_t));
+    for (uint32_t i = 0; i < num_buckets; ++i) {
+        int32_t p = buckets[i].winner;
+        uint64_t end = (i + 1 < num_buckets) ? buckets[i + 1].bytes : PERF_TUNE_RANGE_MAX;
+        if (closed[p]) {
+            ++num_lost;
+            p = stack[top - 1];
+        } else if (plans[p].used) {
+            while (stack[top - 1] != p) {
+                closed[stack[--top]] = 1;
+            }
+        } else {
+            plans[p].used = 1;
+            plans[p].start = (i == 0) ? 0 : buckets[i].bytes;
+            plans[p].depth = top;
+            stack[top++] = p;
+        }
+        plans[p].end = end;
+    }
+    return num_lost;
+}
+
+ucg_status_t perf_tune_attr(const ucg_perf_sweep_t *sweep, const char *planc,
+                            char *attr, size_t size)
+{
+    ucg_status_t status = UCG_OK;
+    attr[0] = '\0';
+    if (sweep->num_cases == 0 || sweep->plans.count == 0) {
+        return UCG_ERR_NOT_FOUND;
+    }
+
+    uint64_t *sizes = malloc(sweep->num_cases * sizeof(uint64_t));
+    perf_tune_bucket_t *buckets = malloc(sweep->num_cases * sizeof(perf_tune_bucket_t));
+    perf_tune_plan_t plans[UCG_PERF_MAX_PLANS];
+    if (sizes == NULL || buckets == NULL) {
+        status = UCG_ERR_NO_MEMORY;
+        goto out;
+    }
+
+    uint32_t num_buckets = perf_tune_sizes(sweep, sizes);
+    for (uint32_t i = 0; i < num_buckets; ++i) {
+        buckets[i].bytes = sizes[i];
+        buckets[i].winner = perf_tune_winner(sweep, sizes[i]);
+    }
+    if (!perf_tune_fill_gaps(buckets, num_buckets)) {
+        status = UCG_ERR_NOT_FOUND;
+        goto out;
+    }
+
+    uint32_t num_lost = perf_tune_assign(sweep, buckets, num_buckets, plans);
+    if (num_lost > 0) {
+        fprintf(stderr, "%u %s size ranges are not served by their fastest plan\n",
+                num_lost, ucg_perf_colls[sweep->coll].name);
+    }
+
+    /* Plans are emitted in id order, the nesting is carried by the scores, which
+       are compared across the plancs too. */
+    size_t len = 0;
+    for (uint32_t p = 0; p < sweep->plans.count && len < size; ++p) {
+        if (!plans[p].used || strcmp(sweep->plans.plans[p].planc, planc)) {
+            continue;
+        }
+        len += snprintf(attr + len, size - len, "I:%dS:%uR:%lu-", sweep->plans.plans[p].id,
+                        PERF_TUNE_SCORE_BASE + plans[p].depth, plans[p].start);
+        if (plans[p].end != PERF_TUNE_RANGE_MAX && len < size) {
+            len += snprintf(attr + len, size - len, "%lu", plans[p].end);
+        }
+    }
+    if (len == 0) {
+        status = UCG_ERR_NOT_FOUND;
+    } else if (len >= size) {
+        status = UCG_ERR_NO_MEMORY;
+    }
+
+out:
+    free(buckets);
+    free(sizes);
+    return status;
+}
@@ -1,8 +1,472 @@
 /*
  * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
  */
+#include "ucg_perf.h"
 
-int main(int argc, char ** argv)
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+
+static void usage()
+{
+    printf("Usage: ucg_perf [options]\n");
+    printf("Run collective benchmarks on one host, processes are started by fork().\n");
+    printf("  -n <nprocs>     Number of processes (default: 2)\n");
+    printf("  -N <nnodes>     Number of simulated nodes (default: 1)\n");
+    printf("  -S <nsockets>   Number of simulated sockets per node (default: 1)\n");
+    printf("  -c <colls>      Comma-separated collectives or \"all\" (default: all)\n");
+    printf("                  bcast,allreduce,barrier,alltoallv,scatterv,gatherv,allgatherv\n");
+    printf("  -b <bytes>      Minimum message size, K/M/G suffix allowed (default: 4)\n");
+    printf("  -e <bytes>      Maximum message size, K/M/G suffix allowed (default: 1M)\n");
+    printf("  -f <factor>     Multiplication factor between sizes (default: 2)\n");
+    printf("  -d <dts>        Comma-separated datatypes or \"all\" (default: int32)\n");
+    printf("                  int8,int16,int32,int64,uint8,uint16,uint32,uint64,fp16,fp32,fp64\n");
+    printf("  -o <ops>        Comma-separated reduction ops or \"all\" (default: sum)\n");
+    printf("                  max,min,sum,prod\n");
+    printf("  -r <roots>      Comma-separated roots or \"all\" (default: 0)\n");
+    printf("  -w <warmup>     Number of warmup iterations (default: 10)\n");
+    printf("  -i <iters>      Number of measured iterations (default: 100)\n");
+    printf("  -O <num>        Number of collectives in flight, started together and\n");
+    printf("                  completed by ucg_progress(), they share buffers (default: 1)\n");
+    printf("  -W              Complete the collectives by ucg_request_wait(), which sleeps\n");
+    printf("                  after UCG_WAIT_SPIN_TIME, and report the CPU usage\n");
+    printf("  -C <us>         Compute for the given time between starting and completing\n");
+    printf("                  the collectives, and report how much of it is overlapped.\n");
+    printf("                  Run with UCG_PROGRESS_THREAD=y to progress in background\n");
+    printf("  -T <threads>    Number of threads, each runs the collectives on its own\n");
+    printf("                  group of a multi-thread context, to measure how the\n");
+    printf("                  throughput scales with the threads (default: 1)\n");
+    printf("  -L              Provide the OOB key-value store, so that the addresses are\n");
+    printf("                  looked up when first needed (UCG_LAZY_ADDRESS)\n");
+    printf("  -I              Report the time and memory of ucg_init() over ranks\n");
+    printf("  -p [planc:]id   Force the plan of the given planc (default: ucx) and id\n");
+    printf("                  for the collectives\n");
+    printf("  -s              Sweep all plans and report the fastest per size\n");
+    printf("  -t <file>       Sweep and write the tuned plan attributes to the file\n");
+    printf("  -h              Show this help\n");
+    printf("Latency columns are the min/avg/max over ranks of the per-rank average,\n");
+    printf("which is the time of one collective divided by the number in flight in\n");
+    printf("all threads.\n");
+    return;
+}
+
+static void perf_default_params(ucg_perf_params_t *params)
+{
+    memset(params, 0, sizeof(*params));
+    params->nprocs = 2;
+    params->nnodes = 1;
+    params->nsockets = 1;
+    params->colls = UCG_MASK(UCG_PERF_COLL_LAST);
+    params->min_bytes = 4;
+    params->max_bytes = 1 << 20;
+    params->step_factor = 2;
+    params->warmup = 10;
+    params->iters = 100;
+    params->outstanding = 1;
+    params->num_dts = 1;
+    params->dts[0] = UCG_DT_TYPE_INT32;
+    params->num_ops = 1;
+    params->ops[0] = UCG_OP_TYPE_SUM;
+    params->num_roots = 1;
+    params->roots[0] = 0;
+    params->all_roots = 0;
+    params->sweep = 0;
+    params->plan_id = -1;
+    snprintf(params->plan_planc, sizeof(params->plan_planc), "ucx");
+    params->tune_file = NULL;
+    params->threads = 1;
+    return;
+}
+
+static int perf_parse_size(const char *str, uint64_t *size)
+{
+    char *end;
+    uint64_t value = strtoull(str, &end, 10);
+    switch (*end) {
+        case 'G':
+        case 'g':
+            value <<= 10;
+            /* fall through */
+        case 'M':
+        case 'm':
+            value <<= 10;
+            /* fall through */
+        case 'K':
+        case 'k':
+            value <<= 10;
+            ++end;
+            break;
+        default:
+            break;
+    }
+    if (end == str || *end != '\0') {
+        return -1;
+    }
+    *size = value;
+    return 0;
+}
+
+static int perf_parse_uint(const char *str, uint32_t *value)
+{
+    char *end;
+    unsigned long v = strtoul(str, &end, 10);
+    if (end == str || *end != '\0' || v > UINT32_MAX) {
+        return -1;
+    }
+    *value = (uint32_t)v;
+    return 0;
+}
+
+static int perf_parse_plan(const char *str, ucg_perf_params_t *params)
+{
+    uint32_t id;
+    const char *sep = strchr(str, ':');
+    if (sep != NULL) {
+        size_t len = sep - str;
+        if (len == 0 || len >= sizeof(params->plan_planc)) {
+            return -1;
+        }
+        memcpy(params->plan_planc, str, len);
+        params->plan_planc[len] = '\0';
+        str = sep + 1;
+    }
+    if (perf_parse_uint(str, &id) != 0 || id > INT32_MAX) {
+        return -1;
+    }
+    params->plan_id = (int32_t)id;
+    return 0;
+}
+
+static int perf_parse_colls(char *str, uint64_t *colls)
 {
+    if (!strcasecmp(str, "all")) {
+        *colls = UCG_MASK(UCG_PERF_COLL_LAST);
+        return 0;
+    }
+
+    *colls = 0;
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(str, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        int i;
+        for (i = 0; i < UCG_PERF_COLL_LAST; ++i) {
+            if (!strcasecmp(tok, ucg_perf_colls[i].name)) {
+                *colls |= UCG_BIT(i);
+                break;
+            }
+        }
+        if (i == UCG_PERF_COLL_LAST) {
+            fprintf(stderr, "Unknown collective '%s'\n", tok);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int perf_parse_dts(char *str, ucg_perf_params_t *params)
+{
+    params->num_dts = 0;
+    if (!strcasecmp(str, "all")) {
+        for (int i = 0; i < UCG_DT_TYPE_PREDEFINED_LAST; ++i) {
+            params->dts[params->num_dts++] = ucg_perf_dts[i].type;
+        }
+        return 0;
+    }
+
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(str, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        int i;
+        for (i = 0; i < UCG_DT_TYPE_PREDEFINED_LAST; ++i) {
+            if (!strcasecmp(tok, ucg_perf_dts[i].name)) {
+                break;
+            }
+        }
+        if (i == UCG_DT_TYPE_PREDEFINED_LAST || params->num_dts == UCG_PERF_MAX_DTS) {
+            fprintf(stderr, "Invalid datatype '%s'\n", tok);
+            return -1;
+        }
+        params->dts[params->num_dts++] = ucg_perf_dts[i].type;
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+static int perf_parse_ops(char *str, ucg_perf_params_t *params)
+{
+    params->num_ops = 0;
+    if (!strcasecmp(str, "all")) {
+        for (int i = 0; i < UCG_OP_TYPE_PREDEFINED_LAST; ++i) {
+            params->ops[params->num_ops++] = ucg_perf_ops[i].type;
+        }
+        return 0;
+    }
+
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(str, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        int i;
+        for (i = 0; i < UCG_OP_TYPE_PREDEFINED_LAST; ++i) {
+            if (!strcasecmp(tok, ucg_perf_ops[i].name)) {
+                break;
+            }
+        }
+        if (i == UCG_OP_TYPE_PREDEFINED_LAST || params->num_ops == UCG_PERF_MAX_OPS) {
+            fprintf(stderr, "Invalid op '%s'\n", tok);
+            return -1;
+        }
+        params->ops[params->num_ops++] = ucg_perf_ops[i].type;
+    }
+    return 0;
+}
+
+static int perf_parse_roots(char *str, ucg_perf_params_t *params)
+{
+    params->num_roots = 0;
+    params->all_roots = !strcasecmp(str, "all");
+    if (params->all_roots) {
+        return 0;
+    }
+
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(str, ",", &saveptr); tok != NULL;
+         tok = strtok_r(NULL, ",", &saveptr)) {
+        uint32_t root;
+        if (perf_parse_uint(tok, &root) != 0 || params->num_roots == UCG_PERF_MAX_ROOTS) {
+            fprintf(stderr, "Invalid root '%s'\n", tok);
+            return -1;
+        }
+        params->roots[params->num_roots++] = (ucg_rank_t)root;
+    }
+    return 0;
+}
+
+static int perf_parse_args(int argc, char **argv, ucg_perf_params_t *params)
+{
+    int ret = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:N:S:c:b:e:f:d:o:r:w:i:O:WC:T:LIp:st:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                ret = perf_parse_uint(optarg, &params->nprocs);
+                break;
+            case 'N':
+                ret = perf_parse_uint(optarg, &params->nnodes);
+                break;
+            case 'S':
+                ret = perf_parse_uint(optarg, &params->nsockets);
+                break;
+            case 'c':
+                ret = perf_parse_colls(optarg, &params->colls);
+                break;
+            case 'b':
+                ret = perf_parse_size(optarg, &params->min_bytes);
+                break;
+            case 'e':
+                ret = perf_parse_size(optarg, &params->max_bytes);
+                break;
+            case 'f':
+                ret = perf_parse_uint(optarg, &params->step_factor);
+                break;
+            case 'd':
+                ret = perf_parse_dts(optarg, params);
+                break;
+            case 'o':
+                ret = perf_parse_ops(optarg, params);
+                break;
+            case 'r':
+                ret = perf_parse_roots(optarg, params);
+                break;
+            case 'w':
+                ret = perf_parse_uint(optarg, &params->warmup);
+                break;
+            case 'i':
+                ret = perf_parse_uint(optarg, &params->iters);
+                break;
+            case 'O':
+                ret = perf_parse_uint(optarg, &params->outstanding);
+                break;
+            case 'W':
+                params->wait = 1;
+                break;
+            case 'C':
+                ret = perf_parse_uint(optarg, &params->compute_us);
+                break;
+            case 'T':
+                ret = perf_parse_uint(optarg, &params->threads);
+                break;
+            case 'L':
+                params->lazy_address = 1;
+                break;
+            case 'I':
+                params->report_init = 1;
+                break;
+            case 'p':
+                ret = perf_parse_plan(optarg, params);
+                break;
+            case 's':
+                params->sweep = 1;
+                break;
+            case 't':
+                params->sweep = 1;
+                params->tune_file = optarg;
+                break;
+            case 'h':
+            default:
+                return -1;
+        }
+        if (ret != 0) {
+            fprintf(stderr, "Invalid value '%s' of option -%c\n", optarg, opt);
+            return -1;
+        }
+    }
+
+    if (params->nprocs == 0 || params->nnodes == 0 || params->nsockets == 0 ||
+        params->nnodes > params->nprocs) {
+        fprintf(stderr, "Invalid number of processes, nodes or sockets\n");
+        return -1;
+    }
+    if (params->step_factor < 2 || params->iters == 0 || params->outstanding == 0 ||
+        params->min_bytes > params->max_bytes) {
+        fprintf(stderr, "Invalid size range or iterations\n");
+        return -1;
+    }
+    /* Counts and displacements of v-collectives are int32_t elements. */
+    if (params->max_bytes * params->nprocs > INT32_MAX) {
+        fprintf(stderr, "Maximum message size is too large for %u processes\n",
+                params->nprocs);
+        return -1;
+    }
+    for (uint32_t i = 0; i < params->num_roots; ++i) {
+        if (params->roots[i] >= (ucg_rank_t)params->nprocs) {
+            fprintf(stderr, "Root %d is out of range\n", params->roots[i]);
+            return -1;
+        }
+    }
+    if (params->threads == 0) {
+        fprintf(stderr, "Invalid number of threads\n");
+        return -1;
+    }
+    if (params->threads > 1 && params->compute_us > 0) {
+        fprintf(stderr, "Option -C can not be used with more than one thread\n");
+        return -1;
+    }
+    if (params->sweep && params->plan_id >= 0) {
+        fprintf(stderr, "Option -p can not be used with -s or -t\n");
+        return -1;
+    }
+    return 0;
+}
+
+static ucg_status_t perf_bench_default(const ucg_perf_params_t *params,
+                                       ucg_perf_oob_t *oob)
+{
+    ucg_status_t status;
+    ucg_perf_t perf;
+    UCG_PERF_CHECK_GOTO(perf_init(&perf, params, oob), out);
+    UCG_PERF_CHECK_GOTO(perf_run(&perf), out_cleanup);
+
+out_cleanup:
+    perf_cleanup(&perf);
+out:
+    return status;
+}
+
+static ucg_status_t perf_bench_forced(const ucg_perf_params_t *params,
+                                      ucg_perf_oob_t *oob,
+                                      ucg_perf_coll_type_t coll_type)
+{
+    ucg_status_t status;
+    ucg_perf_t perf;
+    ucg_perf_plans_t plans;
+
+    UCG_PERF_CHECK_GOTO(perf_init(&perf, params, oob), out);
+    UCG_PERF_CHECK_GOTO(perf_plan_query(&perf, coll_type, &plans), out_cleanup);
+    const ucg_perf_plan_t *plan = perf_plan_find(&plans, params->plan_planc,
+                                                 params->plan_id);
+    if (plan == NULL) {
+        fprintf(stderr, "Plan %s:%d of %s is not found\n", params->plan_planc,
+                params->plan_id, ucg_perf_colls[coll_type].name);
+        status = UCG_ERR_NOT_FOUND;
+        goto out_cleanup;
+    }
+    UCG_PERF_CHECK_GOTO(perf_plan_force(&perf, coll_type, plan), out_cleanup);
+    if (oob->myrank == 0) {
+        printf("# Forced %s plan %s:%d (%s)\n", ucg_perf_colls[coll_type].name,
+               plan->planc, plan->id, plan->name);
+    }
+    UCG_PERF_CHECK_GOTO(perf_run_coll(&perf, coll_type), out_unforce);
+
+out_unforce:
+    perf_plan_unforce(&perf, coll_type);
+out_cleanup:
+    perf_cleanup(&perf);
+out:
+    return status;
+}
+
+static ucg_status_t perf_bench(const ucg_perf_params_t *params, ucg_perf_oob_t *oob)
+{
+    if (params->sweep) {
+        return perf_sweep(params, oob);
+    }
+
+    if (params->plan_id < 0) {
+        return perf_bench_default(params, oob);
+    }
+
+    ucg_status_t status;
+    for (int c = 0; c < UCG_PERF_COLL_LAST; ++c) {
+        if (!(params->colls & UCG_BIT(c))) {
+            continue;
+        }
+        status = perf_bench_forced(params, oob, (ucg_perf_coll_type_t)c);
+        if (status != UCG_OK) {
+            return status;
+        }
+    }
+    return UCG_OK;
+}
+
+static int perf_rank_main(const ucg_perf_params_t *params, ucg_perf_oob_t *oob)
+{
+    ucg_status_t status;
+    ucg_global_params_t global_params;
+    global_params.field_mask = 0;
+    status = ucg_global_init(&global_params);
+    if (status != UCG_OK) {
+        fprintf(stderr, "Rank %d failed to initialize UCG\n", oob->myrank);
+        return -1;
+    }
+
+    status = perf_bench(params, oob);
+    ucg_global_cleanup();
+    return status == UCG_OK ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+    ucg_perf_params_t params;
+    perf_default_params(&params);
+    if (perf_parse_args(argc, argv, &params) != 0) {
+        usage();
+        return -1;
+    }
+
+    ucg_perf_oob_t oob;
+    int is_launcher;
+    if (perf_oob_launch(&params, &oob, &is_launcher) != UCG_OK) {
+        return -1;
+    }
+
+    if (is_launcher) {
+        int ret = perf_oob_wait(&oob);
+        perf_oob_finalize(&oob);
+        return ret;
+    }
+
+    int ret = perf_rank_main(&params, &oob);
+    perf_oob_finalize(&oob);
+    return ret;
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2022-2022. All rights reserved.
+ */
+
+#ifndef UCG_PERF_H_
+#define UCG_PERF_H_
+
+#include <ucg/api/ucg.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define UCG_PERF_MAX_DTS        UCG_DT_TYPE_PREDEFINED_LAST
+#define UCG_PERF_MAX_OPS        UCG_OP_TYPE_PREDEFINED_LAST
+#define UCG_PERF_MAX_ROOTS      64
+#define UCG_PERF_MAX_PLANS      32
+#define UCG_PERF_MAX_PLANC_LEN  16
+#define UCG_PERF_MAX_ATTR_LEN   4096
+#define UCG_PERF_OOB_SLOT_SIZE  65536
+#define UCG_PERF_OOB_KVS_SIZE   16384
+
+#define UCG_PERF_CHECK_GOTO(_stmt, _label) \
+    do { \
+        status = _stmt; \
+        if (status != UCG_OK) { \
+            fprintf(stderr, "[%s:%d]Failed to %s, %s\n", __FILE__, __LINE__, #_stmt, \
+                    ucg_status_string(status)); \
+            goto _label; \
+        } \
+    } while(0)
+
+typedef enum {
+    UCG_PERF_COLL_BCAST,
+    UCG_PERF_COLL_ALLREDUCE,
+    UCG_PERF_COLL_BARRIER,
+    UCG_PERF_COLL_ALLTOALLV,
+    UCG_PERF_COLL_SCATTERV,
+    UCG_PERF_COLL_GATHERV,
+    UCG_PERF_COLL_ALLGATHERV,
+    UCG_PERF_COLL_LAST,
+} ucg_perf_coll_type_t;
+
+enum {
+    UCG_PERF_COLL_FLAG_ROOTED = UCG_BIT(0), /* The collective has a root. */
+    UCG_PERF_COLL_FLAG_REDUCE = UCG_BIT(1), /* The collective has a reduction op. */
+    UCG_PERF_COLL_FLAG_NO_DATA = UCG_BIT(2), /* The collective moves no data. */
+    UCG_PERF_COLL_FLAG_NO_MSG_SIZE = UCG_BIT(3), /* Plan selection ignores the message size. */
+};
+
+/**
+ * @brief Shared memory segment used by the fork-based OOB group.
+ *
+ * The segment is mapped before fork(), so every rank sees the same pages.
+ * Data is exchanged through one slot of UCG_PERF_OOB_SLOT_SIZE bytes per rank.
+ * The slots are followed by one key-value entry of UCG_PERF_OOB_KVS_SIZE bytes
+ * per rank, which starts with the size of the published data.
+ */
+typedef struct ucg_perf_shm {
+    uint32_t count; /* Number of ranks arrived at the barrier */
+    uint32_t sense; /* Barrier generation flag */
+    int32_t abort; /* Set by the launcher when any rank died */
+    uint32_t padding;
+    uint8_t slots[];
+} ucg_perf_shm_t;
+
+typedef struct ucg_perf_oob {
+    ucg_rank_t myrank;
+    uint32_t size;
+    uint32_t nnodes;
+    uint32_t nsockets;
+    uint32_t sense;
+    ucg_perf_shm_t *shm;
+    size_t shm_size;
+    pid_t *pids; /* Only valid in the launcher */
+} ucg_perf_oob_t;
+
+typedef struct ucg_perf_params {
+    uint32_t nprocs;
+    uint32_t nnodes;
+    uint32_t nsockets; /* Number of sockets per node */
+    uint64_t colls; /* Bitmap of ucg_perf_coll_type_t */
+    uint64_t min_bytes;
+    uint64_t max_bytes;
+    uint32_t step_factor;
+    uint32_t warmup;
+    uint32_t iters;
+    uint32_t outstanding; /* Number of collectives in flight in each iteration */
+    int wait; /* Complete the collectives by ucg_request_wait() */
+    uint32_t compute_us; /* Busy time between starting and completing the collectives */
+    int lazy_address; /* Provide the OOB key-value store to look up addresses lazily */
+    int report_init; /* Report the time and memory of ucg_init() */
+    uint32_t num_dts;
+    ucg_dt_type_t dts[UCG_PERF_MAX_DTS];
+    uint32_t num_ops;
+    ucg_op_type_t ops[UCG_PERF_MAX_OPS];
+    uint32_t num_roots;
+    ucg_rank_t roots[UCG_PERF_MAX_ROOTS];
+    int all_roots;
+    int sweep; /* Measure every plan instead of the default selection */
+    int32_t plan_id; /* Plan to force, negative means the default selection */
+    char plan_planc[UCG_PERF_MAX_PLANC_LEN]; /* Planc of the plan to force */
+    const char *tune_file; /* Where to write the tuned plan attributes of a sweep */
+    uint32_t threads; /* Number of threads, each runs the collectives on its own group */
+} ucg_perf_params_t;
+
+/**
+ * @brief One benchmark case, i.e. one row of the output table.
+ */
+typedef struct ucg_perf_case {
+    ucg_perf_coll_type_t coll;
+    uint64_t bytes; /* Message size per peer block */
+    int32_t count; /* Number of elements per peer block */
+    ucg_dt_type_t dt_type;
+    ucg_op_type_t op_type;
+    ucg_rank_t root;
+} ucg_perf_case_t;
+
+/**
+ * @brief Result of one case, reduced over all ranks.
+ */
+typedef struct ucg_perf_result {
+    ucg_status_t status;
+    double min_us;
+    double avg_us;
+    double max_us;
+    double algbw; /* GB/s */
+    double busbw; /* GB/s */
+    double cpu; /* Average over ranks of CPU time per wall time, in percent */
+    double overlap; /* Average over ranks of the hidden part of the shorter of
+                       collective and compute time, in percent */
+} ucg_perf_result_t;
+
+typedef struct ucg_perf {
+    const ucg_perf_params_t *params;
+    ucg_perf_oob_t *oob;
+    ucg_context_h context;
+    ucg_group_h group;
+    ucg_dt_h dts[UCG_DT_TYPE_PREDEFINED_LAST];
+    ucg_op_h ops[UCG_OP_TYPE_PREDEFINED_LAST];
+    void *sendbuf;
+    void *recvbuf;
+    uint64_t buf_size;
+    int32_t *counts;
+    int32_t *displs;
+    /* Group and buffers of the threads other than the first one, params->threads - 1
+       entries sharing the context, NULL if single thread. */
+    struct ucg_perf *workers;
+} ucg_perf_t;
+
+typedef struct ucg_perf_plan {
+    char planc[UCG_PERF_MAX_PLANC_LEN];
+    int32_t id;
+    char name[64];
+} ucg_perf_plan_t;
+
+/**
+ * @brief Plans that can serve one collective, sorted by planc and id.
+ */
+typedef struct ucg_perf_plans {
+    uint32_t count;
+    ucg_perf_plan_t plans[UCG_PERF_MAX_PLANS];
+} ucg_perf_plans_t;
+
+/**
+ * @brief Latency of every case under the default selection and every plan.
+ */
+typedef struct ucg_perf_sweep {
+    ucg_perf_coll_type_t coll;
+    uint32_t num_cases;
+    ucg_perf_case_t *cases;
+    ucg_perf_plans_t plans;
+    /* [plans.count + 1][num_cases] average latency in us, column 0 is the default
+       selection, negative if the case is unsupported. */
+    double *latency;
+} ucg_perf_sweep_t;
+
+typedef ucg_status_t (*ucg_perf_coll_init_func_t)(ucg_perf_t *perf,
+                                                  const ucg_perf_case_t *pcase,
+                                                  ucg_request_h *request);
+
+typedef struct ucg_perf_coll {
+    const char *name;
+    uint64_t flags;
+    ucg_perf_coll_init_func_t init;
+    /* The ratio of bus bandwidth to algorithm bandwidth. */
+    double (*busbw_factor)(uint32_t nprocs);
+    /* Total bytes moved by one rank, used to compute algorithm bandwidth. */
+    uint64_t (*total_bytes)(uint64_t bytes, uint32_t nprocs);
+} ucg_perf_coll_t;
+
+typedef struct ucg_perf_dt {
+    const char *name;
+    ucg_dt_type_t type;
+    uint32_t size;
+} ucg_perf_dt_t;
+
+typedef struct ucg_perf_op {
+    const char *name;
+    ucg_op_type_t type;
+} ucg_perf_op_t;
+
+extern const ucg_perf_coll_t ucg_perf_colls[UCG_PERF_COLL_LAST];
+extern const ucg_perf_dt_t ucg_perf_dts[UCG_DT_TYPE_PREDEFINED_LAST];
+extern const ucg_perf_op_t ucg_perf_ops[UCG_OP_TYPE_PREDEFINED_LAST];
+
+/* Fork-based out-of-band bootstrap */
+ucg_status_t perf_oob_launch(const ucg_perf_params_t *params, ucg_perf_oob_t *oob,
+                             int *is_launcher);
+int perf_oob_wait(ucg_perf_oob_t *oob);
+void perf_oob_finalize(ucg_perf_oob_t *oob);
+void perf_oob_barrier(ucg_perf_oob_t *oob);
+ucg_status_t perf_oob_allgather(const void *sendbuf, void *recvbuf,
+                                int32_t count, void *group);
+ucg_status_t perf_oob_get_location(ucg_rank_t rank, ucg_location_t *location);
+void perf_oob_fill_group(ucg_perf_oob_t *oob, ucg_oob_group_t *oob_group);
+void perf_oob_fill_kvs(ucg_perf_oob_t *oob, ucg_oob_kvs_t *oob_kvs);
+
+/* Context, group and buffers */
+ucg_status_t perf_init(ucg_perf_t *perf, const ucg_perf_params_t *params,
+                       ucg_perf_oob_t *oob);
+void perf_cleanup(ucg_perf_t *perf);
+
+/* Benchmark driver */
+ucg_status_t perf_run_case(ucg_perf_t *perf, const ucg_perf_case_t *pcase,
+                           ucg_perf_result_t *result);
+uint32_t perf_make_cases(const ucg_perf_params_t *params, ucg_perf_coll_type_t coll_type,
+                         ucg_perf_case_t *cases);
+int perf_is_same_series(const ucg_perf_case_t *case1, const ucg_perf_case_t *case2);
+int perf_is_root(const ucg_perf_t *perf);
+void perf_print_series(const ucg_perf_params_t *params, const char *title,
+                       const ucg_perf_case_t *pcase);
+ucg_status_t perf_run_coll(ucg_perf_t *perf, ucg_perf_coll_type_t coll_type);
+ucg_status_t perf_run(ucg_perf_t *perf);
+
+/* Plan enumeration and forcing, forcing applies to the requests created afterwards */
+ucg_status_t perf_plan_query(ucg_perf_t *perf, ucg_perf_coll_type_t coll_type,
+                             ucg_perf_plans_t *plans);
+const ucg_perf_plan_t *perf_plan_find(const ucg_perf_plans_t *plans, const char *planc,
+                                      int32_t id);
+ucg_status_t perf_plan_force(ucg_perf_t *perf, ucg_perf_coll_type_t coll_type,
+                             const ucg_perf_plan_t *plan);
+void perf_plan_unforce(ucg_perf_t *perf, ucg_perf_coll_type_t coll_type);
+void perf_plan_env_name(ucg_perf_coll_type_t coll_type, const char *planc,
+                        char *name, size_t size);
+
+/* Plan sweep */
+ucg_status_t perf_sweep_coll(const ucg_perf_params_t *params, ucg_perf_oob_t *oob,
+                             ucg_perf_coll_type_t coll_type, ucg_perf_sweep_t *sweep);
+int32_t perf_sweep_best(const ucg_perf_sweep_t *sweep, uint32_t case_idx,
+                        double *best_latency);
+void perf_sweep_cleanup(ucg_perf_sweep_t *sweep);
+ucg_status_t perf_sweep(const ucg_perf_params_t *params, ucg_perf_oob_t *oob);
+
+/* Plan attribute of the sweep winners of the planc, "I:<id>S:<score>R:<start>-<end>..." */
+ucg_status_t perf_tune_attr(const ucg_perf_sweep_t *sweep, const char *planc,
+                            char *attr, size_t size);
+
+#endif